@@ -13,7 +13,11 @@
 #include "BCRexternalBWT.hh"
 
 #include "BWTCollection.hh"
+#include "BwtIndex.hh"
+#include "BwtRankIndex.hh"
 #include "Filename.hh"
+#include "LcpFile.hh"
+#include "SampledSuffixArray.hh"
 #include "Tools.hh"
 #include "TransposeFasta.hh"
 #include "parameters/BwtParameters.hh"
@@ -46,7 +50,11 @@ using SXSI::BWTCollection;
  * Constructor inits
  */
 BCRexternalBWT::BCRexternalBWT ( const string &file1, const string &fileOutput, const int mode, const CompressionFormatType outputCompression, ToolParameters *toolParams )
-    : toolParams_( toolParams, emptyDeleter() )
+    : cyclesInRam_( NULL )
+    , bclRunFolder_( NULL )
+    , profiler_( NULL )
+    , appendedSeqCount_( 0 )
+    , toolParams_( toolParams, emptyDeleter() )
     , bwtParams_( 0 )
     , unbwtParams_( 0 )
     , searchParams_( 0 )
@@ -97,6 +105,20 @@ BCRexternalBWT::BCRexternalBWT ( const string &file1, const string &fileOutput,
 
         if ( bwtParams_->getValue( PARAMETER_GENERATE_ENDPOSFILE ) || BUILD_SA )
         {
+            if ( ( *bwtParams_ )[PARAMETER_APPEND_TO].isSet() )
+            {
+                // The existing file gets extended, possibly in place, so we read from a copy of it
+                Filename existingFileEndPos( bwtParams_->getStringValue( PARAMETER_APPEND_TO ).c_str(), "-end-pos" );
+                TmpFilename fileEndPosCopy( "append-end-pos" );
+                ifstream is( existingFileEndPos.str().c_str(), ios::binary );
+                ofstream os( fileEndPosCopy.str().c_str(), ios::binary );
+                if ( !is.good() || !( os << is.rdbuf() ) )
+                {
+                    cerr << "Error copying " << existingFileEndPos << " to " << fileEndPosCopy << endl;
+                    exit ( EXIT_FAILURE );
+                }
+            }
+
             // we make sure that this file does not exist, to avoid reading an old version
             Filename fileEndPos( bwtParams_->getStringValue( "output filename" ).c_str(), "-end-pos" );
             remove( fileEndPos );
@@ -225,6 +247,26 @@ BCRexternalBWT::BCRexternalBWT ( const string &file1, const string &fileOutput,
                 Filename newFilename( fileOutput, "-B0", g, "" );
                 safeRename( filename, newFilename );
 
+                // Index files of the BWT we appended to are rebuilt, with beetl-index's default block size
+                if ( bwtParams_ && ( *bwtParams_ )[PARAMETER_APPEND_TO].isSet()
+                     && bwtParams_->getValue( PARAMETER_OUTPUT_FORMAT ) == OUTPUT_FORMAT_RLE )
+                {
+                    Filename existingIndexFilename( bwtParams_->getStringValue( PARAMETER_APPEND_TO ).c_str(), "-B0", g, ".idx" );
+                    if ( readWriteCheck( existingIndexFilename, false, false ) )
+                    {
+                        Filename indexFilename( fileOutput, "-B0", g, ".idx" );
+                        unique_ptr<BwtReaderBase> pReader( instantiateBwtPileReader( newFilename.str(), "", false, true ) );
+                        FILE *pIndexFile = fopen( indexFilename, "wb" );
+                        if ( pIndexFile == NULL )
+                        {
+                            cerr << "Error opening " << indexFilename << " for writing" << endl;
+                            exit ( EXIT_FAILURE );
+                        }
+                        buildIndex( pReader.get(), pIndexFile, 2048 );
+                        fclose( pIndexFile );
+                    }
+                }
+
                 if ( hasProcessedQualities )
                 {
                     TmpFilename qualFilename( "", g, ".qual" );
@@ -245,14 +287,24 @@ BCRexternalBWT::BCRexternalBWT ( const string &file1, const string &fileOutput,
                     if ( remove( filenameIn ) != 0 )
                         perror( ( "BCRexternalBWT: Error deleting file " + filenameIn.str() ).c_str() );
                 }
-                else   //rename the aux lcp file
+                else   //decode the aux lcp file to the 4-byte output format
                 {
                     Filename newFilename( fileOutput, "-L0", g, "" );
-                    safeRename( filenameIn, newFilename );
+                    convertLcpFileToRaw( filenameIn.str(), newFilename.str() );
+                    if ( remove( filenameIn ) != 0 )
+                        perror( ( "BCRexternalBWT: Error deleting file " + filenameIn.str() ).c_str() );
                 }
             }
         }
 
+        // Sampled suffix array: far smaller than the full one (BUILD_SA), computed from the final BWT piles
+        if ( deletePartialBWT != 1 && ( *bwtParams_ )[PARAMETER_SA_SAMPLING_RATE].isSet() )
+        {
+            Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Sampling the suffix array\n";
+            RankIndexedBwt bwt( fileOutput );
+            SampledSuffixArray::build( bwt, fileOutput, bwtParams_->getValue( PARAMETER_SA_SAMPLING_RATE ) );
+        }
+
         /*  std::cerr << "Removing/Renaming the SA segments\n";
                 for (AlphabetSymbol g = 0 ; g < alphabetSize; g++) {
                     Filename filenameIn( "sa_", g );
@@ -300,6 +352,7 @@ BCRexternalBWT::BCRexternalBWT ( const string &file1, const string &fileOutput,
             unbwtParams_.reset( new UnbwtParameters );
             ( *unbwtParams_ )[PARAMETER_DECODE_DIRECTION] = DECODE_DIRECTION_BACKWARD;
             ( *unbwtParams_ )[PARAMETER_USE_VECTOR] = USE_VECTOR_ON;
+            ( *unbwtParams_ )[PARAMETER_DECODE_METHOD] = DECODE_METHOD_RANK_INDEX;
         }
 
         std::cerr << "Start BCR decode\n";
@@ -1148,8 +1201,8 @@ int BCRexternalBWT::backwardSearchManyBCR( char const *file1, char const *fileOu
             if ( LastVector[i].posN >= FirstVector[i].posN ) //if not, the kmer is not in the collection
                 symbols[FirstVector[i].seqN] = kmers[FirstVector[i].seqN][posSymb - 1];
 
-        quickSort( FirstVector );
-        quickSort( LastVector );
+        sortByPileAndPosition( FirstVector );
+        sortByPileAndPosition( LastVector );
 
         //For each symbol in the kmer we have to update First and Last
         int resultCompute = computeManyNewPositionForBackSearchByVector ( file1, fileOutBwt, symbols, kmers.size() );
@@ -1500,6 +1553,13 @@ int BCRexternalBWT::initializeUnbuildBCR( char const *file1, char const *fileOut
 int BCRexternalBWT::unbuildBCR( char const *file1, char const *fileOutBwt, char const *fileOut, char const *fileOutput )
 {
     bool processQualities = hasSuffix( fileOutput, ".fastq" );
+    if ( unbwtParams_->getValue( BeetlUnbwtParameters::PARAMETER_DECODE_DIRECTION ) == BeetlUnbwtParameters::DECODE_DIRECTION_BACKWARD
+         && unbwtParams_->getValue( BeetlUnbwtParameters::PARAMETER_DECODE_METHOD ) == BeetlUnbwtParameters::DECODE_METHOD_RANK_INDEX )
+    {
+        std::cerr << "Inverse BWT by Backward direction, using rank-indexed piles." << std::endl;
+        return decodeBCRwithRankIndex( file1, fileOutput, processQualities );
+    }
+
     LetterNumber freq[256];  //contains the distribution of the symbols.
     int resultInit = initializeUnbuildBCR( file1, fileOutBwt, freq );
     checkIfEqual ( resultInit, 1 );
@@ -1633,7 +1693,7 @@ vector <int> BCRexternalBWT::recoverNSequenceForward( char const *file1, char co
     }
     std::cerr << "We want to compute the seqID of " << numTotKmers  << " sequences." << std::endl;
 
-    quickSort( vectTriple );
+    sortByPileAndPosition( vectTriple );
     uchar *toFindSymbols = new uchar[numTotKmers];  //Symbol to find for each kmers
     SequenceNumber h;
     for ( h = 0 ; h < numTotKmers; h++ )
@@ -1679,7 +1739,7 @@ vector <int> BCRexternalBWT::recoverNSequenceForward( char const *file1, char co
             }
         }
         */
-        quickSort( vectTriple );
+        sortByPileAndPosition( vectTriple );
         //Update toFindSymbol and count the dollars
         countDollars = 0;
         for ( h = 0 ; h < numTotKmers; h++ )
@@ -2012,6 +2072,98 @@ int BCRexternalBWT::decodeBCRmultipleReverse( char const *file1, char const *fil
     return true;
 }
 
+//The piles stay in RAM as rank indexes (mmap'ed RLE or ASCII files plus occurrence samples),
+//so that each sequence can be decoded on its own by following the LF-mapping from its '$' back to its first symbol.
+//Blocks of sequences are decoded in parallel, and written in sequence order without intermediate cycle files.
+int BCRexternalBWT::decodeBCRwithRankIndex( char const *file1, char const *fileOutput, bool processQualities )
+{
+    RankIndexedBwt bwt( file1 );
+    const SequenceNumber seqCount = bwt.pile( 0 ).size();
+    Logger::out() << "Decoding " << seqCount << " sequences" << endl;
+
+    vector< vector<char> > qualities( processQualities ? alphabetSize : 0 );
+    for ( unsigned int pileNum = 0; pileNum < qualities.size(); ++pileNum )
+    {
+        Filename qualFilename( file1, "-Q0", pileNum );
+        FILE *InFileBWTQual = fopen( qualFilename, "rb" );
+        if ( InFileBWTQual == NULL )
+        {
+            std::cerr << "decodeBCRwithRankIndex: could not open file " << qualFilename << " !" << std::endl;
+            exit ( EXIT_FAILURE );
+        }
+        qualities[pileNum].resize( bwt.pile( pileNum ).size() );
+        const LetterNumber numcharRead = qualities[pileNum].empty() ? 0 : fread( &qualities[pileNum][0], sizeof( char ), qualities[pileNum].size(), InFileBWTQual );
+        checkIfEqual( numcharRead, qualities[pileNum].size() );
+        fclose( InFileBWTQual );
+    }
+
+    ofstream outFile( fileOutput );
+    if ( outFile.is_open() == false )
+    {
+        std::cerr << "decodeBCRwithRankIndex: could not open file " << fileOutput << " !" << std::endl;
+        exit ( EXIT_FAILURE );
+    }
+
+    const SequenceNumber blockSize = 1 << 16;
+    vector<string> sequences( min( seqCount, blockSize ) );
+    vector<string> sequenceQualities( processQualities ? sequences.size() : 0 );
+    for ( SequenceNumber blockStart = 0; blockStart < seqCount; blockStart += blockSize )
+    {
+        const SequenceNumber blockEnd = min( seqCount, blockStart + blockSize );
+        Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Decoding sequences " << blockStart << " to " << blockEnd - 1 << endl;
+
+        // Each sequence starts from its '$' sign, at position seqNum of pile 0
+        #pragma omp parallel for schedule(dynamic, 256)
+        for ( SequenceNumber seqNum = blockStart; seqNum < blockEnd; ++seqNum )
+        {
+            string &sequence = sequences[seqNum - blockStart];
+            sequence.clear();
+            int pileNum = 0;
+            LetterNumber pos = seqNum;
+            if ( processQualities )
+            {
+                string &quality = sequenceQualities[seqNum - blockStart];
+                quality.clear();
+                while ( true )
+                {
+                    const char qualityChar = qualities[pileNum][pos];
+                    const int letterPile = bwt.stepBackward( pileNum, pos );
+                    if ( letterPile == 0 )
+                        break;
+                    sequence.push_back( alphabet[letterPile] );
+                    quality.push_back( qualityChar );
+                }
+                reverse( quality.begin(), quality.end() );
+            }
+            else
+            {
+                int letterPile;
+                while ( ( letterPile = bwt.stepBackward( pileNum, pos ) ) != 0 )
+                    sequence.push_back( alphabet[letterPile] );
+            }
+            reverse( sequence.begin(), sequence.end() );
+        }
+
+        for ( SequenceNumber seqNum = blockStart; seqNum < blockEnd; ++seqNum )
+        {
+            if ( processQualities )
+            {
+                outFile << "@Read" << seqNum << '\n';
+                outFile << sequences[seqNum - blockStart] << '\n';
+                outFile << "+\n";
+                outFile << sequenceQualities[seqNum - blockStart] << '\n';
+            }
+            else
+            {
+                outFile << "> Read " << seqNum << '\n';
+                outFile << sequences[seqNum - blockStart] << '\n';
+            }
+        }
+    }
+
+    return true;
+}
+
 //It is used to reconstruct m sequences backwards by threading through the FL-mapping and reading the characters off of L.
 int BCRexternalBWT::RecoverNsymbolsReverse( char const *file1, char const *fileOutBwt, uchar *newSymb, uchar *newQual )
 {
@@ -2132,7 +2284,7 @@ int BCRexternalBWT::RecoverNsymbolsReverse( char const *file1, char const *fileO
         std::cerr << std::endl;
     }
 
-    quickSort( vectTriple );
+    sortByPileAndPosition( vectTriple );
 
     if ( verboseDecode == 1 )
     {
@@ -2335,7 +2487,7 @@ int BCRexternalBWT::RecoverNsymbolsReverseByVector( char const *file1, char cons
         std::cerr << std::endl;
     }
 
-    quickSort( vectTriple );
+    sortByPileAndPosition( vectTriple );
 
     if ( verboseDecode == 1 )
     {
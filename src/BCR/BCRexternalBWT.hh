@@ -15,15 +15,18 @@
 
 #include "BWTCollection.hh"
 #include "BwtReader.hh"
+#include "BwtWriter.hh"
 #include "libzoo/cli/ToolParameters.hh"
-#include "shared/FragmentedVector.hh"
 
 #include <fstream>
 #include <iostream>
 #include <map>
 
 
+class BclRunFolder;
+class PhaseProfiler;
 class SearchParameters;
+class TransposeFasta;
 
 
 class BCRexternalBWT : public SXSI::BWTCollection
@@ -40,6 +43,7 @@ public:
     int backwardSearchBCR( char const * , char const * , char const * , char const * );
     int decodeBCRnaiveForward( char const *, char const *, char const * ); //Inverse BWT by Forward direction of nText sequences, one sequence at a time, in lexicographic order.
     int decodeBCRmultipleReverse( char const *, char const *, char const *, bool processQualities = false ); //Inverse BWT by Backward direction of nText sequences at the same time by lengthRead iterations.
+    int decodeBCRwithRankIndex( char const *file1, char const *fileOutput, bool processQualities = false ); //Inverse BWT by Backward direction, with rank-indexed piles in RAM and blocks of sequences decoded in parallel.
     int Recover1symbolReverse( char const * , char const * , uchar *, sortElement * );
     int RecoverNsymbolsReverse( char  const *, char const *, uchar *, uchar *newQual = 0 );
     int RecoverNsymbolsReverseByVector( char const *file1, char const *fileOutBwt, uchar *newSymb, uchar *newQual = 0 );
@@ -48,6 +52,7 @@ public:
     int recoverNSequenceForwardSequentially( char const * , char const *, SequenceNumber );
     void storeBWT( uchar const *, uchar const *qual = NULL );
     void storeBWT_parallelPile( uchar const *newSymb, uchar const *newQual, unsigned int parallelPile, SequenceNumber startIndex, SequenceNumber endIndex );
+    void storeBWTandLCP_parallelPile( uchar const *newSymb, const AlphabetSymbol currentPile, const SequenceNumber startIndex, const SequenceNumber endIndex );
     void storeEntireBWT( const string & );
     void storeSA( SequenceLength );
     void storeEntirePairSA( const char * );
@@ -66,8 +71,9 @@ public:
     int SearchAndLocateKmer ( char const * , char const * , char const * , vector<string> , SequenceLength , vector <int> & );
 private:
     void InsertNsymbols( uchar const *, SequenceLength, uchar const *qual = NULL );
-    void InsertNsymbols_parallelPile( uchar const *newSymb, SequenceLength posSymb, uchar const *newQual, unsigned int parallelPile, SequenceNumber startIndex, SequenceNumber endIndex, vector< FragmentedVector< sortElement > > &newVectTriplePerNewPile );
+    void InsertNsymbols_parallelPile( uchar const *newSymb, SequenceLength posSymb, uchar const *newQual, unsigned int parallelPile, SequenceNumber startIndex, SequenceNumber endIndex, SortElementStore &newTriples, SequenceNumber *newPileCounts, const BwtFileSample *startSample = NULL );
     void InitialiseTmpFiles();
+    void InitialiseTmpFilesFromExistingBwt( const string &prefix );
     void InsertFirstsymbols( uchar const *, uchar const *qual = NULL, const int subSequenceNum = 0 );
     int initializeUnbuildBCR( char const *, char const *, LetterNumber [] );
     int computeNewPositionForBackSearch ( char const *, char const *, uchar );
@@ -89,6 +95,14 @@ private:
     void writeEndPosFile( const uint8_t subSequenceNum, const bool lastFile );
 
     BwtWriterBase *pWriterBwt0_; // persistent file, as we only ever need to append (never insert) characters to it
+    const TransposeFasta *cyclesInRam_; // source of the cycles during buildBCR, when not read from cycle files
+    const BclRunFolder *bclRunFolder_; // source of the cycles during buildBCR, when read from the BCL files of a run folder
+    PhaseProfiler *profiler_; // phase timings of buildBCR, NULL unless --profile is set
+    SequenceNumber appendedSeqCount_; // number of sequences of the existing BWT that we append to (--append-to)
+    vector< vector<BwtFileSample> > pileSamples_; // [pile] samples of the intermediate BWT files, used to split their processing between threads
+    vector< vector<BwtFileSample> > newPileSamples_; // [pile] samples of the "new_" files being written
+    SortElementStore triples_; // vectTriple of the BCR construction, one array per field
+    SortElementStore newTriples_; // triples_ entries updated by InsertNsymbols, before their redistribution by new pile
     shared_ptr< ToolParameters > toolParams_;
     shared_ptr< BwtParameters > bwtParams_;
     shared_ptr< UnbwtParameters > unbwtParams_;
@@ -15,17 +15,22 @@
 #include "BwtReader.hh"
 #include "BwtWriter.hh"
 #include "Filename.hh"
+#include "LcpFile.hh"
 #include "LetterCount.hh"
+#include "PhaseProfiler.hh"
 #include "PredictiveEncoding.hh"
 #include "SeqReader.hh"
 #include "Timer.hh"
 #include "Tools.hh"
 #include "TransposeFasta.hh"
+#include "libzoo/io/Bcl.hh"
 #include "libzoo/util/Logger.hh"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <limits>
 #include <unistd.h>
 #include <sys/stat.h>
 
@@ -44,7 +49,28 @@ vector<char> whichPileSAP;
 
 
 #define SIZEBUFFER 1024 // TBD get rid of this
+const LetterNumber pileSampleInterval = 1 << 16; // letters between two samples of the intermediate BWT files
 unsigned int debugCycle = 0;
+
+namespace
+{
+
+// Range of vectTriple entries of one pile processed by one thread in InsertNsymbols
+struct PileSegment
+{
+    int pile;
+    SequenceNumber startIndex;
+    SequenceNumber endIndex;
+    const BwtFileSample *startSample; // NULL: start of the pile file
+};
+
+bool isBeforeSample( const LetterNumber letterPos, const BwtFileSample &sample )
+{
+    return letterPos < sample.letterPos;
+}
+
+} // anonymous namespace
+
 unsigned int lastDefragCycle = 0;
 Timer timer;
 
@@ -116,23 +142,37 @@ void BCRexternalBWT::ReadFilesForCycle( const char *prefix, const SequenceLength
             cycle = readLength - 1 - cycle1;
         }
 
-        Filename filename( prefix, cycle, "" );
-        Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Opening file " << filename << " for reading" << endl;
-        FILE *InFileInputText = fopen( filename, "rb" );
-        if ( InFileInputText == NULL )
+        if ( cyclesInRam_ != NULL )
         {
-            cerr << filename << " : Error opening " << endl;
-            exit ( EXIT_FAILURE );
+            // Cycles (and qualities) kept in RAM by TransposeFasta
+            checkIfEqual( cyclesInRam_->nSeq, count );
+            cyclesInRam_->readCycleFromRam( cycle, newSymb + ( revComp ? count : 0 ), processQualities ? newQual + ( revComp ? count : 0 ) : NULL );
         }
-        //#define ALL_A_FOR_DEBUGGING
+        else if ( bclRunFolder_ != NULL )
+        {
+            // Cycles (and qualities) decoded straight from the BCL files
+            bclRunFolder_->readCycle( cycle + 1, newSymb + ( revComp ? count : 0 ), processQualities ? newQual + ( revComp ? count : 0 ) : NULL );
+        }
+        else
+        {
+            Filename filename( prefix, cycle, "" );
+            Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Opening file " << filename << " for reading" << endl;
+            FILE *InFileInputText = fopen( filename, "rb" );
+            if ( InFileInputText == NULL )
+            {
+                cerr << filename << " : Error opening " << endl;
+                exit ( EXIT_FAILURE );
+            }
+            //#define ALL_A_FOR_DEBUGGING
 #ifdef ALL_A_FOR_DEBUGGING
-        for ( SequenceNumber i = 0; i < count; ++i )
-            newSymb[i + ( revComp ? count : 0 )] = 'A';
+            for ( SequenceNumber i = 0; i < count; ++i )
+                newSymb[i + ( revComp ? count : 0 )] = 'A';
 #else
-        SequenceNumber num = fread( newSymb + ( revComp ? count : 0 ), sizeof( uchar ), count, InFileInputText );
-        checkIfEqual( num, count ); // we should always read the same number of characters
+            SequenceNumber num = fread( newSymb + ( revComp ? count : 0 ), sizeof( uchar ), count, InFileInputText );
+            checkIfEqual( num, count ); // we should always read the same number of characters
 #endif
-        fclose( InFileInputText );
+            fclose( InFileInputText );
+        }
 
         if ( revComp == 1 )
         {
@@ -164,7 +204,7 @@ void BCRexternalBWT::ReadFilesForCycle( const char *prefix, const SequenceLength
             }
         }
 
-        if ( processQualities )
+        if ( processQualities && cyclesInRam_ == NULL && bclRunFolder_ == NULL )
         {
             Filename qualFilename( prefix, "qual.", cycle, "" );
             Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Opening file " << qualFilename << " for reading" << endl;
@@ -337,43 +377,75 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
     }
 #endif //ifdef _OPENMP
 
-    //2020-12-04
-    if ( bwtParams_->getValue( PARAMETER_GENERATE_LCP ) == true )
-    {        
-        #if BUILD_LCP == 0
-            cerr << "++++ Sorry, for computing the LCP array, you must set BUILD_LCP to 1 in src/shared/Tools.hh and compile again! ++++" << endl;
-            exit ( EXIT_FAILURE );
-        #endif
-    }
-    
     const bool permuteQualities = ( bwtParams_->getValue( PARAMETER_PROCESS_QUALITIES ) == PROCESS_QUALITIES_PERMUTE );
     const bool generateCycleQualities = ( bwtParams_->getValue( PARAMETER_GENERATE_CYCLE_QUAL ) != GENERATE_CYCLE_QUAL_OFF );
     const bool readQualities = permuteQualities || generateCycleQualities;
 
+    unique_ptr<PhaseProfiler> profiler;
+    if ( bwtParams->getValue( PARAMETER_PHASE_PROFILE ) != PHASE_PROFILE_OFF )
+    {
+        const bool isJson = ( bwtParams->getValue( PARAMETER_PHASE_PROFILE ) == PHASE_PROFILE_JSON );
+        const string profileFilename = bwtParams->getStringValue( PARAMETER_OUTPUT_FILENAME ) + ( isJson ? "-profile.jsonl" : "-profile.csv" );
+        profiler.reset( new PhaseProfiler( profileFilename, isJson ? PhaseProfiler::FORMAT_JSON : PhaseProfiler::FORMAT_CSV ) );
+        profiler_ = profiler.get();
+    }
+
     string cycFilesPrefix;
     TransposeFasta transp;
+    unique_ptr<BclRunFolder> bclRunFolder;
+    PhaseProfiler::Scope transposeScope( profiler_, "transpose" );
     if ( bwtParams->getValue( PARAMETER_INPUT_FORMAT ) == INPUT_FORMAT_CYC )
     {
         cycFilesPrefix = string( file1 );
         transp.inputCycFile( cycFilesPrefix );
     }
+    else if ( bwtParams->getValue( PARAMETER_INPUT_FORMAT ) == INPUT_FORMAT_RUNFOLDER )
+    {
+        // The BCL files are already cycle-major: no transposition needed
+        bclRunFolder.reset( new BclRunFolder( file1, "", "" ) );
+        transp.inputBclRunFolder( *bclRunFolder, readQualities );
+        bclRunFolder_ = bclRunFolder.get();
+    }
     else
     {
         TmpFilename cycFilesPrefix2( fileOut ); // "move" filename to temp directory
         cycFilesPrefix = cycFilesPrefix2.str();
-        FILE *f;
-        if ( file1 == "-" )
-            f = stdin;
-        else
-            f = fopen( file1.c_str(), "rb" );
-        SeqReaderFile *pReader( SeqReaderFile::getReader( f ) );
+        // Uncompressed files are memory-mapped, other inputs are streamed
+        FILE *f = NULL;
+        SeqReaderBase *pReader = NULL;
+        if ( file1 != "-" )
+            pReader = SeqReaderMmap::open( file1 );
+        if ( pReader == NULL )
+        {
+            if ( file1 == "-" )
+                f = stdin;
+            else
+                f = fopen( file1.c_str(), "rb" );
+            pReader = SeqReaderFile::getReader( f );
+        }
         transp.init( pReader, readQualities );
-        transp.convert( cycFilesPrefix );
+
+        // Medium-sized inputs skip the cycle files
+        uint64_t maxBytesInRam = 0;
+        switch ( bwtParams->getValue( PARAMETER_CYCLES_IN_RAM ) )
+        {
+            case CYCLES_IN_RAM_ON:
+                maxBytesInRam = numeric_limits<uint64_t>::max();
+                break;
+            case CYCLES_IN_RAM_AUTO:
+                if ( bwtParams->getValue( PARAMETER_MEMORY_LIMIT ) > 0 )
+                    maxBytesInRam = ( uint64_t )bwtParams->getValue( PARAMETER_MEMORY_LIMIT ) * 1024 * 1024 / 4;
+                break;
+        }
+        transp.convert( cycFilesPrefix, true, maxBytesInRam );
+        if ( transp.hasCyclesInRam() )
+            cyclesInRam_ = &transp;
         delete pReader;
-        if ( f != stdin )
+        if ( f != NULL && f != stdin )
             fclose( f );
     }
 
+    transposeScope.stop();
     nText = transp.nSeq;
     lengthRead = transp.lengthRead;
     lengthTot = transp.lengthTexts;
@@ -462,7 +534,12 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
     uchar *newQual = processQualities ? ( new uchar[nText] ) : NULL;
     uchar *nextSymb = new uchar[nText];
     uchar *nextQual = processQualities ? ( new uchar[nText] ) : NULL;
-    vectTriple.resize( nText );
+    if ( bwtParams_->getValue( PARAMETER_GENERATE_LCP ) == true )
+    {
+        triples_.enableLcp();
+        newTriples_.enableLcp();
+    }
+    triples_.resize( nText );
 
 #ifdef REPLACE_TABLEOCC
     tableOcc = new LetterNumber*[sizeAlpha];
@@ -475,13 +552,21 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
             tableOcc[j][h] = 0;
 #endif
     tableOcc_.clear();
+    pileSamples_.assign( alphabetSize, vector<BwtFileSample>() );
+    newPileSamples_.assign( alphabetSize, vector<BwtFileSample>() );
 
     Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "\nFirst symbols: " << "Iteration " << 0 << " - symbols in (zero-based) position " << currentCycleFileNum << "\n";
     Logger::out() << "Starting iteration " << currentIteration << ", time now: " << timer.timeNow();
     Logger::out() << "Starting iteration " << currentIteration << ", usage: " << timer << endl;
 
-    ReadFilesForCycle( cycFilesPrefix.c_str(), currentCycleFileNum, lengthRead, nText, newSymb, processQualities, newQual );
+    {
+        PhaseProfiler::Scope scope( profiler_, "readCycle" );
+        ReadFilesForCycle( cycFilesPrefix.c_str(), currentCycleFileNum, lengthRead, nText, newSymb, processQualities, newQual );
+    }
     InitialiseTmpFiles();
+    appendedSeqCount_ = 0;
+    if ( ( *bwtParams_ )[PARAMETER_APPEND_TO].isSet() )
+        InitialiseTmpFilesFromExistingBwt( bwtParams_->getStringValue( PARAMETER_APPEND_TO ) );
 
 
     if ( ( *bwtParams_ )[PARAMETER_SAP_ORDERING] == true )
@@ -501,7 +586,7 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
         {
             cerr << "Before1:" << endl;
             for ( SequenceNumber i = 0; i < nText; i++ )
-                cerr << "Triple[" << i << "]: " << vectTriple[i].seqN << " " << vectTriple[i].posN << " " << ( int )vectTriple[i].pileN << ", newSymb=" << newSymb[i] << endl;
+                cerr << "Triple[" << i << "]: " << triples_.seqN( i ) << " " << triples_.posN( i ) << " " << ( int )triples_.pileN( i ) << ", newSymb=" << newSymb[i] << endl;
         }
 
         //        vector <sortElement> vectTriple2( nText );
@@ -530,7 +615,7 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
         {
             cerr << "After1:" << endl;
             for ( SequenceNumber i = 0; i < nText; i++ )
-                cerr << "Triple[" << i << "]: " << vectTriple[i].seqN << " " << vectTriple[i].posN << " " << ( int )vectTriple[i].pileN << ", newSymb=" << newSymb[i] << ", newSymb3=" << newSymb3[i] << endl;
+                cerr << "Triple[" << i << "]: " << triples_.seqN( i ) << " " << triples_.posN( i ) << " " << ( int )triples_.pileN( i ) << ", newSymb=" << newSymb[i] << ", newSymb3=" << newSymb3[i] << endl;
             cerr << "sapCount=";
             for ( unsigned int i = 0; i < sapCount.size(); ++i )
                 cerr << sapCount[i] << ",";
@@ -540,6 +625,8 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
     }
     else
         InsertFirstsymbols( newSymb, newQual );
+    if ( profiler_ )
+        profiler_->endIteration( currentIteration );
 
 
 
@@ -555,7 +642,9 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
             Logger::out() << "Reading next cycle files, time now: " << timer.timeNow();
             Logger::out() << "Reading next cycle files, usage: " << timer << endl;
         }
+        PhaseProfiler::Scope readScope( profiler_, "readCycle" );
         ReadFilesForCycle( cycFilesPrefix.c_str(), currentCycleFileNum, lengthRead, nText, nextSymb, processQualities, nextQual );
+        readScope.stop();
 
 
         if ( ( *bwtParams_ )[PARAMETER_SAP_ORDERING] == true )
@@ -564,10 +653,13 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
             {
                 cerr << "Before:" << endl;
                 for ( SequenceNumber i = 0; i < nText; i++ )
-                    cerr << "Triple[" << i << "]: " << vectTriple[i].seqN << " " << vectTriple[i].posN << " " << ( int )vectTriple[i].pileN << ", newSymb=" << newSymb[i] << ", nextSymb=" << nextSymb[i] << endl;
+                    cerr << "Triple[" << i << "]: " << triples_.seqN( i ) << " " << triples_.posN( i ) << " " << ( int )triples_.pileN( i ) << ", newSymb=" << newSymb[i] << ", nextSymb=" << nextSymb[i] << endl;
             }
 
-            vector <sortElement> vectTriple2( nText );
+            SortElementStore vectTriple2;
+            if ( triples_.hasLcp() )
+                vectTriple2.enableLcp();
+            vectTriple2.resize( nText );
             uchar *nextSymb2 = new uchar[nText];
 
             SequenceNumber pos = 0;
@@ -578,8 +670,8 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
                     if ( whichPile[( int )newSymb[i]] == j )
                     {
                         nextSymb2[pos] = nextSymb[i];
-                        vectTriple2[pos] = vectTriple[i];
-                        vectTriple2[pos].posN = pos + 1;
+                        vectTriple2.copy( pos, triples_, i );
+                        vectTriple2.setPosN( pos, pos + 1 );
                         ++pos;
                     }
                 }
@@ -593,14 +685,14 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
                             nextSymb2 = tmp;
                         }
             */
-            vectTriple.swap( vectTriple2 );
+            triples_.swap( vectTriple2 );
             delete [] nextSymb2;
 
             Logger_if( LOG_FOR_DEBUGGING )
             {
                 cerr << "After:" << endl;
                 for ( SequenceNumber i = 0; i < nText; i++ )
-                    cerr << "Triple[" << i << "]: " << vectTriple[i].seqN << " " << vectTriple[i].posN << " " << ( int )vectTriple[i].pileN << ", newSymb=" << newSymb[i] << ", nextSymb=" << nextSymb[i] << endl;
+                    cerr << "Triple[" << i << "]: " << triples_.seqN( i ) << " " << triples_.posN( i ) << " " << ( int )triples_.pileN( i ) << ", newSymb=" << newSymb[i] << ", nextSymb=" << nextSymb[i] << endl;
             }
         }
 
@@ -636,10 +728,14 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
         //The last inserted symbol is in position i+1 (or it is newSymb[j]),
         //the next symbol (to insert) is in position i
 
+        // Time that the insertion waits for the prefetch of the next cycle at the end of the sections
+        double insertionSeconds = 0;
+        double prefetchSeconds = 0;
         #pragma omp parallel sections
         {
             #pragma omp section
             {
+                const double startTime = PhaseProfiler::now();
                 if ( ( int )currentIteration == nextIterationReset )
                 {
                     Logger::out() << "Resetting counters" << endl;
@@ -672,13 +768,21 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
                 {
                     InsertNsymbols( newSymb, currentIteration, newQual );
                 }
+                insertionSeconds = PhaseProfiler::now() - startTime;
             }
             #pragma omp section
             {
+                PhaseProfiler::Scope scope( profiler_, "readCycle" );
                 ReadFilesForCycle( cycFilesPrefix.c_str(), currentCycleFileNum + cycleFileNumIncrement, lengthRead, nText, nextSymb, processQualities, nextQual );
+                prefetchSeconds = scope.elapsedSeconds();
                 Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Finished reading input file, time now: " << timer.timeNow();
             }
         }
+        if ( profiler_ )
+        {
+            profiler_->add( "prefetchWait", -1, max( 0.0, prefetchSeconds - insertionSeconds ) );
+            profiler_->endIteration( currentIteration );
+        }
 
         // swap data pointers
         uchar *tmp;
@@ -708,6 +812,8 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
     assert( currentIteration == lengthRead - 1 );
     assert( currentCycleFileNum == 0 || currentCycleFileNum == lengthRead - 1 ); // depending on the --reverse flag
     InsertNsymbols( newSymb, currentIteration, newQual );
+    if ( profiler_ )
+        profiler_->endIteration( currentIteration );
     // Update iteration counters
     ++currentIteration;
     debugCycle = currentIteration;
@@ -727,6 +833,8 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
             newQual[j] = 0;
     }
     InsertNsymbols( newSymb, currentIteration, newQual );
+    if ( profiler_ )
+        profiler_->endIteration( currentIteration );
 
     Logger::out() << "Final iteration complete, time now: " << timer.timeNow();
     Logger::out() << "Final iteration complete, usage: " << timer << endl;
@@ -828,6 +936,15 @@ int BCRexternalBWT::buildBCR( const string &file1, const string &fileOut, const
         }
     }
 
+    // The last record covers the conversions to the final format
+    if ( profiler_ )
+        profiler_->endIteration( lengthRead + 1 );
+
+    cyclesInRam_ = NULL;
+    bclRunFolder_ = NULL;
+    profiler_ = NULL;
+    triples_.clear();
+    newTriples_.clear();
     return permuteQualities ? 2 : 1;
 } // ~buildBCR
 
@@ -862,13 +979,7 @@ void BCRexternalBWT::InitialiseTmpFiles()
         if ( bwtParams_->getValue( PARAMETER_GENERATE_LCP ) == true )
         {
             TmpFilename filenameOut( "", i, ".lcp" );
-            FILE *OutFileLCP = fopen( filenameOut, "wb" );
-            if ( OutFileLCP == NULL )
-            {
-                cerr << "LCP file: " << filenameOut << " : Error opening " << endl;
-                exit ( EXIT_FAILURE );
-            }
-            fclose( OutFileLCP );
+            LcpFileWriter createEmptyFile( filenameOut.str() );
         }
 
         //Do we want compute the extended suffix array (position and number of sequence)?
@@ -887,11 +998,67 @@ void BCRexternalBWT::InitialiseTmpFiles()
 
 }
 
+void BCRexternalBWT::InitialiseTmpFilesFromExistingBwt( const string &prefix )
+{
+    // The existing BWT becomes the starting point of our piles. The new
+    // sequences then get inserted column by column, the same way as if they
+    // had been processed together with the existing ones, after them.
+    Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Appending to existing BWT " << prefix << endl;
+    const bool permuteQualities = ( bwtParams_->getValue( PARAMETER_PROCESS_QUALITIES ) == PROCESS_QUALITIES_PERMUTE );
+
+    for ( AlphabetSymbol i = 0; i < alphabetSize; ++i )
+    {
+        Filename existingFilename( prefix, "-B0", i, "" );
+        readWriteCheck( existingFilename, false );
+
+        unique_ptr<BwtReaderBase> pCountingReader( instantiateBwtPileReader( existingFilename, "", false, true ) );
+        tableOcc_[i].clear();
+        pCountingReader->readAndCount( tableOcc_[i] );
+
+        unique_ptr<BwtReaderBase> pReader( instantiateBwtPileReader( existingFilename, "", false, true ) );
+        if ( i == 0 )
+        {
+            pReader->readAndSend( *pWriterBwt0_ ); // flushed after the new symbols
+        }
+        else
+        {
+            TmpFilename filenameOut( i );
+            unique_ptr<BwtWriterBase> pWriter( instantiateBwtWriterForIntermediateCycle( filenameOut ) );
+            pWriter->enableSampling( &pileSamples_[i], pileSampleInterval );
+            pReader->readAndSend( *pWriter );
+        }
+
+        if ( permuteQualities )
+        {
+            Filename existingQualFilename( prefix, "-Q0", i, "" );
+            readWriteCheck( existingQualFilename, false );
+            TmpFilename filenameQualOut( "", i, ".qual" );
+            unique_ptr<BwtReaderBase> pQualReader( new BwtReaderASCII( existingQualFilename ) );
+            unique_ptr<BwtWriterBase> pQualWriter( new BwtWriterASCII( filenameQualOut ) );
+            pQualReader->readAndSend( *pQualWriter );
+        }
+    }
+
+    // One '$'-pile entry per existing sequence
+    appendedSeqCount_ = 0;
+    for ( AlphabetSymbol j = 0; j < alphabetSize; ++j )
+        appendedSeqCount_ += tableOcc_[0].count_[j];
+    if ( appendedSeqCount_ + nText < appendedSeqCount_ )
+    {
+        Logger::error() << "Error: Too many sequences. This version of BEETL was compiled for a maximum of " << maxSequenceNumber << " sequences" << endl;
+        exit( -1 );
+    }
+    Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Existing BWT contains " << appendedSeqCount_ << " sequences" << endl;
+}
+
 void BCRexternalBWT::InsertFirstsymbols( uchar const *newSymb, uchar const *newSymbQual, const int subSequenceNum )
 {
+    PhaseProfiler::Scope scope( profiler_, "insert" );
+    // New '$' signs are sorted after the ones of any existing sequence
+    triples_.reservePositions( appendedSeqCount_ + ( LetterNumber )nText * ( subSequenceNum + 1 ) );
     for ( SequenceNumber j = 0 ; j < nText; j++ )
     {
-        vectTriple[j] = sortElement( 0, nText * subSequenceNum + j + 1, j );
+        triples_.set( j, sortElement( 0, appendedSeqCount_ + nText * subSequenceNum + j + 1, j ) );
     }
     if ( verboseEncode == 1 )
     {
@@ -899,19 +1066,19 @@ void BCRexternalBWT::InsertFirstsymbols( uchar const *newSymb, uchar const *newS
         cerr << "Q  ";
         for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            cerr << ( int )vectTriple[g].pileN << " ";
+            cerr << ( int )triples_.pileN( g ) << " ";
         }
         cerr << endl;
         cerr << "P  ";
         for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            cerr << vectTriple[g].posN  << " ";
+            cerr << triples_.posN( g )  << " ";
         }
         cerr << endl;
         cerr << "N  ";
         for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            cerr << vectTriple[g].seqN  << " ";
+            cerr << triples_.seqN( g )  << " ";
         }
         cerr << endl;
 
@@ -920,13 +1087,13 @@ void BCRexternalBWT::InsertFirstsymbols( uchar const *newSymb, uchar const *newS
             cerr << "C  ";             //LCP current
             for ( SequenceNumber g = 0 ; g < nText; g++ )
             {
-                cerr << ( int )vectTriple[g].getLcpCurN()  << " ";
+                cerr << ( int )triples_.getLcpCurN( g )  << " ";
             }
             cerr << endl;
             cerr << "S  ";                     //LCP successive
             for ( SequenceNumber g = 0 ; g < nText; g++ )
             {
-                cerr << ( int )vectTriple[g].getLcpSucN()  << " ";
+                cerr << ( int )triples_.getLcpSucN( g )  << " ";
             }
             cerr << endl;
         }
@@ -959,25 +1126,10 @@ void BCRexternalBWT::InsertFirstsymbols( uchar const *newSymb, uchar const *newS
 
     if ( bwtParams_->getValue( PARAMETER_GENERATE_LCP ) == true )
     {
-        SequenceLength *vectLCP = new SequenceLength[nText];
-        for ( SequenceNumber j = 0 ; j < nText; j++ )
-        {
-            vectLCP[j] = 0;
-        }
-        FILE *OutFileLCP;                  // output and input file LCP;
         TmpFilename filenameOut( "0.lcp" );
-        OutFileLCP = fopen( filenameOut, "ab" );
-        if ( OutFileLCP == NULL )
-        {
-            cerr << "LCP file $: " << filenameOut << " Error opening " << endl;
-            exit ( EXIT_FAILURE );
-        }
-
-        LetterNumber num = fwrite ( vectLCP, sizeof( SequenceLength ), nText , OutFileLCP );
-        checkIfEqual( num , nText ); // we should always read the same number of integers
-        //vectLCP.clear();
-        fclose( OutFileLCP );
-        delete [] vectLCP;
+        LcpFileWriter lcpWriter( filenameOut.str(), true );
+        for ( SequenceNumber j = 0 ; j < nText; j++ )
+            lcpWriter.write( 0 );
     }
 
     //Do we want compute the extended suffix array (position and number of sequence)?
@@ -1020,7 +1172,7 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
     SequenceNumber index = 0;
     for ( int pile = 1; pile < alphabetSize + 1; ++pile )
     {
-        while ( index < nText && vectTriple[index].pileN < pile )
+        while ( index < nText && triples_.pileN( index ) < pile )
             ++index;
         pileStarts[pile] = index;
     }
@@ -1030,17 +1182,61 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
       clog << " => pile " << j << ": " << pileStarts[j] << "-" << pileStarts[j+1] <<endl;
       }
     */
-    vector< vector< FragmentedVector< sortElement > > > parallelVectTriplePerNewPile( alphabetSize, vector< FragmentedVector< sortElement > >( alphabetSize ) );
 
-    int parallelPile;
-    //    for (int parallelPile = alphabetSize-2; parallelPile >= 0; --parallelPile)
-    #pragma omp parallel for
-    for ( parallelPile = 0; parallelPile < alphabetSize; ++parallelPile )
+    // The piles are split into segments of similar sizes, each starting at a
+    // sample of its pile file, so that the threads are not limited to one pile each
+#ifdef _OPENMP
+    const SequenceNumber targetSegmentSize = max<SequenceNumber>( nText / ( 4 * omp_get_max_threads() ), 1024 );
+#else
+    const SequenceNumber targetSegmentSize = nText;
+#endif //ifdef _OPENMP
+    vector<PileSegment> segments;
+    for ( int pile = 0; pile < alphabetSize; ++pile )
+    {
+        const vector<BwtFileSample> &samples = pileSamples_[pile];
+        PileSegment segment = { pile, pileStarts[pile], pileStarts[pile + 1], NULL };
+        for ( SequenceNumber splitIndex = segment.startIndex + targetSegmentSize; splitIndex < segment.endIndex; splitIndex += targetSegmentSize )
+        {
+            // Last sample before the first letter read by this entry, if it is past the start of the previous segment
+            vector<BwtFileSample>::const_iterator sample = upper_bound( samples.begin(), samples.end(), triples_.posN( splitIndex ) - 1, isBeforeSample );
+            if ( sample == samples.begin() || ( sample - 1 )->letterPos < triples_.posN( segment.startIndex ) )
+                continue;
+            PileSegment nextSegment = { pile, splitIndex, segment.endIndex, &*( sample - 1 ) };
+            segment.endIndex = splitIndex;
+            segments.push_back( segment );
+            segment = nextSegment;
+        }
+        if ( segment.startIndex < segment.endIndex )
+            segments.push_back( segment );
+    }
+    Logger_if( LOG_FOR_DEBUGGING ) Logger::out() << "InsertNsymbols: " << segments.size() << " pile segments" << endl;
+
+    // Largest position that the new entries may get, which decides how wide
+    // their positions are stored
+    LetterNumber maxNewPileSize = 0;
+    for ( int newPile = 0; newPile < alphabetSize; ++newPile )
     {
-        InsertNsymbols_parallelPile( newSymb, iterationNum, newQual, parallelPile, pileStarts[parallelPile], pileStarts[parallelPile + 1], parallelVectTriplePerNewPile[parallelPile] );
+        LetterNumber newPileSize = nText + 1;
+        for ( int g = 0; g < alphabetSize; ++g )
+            newPileSize += tableOcc_[g].count_[newPile];
+        maxNewPileSize = max( maxNewPileSize, newPileSize );
+    }
+    triples_.reservePositions( maxNewPileSize );
+    newTriples_.resize( nText );
+    newTriples_.reservePositions( maxNewPileSize );
+    Logger_if( LOG_FOR_DEBUGGING ) Logger::out() << "InsertNsymbols: " << triples_.bytesPerElement() << " bytes per sequence entry" << endl;
+    vector<SequenceNumber> newPileCounts( segments.size() * alphabetSize, 0 ); // [segment][new pile]
+
+    #pragma omp parallel for schedule( dynamic )
+    for ( int segmentNum = 0; segmentNum < ( int )segments.size(); ++segmentNum )
+    {
+        const PileSegment &segment = segments[segmentNum];
+        PhaseProfiler::Scope scope( profiler_, "count", segment.pile );
+        InsertNsymbols_parallelPile( newSymb, iterationNum, newQual, segment.pile, segment.startIndex, segment.endIndex, newTriples_, &newPileCounts[segmentNum * alphabetSize], segment.startSample );
     }
 
     Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Finished inserting symbols in RAM, time now: " << timer.timeNow();
+    PhaseProfiler::Scope insertScope( profiler_, "insert" );
 
     if ( verboseEncode == 1 )
     {
@@ -1075,10 +1271,10 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
             while ( mmm < alphabetSize )
             {
                 TmpFilename filenameInLCP( "", mmm, ".lcp" );
-                FILE *InFileLCP = fopen( filenameInLCP, "rb" );
+                LcpFileReader lcpReader( filenameInLCP.str() );
                 for ( LetterNumber g = 0 ; g < SIZEBUFFER; g++ )
                     bufferLCP[g] = 0;
-                numchar = fread( bufferLCP, sizeof( SequenceLength ), SIZEBUFFER, InFileLCP );
+                numchar = lcpReader.read( bufferLCP, SIZEBUFFER );
                 cerr << "L[" << ( int )mmm << "]:\t";
                 if ( numchar == 0 )
                     cerr  << "empty";
@@ -1086,7 +1282,6 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
                     for ( SequenceNumber g = 0 ; g < numchar; g++ )
                         cerr  << ( int )bufferLCP[g] << " ";
                 cerr  << "\n";
-                fclose( InFileLCP );
                 mmm++;
             }
             delete [] bufferLCP;
@@ -1102,19 +1297,19 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
         cerr << "Q  ";
         for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            cerr << ( int )vectTriple[g].pileN << " ";
+            cerr << ( int )triples_.pileN( g ) << " ";
         }
         cerr << endl;
         cerr << "P  ";
         for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            cerr << vectTriple[g].posN  << " ";
+            cerr << triples_.posN( g )  << " ";
         }
         cerr << endl;
         cerr << "N  ";
         for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            cerr << vectTriple[g].seqN  << " ";
+            cerr << triples_.seqN( g )  << " ";
         }
         cerr << endl;
     } // ~if verboseEncode
@@ -1123,19 +1318,28 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
     delete [] counters;
 #endif
 
-    //    quickSort(vectTriple);
-    vectTriple.clear();
+    // Counting redistribution of the updated entries by new pile, keeping
+    // the order of the segments and of the entries within each segment
+    vector<SequenceNumber> &newPileOffsets = newPileCounts;
+    SequenceNumber offset = 0;
     for ( uint newPile = 0; newPile < alphabetSize; ++newPile )
     {
-        for ( uint prevPile = 0; prevPile < alphabetSize; ++prevPile )
+        for ( uint segmentNum = 0; segmentNum < segments.size(); ++segmentNum )
         {
-            if ( !parallelVectTriplePerNewPile[prevPile][newPile].empty() )
-            {
-                //                vectTriple.insert( vectTriple.end(), parallelVectTriplePerNewPile[prevPile][newPile].begin(), parallelVectTriplePerNewPile[prevPile][newPile].end() );
-                parallelVectTriplePerNewPile[prevPile][newPile].appendTo( vectTriple );
-            }
+            const SequenceNumber count = newPileCounts[segmentNum * alphabetSize + newPile];
+            newPileOffsets[segmentNum * alphabetSize + newPile] = offset;
+            offset += count;
         }
     }
+    assert( offset == nText );
+
+    #pragma omp parallel for schedule( dynamic )
+    for ( int segmentNum = 0; segmentNum < ( int )segments.size(); ++segmentNum )
+    {
+        SequenceNumber *offsets = &newPileOffsets[segmentNum * alphabetSize];
+        for ( SequenceNumber k = segments[segmentNum].startIndex; k < segments[segmentNum].endIndex; ++k )
+            triples_.copy( offsets[newTriples_.pileN( k )]++, newTriples_, k );
+    }
 
     Logger_if( LOG_FOR_DEBUGGING )
     {
@@ -1149,19 +1353,19 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
         Logger::out() << "Q  ";
         for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            Logger::out() << ( int )vectTriple[g].pileN << " ";
+            Logger::out() << ( int )triples_.pileN( g ) << " ";
         }
         Logger::out() << endl;
         Logger::out() << "P  ";
         for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            Logger::out() << vectTriple[g].posN  << " ";
+            Logger::out() << triples_.posN( g )  << " ";
         }
         Logger::out() << endl;
         Logger::out() << "N  ";
         for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            Logger::out() << vectTriple[g].seqN  << " ";
+            Logger::out() << triples_.seqN( g )  << " ";
         }
         Logger::out() << endl;
 
@@ -1170,13 +1374,13 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
             Logger::out() << "C  ";
             for ( SequenceNumber g = 0 ; g < nText; g++ )
             {
-                Logger::out() << ( int )vectTriple[g].getLcpCurN()  << " ";
+                Logger::out() << ( int )triples_.getLcpCurN( g )  << " ";
             }
             Logger::out() << endl;
             Logger::out() << "S  ";
             for ( SequenceNumber g = 0 ; g < nText; g++ )
             {
-                Logger::out() << ( int )vectTriple[g].getLcpSucN()  << " ";
+                Logger::out() << ( int )triples_.getLcpSucN( g )  << " ";
             }
             Logger::out() << endl;
         }
@@ -1190,10 +1394,10 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
         {
             Logger::out() << "Before2:" << endl;
             for ( SequenceNumber i = 0; i < nText; i++ )
-                Logger::out() << "Triple[" << i << "]: " << vectTriple[i].seqN << " " << vectTriple[i].posN << " " << ( int )vectTriple[i].pileN << ", newSymb=" << newSymb[i] << endl;
+                Logger::out() << "Triple[" << i << "]: " << triples_.seqN( i ) << " " << triples_.posN( i ) << " " << ( int )triples_.pileN( i ) << ", newSymb=" << newSymb[i] << endl;
         }
 
-        vector <sortElement> vectTriple2( nText );
+        SortElementStore vectTriple2( triples_ );
         //            uchar *nextSymb2 = new uchar[nText];
         //            uchar *newSymb3 = new uchar[nText];
 
@@ -1244,7 +1448,7 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
                 {
                     for ( SequenceNumber i = startSeqNum; i < endSeqNum; ++i )
                     {
-                        int s = vectTriple[i].seqN;
+                        int s = triples_.seqN( i );
                         if ( whichPileSAP[( int )newSymb[s]] == -1 )
                         {
                             cerr << "Error SAP with char " << newSymb[s] << " at position " << s << endl;
@@ -1252,16 +1456,16 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
                         }
                         if ( whichPileSAP[( int )newSymb[s]] == j )
                         {
-                            vectTriple2[pos] = vectTriple[i];
-                            vectTriple2[pos].posN = vectTriple[pos].posN;
-                            vectTriple2[pos].pileN = vectTriple[pos].pileN;
+                            vectTriple2.setSeqN( pos, triples_.seqN( i ) );
+                            vectTriple2.setLcpCurN( pos, triples_.getLcpCurN( i ) );
+                            vectTriple2.setLcpSucN( pos, triples_.getLcpSucN( i ) );
                             ++pos;
                             ++sapCount2[sapSet + j * sapCount.size()];
                         }
                     }
                 }
 
-                if ( newSymb[vectTriple2[startSeqNum].seqN] != newSymb[vectTriple2[endSeqNum - 1].seqN] )
+                if ( newSymb[vectTriple2.seqN( startSeqNum )] != newSymb[vectTriple2.seqN( endSeqNum - 1 )] )
                 {
                     #pragma omp critical
                     {
@@ -1279,14 +1483,14 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
             {
                 SAPstopped = true;
             }
-            vectTriple.swap( vectTriple2 );
+            triples_.swap( vectTriple2 );
             sapCount.swap( sapCount2 );
 
             Logger_if( LOG_FOR_DEBUGGING )
             {
                 Logger::out() << "After2:" << endl;
                 for ( SequenceNumber i = 0; i < nText; i++ )
-                    Logger::out() << "Triple[" << i << "]: " << vectTriple[i].seqN << " " << vectTriple[i].posN << " " << ( int )vectTriple[i].pileN << ", newSymb=" << newSymb[i] << endl;
+                    Logger::out() << "Triple[" << i << "]: " << triples_.seqN( i ) << " " << triples_.posN( i ) << " " << ( int )triples_.pileN( i ) << ", newSymb=" << newSymb[i] << endl;
                 Logger::out() << "sapCount=";
                 for ( unsigned int i = 0; i < sapCount.size(); ++i )
                 {
@@ -1301,6 +1505,7 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
         }
     }
 
+    insertScope.stop();
     Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Writing intermediate BWT files to disk, time now: " << timer.timeNow();
 
     if ( bwtParams_->getValue( PARAMETER_GENERATE_LCP ) == false )
@@ -1323,7 +1528,7 @@ void BCRexternalBWT::InsertNsymbols( uchar const *newSymb, SequenceLength iterat
     //  delete pReader;
 }
 
-void BCRexternalBWT::InsertNsymbols_parallelPile( uchar const *newSymb, SequenceLength iterationNum, uchar const *newQual, unsigned int parallelPile, SequenceNumber startIndex, SequenceNumber endIndex, vector< FragmentedVector< sortElement > > &newVectTriplePerNewPile )
+void BCRexternalBWT::InsertNsymbols_parallelPile( uchar const *newSymb, SequenceLength iterationNum, uchar const *newQual, unsigned int parallelPile, SequenceNumber startIndex, SequenceNumber endIndex, SortElementStore &newTriples, SequenceNumber *newPileCounts, const BwtFileSample *startSample )
 {
     Logger_if( LOG_FOR_DEBUGGING )
     {
@@ -1356,7 +1561,7 @@ void BCRexternalBWT::InsertNsymbols_parallelPile( uchar const *newSymb, Sequence
         return;
     }
     //    clog << "---------- " << (int)vectTriple[j].pileN << "|" << parallelPile << endl;
-    AlphabetSymbol currentPile = parallelPile; //vectTriple[j].pileN;
+    AlphabetSymbol currentPile = parallelPile; //triples_.pileN( j );
     assert ( currentPile < alphabetSize );
     TmpFilename filename( "", currentPile, "" );
     //printf("===Current BWT-partial= %d\n",currentPile);
@@ -1372,6 +1577,8 @@ void BCRexternalBWT::InsertNsymbols_parallelPile( uchar const *newSymb, Sequence
 
     pReader = instantiateBwtReaderForIntermediateCycle( filename );
     assert( pReader != NULL );
+    if ( startSample != NULL )
+        pReader->seek( startSample->posInFile, startSample->letterPos );
 
     if ( j < endIndex )
     {
@@ -1381,22 +1588,22 @@ void BCRexternalBWT::InsertNsymbols_parallelPile( uchar const *newSymb, Sequence
         SequenceNumber k = j;
         //For each pile, we have a different counter of characters
         for ( AlphabetSymbol i = 0 ; i < alphabetSize; i++ )
-            counters.count_[i] = 0;
-        LetterNumber cont = 0;   //number of the read symbols
+            counters.count_[i] = startSample ? startSample->counts.count_[i] : 0;
+        LetterNumber cont = startSample ? startSample->letterPos : 0;   //number of the read symbols
         uchar foundSymbol;
         LetterNumber numberRead = 0;
-        while ( ( k < endIndex ) && ( vectTriple[k].pileN == currentPile ) )
+        while ( ( k < endIndex ) && ( triples_.pileN( k ) == currentPile ) )
         {
             //For any character (of differents sequences) in the same pile
             if ( verboseEncode == 1 )
             {
-                cerr << "j-1: Q[" << k << "]=" << ( int )vectTriple[k].pileN << " P[" << k << "]=" << ( LetterNumber )vectTriple[k].posN << " N[" << k << "]=" << ( SequenceNumber )vectTriple[k].seqN << "\t";
+                cerr << "j-1: Q[" << k << "]=" << ( int )triples_.pileN( k ) << " P[" << k << "]=" << ( LetterNumber )triples_.posN( k ) << " N[" << k << "]=" << ( SequenceNumber )triples_.seqN( k ) << "\t";
                 //cerr << "--k= " << k << " pileN[k]= " << pileN[k] << " posN[k]= " << posN[k] <<  " seqN[k]= " << seqN[k] << endl;
             }
             foundSymbol = '\0';
 
             //cont is the number of symbols already read!
-            LetterNumber toRead = vectTriple[k].posN - cont;
+            LetterNumber toRead = triples_.posN( k ) - cont;
             if ( toRead > 0 )
             {
                 Logger_if( LOG_FOR_DEBUGGING ) Logger::out() << "toRead: " << toRead << endl;
@@ -1410,7 +1617,7 @@ void BCRexternalBWT::InsertNsymbols_parallelPile( uchar const *newSymb, Sequence
                         cerr << "  numberRead=" << numberRead << endl;
                         cerr << "  cont=" << cont << endl;
                         cerr << "  k=" << k << endl;
-                        cerr << "  vectTriple[k].posN=" << vectTriple[k].posN << endl;
+                        cerr << "  vectTriple[k].posN=" << triples_.posN( k ) << endl;
                         cerr << "  newSymb= " << newSymb[0] << newSymb[1] << newSymb[2] << "..." << endl;
                         cerr << "  iterationNum=" << iterationNum << endl;
                         if ( newQual )
@@ -1449,7 +1656,7 @@ void BCRexternalBWT::InsertNsymbols_parallelPile( uchar const *newSymb, Sequence
             //#endif
             //cerr << "--New posN[k]=" << (int)posN[k] <<endl;
             if ( verboseEncode == 1 )
-                cerr << "\nInit New P[" << k << "]= " << vectTriple[k].posN << endl; //TODO: update this to newVectTripleItem
+                cerr << "\nInit New P[" << k << "]= " << triples_.posN( k ) << endl; //TODO: update this to newVectTripleItem
 
             for ( AlphabetSymbol g = 0 ; g < currentPile; g++ )  //I have to count in each pile g= 0... (currentPile-1)-pile
             {
@@ -1460,7 +1667,7 @@ void BCRexternalBWT::InsertNsymbols_parallelPile( uchar const *newSymb, Sequence
                 {
                     cerr << "g= " << ( int )g << " symbol= " << ( int )foundSymbol << " whichPile[symbol]= "
                          << ( int )whichPile[( int )foundSymbol] << endl;
-                    cerr << "Add New posN[k]=" << vectTriple[k].posN << " tableOcc[g][whichPile[(int)symbol]] "
+                    cerr << "Add New posN[k]=" << triples_.posN( k ) << " tableOcc[g][whichPile[(int)symbol]] "
                          << tableOcc_[g].count_[whichPile[( int )foundSymbol]] << endl;
                 }
 
@@ -1471,14 +1678,15 @@ void BCRexternalBWT::InsertNsymbols_parallelPile( uchar const *newSymb, Sequence
             newVectTripleItem.pileN = whichPile[( int )foundSymbol];
             //cerr << "New posN[k]=" << (int)posN[k] << " New pileN[k]=" << (int)pileN[k] << endl;
             if ( verboseEncode == 1 )
-                cerr << "j  : Q[q]=" << ( int )vectTriple[k].pileN << " P[q]=" << ( LetterNumber )vectTriple[k].posN <<  " N[q]=" << ( SequenceNumber )vectTriple[k].seqN << endl;
+                cerr << "j  : Q[q]=" << ( int )triples_.pileN( k ) << " P[q]=" << ( LetterNumber )triples_.posN( k ) <<  " N[q]=" << ( SequenceNumber )triples_.seqN( k ) << endl;
 
-            newVectTripleItem.seqN = vectTriple[k].seqN;
-            newVectTripleItem.setLcpCurN( vectTriple[k].getLcpCurN() );
-            newVectTripleItem.setLcpSucN( vectTriple[k].getLcpSucN() );
+            newVectTripleItem.seqN = triples_.seqN( k );
             //            vectTriple[k] = newVectTripleItem;
 
-            newVectTriplePerNewPile[ newVectTripleItem.pileN ].push_back( newVectTripleItem );
+            newTriples.set( k, newVectTripleItem );
+            newTriples.setLcpCurN( k, triples_.getLcpCurN( k ) );
+            newTriples.setLcpSucN( k, triples_.getLcpSucN( k ) );
+            ++newPileCounts[newVectTripleItem.pileN];
 
             k++;
         }
@@ -1503,12 +1711,15 @@ void BCRexternalBWT::storeBWT( uchar const *newSymb, uchar const *newQual )
     SequenceNumber index = 0;
     for ( int pile = 1; pile < alphabetSize + 1; ++pile )
     {
-        while ( index < nText && vectTriple[index].pileN < pile )
+        while ( index < nText && triples_.pileN( index ) < pile )
             ++index;
         pileStarts[pile] = index;
     }
 
 
+    for ( AlphabetSymbol g = 0 ; g < alphabetSize; g++ )
+        newPileSamples_[g].clear();
+
     int parallelPile;
     //    for (int parallelPile = alphabetSize-2; parallelPile >= 0; --parallelPile)
     #pragma omp parallel for
@@ -1533,6 +1744,7 @@ void BCRexternalBWT::storeBWT( uchar const *newSymb, uchar const *newQual )
                 cerr << filenameIn << ": Error deleting file" << endl;
             else if ( safeRename( filenameOut, filenameIn ) )
                 cerr << filenameOut << ": Error renaming " << endl;
+            pileSamples_[g].swap( newPileSamples_[g] );
         }
 
         if ( verboseEncode == 1 )
@@ -1664,6 +1876,7 @@ char getPredictionBasedEncoding( const char actualBase, char predictedBase, bool
 
 void BCRexternalBWT::storeBWT_parallelPile( uchar const *newSymb, uchar const *newQual, unsigned int parallelPile, SequenceNumber startIndex, SequenceNumber endIndex )
 {
+    PhaseProfiler::Scope scope( profiler_, "store", parallelPile );
     if ( 0 )
     {
         #pragma omp critical
@@ -1694,7 +1907,7 @@ void BCRexternalBWT::storeBWT_parallelPile( uchar const *newSymb, uchar const *n
     j = startIndex;
     while ( j < endIndex )
     {
-        assert( currentPile == vectTriple[j].pileN );
+        assert( currentPile == triples_.pileN( j ) );
         if ( verboseEncode == 1 )
             cerr << "index j= " << j << " current BWT segment " << ( int )currentPile << endl;
 
@@ -1708,6 +1921,7 @@ void BCRexternalBWT::storeBWT_parallelPile( uchar const *newSymb, uchar const *n
         if ( debugCycle < lengthRead )
         {
             pWriter.reset( instantiateBwtWriterForIntermediateCycle( filenameOut ) );
+            pWriter->enableSampling( &newPileSamples_[currentPile], pileSampleInterval );
         }
         else
         {
@@ -1744,16 +1958,16 @@ void BCRexternalBWT::storeBWT_parallelPile( uchar const *newSymb, uchar const *n
         //For each new symbol in the same pile
         SequenceNumber k = j;
         LetterNumber cont = 0;
-        while ( ( k < nText ) && ( vectTriple[k].pileN == currentPile ) )
+        while ( ( k < nText ) && ( triples_.pileN( k ) == currentPile ) )
         {
             if ( verboseEncode == 1 )
-                cerr << "k= " << k << " Q[k]= " << ( int )vectTriple[k].pileN << " P[k]= " << vectTriple[k].posN << " cont = " << cont << endl;
+                cerr << "k= " << k << " Q[k]= " << ( int )triples_.pileN( k ) << " P[k]= " << triples_.posN( k ) << " cont = " << cont << endl;
             //cerr << "k= " << k << " pileN[k]= " << pileN[k] << " posN[k]= " << posN[k] << endl;
             //So I have to read the k-BWT and I have to count the number of the symbols up to the position posN.
             //As PosN starts to the position 1 and I have to insert the new symbol in position posN[k]
             // I have to read posN[k]-1 symbols
             //cont is the number of symbols already read!
-            toRead = ( vectTriple[k].posN - 1 ) - cont;
+            toRead = ( triples_.posN( k ) - 1 ) - cont;
             if ( toRead )
             {
                 Logger_if( LOG_FOR_DEBUGGING ) Logger::out() << "Start: to Read " << toRead << "\n";
@@ -1772,7 +1986,7 @@ void BCRexternalBWT::storeBWT_parallelPile( uchar const *newSymb, uchar const *n
             //And I have to update the number of occurrences of each symbol
             //   if (toRead==0) {
 
-            const char charToWrite = newSymb[vectTriple[k].seqN];
+            const char charToWrite = newSymb[triples_.seqN( k )];
             if ( generateCycleBwt || generateCycleQualities )
             {
                 char predictedChar = pWriter->getLastChar();
@@ -1797,7 +2011,7 @@ void BCRexternalBWT::storeBWT_parallelPile( uchar const *newSymb, uchar const *n
                 // Prediction-based encoded Qualities
                 if ( generateCycleQualities && newQual )
                 {
-                    const char qual = newQual[vectTriple[k].seqN];
+                    const char qual = newQual[triples_.seqN( k )];
                     bool removeQuality;
                     if ( qual <= 33 + 2 )
                     {
@@ -1818,10 +2032,10 @@ void BCRexternalBWT::storeBWT_parallelPile( uchar const *newSymb, uchar const *n
             ( *pWriter )( ( char * )&charToWrite, 1 );
             if ( permuteQualities && newQual )
             {
-                ( *pQualWriter )( ( char * )&newQual[vectTriple[k].seqN], 1 );
+                ( *pQualWriter )( ( char * )&newQual[triples_.seqN( k )], 1 );
             }
 
-            tableOcc_[currentPile].count_[whichPile[( int )newSymb[vectTriple[k].seqN]]]++;     //update the number of occurrences in BWT of the pileN[k]
+            tableOcc_[currentPile].count_[whichPile[( int )newSymb[triples_.seqN( k )]]]++;     //update the number of occurrences in BWT of the pileN[k]
             //cerr << "new number write " << numchar << "\n";
             cont++;    //number of read symbols
             //toRead--;
@@ -1973,7 +2187,7 @@ void BCRexternalBWT::storeSA( SequenceLength iterationNum )
     SequenceNumber j = 0;
     while ( j < nText )
     {
-        AlphabetSymbol currentPile = vectTriple[j].pileN;
+        AlphabetSymbol currentPile = triples_.pileN( j );
         //if (verboseEncode==1)
         // cerr << "\nNew Segment; index text j= " << j << " current SA segment is " << (int)currentPile << endl;
         //cerr << "Pile " << (int)currentPile << endl;
@@ -1998,7 +2212,7 @@ void BCRexternalBWT::storeSA( SequenceLength iterationNum )
         //For each new symbol in the same pile
         SequenceNumber k = j;
         LetterNumber cont = 0;
-        while ( ( k < nText ) && ( vectTriple[k].pileN == currentPile ) )
+        while ( ( k < nText ) && ( triples_.pileN( k ) == currentPile ) )
         {
 
             //if (verboseEncode==1)
@@ -2008,7 +2222,7 @@ void BCRexternalBWT::storeSA( SequenceLength iterationNum )
             //As PosN starts to the position 1 and I have to insert the new symbol in position posN[k]
             // I have to read posN[k]-1 symbols
             //cont is the number of symbols already read!
-            toRead = ( vectTriple[k].posN - 1 ) - cont;
+            toRead = ( triples_.posN( k ) - 1 ) - cont;
             /*
             if (verboseEncode == 1)
                 cerr << "Start: to Read " << toRead << "\n";
@@ -2053,7 +2267,7 @@ void BCRexternalBWT::storeSA( SequenceLength iterationNum )
             {
                 ElementType newEle;
                 newEle.sa = iterationNum; //( posSymb + 1 ) % ( lengthRead + 1 );
-                newEle.numSeq = vectTriple[k].seqN;
+                newEle.numSeq = triples_.seqN( k );
 
                 numchar = fwrite ( &newEle, sizeof( ElementType ), 1, OutFileSA );
                 checkIfEqual( numchar, 1 ); // we should always read/write the same number of characters
@@ -2334,536 +2548,491 @@ void BCRexternalBWT::storeEntireSAfromPairSA( const char *fn )
 
 void BCRexternalBWT::storeBWTandLCP( uchar const *newSymb )
 {
-    SequenceLength maxValueLen = lengthRead + 1;
-    vector <SequenceLength> minLCPcur;
-    vector <bool> minLCPcurFound;
-    vector <SequenceLength> minLCPsuc;
-    vector <SequenceNumber> minLCPsucText;
-    vector <bool> minLCPsucToFind;
-    minLCPcur.resize( alphabetSize );     //for each symbol of the alphabet
-    minLCPcurFound.resize( alphabetSize );
-    minLCPsuc.resize( alphabetSize );
-    minLCPsucText.resize( alphabetSize );
-    minLCPsucToFind.resize( alphabetSize );
-
     //I have found the position where I have to insert the chars in the position t of the each text
-    //Now I have to update the BWT in each file.
-    LetterNumber numchar = 0;
-    LetterNumber numcharWrite = 0;
-    uchar *buffer = new uchar[SIZEBUFFER];
-    SequenceLength *bufferLCP = new SequenceLength[SIZEBUFFER];
-    LetterNumber toRead = 0;
+    //Now I have to update the BWT and the LCP in each file, one pile per thread like storeBWT.
+    //The lcpCurN and lcpSucN values updated by a pile only belong to the triples of this pile.
+    vector<SequenceNumber> pileStarts( alphabetSize + 1 );
+    pileStarts[0] = 0;
+    SequenceNumber index = 0;
+    for ( int pile = 1; pile < alphabetSize + 1; ++pile )
+    {
+        while ( index < nText && triples_.pileN( index ) < pile )
+            ++index;
+        pileStarts[pile] = index;
+    }
 
-    SequenceNumber j = 0;
-    while ( j < nText )
+    int parallelPile;
+    #pragma omp parallel for
+    for ( parallelPile = 0; parallelPile < alphabetSize; ++parallelPile )
     {
-        AlphabetSymbol currentPile = vectTriple[j].pileN;
-        for ( AlphabetSymbol g = 0 ; g < alphabetSize; g++ )
+        storeBWTandLCP_parallelPile( newSymb, parallelPile, pileStarts[parallelPile], pileStarts[parallelPile + 1] );
+    }
+
+    if ( verboseEncode == 1 )
+    {
+        cerr << "After the computation of LCP for the next iteration" << endl;
+        cerr << "Q  ";
+        for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            minLCPcur[g] = maxValueLen;
-            minLCPcurFound[g] = 0;
-            minLCPsuc[g] = maxValueLen;
-            minLCPsucText[g] = 0;   //denotes the number of the text associated with the symbol g
-            minLCPsucToFind[g] = 0;
+            cerr << ( int )triples_.pileN( g ) << " ";
         }
-        assert( currentPile < alphabetSize );
-        TmpFilename filenameIn( currentPile );
-        FILE *InFileBWT = fopen( filenameIn, "rb" );
-        if ( InFileBWT == NULL )
+        cerr << endl;
+        cerr << "P  ";
+        for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            cerr << "(storeBWTandLCP) In BWT file " << filenameIn << ": Error opening " << endl;
-            exit ( EXIT_FAILURE );
+            cerr << triples_.posN( g )  << " ";
         }
-        TmpFilename filenameOut( "new_", currentPile );
-        FILE *OutFileBWT = fopen( filenameOut, "wb" );
-        if ( OutFileBWT == NULL )
+        cerr << endl;
+        cerr << "N  ";
+        for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            cerr << "(storeBWTandLCP) Out BWT file " << filenameIn << ": Error opening " << endl;
-            exit ( EXIT_FAILURE );
+            cerr << triples_.seqN( g )  << " ";
         }
-        TmpFilename filenameInLCP( "", currentPile, ".lcp" );
-        FILE *InFileLCP = fopen( filenameInLCP, "rb" );
-        if ( InFileLCP == NULL )
+        cerr << endl;
+        cerr << "C  ";
+        for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            cerr << "In LCP file " << filenameInLCP << ": Error opening "  << endl;
-            exit ( EXIT_FAILURE );
+            cerr << triples_.getLcpCurN( g )  << " ";
         }
-        TmpFilename filenameOutLCP( "new_", currentPile, ".lcp" );
-        FILE *OutFileLCP = fopen( filenameOutLCP, "wb" );
-        if ( OutFileLCP == NULL )
+        cerr << endl;
+        cerr << "S  ";
+        for ( SequenceNumber g = 0 ; g < nText; g++ )
         {
-            cerr << "Out LCP file " << filenameInLCP << ": Error opening " << filenameOutLCP << endl;
-            exit ( EXIT_FAILURE );
+            cerr << triples_.getLcpSucN( g )  << " ";
         }
+        cerr << endl;
+    }
+}
 
-        //For each new symbol in the same pile
-        SequenceNumber k = j;
-        LetterNumber cont = 0;
-        while ( ( k < nText ) && ( vectTriple[k].pileN == currentPile ) )
+void BCRexternalBWT::storeBWTandLCP_parallelPile( uchar const *newSymb, const AlphabetSymbol currentPile, const SequenceNumber startIndex, const SequenceNumber endIndex )
+{
+    PhaseProfiler::Scope scope( profiler_, "store", currentPile );
+    if ( startIndex == endIndex )
+        return;
+
+    SequenceLength maxValueLen = lengthRead + 1;
+    vector <SequenceLength> minLCPcur( alphabetSize, maxValueLen );     //for each symbol of the alphabet
+    vector <bool> minLCPcurFound( alphabetSize, 0 );
+    vector <SequenceLength> minLCPsuc( alphabetSize, maxValueLen );
+    vector <SequenceNumber> minLCPsucText( alphabetSize, 0 );   //denotes the number of the text associated with the symbol g
+    vector <bool> minLCPsucToFind( alphabetSize, 0 );
+
+    LetterNumber numchar = 0;
+    LetterNumber numcharWrite = 0;
+    uchar *buffer = new uchar[SIZEBUFFER];
+    SequenceLength *bufferLCP = new SequenceLength[SIZEBUFFER];
+    LetterNumber toRead = 0;
+
+    TmpFilename filenameIn( currentPile );
+    FILE *InFileBWT = fopen( filenameIn, "rb" );
+    if ( InFileBWT == NULL )
+    {
+        cerr << "(storeBWTandLCP) In BWT file " << filenameIn << ": Error opening " << endl;
+        exit ( EXIT_FAILURE );
+    }
+    TmpFilename filenameOut( "new_", currentPile );
+    FILE *OutFileBWT = fopen( filenameOut, "wb" );
+    if ( OutFileBWT == NULL )
+    {
+        cerr << "(storeBWTandLCP) Out BWT file " << filenameIn << ": Error opening " << endl;
+        exit ( EXIT_FAILURE );
+    }
+    TmpFilename filenameInLCP( "", currentPile, ".lcp" );
+    LcpFileReader *pInLCP = new LcpFileReader( filenameInLCP.str() );
+    TmpFilename filenameOutLCP( "new_", currentPile, ".lcp" );
+    LcpFileWriter *pOutLCP = new LcpFileWriter( filenameOutLCP.str() );
+
+    //For each new symbol in the same pile
+    SequenceNumber k = startIndex;
+    LetterNumber cont = 0;
+    while ( k < endIndex )
+    {
+        //So I have to read the k-BWT and I have to count the number of the symbols up to the position posN.
+        //symbol = '\0';
+        //PosN is indexed from the position 1 and I have to insert the new symbol in position posN[k], then I have to read posN[k]-1 symbols
+        //cont is the number of symbols already read!
+        toRead = ( triples_.posN( k ) - 1 ) - cont;
+        while ( toRead > 0 )            //((numchar!=0) && (toRead > 0)) {
         {
-            //So I have to read the k-BWT and I have to count the number of the symbols up to the position posN.
-            //symbol = '\0';
-            //PosN is indexed from the position 1 and I have to insert the new symbol in position posN[k], then I have to read posN[k]-1 symbols
-            //cont is the number of symbols already read!
-            toRead = ( vectTriple[k].posN - 1 ) - cont;
-            while ( toRead > 0 )            //((numchar!=0) && (toRead > 0)) {
+            if ( toRead < SIZEBUFFER ) //The last reading for this sequence
             {
-                if ( toRead < SIZEBUFFER ) //The last reading for this sequence
-                {
-                    numchar = fread( buffer, sizeof( uchar ), toRead, InFileBWT );
-                    checkIfEqual( numchar , toRead );
-                    numcharWrite = fwrite ( buffer, sizeof( uchar ), numchar , OutFileBWT );
-                    checkIfEqual( numchar , numcharWrite );
-                    numchar = fread( bufferLCP, sizeof( SequenceLength ), toRead, InFileLCP );
-                    checkIfEqual( numchar , toRead );
-                    numcharWrite = fwrite ( bufferLCP, sizeof( SequenceLength ), numchar , OutFileLCP );
-                    checkIfEqual( numchar , numcharWrite );
-                }
-                else
+                numchar = fread( buffer, sizeof( uchar ), toRead, InFileBWT );
+                checkIfEqual( numchar , toRead );
+                numcharWrite = fwrite ( buffer, sizeof( uchar ), numchar , OutFileBWT );
+                checkIfEqual( numchar , numcharWrite );
+                numchar = pInLCP->read( bufferLCP, toRead );
+                checkIfEqual( numchar , toRead );
+                pOutLCP->write( bufferLCP, numchar );
+            }
+            else
+            {
+                numchar = fread( buffer, sizeof( uchar ), SIZEBUFFER, InFileBWT );
+                checkIfEqual( numchar , SIZEBUFFER );
+                numcharWrite = fwrite ( buffer, sizeof( uchar ), numchar , OutFileBWT );
+                checkIfEqual( numchar , numcharWrite );
+                numchar = pInLCP->read( bufferLCP, SIZEBUFFER );
+                checkIfEqual( numchar , SIZEBUFFER );
+                pOutLCP->write( bufferLCP, numchar );
+            }
+            //I must to compute the minimum LCP. It needs to compute the lcpValue for the next iteration
+            //cerr << "For each letter in the buffer before of the position where I have to insert the new symbol\n";
+            for ( LetterNumber bb = 0 ; bb < numcharWrite; bb++ )
+            {
+                //Update the min1 for each letter of the alphabet, for which I have already met the symbol
+                for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
                 {
-                    numchar = fread( buffer, sizeof( uchar ), SIZEBUFFER, InFileBWT );
-                    checkIfEqual( numchar , SIZEBUFFER );
-                    numcharWrite = fwrite ( buffer, sizeof( uchar ), numchar , OutFileBWT );
-                    checkIfEqual( numchar , numcharWrite );
-                    numchar = fread( bufferLCP, sizeof( SequenceLength ), SIZEBUFFER, InFileLCP );
-                    checkIfEqual( numchar , SIZEBUFFER );
-                    numcharWrite = fwrite ( bufferLCP, sizeof( SequenceLength ), numchar , OutFileLCP );
-                    checkIfEqual( numchar , numcharWrite );
+                    if ( minLCPcurFound[gg] == 1 ) //I already met the symbol gg. So, I must compute the minimum
+                        if ( bufferLCP[bb] < minLCPcur[gg] ) //comparison with the last inserted lcp
+                            minLCPcur[gg] = bufferLCP[bb];
                 }
-                //I must to compute the minimum LCP. It needs to compute the lcpValue for the next iteration
-                //cerr << "For each letter in the buffer before of the position where I have to insert the new symbol\n";
-                for ( LetterNumber bb = 0 ; bb < numcharWrite; bb++ )
-                {
-                    //Update the min1 for each letter of the alphabet, for which I have already met the symbol
-                    for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
-                    {
-                        if ( minLCPcurFound[gg] == 1 ) //I already met the symbol gg. So, I must compute the minimum
-                            if ( bufferLCP[bb] < minLCPcur[gg] ) //comparison with the last inserted lcp
-                                minLCPcur[gg] = bufferLCP[bb];
-                    }
 
-                    minLCPcur[whichPile[( int )buffer[bb]]] = maxValueLen; //For each occurrence of buffer[bb], I have to set the min1 (the interval starts from the next symbol)
-                    minLCPcurFound[whichPile[( int )buffer[bb]]] = 1; //So I open the LCP interval for buffer[bb] (for the first occurrence of buffer[bb])
+                minLCPcur[whichPile[( int )buffer[bb]]] = maxValueLen; //For each occurrence of buffer[bb], I have to set the min1 (the interval starts from the next symbol)
+                minLCPcurFound[whichPile[( int )buffer[bb]]] = 1; //So I open the LCP interval for buffer[bb] (for the first occurrence of buffer[bb])
 
-                    //First, it needs to check if the symbol buffer[bb] closes a previous interval or it is in the middle or no.
-                    //In any case, for each symbol, we have to update the minimum
-                    for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
-                    {
-                        if ( minLCPsucToFind[( int )gg] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
-                        {
-                            if ( bufferLCP[bb] < minLCPsuc[( int )gg] ) //comparison with the last inserted lcp
-                                minLCPsuc[( int )gg] = bufferLCP[bb];
-                        }
-                    }
-                    //If the symbol buffer[bb] does not close an LCP interval, ok!
-                    if ( minLCPsucToFind[whichPile[( int )buffer[bb]]] == 1 ) //The symbol buffer[bb] closed an interval LCP
+                //First, it needs to check if the symbol buffer[bb] closes a previous interval or it is in the middle or no.
+                //In any case, for each symbol, we have to update the minimum
+                for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
+                {
+                    if ( minLCPsucToFind[( int )gg] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
                     {
-                        //We have to compute the minimum for the lcp of the symbol buffer[bb]
-                        //I have already computed the minimum (close the previous lcp interval).
-                        //I can set lcpSucN of minLCPsucText[alpha[(int)[buffer[bb]]]
-                        vectTriple[minLCPsucText[whichPile[( int )buffer[bb]]]].setLcpSucN( minLCPsuc[whichPile[( int )buffer[bb]]] );
-                        //Since it closes the LCP interval, then
-                        minLCPsuc[whichPile[( int )buffer[bb]]] = maxValueLen;
-                        minLCPsucToFind[whichPile[( int )buffer[bb]]] = 0;
-                        minLCPsucText[whichPile[( int )buffer[bb]]] = 0;
+                        if ( bufferLCP[bb] < minLCPsuc[( int )gg] ) //comparison with the last inserted lcp
+                            minLCPsuc[( int )gg] = bufferLCP[bb];
                     }
                 }
-                cont   += numchar;  //number of read symbols
-                toRead -= numchar;
-                if ( ( numchar == 0 ) && ( toRead > 0 ) ) //it means that we have read 0 character, but there are still toRead characters to read
+                //If the symbol buffer[bb] does not close an LCP interval, ok!
+                if ( minLCPsucToFind[whichPile[( int )buffer[bb]]] == 1 ) //The symbol buffer[bb] closed an interval LCP
                 {
-                    // NO, abort program
-                    cerr << "Error storeBWT: sequence number" << ( int )k << " read 0 character, but there are still " << toRead << " characters to read  " << endl;
-                    exit ( EXIT_FAILURE );
+                    //We have to compute the minimum for the lcp of the symbol buffer[bb]
+                    //I have already computed the minimum (close the previous lcp interval).
+                    //I can set lcpSucN of minLCPsucText[alpha[(int)[buffer[bb]]]
+                    triples_.setLcpSucN( minLCPsucText[whichPile[( int )buffer[bb]]], minLCPsuc[whichPile[( int )buffer[bb]]] );
+                    //Since it closes the LCP interval, then
+                    minLCPsuc[whichPile[( int )buffer[bb]]] = maxValueLen;
+                    minLCPsucToFind[whichPile[( int )buffer[bb]]] = 0;
+                    minLCPsucText[whichPile[( int )buffer[bb]]] = 0;
                 }
+            }
+            cont   += numchar;  //number of read symbols
+            toRead -= numchar;
+            if ( ( numchar == 0 ) && ( toRead > 0 ) ) //it means that we have read 0 character, but there are still toRead characters to read
+            {
+                // NO, abort program
+                cerr << "Error storeBWT: sequence number" << ( int )k << " read 0 character, but there are still " << toRead << " characters to read  " << endl;
+                exit ( EXIT_FAILURE );
+            }
 
+        }
+        //Now I have to insert the new symbol associated with the suffix of the sequence k
+        //And I have to update the number of occurrences of each symbol
+        //And I have to insert the valueLCP store in lcpCurN + 1 in the previous iteration
+        if ( toRead == 0 )
+        {
+            //cerr << "\nNow I can insert the new symbol and lcp, indeed toRead= " << toRead << endl;
+            numchar = fwrite ( &newSymb[triples_.seqN( k )], sizeof( uchar ), 1, OutFileBWT );
+            checkIfEqual( numchar , 1 ); // we should always read/write the same number of characters
+            tableOcc_[currentPile].count_[whichPile[( int )newSymb[triples_.seqN( k )]]]++;
+            //tableOcc[currentPile][whichPile[(int)newSymb[vectTriple[k].seqN]]]++;       //update the number of occurrences in BWT of the pileN[k]
+            SequenceLength lcpValueNow;
+            if ( triples_.posN( k ) == 1 )   //it is the first symbol of the segment. So, the lcp value is 0
+            {
+                lcpValueNow = triples_.getLcpCurN( k );
             }
-            //Now I have to insert the new symbol associated with the suffix of the sequence k
-            //And I have to update the number of occurrences of each symbol
-            //And I have to insert the valueLCP store in lcpCurN + 1 in the previous iteration
-            if ( toRead == 0 )
+            else
+                lcpValueNow = triples_.getLcpCurN( k ) + 1;
+            pOutLCP->write( lcpValueNow ); //Insert the lcp for the new symbol
+            //cerr << "I insert the symbol= " << newSymb[vectTriple[k].seqN] <<  " and lcp " << lcpValueNow << endl;
+            //Update the lcpCurN for the next iteration
+            if ( minLCPcurFound[whichPile[( int )newSymb[triples_.seqN( k )]]] == 0 )
             {
-                //cerr << "\nNow I can insert the new symbol and lcp, indeed toRead= " << toRead << endl;
-                numchar = fwrite ( &newSymb[vectTriple[k].seqN], sizeof( uchar ), 1, OutFileBWT );
-                checkIfEqual( numchar , 1 ); // we should always read/write the same number of characters
-                tableOcc_[currentPile].count_[whichPile[( int )newSymb[vectTriple[k].seqN]]]++;
-                //tableOcc[currentPile][whichPile[(int)newSymb[vectTriple[k].seqN]]]++;       //update the number of occurrences in BWT of the pileN[k]
-                SequenceLength lcpValueNow;
-                if ( vectTriple[k].posN == 1 )   //it is the first symbol of the segment. So, the lcp value is 0
+                if ( minLCPcur[whichPile[( int )newSymb[triples_.seqN( k )]]] == maxValueLen )
                 {
-                    lcpValueNow = vectTriple[k].getLcpCurN();
+                    //it means that we have not met the symbol before of the position posN because minLCPcurFound is 0.
+                    //if minLCPcurFound is 0, then minLCPcur is maxValueLen
+                    triples_.setLcpCurN( k, 0 );         //The next suffix has suffix 0+1=1
                 }
-                else
-                    lcpValueNow = vectTriple[k].getLcpCurN() + 1;
-                numchar = fwrite ( &lcpValueNow, sizeof( SequenceLength ), 1, OutFileLCP ); //Insert the lcp for the new symbol
-                checkIfEqual( numchar , 1 );
-                //cerr << "I insert the symbol= " << newSymb[vectTriple[k].seqN] <<  " and lcp " << lcpValueNow << endl;
-                //Update the lcpCurN for the next iteration
-                if ( minLCPcurFound[whichPile[( int )newSymb[vectTriple[k].seqN]]] == 0 )
+            }
+            else    //it means that (minLCPcurFound[alpha[(int)newSymb[triples_.seqN( k )]]] == 1)
+            {
+                if ( minLCPcur[whichPile[( int )newSymb[triples_.seqN( k )]]] == maxValueLen )
                 {
-                    if ( minLCPcur[whichPile[( int )newSymb[vectTriple[k].seqN]]] == maxValueLen )
-                    {
-                        //it means that we have not met the symbol before of the position posN because minLCPcurFound is 0.
-                        //if minLCPcurFound is 0, then minLCPcur is maxValueLen
-                        vectTriple[k].setLcpCurN( 0 );         //The next suffix has suffix 0+1=1
-                    }
+                    //it means that we have met the symbol before of the position posN because minLCPcurFound is 1.
+                    //But minLCPcur is maxValueLen, this means that the previous occurrences of new symbol is the previous position
+                    triples_.setLcpCurN( k, lcpValueNow );         //The next suffix has suffix lcpValueNow+1
                 }
-                else    //it means that (minLCPcurFound[alpha[(int)newSymb[vectTriple[k].seqN]]] == 1)
+                else
                 {
-                    if ( minLCPcur[whichPile[( int )newSymb[vectTriple[k].seqN]]] == maxValueLen )
+                    if ( lcpValueNow < minLCPcur[whichPile[( int )newSymb[triples_.seqN( k )]]] )
                     {
-                        //it means that we have met the symbol before of the position posN because minLCPcurFound is 1.
-                        //But minLCPcur is maxValueLen, this means that the previous occurrences of new symbol is the previous position
-                        vectTriple[k].setLcpCurN( lcpValueNow );         //The next suffix has suffix lcpValueNow+1
+                        //comparison with the last inserted lcp. It means that the previous occurrence of new symbol is not the previous symbol
+                        triples_.setLcpCurN( k, lcpValueNow );
                     }
                     else
                     {
-                        if ( lcpValueNow < minLCPcur[whichPile[( int )newSymb[vectTriple[k].seqN]]] )
-                        {
-                            //comparison with the last inserted lcp. It means that the previous occurrence of new symbol is not the previous symbol
-                            vectTriple[k].setLcpCurN( lcpValueNow );
-                        }
-                        else
-                        {
-                            vectTriple[k].setLcpCurN( minLCPcur[whichPile[( int )newSymb[vectTriple[k].seqN]]] );
-                        }
+                        triples_.setLcpCurN( k, minLCPcur[whichPile[( int )newSymb[triples_.seqN( k )]]] );
                     }
                 }
+            }
 
-                //it may happen that the new symbol closes a previous interval or it is in the middle or no.
-                //In any case, for each symbol, we have to update the minimum
-                for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
+            //it may happen that the new symbol closes a previous interval or it is in the middle or no.
+            //In any case, for each symbol, we have to update the minimum
+            for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
+            {
+                if ( minLCPsucToFind[( int )gg] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
                 {
-                    if ( minLCPsucToFind[( int )gg] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
-                    {
-                        //if (minLCPsuc[gg] != maxValueLen) {      //There are an LCP interval opened for the symbol c_g
-                        if ( lcpValueNow < minLCPsuc[( int )gg] ) //comparison with the last inserted lcp
-                            minLCPsuc[( int )gg] = lcpValueNow;
-                        //}
-                    }
+                    //if (minLCPsuc[gg] != maxValueLen) {      //There are an LCP interval opened for the symbol c_g
+                    if ( lcpValueNow < minLCPsuc[( int )gg] ) //comparison with the last inserted lcp
+                        minLCPsuc[( int )gg] = lcpValueNow;
+                    //}
+                }
 
-                    if ( minLCPcurFound[( int )gg] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
-                    {
-                        if ( lcpValueNow < minLCPcur[( int )gg] ) //comparison with the last inserted lcp
-                            minLCPcur[( int )gg] = lcpValueNow;
-                    }
+                if ( minLCPcurFound[( int )gg] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
+                {
+                    if ( lcpValueNow < minLCPcur[( int )gg] ) //comparison with the last inserted lcp
+                        minLCPcur[( int )gg] = lcpValueNow;
                 }
+            }
 
-                //I have to re-set
-                minLCPcur[whichPile[( int )newSymb[vectTriple[k].seqN]]] = maxValueLen;  //I initialized the minLCPcur
-                minLCPcurFound[whichPile[( int )newSymb[vectTriple[k].seqN]]] = 1;  // I set the fact that I met the new symbol
+            //I have to re-set
+            minLCPcur[whichPile[( int )newSymb[triples_.seqN( k )]]] = maxValueLen;  //I initialized the minLCPcur
+            minLCPcurFound[whichPile[( int )newSymb[triples_.seqN( k )]]] = 1;  // I set the fact that I met the new symbol
 
-                if ( minLCPsucToFind[whichPile[( int )newSymb[vectTriple[k].seqN]]] == 1 ) //If the new symbol closes a LCP interval
+            if ( minLCPsucToFind[whichPile[( int )newSymb[triples_.seqN( k )]]] == 1 ) //If the new symbol closes a LCP interval
+            {
+                //I have already computed the minimum in the previous FOR (close the previous lcp interval).
+                //I can set lcpSucN of minLCPsucText[alpha[(int)[vectTriple[k].seqN]]]
+                triples_.setLcpSucN( minLCPsucText[whichPile[( int )newSymb[triples_.seqN( k )]]], minLCPsuc[whichPile[( int )newSymb[triples_.seqN( k )]]] );
+            }
+            //It set minLVP for the new LCP interval for the new symbol
+            //					minLCPsuc[alpha[(int)newSymb[vectTriple[k].seqN]]] = vectTriple[k].lcpCurN+1;   //It sets the min_2 for successive symbol with the current of the new symbol (next text)
+            minLCPsuc[whichPile[( int )newSymb[triples_.seqN( k )]]] = maxValueLen;
+            minLCPsucText[whichPile[( int )newSymb[triples_.seqN( k )]]] = k;
+            minLCPsucToFind[whichPile[( int )newSymb[triples_.seqN( k )]]] = 1; //I have to open the lcp succ for this sequence
+            //cerr << "minSuc was not the maxValue. The new value for minLCPsuc[" << newSymb[vectTriple[k].seqN] << "] is " << minLCPsuc[alpha[(int)newSymb[vectTriple[k].seqN]]] << "\n";
+
+            //Since we have inserted, we must update them
+            cont++;    //number of read symbols
+            toRead--;
+
+            //Now I have to update the lcp of the next symbol, if it exists.
+            if ( ( k + 1 < endIndex ) && ( triples_.posN( k + 1 ) == triples_.posN( k ) + 1 ) )
+            {
+                //If the next symbol is the new symbol associated with another text (in the same segment), that I have to insert yet
+                //I can ignored this updating, because the lcp of the new symbol is already computed
+                //We set the minLCPsuc with the value LCP associated with the next symbol that we have to insert in it.
+                //it should be vectTriple[k].lcpSucN + 1 == vectTriple[k+1].lcpCurN
+                if ( triples_.getLcpSucN( k ) + 1 != triples_.getLcpCurN( k + 1 ) + 1 )
                 {
-                    //I have already computed the minimum in the previous FOR (close the previous lcp interval).
-                    //I can set lcpSucN of minLCPsucText[alpha[(int)[vectTriple[k].seqN]]]
-                    vectTriple[minLCPsucText[whichPile[( int )newSymb[vectTriple[k].seqN]]]].setLcpSucN( minLCPsuc[whichPile[( int )newSymb[vectTriple[k].seqN]]] );
+                    cerr << "???? Warning!--Should be the same? triple[" << k << "].lcpSucN(=" << triples_.getLcpSucN( k ) << ") + 1= " << triples_.getLcpSucN( k ) + 1 << " == triple[" << k + 1 << "].lcpCurN+1= " << triples_.getLcpCurN( k + 1 ) + 1 << " ";
+                    cerr << ", Seq k N. " << triples_.seqN( k ) << " and Seq k+1 N. " << triples_.seqN( k + 1 ) << "\n";
                 }
-                //It set minLVP for the new LCP interval for the new symbol
-                //					minLCPsuc[alpha[(int)newSymb[vectTriple[k].seqN]]] = vectTriple[k].lcpCurN+1;   //It sets the min_2 for successive symbol with the current of the new symbol (next text)
-                minLCPsuc[whichPile[( int )newSymb[vectTriple[k].seqN]]] = maxValueLen;
-                minLCPsucText[whichPile[( int )newSymb[vectTriple[k].seqN]]] = k;
-                minLCPsucToFind[whichPile[( int )newSymb[vectTriple[k].seqN]]] = 1; //I have to open the lcp succ for this sequence
-                //cerr << "minSuc was not the maxValue. The new value for minLCPsuc[" << newSymb[vectTriple[k].seqN] << "] is " << minLCPsuc[alpha[(int)newSymb[vectTriple[k].seqN]]] << "\n";
-
-                //Since we have inserted, we must update them
-                cont++;    //number of read symbols
-                toRead--;
 
-                //Now I have to update the lcp of the next symbol, if it exists.
-                if ( ( k + 1 < nText ) && ( vectTriple[k + 1].pileN == currentPile ) && ( vectTriple[k + 1].posN == vectTriple[k].posN + 1 ) )
+                //Hence, at the next step, I have to insert the symbol newSymb[vectTriple[k+1].seqN]
+                //I check if newSymb[vectTriple[k+1].seqN] is equal to the inserted symbol now, that is newSymb[vectTriple[k].seqN]
+                if ( newSymb[triples_.seqN( k )] == newSymb[triples_.seqN( k + 1 )] )
                 {
-                    //If the next symbol is the new symbol associated with another text (in the same segment), that I have to insert yet
-                    //I can ignored this updating, because the lcp of the new symbol is already computed
-                    //We set the minLCPsuc with the value LCP associated with the next symbol that we have to insert in it.
-                    //it should be vectTriple[k].lcpSucN + 1 == vectTriple[k+1].lcpCurN
-                    if ( vectTriple[k].getLcpSucN() + 1 != vectTriple[k + 1].getLcpCurN() + 1 )
-                    {
-                        cerr << "???? Warning!--Should be the same? triple[" << k << "].lcpSucN(=" << vectTriple[k].getLcpSucN() << ") + 1= " << vectTriple[k].getLcpSucN() + 1 << " == triple[" << k + 1 << "].lcpCurN+1= " << vectTriple[k + 1].getLcpCurN() + 1 << " ";
-                        cerr << ", Seq k N. " << vectTriple[k].seqN << " and Seq k+1 N. " << vectTriple[k + 1].seqN << "\n";
-                    }
-
-                    //Hence, at the next step, I have to insert the symbol newSymb[vectTriple[k+1].seqN]
-                    //I check if newSymb[vectTriple[k+1].seqN] is equal to the inserted symbol now, that is newSymb[vectTriple[k].seqN]
-                    if ( newSymb[vectTriple[k].seqN] == newSymb[vectTriple[k + 1].seqN] )
-                    {
-                        //In this case, I can set the lcpSuc of newSymb[vectTriple[k].seqN] to vectTriple[k+1].lcpCurN + 1
-                        vectTriple[k].setLcpSucN( vectTriple[k + 1].getLcpCurN() + 1 );    //I set the lcpSucN of the current symbol (in position k)
-                        //I close the LCP interval for newSymb[vectTriple[k].seqN]], so
-                        minLCPsuc[whichPile[( int )newSymb[vectTriple[k].seqN]]] = maxValueLen;
-                        minLCPsucToFind[whichPile[( int )newSymb[vectTriple[k].seqN]]] = 0; //closes the LCP interval
-                        minLCPsucText[whichPile[( int )newSymb[vectTriple[k].seqN]]] = 0;
-                    }
-                    else
-                    {
-                        //In this case, I cannot set the lcpSuc of newSymb[vectTriple[k].seqN], because the symbol corresponding to k+1 is different
-                        //I set minLCPsuc of newSymb[vectTriple[k].seqN] to vectTriple[k+1].lcpCurN +1, and I search the symbol newSymb[vectTriple[k].seqN]
-                        minLCPsuc[whichPile[( int )newSymb[vectTriple[k].seqN]]] = vectTriple[k + 1].getLcpCurN() + 1;	//set the lcp interval
-                        minLCPsucToFind[whichPile[( int )newSymb[vectTriple[k].seqN]]] = 1;
-                        minLCPsucText[whichPile[( int )newSymb[vectTriple[k].seqN]]] = k;
-                    }
+                    //In this case, I can set the lcpSuc of newSymb[vectTriple[k].seqN] to vectTriple[k+1].lcpCurN + 1
+                    triples_.setLcpSucN( k, triples_.getLcpCurN( k + 1 ) + 1 );    //I set the lcpSucN of the current symbol (in position k)
+                    //I close the LCP interval for newSymb[vectTriple[k].seqN]], so
+                    minLCPsuc[whichPile[( int )newSymb[triples_.seqN( k )]]] = maxValueLen;
+                    minLCPsucToFind[whichPile[( int )newSymb[triples_.seqN( k )]]] = 0; //closes the LCP interval
+                    minLCPsucText[whichPile[( int )newSymb[triples_.seqN( k )]]] = 0;
                 }
                 else
                 {
-                    //The next symbol in the current segment, if there exists, it is an old symbol
-                    uchar sucSymbol = '\0';
-                    //it there exists another symbol in the segment file then I have to update it.
-                    numchar = fread( &sucSymbol, sizeof( uchar ), 1, InFileBWT );
-                    if ( numchar == 1 )  //There exists at least a symbol in the current segment
+                    //In this case, I cannot set the lcpSuc of newSymb[vectTriple[k].seqN], because the symbol corresponding to k+1 is different
+                    //I set minLCPsuc of newSymb[vectTriple[k].seqN] to vectTriple[k+1].lcpCurN +1, and I search the symbol newSymb[vectTriple[k].seqN]
+                    minLCPsuc[whichPile[( int )newSymb[triples_.seqN( k )]]] = triples_.getLcpCurN( k + 1 ) + 1;	//set the lcp interval
+                    minLCPsucToFind[whichPile[( int )newSymb[triples_.seqN( k )]]] = 1;
+                    minLCPsucText[whichPile[( int )newSymb[triples_.seqN( k )]]] = k;
+                }
+            }
+            else
+            {
+                //The next symbol in the current segment, if there exists, it is an old symbol
+                uchar sucSymbol = '\0';
+                //it there exists another symbol in the segment file then I have to update it.
+                numchar = fread( &sucSymbol, sizeof( uchar ), 1, InFileBWT );
+                if ( numchar == 1 )  //There exists at least a symbol in the current segment
+                {
+                    numcharWrite = fwrite ( &sucSymbol, sizeof( uchar ), numchar, OutFileBWT );
+                    assert( numchar == numcharWrite ); // we should always read/write the same number of characters
+                    //I have to update the lcp of the next symbol
+                    SequenceLength sucLCP = 0;
+                    numchar = pInLCP->read( &sucLCP, 1 ); //I have to change it
+                    checkIfEqual( numchar , 1 ); // we should always read/write the same number of characters
+
+                    //I have to update the lcp of this symbol and I have to copy it into the new bwt segment
+                    SequenceLength lcpValueNow = triples_.getLcpSucN( k ) + 1;
+                    pOutLCP->write( lcpValueNow ); //Updated the lcpSuc
+
+                    //Now, I have to check if the symbol sucSymbol close the LCP interval the new symbol
+                    if ( newSymb[triples_.seqN( k )] == sucSymbol )
+                    {
+                        //If it is equal to newSymb[vectTriple[k].seqN] then I can set lcpSucN of newSymb[vectTriple[k].seqN]
+                        triples_.setLcpSucN( k, lcpValueNow );
+                        minLCPsucToFind[whichPile[( int )newSymb[triples_.seqN( k )]]] = 0; //Close the LCP interval
+                        minLCPsuc[whichPile[( int )newSymb[triples_.seqN( k )]]] = maxValueLen;
+                        minLCPsucText[whichPile[( int )newSymb[triples_.seqN( k )]]] = 0;
+                    }
+                    else    			//cerr << "The succSymb is not equal to the new symbol\n";
                     {
-                        numcharWrite = fwrite ( &sucSymbol, sizeof( uchar ), numchar, OutFileBWT );
-                        assert( numchar == numcharWrite ); // we should always read/write the same number of characters
-                        //I have to update the lcp of the next symbol
-                        SequenceLength sucLCP = 0;
-                        numchar = fread( &sucLCP, sizeof( SequenceLength ), 1, InFileLCP ); //I have to change it
-                        checkIfEqual( numchar , 1 ); // we should always read/write the same number of characters
-
-                        //I have to update the lcp of this symbol and I have to copy it into the new bwt segment
-                        SequenceLength lcpValueNow = vectTriple[k].getLcpSucN() + 1;
-                        numcharWrite = fwrite ( &lcpValueNow , sizeof( SequenceLength ), numchar , OutFileLCP ); //Updated the lcpSuc
-                        checkIfEqual( numchar , numcharWrite ); // we should always read/write the same number of characters
-
-                        //Now, I have to check if the symbol sucSymbol close the LCP interval the new symbol
-                        if ( newSymb[vectTriple[k].seqN] == sucSymbol )
+                        minLCPsucToFind[whichPile[( int )newSymb[triples_.seqN( k )]]] = 1; //I have to search the symbol newSymb[triples_.seqN( k )]]
+                        minLCPsuc[whichPile[( int )newSymb[triples_.seqN( k )]]] = lcpValueNow; //I set the minLCPsuc for the new symbol
+                        minLCPsucText[whichPile[( int )newSymb[triples_.seqN( k )]]] = k;
+                        //It could close the LCP interval for the symbol sucSymb if it is opened
+                        //If the symbol sucSymbol does not close an LCP interval, ok!
+                        if ( minLCPsucToFind[whichPile[( int )sucSymbol]] == 1 )  //We have to compute the minimum for the lcp of the symbol (int)sucSymbol
                         {
-                            //If it is equal to newSymb[vectTriple[k].seqN] then I can set lcpSucN of newSymb[vectTriple[k].seqN]
-                            vectTriple[k].setLcpSucN( lcpValueNow );
-                            minLCPsucToFind[whichPile[( int )newSymb[vectTriple[k].seqN]]] = 0; //Close the LCP interval
-                            minLCPsuc[whichPile[( int )newSymb[vectTriple[k].seqN]]] = maxValueLen;
-                            minLCPsucText[whichPile[( int )newSymb[vectTriple[k].seqN]]] = 0;
+                            //it means that there is an interval lcp to close for the symbol (int)sucSymbol
+                            //The symbol sucSymbol closes a LCP interval
+                            if ( lcpValueNow < minLCPsuc[whichPile[( int )sucSymbol]] ) //comparison with the last inserted lcp
+                                minLCPsuc[whichPile[( int )sucSymbol]] = lcpValueNow;
+                            triples_.setLcpSucN( minLCPsucText[whichPile[( int )sucSymbol]], minLCPsuc[whichPile[( int )sucSymbol]] ); //I can set lcpSucN of minLCPsucText[alpha[(int)[sucSymbol]]
+                            //It closes the LCP interval, so
+                            minLCPsucToFind[whichPile[( int )sucSymbol]] = 0; //Close the LCP interval for the symbol sucSymbol
+                            minLCPsuc[whichPile[( int )sucSymbol]] = maxValueLen;
+                            minLCPsucText[whichPile[( int )sucSymbol]] = 0;
                         }
-                        else    			//cerr << "The succSymb is not equal to the new symbol\n";
+                    }
+
+                    //Now, I have to update the lcpSucc of the opened interval lcp
+                    for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
+                    {
+                        //Update the minLCPsuc
+                        if ( minLCPsucToFind[( int )gg] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
                         {
-                            minLCPsucToFind[whichPile[( int )newSymb[vectTriple[k].seqN]]] = 1; //I have to search the symbol newSymb[vectTriple[k].seqN]]
-                            minLCPsuc[whichPile[( int )newSymb[vectTriple[k].seqN]]] = lcpValueNow; //I set the minLCPsuc for the new symbol
-                            minLCPsucText[whichPile[( int )newSymb[vectTriple[k].seqN]]] = k;
-                            //It could close the LCP interval for the symbol sucSymb if it is opened
-                            //If the symbol sucSymbol does not close an LCP interval, ok!
-                            if ( minLCPsucToFind[whichPile[( int )sucSymbol]] == 1 )  //We have to compute the minimum for the lcp of the symbol (int)sucSymbol
+                            //if (minLCPsuc[gg] != maxValueLen) {      //There are an LCP interval opened for the symbol c_g
+                            if ( lcpValueNow < minLCPsuc[( int )gg] ) //comparison with the last inserted lcp
                             {
-                                //it means that there is an interval lcp to close for the symbol (int)sucSymbol
-                                //The symbol sucSymbol closes a LCP interval
-                                if ( lcpValueNow < minLCPsuc[whichPile[( int )sucSymbol]] ) //comparison with the last inserted lcp
-                                    minLCPsuc[whichPile[( int )sucSymbol]] = lcpValueNow;
-                                vectTriple[minLCPsucText[whichPile[( int )sucSymbol]]].setLcpSucN( minLCPsuc[whichPile[( int )sucSymbol]] ); //I can set lcpSucN of minLCPsucText[alpha[(int)[sucSymbol]]
-                                //It closes the LCP interval, so
-                                minLCPsucToFind[whichPile[( int )sucSymbol]] = 0; //Close the LCP interval for the symbol sucSymbol
-                                minLCPsuc[whichPile[( int )sucSymbol]] = maxValueLen;
-                                minLCPsucText[whichPile[( int )sucSymbol]] = 0;
+                                minLCPsuc[( int )gg] = lcpValueNow;
                             }
                         }
-
-                        //Now, I have to update the lcpSucc of the opened interval lcp
-                        for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
-                        {
-                            //Update the minLCPsuc
-                            if ( minLCPsucToFind[( int )gg] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
+                        //Update the minLCPCur
+                        if ( minLCPcurFound[gg] == 1 ) //I already met the symbol gg. So, I must compute the minimum
+                            if ( lcpValueNow < minLCPcur[gg] ) //comparison with the last inserted lcp for the symbol gg
                             {
-                                //if (minLCPsuc[gg] != maxValueLen) {      //There are an LCP interval opened for the symbol c_g
-                                if ( lcpValueNow < minLCPsuc[( int )gg] ) //comparison with the last inserted lcp
-                                {
-                                    minLCPsuc[( int )gg] = lcpValueNow;
-                                }
+                                minLCPcur[gg] = lcpValueNow;
                             }
-                            //Update the minLCPCur
-                            if ( minLCPcurFound[gg] == 1 ) //I already met the symbol gg. So, I must compute the minimum
-                                if ( lcpValueNow < minLCPcur[gg] ) //comparison with the last inserted lcp for the symbol gg
-                                {
-                                    minLCPcur[gg] = lcpValueNow;
-                                }
-                        }
+                    }
 
-                        //For the current LCP
-                        minLCPcur[whichPile[( int )sucSymbol]] = maxValueLen; //For each occurrence of sucSymbol, I have to set the min1(the interval starts from the next symbol)
-                        minLCPcurFound[whichPile[( int )sucSymbol]] = 1; //So I open the LCP interval for sucSymbol (for the first occurrence of sucSymbol)
+                    //For the current LCP
+                    minLCPcur[whichPile[( int )sucSymbol]] = maxValueLen; //For each occurrence of sucSymbol, I have to set the min1(the interval starts from the next symbol)
+                    minLCPcurFound[whichPile[( int )sucSymbol]] = 1; //So I open the LCP interval for sucSymbol (for the first occurrence of sucSymbol)
 
-                        //We have read another symbol of bwt and its associated lcp
-                        cont++;    //number of read symbols
-                        //toRead--;
-                    }
-                    else    //Then there are not other symbols.
+                    //We have read another symbol of bwt and its associated lcp
+                    cont++;    //number of read symbols
+                    //toRead--;
+                }
+                else    //Then there are not other symbols.
+                {
+                    //it means that the file does not contain other symbols and we have inserted the symbol in the last position
+                    //all lcp intervals have to be close and initializate
+                    for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
                     {
-                        //it means that the file does not contain other symbols and we have inserted the symbol in the last position
-                        //all lcp intervals have to be close and initializate
-                        for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
+                        if ( minLCPsucToFind[( int )gg] == 1 )  //We have to close the lcp interval of the symbol gg
                         {
-                            if ( minLCPsucToFind[( int )gg] == 1 )  //We have to close the lcp interval of the symbol gg
-                            {
-                                //if (minLCPsuc[gg] != maxValueLen) {      //LCP interval is apened for the symbol c_g
+                            //if (minLCPsuc[gg] != maxValueLen) {      //LCP interval is apened for the symbol c_g
 
-                                //I have to set the lcpSuc of the text minLCPsucText[(int)gg] to 0
-                                vectTriple[minLCPsucText[( int )gg]].setLcpSucN( 0 );
-                                minLCPsucToFind[( int )gg] = 0;
-                                minLCPsuc[( int )gg] = maxValueLen;
-                                minLCPsucText[( int )gg] = 0;
-                            }
+                            //I have to set the lcpSuc of the text minLCPsucText[(int)gg] to 0
+                            triples_.setLcpSucN( minLCPsucText[( int )gg], 0 );
+                            minLCPsucToFind[( int )gg] = 0;
+                            minLCPsuc[( int )gg] = maxValueLen;
+                            minLCPsucText[( int )gg] = 0;
                         }
                     }
                 }
             }
-            //}
-            k++;   //  I changed the number of the sequence. New iteration.
         }
-        //it means that posN[k]<>currentPile, so I have to change BWT-file
-        //But before, I have to copy the remainder symbols from the old BWT to new BWT
-        //We could need to compute the minLCPsuc for some text
-        //		numchar = 1;                   //***********************************
-        //if we have inserted the new symbol and we don't read or read the successive symbol, numchar=1,
-        //if we have inserted the new symbol and the successive symbol does not exists, numchar=0
-        while ( numchar != 0 )
-        {
-            //For BWT
-            numchar = fread( buffer, sizeof( uchar ), SIZEBUFFER, InFileBWT );
-            numcharWrite = fwrite ( buffer, sizeof( uchar ), numchar , OutFileBWT );
-            assert( numchar == numcharWrite ); // we should always read/write the same number of characters
-            //For LCP
-            numchar = fread( bufferLCP, sizeof( SequenceLength ), SIZEBUFFER, InFileLCP );
-            numcharWrite = fwrite ( bufferLCP, sizeof( SequenceLength ), numchar , OutFileLCP );
-            assert( numchar == numcharWrite ); // we should always read/write the same number of characters
-            //Compute lcpSucN for the other texts
-            //For each symbol in the buffer, we check it it close any interval, while each entry in minLcpSuc is maxValue
-
-            //TBD: TO OPTIMIZE. IT CAN END BEFORE. IT DOES NOT NEED TO READ THE ENTIRE BUFFER
-
-            for ( LetterNumber bb = 0 ; bb < numchar; bb++ )
+        //}
+        k++;   //  I changed the number of the sequence. New iteration.
+    }
+    //it means that posN[k]<>currentPile, so I have to change BWT-file
+    //But before, I have to copy the remainder symbols from the old BWT to new BWT
+    //We could need to compute the minLCPsuc for some text
+    //		numchar = 1;                   //***********************************
+    //if we have inserted the new symbol and we don't read or read the successive symbol, numchar=1,
+    //if we have inserted the new symbol and the successive symbol does not exists, numchar=0
+    while ( numchar != 0 )
+    {
+        //For BWT
+        numchar = fread( buffer, sizeof( uchar ), SIZEBUFFER, InFileBWT );
+        numcharWrite = fwrite ( buffer, sizeof( uchar ), numchar , OutFileBWT );
+        assert( numchar == numcharWrite ); // we should always read/write the same number of characters
+        //For LCP
+        numchar = pInLCP->read( bufferLCP, SIZEBUFFER );
+        assert( numchar == numcharWrite ); // we should always read/write the same number of characters
+        pOutLCP->write( bufferLCP, numchar );
+        //Compute lcpSucN for the other texts
+        //For each symbol in the buffer, we check it it close any interval, while each entry in minLcpSuc is maxValue
+
+        //TBD: TO OPTIMIZE. IT CAN END BEFORE. IT DOES NOT NEED TO READ THE ENTIRE BUFFER
+
+        for ( LetterNumber bb = 0 ; bb < numchar; bb++ )
+        {
+            //First, I check if the symbol bb closes a previous interval or it is in the middle or no.
+            //In any case, for each symbol, we have to update the minimum
+            for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
             {
-                //First, I check if the symbol bb closes a previous interval or it is in the middle or no.
-                //In any case, for each symbol, we have to update the minimum
-                for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
+                if ( minLCPsucToFind[( int )gg] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
                 {
-                    if ( minLCPsucToFind[( int )gg] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
+                    //if (minLCPsuc[gg] != maxValueLen) {      //There are an LCP interval apened for the symbol c_g
+                    if ( bufferLCP[bb] < minLCPsuc[( int )gg] ) //comparison with the last inserted lcp
                     {
-                        //if (minLCPsuc[gg] != maxValueLen) {      //There are an LCP interval apened for the symbol c_g
-                        if ( bufferLCP[bb] < minLCPsuc[( int )gg] ) //comparison with the last inserted lcp
-                        {
-                            minLCPsuc[( int )gg] = bufferLCP[bb];
-                        }
+                        minLCPsuc[( int )gg] = bufferLCP[bb];
                     }
                 }
-                //If the symbol buffer[bb] does not close an LCP interval, ok!
-                if ( minLCPsucToFind[whichPile[( int )buffer[bb]]] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
-                {
-                    //if (minLCPsuc[alpha[(int)buffer[bb]]] != maxValueLen) {       //it means that there is an interval lcp to close for this symbol
-                    //The symbol bb closes a LCP interval
-                    //I have already computed the minimum (close the previous lcp interval).
-                    //I can set lcpSucN of minLCPsucText[alpha[(int)[bb]]
-                    vectTriple[minLCPsucText[whichPile[( int )buffer[bb]]]].setLcpSucN( minLCPsuc[whichPile[( int )buffer[bb]]] );
-                    //It close the LCP interval, so
-                    minLCPsucToFind[whichPile[( int )buffer[bb]]] = 0;
-                    minLCPsuc[whichPile[( int )buffer[bb]]] = maxValueLen;
-                    minLCPsucText[whichPile[( int )buffer[bb]]] = 0;
-                }
-            }  //~For
-            //           } //~If       //***********************************
-        }   //~While
-        //The file is finished! but some interval lcp could be opened
-        //In this case, we have to set the lcpSuc to 0
-        for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
-        {
-            if ( minLCPsucToFind[( int )gg] == 1 )  //We have to close the lcp interval of the symbol gg
+            }
+            //If the symbol buffer[bb] does not close an LCP interval, ok!
+            if ( minLCPsucToFind[whichPile[( int )buffer[bb]]] == 1 )  //We have to compute the minimum for the lcp of the symbol gg
             {
-                //if (minLCPsuc[gg] != maxValueLen) {      //There are an LCP interval opened for the symbol c_g
-                vectTriple[minLCPsucText[( int )gg]].setLcpSucN( 0 );
-                minLCPsucToFind[( int )gg] = 0;
-                minLCPsuc[( int )gg] = maxValueLen;
-                minLCPsucText[( int )gg] = 0;
+                //if (minLCPsuc[alpha[(int)buffer[bb]]] != maxValueLen) {       //it means that there is an interval lcp to close for this symbol
+                //The symbol bb closes a LCP interval
+                //I have already computed the minimum (close the previous lcp interval).
+                //I can set lcpSucN of minLCPsucText[alpha[(int)[bb]]
+                triples_.setLcpSucN( minLCPsucText[whichPile[( int )buffer[bb]]], minLCPsuc[whichPile[( int )buffer[bb]]] );
+                //It close the LCP interval, so
+                minLCPsucToFind[whichPile[( int )buffer[bb]]] = 0;
+                minLCPsuc[whichPile[( int )buffer[bb]]] = maxValueLen;
+                minLCPsucText[whichPile[( int )buffer[bb]]] = 0;
             }
-        }
-
-        fclose( InFileBWT );
-        fclose( OutFileBWT );
-        fclose( InFileLCP );
-        fclose( OutFileLCP );
-
-        //Rename files
-        //cerr << "Filenames:" << filenameIn << "\t" <<filenameOut << endl;
-        OutFileBWT = fopen( filenameOut, "r" );
-        if ( OutFileBWT != NULL ) //If it exists
-        {
-            fclose( OutFileBWT );
-            if ( remove( filenameIn ) != 0 )
-                cerr << filenameIn << ": Error deleting file" << endl;
-            else if ( safeRename( filenameOut, filenameIn ) )
-                cerr << filenameOut << ": Error renaming " << endl;
-        }
-        //cerr << "Filenames:" << filenameIn << "\t" <<filenameOut << endl;
-        OutFileLCP = fopen( filenameOutLCP, "r" );
-        if ( OutFileLCP != NULL ) //If it exists
-        {
-            fclose( OutFileLCP );
-            if ( remove( filenameInLCP ) != 0 )
-                cerr << filenameInLCP << ": Error deleting file" << endl;
-            else if ( safeRename( filenameOutLCP, filenameInLCP ) )
-                cerr << filenameOutLCP << ": Error renaming " << endl;
-        }
-
-        j = k;
-    }
-
-    if ( verboseEncode == 1 )
+        }  //~For
+        //           } //~If       //***********************************
+    }   //~While
+    //The file is finished! but some interval lcp could be opened
+    //In this case, we have to set the lcpSuc to 0
+    for ( AlphabetSymbol gg = 0 ; gg < alphabetSize; gg++ )
     {
-        cerr << "After the computation of LCP for the next iteration" << endl;
-        cerr << "Q  ";
-        for ( SequenceNumber g = 0 ; g < nText; g++ )
-        {
-            cerr << ( int )vectTriple[g].pileN << " ";
-        }
-        cerr << endl;
-        cerr << "P  ";
-        for ( SequenceNumber g = 0 ; g < nText; g++ )
-        {
-            cerr << vectTriple[g].posN  << " ";
-        }
-        cerr << endl;
-        cerr << "N  ";
-        for ( SequenceNumber g = 0 ; g < nText; g++ )
-        {
-            cerr << vectTriple[g].seqN  << " ";
-        }
-        cerr << endl;
-        cerr << "C  ";
-        for ( SequenceNumber g = 0 ; g < nText; g++ )
+        if ( minLCPsucToFind[( int )gg] == 1 )  //We have to close the lcp interval of the symbol gg
         {
-            cerr << vectTriple[g].getLcpCurN()  << " ";
+            //if (minLCPsuc[gg] != maxValueLen) {      //There are an LCP interval opened for the symbol c_g
+            triples_.setLcpSucN( minLCPsucText[( int )gg], 0 );
+            minLCPsucToFind[( int )gg] = 0;
+            minLCPsuc[( int )gg] = maxValueLen;
+            minLCPsucText[( int )gg] = 0;
         }
-        cerr << endl;
-        cerr << "S  ";
-        for ( SequenceNumber g = 0 ; g < nText; g++ )
-        {
-            cerr << vectTriple[g].getLcpSucN()  << " ";
-        }
-        cerr << endl;
     }
 
-    //Renaming new to old
-    for ( AlphabetSymbol g = 0 ; g < alphabetSize; g++ )
-    {
-        TmpFilename filenameOut( "new_", g );
-        TmpFilename filenameIn( g );
-        //cerr << "Filenames:" << filenameIn << "\t" <<filenameOut << endl;
-        FILE *OutFileBWT = fopen( filenameOut, "rb" );
-        if ( OutFileBWT != NULL ) //If it exists
-        {
-            fclose( OutFileBWT );
-            if ( remove( filenameIn ) != 0 )
-                cerr << filenameIn << ": Error deleting file" << endl;
-            else if ( safeRename( filenameOut, filenameIn ) )
-                cerr << filenameOut << ": Error renaming " << endl;
-        }
+    fclose( InFileBWT );
+    fclose( OutFileBWT );
+    delete pInLCP;
+    delete pOutLCP;
 
-        TmpFilename filenameOutLCP( "new_", g, ".lcp" );
-        TmpFilename filenameInLCP( "", g, ".lcp" );
-        //cerr << "Filenames:" << filenameIn << "\t" <<filenameOut << endl;
-        FILE *OutFileLCP = fopen( filenameOutLCP, "rb" );
-        if ( OutFileLCP != NULL ) //If it exists
-        {
-            fclose( OutFileLCP );
-            if ( remove( filenameInLCP ) != 0 )
-                cerr << filenameInLCP << ": Error deleting file" << endl;
-            else if ( safeRename( filenameOutLCP, filenameInLCP ) )
-                cerr << filenameOutLCP << ": Error renaming " << endl;
-        }
+    //Rename files
+    //cerr << "Filenames:" << filenameIn << "\t" <<filenameOut << endl;
+    OutFileBWT = fopen( filenameOut, "r" );
+    if ( OutFileBWT != NULL ) //If it exists
+    {
+        fclose( OutFileBWT );
+        if ( remove( filenameIn ) != 0 )
+            cerr << filenameIn << ": Error deleting file" << endl;
+        else if ( safeRename( filenameOut, filenameIn ) )
+            cerr << filenameOut << ": Error renaming " << endl;
     }
+    //cerr << "Filenames:" << filenameIn << "\t" <<filenameOut << endl;
+    if ( remove( filenameInLCP ) != 0 )
+        cerr << filenameInLCP << ": Error deleting file" << endl;
+    else if ( safeRename( filenameOutLCP, filenameInLCP ) )
+        cerr << filenameOutLCP << ": Error renaming " << endl;
 
     delete [] buffer;
     delete [] bufferLCP;
@@ -2891,33 +3060,19 @@ void BCRexternalBWT::storeEntireLCP( const string &fn )
     for ( AlphabetSymbol g = 0 ; g < alphabetSize; g++ )
     {
         TmpFilename filenameInLCP( "", g, ".lcp" );
-        FILE *InFileLCP = fopen( filenameInLCP, "rb" );
-        if ( InFileLCP == NULL )
-        {
-            cerr << "In LCP file " << filenameInLCP << ": Error opening "  << endl;
-            exit ( EXIT_FAILURE );
-        }
-
-
-        if ( InFileLCP == NULL )
-        {
-            cerr << "storeEntireLCP: " << "LCP file " << ( int )g << ": Error opening " << endl;
-            exit ( EXIT_FAILURE );
-        }
+        LcpFileReader lcpReader( filenameInLCP.str() );
         cerr << "LCP file " << fnLCP << "\n";
-        numchar = fread( bufferLCP, sizeof( SequenceLength ), SIZEBUFFER, InFileLCP );
+        numchar = lcpReader.read( bufferLCP, SIZEBUFFER );
         numcharWrite = fwrite( bufferLCP, sizeof( SequenceLength ), numchar, OutFileLCP );
         checkIfEqual( numchar, numcharWrite ); // we should always read/write the same number of characters
- 
+
         while ( numchar != 0 )
         {
-            numchar = fread( bufferLCP, sizeof( SequenceLength ), SIZEBUFFER, InFileLCP );
+            numchar = lcpReader.read( bufferLCP, SIZEBUFFER );
             numcharWrite = fwrite( bufferLCP, sizeof( SequenceLength ), numchar, OutFileLCP );
             checkIfEqual( numchar, numcharWrite ); // we should always read/write the same number of characters
             numTotLcp += numcharWrite;
         }
-
-        fclose( InFileLCP );
     }
     fclose( OutFileLCP );
 
@@ -2974,15 +3129,27 @@ void BCRexternalBWT::writeEndPosFile( const uint8_t subSequenceNum, const bool l
     FILE *OutFileEndPos = NULL;
     static bool firstTime = true;
     char inBuf[ sizeof( SequenceNumber ) + sizeof( uint8_t ) ];
-    if ( !firstTime )
+    const bool appending = ( *bwtParams_ )[PARAMETER_APPEND_TO].isSet();
+    if ( !firstTime || appending )
     {
-        Filename previousFileEndPos( bwtParams_->getStringValue( "output filename" ).c_str(), "-end-pos-intermediate" );
-        inFileEndPos = fopen( previousFileEndPos, "rb" );
+        // When appending, the mapping of the existing '$' signs comes from a copy of the existing end-pos file
+        const string previousFileEndPos = firstTime ? TmpFilename( "append-end-pos" ).str() : Filename( bwtParams_->getStringValue( "output filename" ).c_str(), "-end-pos-intermediate" ).str();
+        inFileEndPos = fopen( previousFileEndPos.c_str(), "rb" );
+        if ( inFileEndPos == NULL )
+        {
+            cerr << "Error opening \"" << previousFileEndPos << "\" file" << endl;
+            exit ( EXIT_FAILURE );
+        }
         SequenceNumber skipNumText;
         uint8_t skipSubSequenceCount, skipHasRevComp;
         fread ( &skipNumText, sizeof( SequenceNumber ), 1 , inFileEndPos );
         fread ( &skipSubSequenceCount, sizeof( uint8_t ), 1 , inFileEndPos );
         fread ( &skipHasRevComp, sizeof( uint8_t ), 1 , inFileEndPos );
+        if ( appending && firstTime && ( skipNumText != appendedSeqCount_ || skipSubSequenceCount != 1 || skipHasRevComp != 0 ) )
+        {
+            cerr << "Error: " << previousFileEndPos << " doesn't match the BWT we are appending to, or was generated with sub-sequences or reverse complements" << endl;
+            exit ( EXIT_FAILURE );
+        }
     }
     Filename fileEndPos( bwtParams_->getStringValue( "output filename" ).c_str(), lastFile ? "-end-pos" : "-end-pos-intermediate" );
     OutFileEndPos = fopen( fileEndPos, "wb" );
@@ -3014,7 +3181,8 @@ void BCRexternalBWT::writeEndPosFile( const uint8_t subSequenceNum, const bool l
     {
         subSequenceCount = firstTime ? 1 : 2;
     }
-    numchar = fwrite ( &seqCount, sizeof( SequenceNumber ), 1 , OutFileEndPos );
+    const SequenceNumber totalSeqCount = appendedSeqCount_ + seqCount;
+    numchar = fwrite ( &totalSeqCount, sizeof( SequenceNumber ), 1 , OutFileEndPos );
     assert( numchar == 1 );
     numchar = fwrite ( &subSequenceCount, sizeof( uint8_t ), 1 , OutFileEndPos );
     assert( numchar == 1 );
@@ -3028,7 +3196,7 @@ void BCRexternalBWT::writeEndPosFile( const uint8_t subSequenceNum, const bool l
     unique_ptr<BwtReaderBase> pReader;
     for ( SequenceNumber i = 0; i < nText; i++ )
     {
-        while ( currentPile != vectTriple[i].pileN )
+        while ( currentPile != triples_.pileN( i ) )
         {
             ++currentPile;
             // finish read&counting current bwt file
@@ -3053,7 +3221,7 @@ void BCRexternalBWT::writeEndPosFile( const uint8_t subSequenceNum, const bool l
         }
 
         // read&count current bwt file until position vectTriple[i].posN
-        LetterNumber toRead = vectTriple[i].posN - cont - 1;
+        LetterNumber toRead = triples_.posN( i ) - cont - 1;
         counters.clear();
         LetterNumber numberRead = ( *pReader ).readAndCount( counters, toRead );
         if ( toRead != numberRead )
@@ -3063,7 +3231,7 @@ void BCRexternalBWT::writeEndPosFile( const uint8_t subSequenceNum, const bool l
             cerr << "  numberRead=" << numberRead << endl;
             cerr << "  cont=" << cont << endl;
             cerr << "  i=" << i << endl;
-            cerr << "  vectTriple[i].posN=" << vectTriple[i].posN << endl;
+            cerr << "  vectTriple[i].posN=" << triples_.posN( i ) << endl;
             assert( false );
         }
         cont += toRead;
@@ -3083,9 +3251,9 @@ void BCRexternalBWT::writeEndPosFile( const uint8_t subSequenceNum, const bool l
         ++cont;
 
         // insert entry
-        Logger_if( LOG_FOR_DEBUGGING ) Logger::out() << "Triple: " << vectTriple[i].seqN << " " << vectTriple[i].posN << " " << ( int )vectTriple[i].pileN << endl;
-        uint8_t extendedSubSeqNum = vectTriple[i].seqN / seqCount;
-        SequenceNumber seqNumWithoutRevCompOrPair = vectTriple[i].seqN % seqCount;
+        Logger_if( LOG_FOR_DEBUGGING ) Logger::out() << "Triple: " << triples_.seqN( i ) << " " << triples_.posN( i ) << " " << ( int )triples_.pileN( i ) << endl;
+        uint8_t extendedSubSeqNum = triples_.seqN( i ) / seqCount;
+        SequenceNumber seqNumWithoutRevCompOrPair = appendedSeqCount_ + triples_.seqN( i ) % seqCount;
 
         numchar = fwrite ( &seqNumWithoutRevCompOrPair, sizeof( SequenceNumber ), 1 , OutFileEndPos );
         assert( numchar == 1 );
@@ -3093,13 +3261,34 @@ void BCRexternalBWT::writeEndPosFile( const uint8_t subSequenceNum, const bool l
         assert( numchar == 1 );
     }
 
+    // Transfer the entries of the '$' signs located after the last new one
+    if ( inFileEndPos )
+    {
+        while ( true )
+        {
+            counters.clear();
+            if ( pReader )
+                pReader->readAndCount( counters );
+            for ( unsigned int j = 0; j < counters.count_[0]; ++j )
+            {
+                fread( inBuf, sizeof( SequenceNumber ) + sizeof( uint8_t ), 1, inFileEndPos );
+                fwrite( inBuf, sizeof( SequenceNumber ) + sizeof( uint8_t ), 1, OutFileEndPos );
+            }
+            if ( ++currentPile >= alphabetSize )
+                break;
+            TmpFilename filenameIn( "", currentPile, "" );
+            pReader.reset( instantiateBwtReaderForLastCycle( filenameIn ) );
+        }
+        fclose( inFileEndPos );
+    }
+
     fclose( OutFileEndPos );
     Logger::out() << "'end positions' stored!" << endl;
 
-    if ( !firstTime )
+    if ( !firstTime || appending )
     {
-        Filename previousFileEndPos( bwtParams_->getStringValue( "output filename" ).c_str(), "-end-pos-intermediate" );
-        if ( remove( previousFileEndPos ) != 0 )
+        const string previousFileEndPos = firstTime ? TmpFilename( "append-end-pos" ).str() : Filename( bwtParams_->getStringValue( "output filename" ).c_str(), "-end-pos-intermediate" ).str();
+        if ( remove( previousFileEndPos.c_str() ) != 0 )
             cerr << "Error deleting file " << previousFileEndPos << endl;
     }
     firstTime = false;
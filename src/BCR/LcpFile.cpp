@@ -0,0 +1,140 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "LcpFile.hh"
+
+#include "Tools.hh"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+
+namespace
+{
+
+const size_t lcpFileBufferSize = 1024 * 1024;
+
+} // anonymous namespace
+
+
+LcpFileReader::LcpFileReader( const string &filename )
+    : filename_( filename )
+    , buf_( lcpFileBufferSize )
+    , bufPos_( 0 )
+    , bufEnd_( 0 )
+{
+    file_ = fopen( filename.c_str(), "rb" );
+    if ( file_ == NULL )
+    {
+        cerr << "In LCP file " << filename << ": Error opening " << endl;
+        exit ( EXIT_FAILURE );
+    }
+}
+
+LcpFileReader::~LcpFileReader()
+{
+    fclose( file_ );
+}
+
+bool LcpFileReader::refill()
+{
+    // Keeps the bytes of a value that may be split across two buffers
+    const size_t remaining = bufEnd_ - bufPos_;
+    for ( size_t i = 0; i < remaining; ++i )
+        buf_[i] = buf_[bufPos_ + i];
+    bufPos_ = 0;
+    bufEnd_ = remaining + fread( &buf_[remaining], 1, buf_.size() - remaining, file_ );
+    return bufEnd_ > remaining;
+}
+
+LetterNumber LcpFileReader::read( SequenceLength *values, const LetterNumber n )
+{
+    LetterNumber count = 0;
+    while ( count < n )
+    {
+        // Makes sure a whole value is in the buffer, unless at end of file
+        if ( bufEnd_ - bufPos_ < maxBytesPerLcpValue && !refill() && bufPos_ == bufEnd_ )
+            break;
+        SequenceLength v = 0;
+        int shift = 0;
+        unsigned char byte;
+        do
+        {
+            if ( bufPos_ == bufEnd_ )
+            {
+                cerr << "LCP file " << filename_ << " is truncated" << endl;
+                exit ( EXIT_FAILURE );
+            }
+            byte = buf_[bufPos_++];
+            v |= ( SequenceLength )( byte & 0x7F ) << shift;
+            shift += 7;
+        }
+        while ( byte & 0x80 );
+        values[count++] = v;
+    }
+    return count;
+}
+
+
+LcpFileWriter::LcpFileWriter( const string &filename, const bool append )
+    : filename_( filename )
+    , buf_( lcpFileBufferSize )
+    , bufPos_( 0 )
+{
+    file_ = fopen( filename.c_str(), append ? "ab" : "wb" );
+    if ( file_ == NULL )
+    {
+        cerr << "Out LCP file " << filename << ": Error opening " << endl;
+        exit ( EXIT_FAILURE );
+    }
+}
+
+LcpFileWriter::~LcpFileWriter()
+{
+    flush();
+    fclose( file_ );
+}
+
+void LcpFileWriter::write( const SequenceLength *values, const LetterNumber n )
+{
+    for ( LetterNumber i = 0; i < n; ++i )
+        write( values[i] );
+}
+
+void LcpFileWriter::flush()
+{
+    const size_t written = fwrite( &buf_[0], 1, bufPos_, file_ );
+    checkIfEqual( written, bufPos_ );
+    bufPos_ = 0;
+}
+
+
+void convertLcpFileToRaw( const string &inputFilename, const string &outputFilename )
+{
+    LcpFileReader reader( inputFilename );
+    FILE *outFile = fopen( outputFilename.c_str(), "wb" );
+    if ( outFile == NULL )
+    {
+        cerr << "LCP file " << outputFilename << ": Error opening " << endl;
+        exit ( EXIT_FAILURE );
+    }
+    vector<SequenceLength> buffer( 65536 );
+    LetterNumber numchar;
+    while ( ( numchar = reader.read( &buffer[0], buffer.size() ) ) != 0 )
+    {
+        const LetterNumber numcharWrite = fwrite( &buffer[0], sizeof( SequenceLength ), numchar, outFile );
+        checkIfEqual( numchar, numcharWrite );
+    }
+    fclose( outFile );
+}
@@ -0,0 +1,86 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef LCP_FILE_HH
+#define LCP_FILE_HH
+
+#include "Types.hh"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+// Intermediate LCP files of the BCR construction store one variable-width
+// value per BWT letter: 7 bits per byte, the high bit meaning "more bytes
+// follow". LCP values are bounded by the read length, so they mostly take
+// one byte instead of sizeof( SequenceLength ).
+
+const size_t maxBytesPerLcpValue = ( sizeof( SequenceLength ) * 8 + 6 ) / 7;
+
+class LcpFileReader
+{
+public:
+    LcpFileReader( const string &filename );
+    ~LcpFileReader();
+
+    // Reads up to n values, returns the number of values read
+    LetterNumber read( SequenceLength *values, const LetterNumber n );
+
+private:
+    bool refill();
+
+    const string filename_;
+    FILE *file_;
+    vector<unsigned char> buf_;
+    size_t bufPos_;
+    size_t bufEnd_;
+};
+
+class LcpFileWriter
+{
+public:
+    LcpFileWriter( const string &filename, const bool append = false );
+    ~LcpFileWriter();
+
+    void write( const SequenceLength *values, const LetterNumber n );
+    void write( const SequenceLength value )
+    {
+        if ( bufPos_ + maxBytesPerLcpValue > buf_.size() )
+            flush();
+        SequenceLength v = value;
+        while ( v >= 0x80 )
+        {
+            buf_[bufPos_++] = ( unsigned char )( v | 0x80 );
+            v >>= 7;
+        }
+        buf_[bufPos_++] = ( unsigned char )v;
+    }
+
+private:
+    void flush();
+
+    const string filename_;
+    FILE *file_;
+    vector<unsigned char> buf_;
+    size_t bufPos_;
+};
+
+// Decodes an intermediate LCP file into sizeof( SequenceLength ) bytes per value,
+// the format of the -L0x output files
+void convertLcpFileToRaw( const string &inputFilename, const string &outputFilename );
+
+
+#endif // LCP_FILE_HH
@@ -13,16 +13,19 @@
 #include "Sorting.hh"
 
 #include <algorithm>
+#include <cassert>
 #include <cstdio>
 #include <cstdlib>
 #include <vector>
 
 #ifdef _OPENMP
 #include <omp.h>
-#include <parallel/algorithm>
 #endif //ifdef _OPENMP
 
 
+using namespace std;
+
+
 bool cmpSortEl ( sortElement a, sortElement b )
 {
     if ( a.pileN == b.pileN )
@@ -31,11 +34,197 @@ bool cmpSortEl ( sortElement a, sortElement b )
         return ( a.pileN < b.pileN );
 }
 
-void quickSort( vector< sortElement > &v )
+namespace
+{
+
+const int radixBits = 8;
+const int radixSize = 1 << radixBits;
+
+int bitsNeededFor( uint64_t maxValue )
 {
+    int bits = 0;
+    while ( maxValue >> bits )
+        ++bits;
+    return bits;
+}
+
+} // anonymous namespace
+
+void sortByPileAndPosition( vector< sortElement > &v )
+{
+    // Stable LSD radix sort of a (pileN, posN) key, stored with the element
+    // indices as separate arrays, followed by a single gather of the elements
+    const size_t n = v.size();
+    if ( n < 2 )
+        return;
+    assert( n - 1 <= maxSequenceNumber );
+
+    LetterNumber maxPos = 0;
+    AlphabetSymbol maxPile = 0;
+    for ( size_t i = 0; i < n; ++i )
+    {
+        maxPos = max( maxPos, ( LetterNumber )v[i].posN );
+        maxPile = max( maxPile, v[i].pileN );
+    }
+    const int posBits = bitsNeededFor( maxPos );
+    const int keyBits = posBits + bitsNeededFor( maxPile );
+    assert( keyBits <= 64 );
+    const int passCount = ( keyBits + radixBits - 1 ) / radixBits;
+
+    vector<uint64_t> keys( n ), keys2( n );
+    vector<SequenceNumber> indices( n ), indices2( n );
+    #pragma omp parallel for
+    for ( size_t i = 0; i < n; ++i )
+    {
+        keys[i] = ( ( uint64_t )v[i].pileN << posBits ) | v[i].posN;
+        indices[i] = i;
+    }
+
+#ifdef _OPENMP
+    const int threadCount = min<size_t>( omp_get_max_threads(), ( n + 65535 ) / 65536 );
+#else
+    const int threadCount = 1;
+#endif //ifdef _OPENMP
+
+    for ( int pass = 0; pass < passCount; ++pass )
+    {
+        const int shift = pass * radixBits;
+        vector<size_t> offsets( threadCount * radixSize, 0 ); // [thread][digit]
+        bool isSingleDigit = false;
+
+        #pragma omp parallel num_threads( threadCount )
+        {
 #ifdef _OPENMP
-    __gnu_parallel::sort( v.begin(), v.end(), cmpSortEl );
-#else //ifdef _OPENMP
-    sort( v.begin(), v.end(), cmpSortEl );
+            const int threadNum = omp_get_thread_num();
+#else
+            const int threadNum = 0;
 #endif //ifdef _OPENMP
+            const size_t begin = n * threadNum / threadCount;
+            const size_t end = n * ( threadNum + 1 ) / threadCount;
+            size_t *threadOffsets = &offsets[threadNum * radixSize];
+
+            for ( size_t i = begin; i < end; ++i )
+                ++threadOffsets[( keys[i] >> shift ) & ( radixSize - 1 )];
+
+            #pragma omp barrier
+            #pragma omp single
+            {
+                // Each thread writes its digits after the same digits of the previous threads
+                size_t offset = 0;
+                for ( int digit = 0; digit < radixSize; ++digit )
+                {
+                    const size_t digitStart = offset;
+                    for ( int t = 0; t < threadCount; ++t )
+                    {
+                        const size_t count = offsets[t * radixSize + digit];
+                        offsets[t * radixSize + digit] = offset;
+                        offset += count;
+                    }
+                    // The pass wouldn't move anything if all the keys have this digit
+                    if ( offset - digitStart == n )
+                        isSingleDigit = true;
+                }
+            }
+
+            if ( !isSingleDigit )
+            {
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    const size_t dest = threadOffsets[( keys[i] >> shift ) & ( radixSize - 1 )]++;
+                    keys2[dest] = keys[i];
+                    indices2[dest] = indices[i];
+                }
+            }
+        }
+
+        if ( !isSingleDigit )
+        {
+            keys.swap( keys2 );
+            indices.swap( indices2 );
+        }
+    }
+    vector<uint64_t>().swap( keys );
+    vector<uint64_t>().swap( keys2 );
+    vector<SequenceNumber>().swap( indices2 );
+
+    vector< sortElement > sorted( n );
+    #pragma omp parallel for
+    for ( size_t i = 0; i < n; ++i )
+        sorted[i] = v[indices[i]];
+    v.swap( sorted );
+}
+
+
+SortElementStore::SortElementStore()
+    : widePositions_( false )
+    , hasLcp_( false )
+{
+}
+
+void SortElementStore::resize( const SequenceNumber n )
+{
+    pileN_.resize( n );
+    posLow_.resize( n );
+    if ( widePositions_ )
+        posHigh_.resize( n );
+    seqN_.resize( n );
+    if ( hasLcp_ )
+    {
+        lcpCurN_.resize( n );
+        lcpSucN_.resize( n );
+    }
+}
+
+void SortElementStore::clear()
+{
+    vector< AlphabetSymbol >().swap( pileN_ );
+    vector< uint32_t >().swap( posLow_ );
+    vector< uint16_t >().swap( posHigh_ );
+    widePositions_ = false;
+    vector< SequenceNumber >().swap( seqN_ );
+    hasLcp_ = false;
+    vector< SequenceLength >().swap( lcpCurN_ );
+    vector< SequenceLength >().swap( lcpSucN_ );
+}
+
+void SortElementStore::swap( SortElementStore &other )
+{
+    pileN_.swap( other.pileN_ );
+    posLow_.swap( other.posLow_ );
+    std::swap( widePositions_, other.widePositions_ );
+    posHigh_.swap( other.posHigh_ );
+    seqN_.swap( other.seqN_ );
+    std::swap( hasLcp_, other.hasLcp_ );
+    lcpCurN_.swap( other.lcpCurN_ );
+    lcpSucN_.swap( other.lcpSucN_ );
+}
+
+void SortElementStore::enableLcp()
+{
+    if ( !hasLcp_ )
+    {
+        hasLcp_ = true;
+        lcpCurN_.resize( pileN_.size(), 0 );
+        lcpSucN_.resize( pileN_.size(), 0 );
+    }
+}
+
+void SortElementStore::reservePositions( const LetterNumber maxPosN )
+{
+    assert( maxPosN >> 48 == 0 );
+    if ( maxPosN >> 32 && !widePositions_ )
+    {
+        widePositions_ = true;
+        posHigh_.resize( pileN_.size(), 0 );
+    }
+}
+
+size_t SortElementStore::bytesPerElement() const
+{
+    size_t bytes = sizeof( AlphabetSymbol ) + sizeof( uint32_t ) + sizeof( SequenceNumber );
+    if ( widePositions_ )
+        bytes += sizeof( uint16_t );
+    if ( hasLcp_ )
+        bytes += 2 * sizeof( SequenceLength );
+    return bytes;
 }
@@ -16,17 +16,13 @@
 #include "Alphabet.hh"
 #include "Types.hh"
 
-//2020-12-04
-#include "Tools.hh"  // it is included for BUILD_LCP
-
+#include <cassert>
 #include <vector>
 
 using std::vector;
 
 struct sortElement
 {
-#if BUILD_LCP == 0
-
     sortElement() {}
 
     sortElement( AlphabetSymbol z, LetterNumber x, SequenceNumber y )
@@ -35,63 +31,131 @@ struct sortElement
         , seqN( y )
     {}
 
-    SequenceLength getLcpCurN() const
+    ~sortElement() {};
+    AlphabetSymbol pileN;
+    LetterNumber posN;
+    SequenceNumber seqN;
+
+#if USE_ATTRIBUTE_PACKED == 1
+} __attribute__ ( ( packed ) );
+#else
+};
+#endif
+
+// Sorts by pileN then posN
+void sortByPileAndPosition( vector< sortElement > &v );
+
+
+// Same content as a vector of sortElement, with the fields kept in separate
+// arrays. posN (a position inside its pile) is stored in 32 bits, plus 16
+// high bits only once a pile may grow beyond 4G letters.
+// The two LCP arrays are only allocated once enableLcp() has been called
+// (--generate-lcp); otherwise their getters return 0 and setters do nothing.
+class SortElementStore
+{
+public:
+    SortElementStore();
+
+    SequenceNumber size() const
     {
-        return 0;
+        return ( SequenceNumber )pileN_.size();
     }
-    SequenceLength getLcpSucN() const
+    void resize( const SequenceNumber n );
+    void clear();
+    void swap( SortElementStore &other );
+
+    // Allocates the LCP arrays, kept across resize() and swap() until clear()
+    void enableLcp();
+    bool hasLcp() const
     {
-        return 0;
+        return hasLcp_;
     }
-    void setLcpCurN( const SequenceLength val ) { }
-    void setLcpSucN( const SequenceLength val ) { }
 
-#else
-
-    sortElement() : pileN( 0 ), lcpCurN( 0 ), lcpSucN( 0 ) {}
+    // Must be called before storing positions above 4G
+    void reservePositions( const LetterNumber maxPosN );
+    size_t bytesPerElement() const;
 
-    sortElement( AlphabetSymbol z, LetterNumber x, SequenceNumber y, SequenceLength l1 = 0, SequenceLength l2 = 0 )
-        : pileN( z )
-        , posN( x )
-        , seqN( y )
-        , lcpCurN( l1 )
-        , lcpSucN( l2 )
-    {}
+    AlphabetSymbol pileN( const SequenceNumber i ) const
+    {
+        return pileN_[i];
+    }
+    LetterNumber posN( const SequenceNumber i ) const
+    {
+        if ( !widePositions_ )
+            return posLow_[i];
+        return posLow_[i] | ( ( LetterNumber )posHigh_[i] << 32 );
+    }
+    SequenceNumber seqN( const SequenceNumber i ) const
+    {
+        return seqN_[i];
+    }
+    sortElement get( const SequenceNumber i ) const
+    {
+        return sortElement( pileN( i ), posN( i ), seqN( i ) );
+    }
 
-    SequenceLength getLcpCurN() const
+    void setPileN( const SequenceNumber i, const AlphabetSymbol pileN )
+    {
+        pileN_[i] = pileN;
+    }
+    void setPosN( const SequenceNumber i, const LetterNumber posN )
     {
-        return lcpCurN;
+        posLow_[i] = ( uint32_t )posN;
+        if ( !widePositions_ )
+            assert( posN >> 32 == 0 );
+        else
+        {
+            assert( posN >> 48 == 0 );
+            posHigh_[i] = ( uint16_t )( posN >> 32 );
+        }
     }
-    SequenceLength getLcpSucN() const
+    void setSeqN( const SequenceNumber i, const SequenceNumber seqN )
     {
-        return lcpSucN;
+        seqN_[i] = seqN;
     }
-    void setLcpCurN( const SequenceLength val )
+    void set( const SequenceNumber i, const sortElement &e )
     {
-        lcpCurN = val;
+        setPileN( i, e.pileN );
+        setPosN( i, e.posN );
+        setSeqN( i, e.seqN );
     }
-    void setLcpSucN( const SequenceLength val )
+    // Copies element j of src, including its LCP values, to position i
+    void copy( const SequenceNumber i, const SortElementStore &src, const SequenceNumber j )
     {
-        lcpSucN = val;
+        set( i, src.get( j ) );
+        setLcpCurN( i, src.getLcpCurN( j ) );
+        setLcpSucN( i, src.getLcpSucN( j ) );
     }
 
-#endif
-    ~sortElement() {};
-    AlphabetSymbol pileN;
-    LetterNumber posN;
-    SequenceNumber seqN;
-#if BUILD_LCP == 1
-    SequenceLength lcpCurN;
-    SequenceLength lcpSucN;
-#endif
+    SequenceLength getLcpCurN( const SequenceNumber i ) const
+    {
+        return hasLcp_ ? lcpCurN_[i] : 0;
+    }
+    SequenceLength getLcpSucN( const SequenceNumber i ) const
+    {
+        return hasLcp_ ? lcpSucN_[i] : 0;
+    }
+    void setLcpCurN( const SequenceNumber i, const SequenceLength val )
+    {
+        if ( hasLcp_ )
+            lcpCurN_[i] = val;
+    }
+    void setLcpSucN( const SequenceNumber i, const SequenceLength val )
+    {
+        if ( hasLcp_ )
+            lcpSucN_[i] = val;
+    }
 
-#if USE_ATTRIBUTE_PACKED == 1
-} __attribute__ ( ( packed ) );
-#else
+private:
+    vector< AlphabetSymbol > pileN_;
+    vector< uint32_t > posLow_;
+    bool widePositions_; // false while all positions fit in 32 bits
+    vector< uint16_t > posHigh_; // only allocated for wide positions
+    vector< SequenceNumber > seqN_;
+    bool hasLcp_;
+    vector< SequenceLength > lcpCurN_;
+    vector< SequenceLength > lcpSucN_;
 };
-#endif
-
-void quickSort( vector< sortElement > &v );
 
 
 #endif
@@ -15,56 +15,290 @@
 #include "Filename.hh"
 #include "SeqReader.hh"
 #include "Tools.hh"
+#include "libzoo/io/Bcl.hh"
 #include "libzoo/util/Logger.hh"
 #include "libzoo/util/TemporaryFilesManager.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif //ifdef _OPENMP
 
 using namespace std;
 
 
 TransposeFasta::TransposeFasta()
     : pReader_( NULL )
+    , pMappedReader_( NULL )
+    , firstSeq_( NULL )
+    , firstQual_( NULL )
     , cycleNum_( 0 )
     , processQualities_( false )
 {
     for ( int i( 0 ); i < 256; i++ ) freq[i] = 0;
 }
 
-void TransposeFasta::init( SeqReaderFile *pReader, const bool processQualities )
+void TransposeFasta::init( SeqReaderBase *pReader, const bool processQualities )
 {
     pReader_ = pReader;
+    // Memory-mapped input gets parsed straight from the mapping
+    pMappedReader_ = dynamic_cast<SeqReaderMmap *>( pReader );
     cycleNum_ = pReader->length();
-    outputFiles_.resize( pReader->length() );
-    buf_.resize( pReader->length(), vector<uchar>( BUFFERSIZE ) );
-    processQualities_ = processQualities;
+    outputFiles_.resize( cycleNum_ );
+    firstSeq_ = pReader->thisSeq();
+    firstQual_ = pReader->thisQual();
+    // If the first entry of the file (which can be fastq or any other format (raw/fasta/etc)) doesn't contain any quality info
+    // , deactivate qualities processing
+    processQualities_ = processQualities && firstQual_[0] != '\0';
+    if ( processQualities_ && strcspn( firstQual_, "\n" ) < cycleNum_ )
+    {
+        Logger::error() << "Error: Quality string of the first read is shorter than its sequence" << endl;
+        exit( EXIT_FAILURE );
+    }
 
     cerr << "Constructing TransposeFasta, found read length of "
          << cycleNum_ << endl;
+}
+
+TransposeFasta::~TransposeFasta()
+{
+
+}
+
+
+namespace
+{
+
+// Input chunk size per parsing thread
+const size_t chunkSizePerThread = 4 * 1024 * 1024;
+
+// Number of reads transposed at once by each thread
+const int transpositionBatchSize = 256;
 
-    if ( processQualities_ && pReader_->thisQual()[0] == '\0' )
+// Asks the kernel to start reading a range of a memory-mapped input
+void madviseWillNeed( const char *begin, const size_t length )
+{
+    const size_t pageSize = sysconf( _SC_PAGESIZE );
+    const uintptr_t alignedBegin = reinterpret_cast<uintptr_t>( begin ) & ~( pageSize - 1 );
+    madvise( reinterpret_cast<void *>( alignedBegin ), reinterpret_cast<uintptr_t>( begin ) + length - alignedBegin, MADV_WILLNEED );
+}
+
+enum RecordFormat
+{
+    RECORD_FORMAT_RAW,
+    RECORD_FORMAT_FASTA,
+    RECORD_FORMAT_FASTQ
+};
+
+// Finds the end of the line starting at p. Returns the start of the next
+// line, or NULL if the line is not complete (the last line of the input
+// doesn't need to be terminated).
+inline const char *nextLine( const char *p, const char *end, const bool isEndOfInput, const char *&lineEnd )
+{
+    if ( p >= end )
+        return NULL;
+    lineEnd = static_cast<const char *>( memchr( p, '\n', end - p ) );
+    if ( lineEnd != NULL )
+        return lineEnd + 1;
+    if ( !isEndOfInput )
+        return NULL;
+    lineEnd = end;
+    return end;
+}
+
+// Parses the record starting at p, checking its format and sequence length.
+// Returns the start of the next record, or NULL if the record is not complete.
+const char *parseRecord( const RecordFormat format, const char *p, const char *end, const bool isEndOfInput, const SequenceLength readLength, const bool checkQualities, const char *&seq, const char *&qual )
+{
+    const char *lineEnd;
+    if ( format != RECORD_FORMAT_RAW )
     {
-        // If the first entry of the file (which can be fastq or any other format (raw/fasta/etc)) doesn't contain any quality info
-        // , deactivate qualities processing
-        processQualities_ = false;
+        const char *header = p;
+        if ( ( p = nextLine( p, end, isEndOfInput, lineEnd ) ) == NULL )
+            return NULL;
+        if ( *header != ( format == RECORD_FORMAT_FASTA ? '>' : '@' ) )
+        {
+            Logger::error() << "Error: Expected " << ( format == RECORD_FORMAT_FASTA ? "FASTA" : "FASTQ" ) << " header, got " << string( header, lineEnd ) << endl;
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    seq = p;
+    if ( ( p = nextLine( p, end, isEndOfInput, lineEnd ) ) == NULL )
+        return NULL;
+    if ( lineEnd - seq != ( ptrdiff_t )readLength )
+    {
+        Logger::error() << "Error: Length of current sequence does not match length of first: " << string( seq, lineEnd ) << endl;
+        exit( EXIT_FAILURE );
+    }
+
+    if ( format == RECORD_FORMAT_FASTQ )
+    {
+        const char *spacer = p;
+        if ( ( p = nextLine( p, end, isEndOfInput, lineEnd ) ) == NULL )
+            return NULL;
+        if ( *spacer != '+' )
+        {
+            Logger::error() << "Error: Expected FASTQ quality spacer, got " << string( spacer, lineEnd ) << endl;
+            exit( EXIT_FAILURE );
+        }
+        qual = p;
+        if ( ( p = nextLine( p, end, isEndOfInput, lineEnd ) ) == NULL )
+            return NULL;
+        // Quality strings only matter when they get transposed
+        if ( checkQualities && lineEnd - qual < ( ptrdiff_t )readLength )
+        {
+            Logger::error() << "Error: FASTQ quality string shorter than its sequence: " << string( qual, lineEnd ) << endl;
+            exit( EXIT_FAILURE );
+        }
     }
+    return p;
 }
 
-TransposeFasta::~TransposeFasta()
+// Finds the first record starting at or after p, without parsing the
+// records before it. Returns end if none is found.
+const char *findRecordStart( const RecordFormat format, const char *begin, const char *p, const char *end )
 {
+    if ( p == begin )
+        return p;
+
+    const char *lineEnd;
+    if ( p[-1] != '\n' && ( p = nextLine( p, end, false, lineEnd ) ) == NULL )
+        return end;
 
+    while ( p < end )
+    {
+        switch ( format )
+        {
+            case RECORD_FORMAT_RAW:
+                return p;
+            case RECORD_FORMAT_FASTA:
+                // Sequences never start with '>'
+                if ( *p == '>' )
+                    return p;
+                break;
+            case RECORD_FORMAT_FASTQ:
+                // Quality strings may start with '@', but are never followed
+                // by a line starting with '+' two lines later
+                if ( *p == '@' )
+                {
+                    const char *q = nextLine( p, end, false, lineEnd );
+                    if ( q != NULL )
+                        q = nextLine( q, end, false, lineEnd );
+                    if ( q == NULL )
+                        return end;
+                    if ( q < end && *q == '+' )
+                        return p;
+                }
+                break;
+        }
+        if ( ( p = nextLine( p, end, false, lineEnd ) ) == NULL )
+            return end;
+    }
+    return end;
 }
 
+// 4-bit codes of the symbols of cycles kept in RAM. Other symbols get the
+// last code and are stored separately.
+const char packedSymbols[] = "$ACGNTZacgnt????";
+const uchar unpackedSymbolCode = 15;
+
+struct SymbolCodes
+{
+    SymbolCodes()
+    {
+        memset( code, unpackedSymbolCode, sizeof( code ) );
+        for ( uchar i = 0; i < unpackedSymbolCode; ++i )
+            if ( packedSymbols[i] != '?' )
+                code[( uchar )packedSymbols[i]] = i;
+    }
+
+    uchar code[256];
+};
 
-bool TransposeFasta::convert( /*const string &input,*/ const string &output, bool generatedFilesAreTemporary )
+const SymbolCodes symbolCodes;
+
+// Per-thread transposed output of one chunk
+struct TransposedReads
+{
+    TransposedReads() : count( 0 ), capacity( 0 ) {}
+
+    void reserve( const size_t newCount )
+    {
+        if ( newCount <= capacity )
+            return;
+        capacity = max( newCount, 2 * capacity );
+        for ( size_t i = 0; i < bases.size(); ++i )
+            bases[i].resize( capacity );
+        for ( size_t i = 0; i < qualities.size(); ++i )
+            qualities[i].resize( capacity );
+    }
+
+    void add( const char **seqs, const char **quals, const int n )
+    {
+        if ( n == 0 )
+            return;
+        reserve( count + n );
+        for ( size_t cycle = 0; cycle < bases.size(); ++cycle )
+        {
+            uchar *dest = &bases[cycle][count];
+            for ( int r = 0; r < n; ++r )
+                dest[r] = seqs[r][cycle];
+        }
+        for ( size_t cycle = 0; cycle < qualities.size(); ++cycle )
+        {
+            uchar *dest = &qualities[cycle][count];
+            for ( int r = 0; r < n; ++r )
+                dest[r] = quals[r][cycle];
+        }
+        count += n;
+    }
+
+    vector<vector<uchar> > bases; // [cycle][read]
+    vector<vector<uchar> > qualities;
+    size_t count;
+    size_t capacity;
+};
+
+void transposeRecords( const RecordFormat format, const char *p, const char *end, const char *dataEnd, const bool isEndOfInput, const SequenceLength readLength, TransposedReads &out )
+{
+    const char *seqs[transpositionBatchSize];
+    const char *quals[transpositionBatchSize];
+    int n = 0;
+
+    out.count = 0;
+    while ( p < end )
+    {
+        p = parseRecord( format, p, dataEnd, isEndOfInput, readLength, !out.qualities.empty(), seqs[n], quals[n] );
+        if ( p == NULL )
+        {
+            Logger::error() << "Error: Incomplete last entry, truncated input file?" << endl;
+            exit( EXIT_FAILURE );
+        }
+        if ( ++n == transpositionBatchSize )
+        {
+            out.add( seqs, quals, n );
+            n = 0;
+        }
+    }
+    out.add( seqs, quals, n );
+}
+
+} // anonymous namespace
+
+
+bool TransposeFasta::convert( /*const string &input,*/ const string &output, bool generatedFilesAreTemporary, const uint64_t maxBytesInRam )
 {
-    vector<vector<uchar> > bufQual;
     vector<FILE *> outputFilesQual;
     if ( processQualities_ )
     {
-        bufQual.resize( pReader_->length(), vector<uchar>( BUFFERSIZE ) );
-        outputFilesQual.resize( pReader_->length() );
+        outputFilesQual.resize( cycleNum_ );
     }
 
     //TO DO
@@ -84,144 +318,334 @@ bool TransposeFasta::convert( /*const string &input,*/ const string &output, boo
     freq[int( 'Z' )] = 1;
 #endif
 
-    // create output files
-    for ( SequenceLength i = 0; i < cycleNum_; i++ )
+    bool cyclesInRam = ( maxBytesInRam > 0 );
+    const uint64_t bytesPerReadInRam = ( cycleNum_ + 1 ) / 2 + ( processQualities_ ? cycleNum_ : 0 );
+    if ( cyclesInRam )
     {
-        Filename fn( output, i, "" );
-        outputFiles_[i] = fopen( fn, "w" );
-        if ( outputFiles_[i] == NULL )
+        Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Keeping transposed cycles in RAM" << endl;
+        packedCycles_.resize( cycleNum_ );
+        unpackedSymbols_.resize( cycleNum_ );
+        if ( processQualities_ )
+            qualityCycles_.resize( cycleNum_ );
+    }
+    else
+        openOutputFiles( output, generatedFilesAreTemporary, outputFilesQual );
+
+    // The reader has already parsed the first entry
+    if ( cyclesInRam )
+    {
+        for ( SequenceLength i = 0; i < cycleNum_; i++ )
+            appendCycleToRam( i, 0, ( const uchar * )firstSeq_ + i, processQualities_ ? ( const uchar * )firstQual_ + i : NULL, 1 );
+    }
+    else
+    {
+        for ( SequenceLength i = 0; i < cycleNum_; i++ )
         {
-            cerr << "Error: couldn't open output file " << fn << endl;
-            if ( i > 0 )
+            fputc( firstSeq_[i], outputFiles_[i] );
+            if ( processQualities_ )
+                fputc( firstQual_[i], outputFilesQual[i] );
+        }
+    }
+    nSeq = 1;
+
+    // The rest of the input is read in large chunks, each chunk being split
+    // into one part per thread at record boundaries. Each thread transposes
+    // its records into its own cycle buffers, while an extra thread reads
+    // the next chunk. The cycle buffers are then flushed in order.
+    // A memory-mapped input is processed in place, chunk by chunk.
+    SeqReaderMmap *pMappedReader = pMappedReader_;
+    RecordFormat format;
+    if ( pMappedReader ? pMappedReader->isFastq() : dynamic_cast<SeqReaderFastq *>( pReader_ ) != NULL )
+        format = RECORD_FORMAT_FASTQ;
+    else if ( pMappedReader ? pMappedReader->isFasta() : dynamic_cast<SeqReaderFasta *>( pReader_ ) != NULL )
+        format = RECORD_FORMAT_FASTA;
+    else
+        format = RECORD_FORMAT_RAW;
+
+#ifdef _OPENMP
+    const int numThreads = omp_get_max_threads();
+#else
+    const int numThreads = 1;
+#endif //ifdef _OPENMP
+    const size_t chunkSize = numThreads * chunkSizePerThread;
+
+    vector<TransposedReads> transposedReads( numThreads );
+    for ( int t = 0; t < numThreads; ++t )
+    {
+        transposedReads[t].bases.resize( cycleNum_ );
+        if ( processQualities_ )
+            transposedReads[t].qualities.resize( cycleNum_ );
+    }
+
+    FILE *pInputFile = NULL;
+    vector<char> chunks[2];
+    int currentChunk = 0;
+    const char *chunkBegin;
+    size_t chunkLength;
+    bool isEndOfInput;
+    if ( pMappedReader )
+    {
+        chunkBegin = pMappedReader->nextData();
+        chunkLength = min<size_t>( chunkSize, pMappedReader->dataEnd() - chunkBegin );
+        isEndOfInput = ( chunkBegin + chunkLength == pMappedReader->dataEnd() );
+    }
+    else
+    {
+        pInputFile = static_cast<SeqReaderFile *>( pReader_ )->file();
+        chunks[0].resize( chunkSize );
+        chunks[1].resize( chunkSize );
+        chunkBegin = chunks[0].data();
+        chunkLength = fread( chunks[0].data(), 1, chunkSize, pInputFile );
+        isEndOfInput = ( chunkLength < chunkSize );
+    }
+
+    while ( chunkLength > 0 )
+    {
+        const char *chunkEnd = chunkBegin + chunkLength;
+
+        // Record boundaries
+        vector<const char *> threadStart( numThreads + 1 );
+        #pragma omp parallel for
+        for ( int t = 0; t < numThreads; ++t )
+            threadStart[t] = findRecordStart( format, chunkBegin, chunkBegin + t * ( chunkLength / numThreads ), chunkEnd );
+        threadStart[numThreads] = chunkEnd;
+
+        // Incomplete last record, carried over to the next chunk
+        const char *carryStart = chunkEnd;
+        if ( !isEndOfInput )
+        {
+            const char *p = findRecordStart( format, chunkBegin, chunkEnd - min( chunkLength, ( size_t )4 * maxSeqSize ), chunkEnd );
+            if ( p == chunkEnd )
+                p = threadStart[numThreads - 1];
+            const char *seq, *qual, *next;
+            while ( ( next = parseRecord( format, p, chunkEnd, false, cycleNum_, false, seq, qual ) ) != NULL )
+                p = next;
+            carryStart = p;
+            if ( carryStart == chunkBegin )
             {
-                cerr << "  You may have reached the maximum number of opened files (see `ulimit -n`) or the maximum number of files allowed in one directory, as we create one file per cycle (and a second one if qualities are present)" << endl;
-                exit ( -1 );
+                Logger::error() << "Error: Entry larger than the input chunk size" << endl;
+                exit( EXIT_FAILURE );
             }
         }
-        if ( generatedFilesAreTemporary )
-            TemporaryFilesManager::get().addFilename( fn );
-        if ( processQualities_ )
+
+        const char *nextChunkBegin = NULL;
+        size_t nextChunkLength = 0;
+        bool nextIsEndOfInput = isEndOfInput;
+        #pragma omp parallel num_threads( numThreads + 1 )
         {
-            Filename fnQual( output + "qual.", i, "" );
-            outputFilesQual[i] = fopen( fnQual, "w" );
-            if ( outputFilesQual[i] == NULL )
+#ifdef _OPENMP
+            const int threadNum = omp_get_thread_num();
+            const int threadCount = omp_get_num_threads();
+#else
+            const int threadNum = 0;
+            const int threadCount = 1;
+#endif //ifdef _OPENMP
+
+            // Roles 0..numThreads-1 transpose, role numThreads reads the next chunk
+            for ( int role = threadNum; role <= numThreads; role += threadCount )
             {
-                cerr << "Error: couldn't open output file " << fnQual << endl;
-                if ( i > 0 )
+                if ( role == numThreads )
                 {
-                    cerr << "  You may have reached the maximum number of opened files (see `ulimit -n`) or the maximum number of files allowed in one directory, as we create one file per cycle (and a second one if qualities are present)" << endl;
-                    exit ( -1 );
+                    if ( !isEndOfInput && pMappedReader )
+                    {
+                        // The next chunk starts in place at the incomplete record; its pages are prefetched
+                        nextChunkBegin = carryStart;
+                        nextChunkLength = min<size_t>( chunkSize, pMappedReader->dataEnd() - carryStart );
+                        nextIsEndOfInput = ( nextChunkBegin + nextChunkLength == pMappedReader->dataEnd() );
+                        madviseWillNeed( nextChunkBegin, nextChunkLength );
+                    }
+                    else if ( !isEndOfInput )
+                    {
+                        const size_t carryLength = chunkEnd - carryStart;
+                        char *nextChunk = chunks[1 - currentChunk].data();
+                        memcpy( nextChunk, carryStart, carryLength );
+                        const size_t bytesRead = fread( nextChunk + carryLength, 1, chunkSize - carryLength, pInputFile );
+                        nextChunkBegin = nextChunk;
+                        nextChunkLength = carryLength + bytesRead;
+                        nextIsEndOfInput = ( bytesRead < chunkSize - carryLength );
+                    }
+                }
+                else
+                {
+                    const char *end = min( threadStart[role + 1], carryStart );
+                    const char *begin = min( threadStart[role], end );
+                    transposeRecords( format, begin, end, chunkEnd, isEndOfInput, cycleNum_, transposedReads[role] );
                 }
             }
-            if ( generatedFilesAreTemporary )
-                TemporaryFilesManager::get().addFilename( fnQual );
         }
-    }
 
+        SequenceNumber chunkReads = 0;
+        for ( int t = 0; t < numThreads; ++t )
+            chunkReads += transposedReads[t].count;
+        if ( cyclesInRam && ( uint64_t )( nSeq + chunkReads ) * bytesPerReadInRam > maxBytesInRam )
+        {
+            Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Transposed cycles don't fit in RAM, moving them to cycle files" << endl;
+            openOutputFiles( output, generatedFilesAreTemporary, outputFilesQual );
+            moveCyclesFromRamToFiles( outputFilesQual );
+            cyclesInRam = false;
+        }
 
-    // looping through the input file, add the characters to the buffer, print buffer when it's full
-    //    unsigned int num_read = 0;
-    unsigned int num_write = 0;
-    unsigned int charsBuffered = 0;
-
-    //******************************buf[cycleNum_+1];  ********* is cycleNum_ right?
-    lengthTexts = 0;
-    nSeq = 0;
-    //    num_read = fread(buf,sizeof(uchar),cycleNum_,ifile);
-
-    //    fgets ( buf,1024, ifile ); %%%%%
-    //    while( !feof(ifile) ) %%%%%
-    while ( pReader_->allRead() == false )
-    {
-        //cerr << "current line : " << buf << endl;
-
-        if ( charsBuffered == BUFFERSIZE )
+        if ( cyclesInRam )
         {
-            // write buffers to the files, clear buffers
-            #pragma omp parallel for num_threads(4)
+            #pragma omp parallel for
             for ( SequenceLength i = 0; i < cycleNum_; i++ )
             {
-                //cerr << "writing to " << i << " : " << buf_[i] << endl;
-                size_t num_write_bases = fwrite ( buf_[i].data(), sizeof( char ), charsBuffered, outputFiles_[i] );
-                checkIfEqual( num_write_bases, charsBuffered ); // we should always read/write the same number of characters
-                if ( processQualities_ )
+                SequenceNumber firstRead = nSeq;
+                for ( int t = 0; t < numThreads; ++t )
                 {
-                    size_t num_write_qual = fwrite ( bufQual[i].data(), sizeof( char ), charsBuffered, outputFilesQual[i] );
-                    checkIfEqual( num_write_bases, num_write_qual );
+                    const size_t count = transposedReads[t].count;
+                    if ( count == 0 )
+                        continue;
+                    appendCycleToRam( i, firstRead, transposedReads[t].bases[i].data(), processQualities_ ? transposedReads[t].qualities[i].data() : NULL, count );
+                    firstRead += count;
                 }
             }
-            lengthTexts += ( num_write * cycleNum_ );
-
-
-            charsBuffered = 0;
         }
-
-        for ( SequenceLength i = 0; i < cycleNum_; i++ )
+        else
         {
-            buf_[i][charsBuffered] = pReader_->thisSeq()[i];
-
-            if ( processQualities_ )
+            // write buffers to the files in read order
+            #pragma omp parallel for num_threads(4)
+            for ( SequenceLength i = 0; i < cycleNum_; i++ )
             {
-                bufQual[i][charsBuffered] = pReader_->thisQual()[i];
+                for ( int t = 0; t < numThreads; ++t )
+                {
+                    const size_t count = transposedReads[t].count;
+                    if ( count == 0 )
+                        continue;
+                    size_t num_write_bases = fwrite ( transposedReads[t].bases[i].data(), sizeof( char ), count, outputFiles_[i] );
+                    checkIfEqual( num_write_bases, count ); // we should always read/write the same number of characters
+                    if ( processQualities_ )
+                    {
+                        size_t num_write_qual = fwrite ( transposedReads[t].qualities[i].data(), sizeof( char ), count, outputFilesQual[i] );
+                        checkIfEqual( num_write_bases, num_write_qual );
+                    }
+                }
             }
         }
-        // increase the counter of chars buffered
-        charsBuffered++;
-        nSeq++;
+        nSeq += chunkReads;
 
+        currentChunk = 1 - currentChunk;
+        chunkBegin = nextChunkBegin;
+        chunkLength = nextChunkLength;
+        isEndOfInput = nextIsEndOfInput;
+    }
+    lengthTexts = ( LetterNumber )nSeq * cycleNum_;
 
-#ifdef XXX
-        // process the input
-        if ( buf[0] != '>' )
+    // closing all the output file streams
+    if ( !cyclesInRam )
+    {
+        for ( SequenceLength i = 0; i < cycleNum_; i++ )
         {
-            // add the characters
-            for ( SequenceLength i = 0; i < cycleNum_; i++ )
+            fclose( outputFiles_[i] );
+            if ( processQualities_ )
             {
-                buf_[i][charsBuffered] = buf[i];
+                fclose( outputFilesQual[i] );
             }
-
-            // increase the counter of chars buffered
-            charsBuffered++;
-            nSeq++;
         }
-#endif                //else
+    }
 
+    std::cout << "Number of sequences reading/writing: " << nSeq << "\n";
+    std::cout << "Number of characters reading/writing: " << lengthTexts << "\n";
 
-        //num_read = fread(buf,sizeof(uchar),cycleNum_,ifile);
-        //        fgets ( buf, 1024, ifile );
-        pReader_->readNext();
-    }
+    //    delete pReader;
+    return true;
+}
 
-    // write the rest
+void TransposeFasta::openOutputFiles( const string &output, bool generatedFilesAreTemporary, vector<FILE *> &outputFilesQual )
+{
     for ( SequenceLength i = 0; i < cycleNum_; i++ )
     {
-        num_write = fwrite ( buf_[i].data(), sizeof( uchar ), charsBuffered, outputFiles_[i] );
-        lengthTexts += num_write;
+        Filename fn( output, i, "" );
+        outputFiles_[i] = fopen( fn, "w" );
+        if ( outputFiles_[i] == NULL )
+        {
+            cerr << "Error: couldn't open output file " << fn << endl;
+            if ( i > 0 )
+            {
+                cerr << "  You may have reached the maximum number of opened files (see `ulimit -n`) or the maximum number of files allowed in one directory, as we create one file per cycle (and a second one if qualities are present)" << endl;
+                exit ( -1 );
+            }
+        }
+        if ( generatedFilesAreTemporary )
+            TemporaryFilesManager::get().addFilename( fn );
         if ( processQualities_ )
         {
-            size_t num_write_qual = fwrite ( bufQual[i].data(), sizeof( uchar ), charsBuffered, outputFilesQual[i] );
-            checkIfEqual( num_write, num_write_qual );
+            Filename fnQual( output + "qual.", i, "" );
+            outputFilesQual[i] = fopen( fnQual, "w" );
+            if ( outputFilesQual[i] == NULL )
+            {
+                cerr << "Error: couldn't open output file " << fnQual << endl;
+                if ( i > 0 )
+                {
+                    cerr << "  You may have reached the maximum number of opened files (see `ulimit -n`) or the maximum number of files allowed in one directory, as we create one file per cycle (and a second one if qualities are present)" << endl;
+                    exit ( -1 );
+                }
+            }
+            if ( generatedFilesAreTemporary )
+                TemporaryFilesManager::get().addFilename( fnQual );
         }
     }
-    checkIfEqual( num_write, charsBuffered );
+}
+
+void TransposeFasta::appendCycleToRam( const SequenceLength cycle, const SequenceNumber firstRead, const uchar *symbols, const uchar *qualities, const size_t count )
+{
+    vector<uchar> &packed = packedCycles_[cycle];
+    packed.resize( ( ( LetterNumber )firstRead + count + 1 ) / 2 );
+    for ( size_t i = 0; i < count; ++i )
+    {
+        const SequenceNumber readNum = firstRead + i;
+        const uchar code = symbolCodes.code[symbols[i]];
+        if ( code == unpackedSymbolCode )
+            unpackedSymbols_[cycle].push_back( make_pair( readNum, symbols[i] ) );
+        packed[readNum / 2] |= code << ( 4 * ( readNum & 1 ) );
+    }
+    if ( qualities != NULL )
+        qualityCycles_[cycle].insert( qualityCycles_[cycle].end(), qualities, qualities + count );
+}
+
+void TransposeFasta::readCycleFromRam( const SequenceLength cycle, uchar *symbols, uchar *qualities ) const
+{
+    assert( hasCyclesInRam() );
+    const uchar *packed = packedCycles_[cycle].data();
+    SequenceNumber i = 0;
+    for ( ; i + 1 < nSeq; i += 2 )
+    {
+        const uchar twoCodes = packed[i / 2];
+        symbols[i] = packedSymbols[twoCodes & 0xF];
+        symbols[i + 1] = packedSymbols[twoCodes >> 4];
+    }
+    if ( i < nSeq )
+        symbols[i] = packedSymbols[packed[i / 2] & 0xF];
 
+    const vector< pair<SequenceNumber, uchar> > &unpacked = unpackedSymbols_[cycle];
+    for ( size_t j = 0; j < unpacked.size(); ++j )
+        symbols[unpacked[j].first] = unpacked[j].second;
 
+    if ( qualities != NULL )
+    {
+        assert( processQualities_ );
+        memcpy( qualities, qualityCycles_[cycle].data(), nSeq );
+    }
+}
 
-    // closing all the output file streams
+void TransposeFasta::moveCyclesFromRamToFiles( vector<FILE *> &outputFilesQual )
+{
+    #pragma omp parallel for num_threads(4)
     for ( SequenceLength i = 0; i < cycleNum_; i++ )
     {
-        fclose( outputFiles_[i] );
+        vector<uchar> symbols( nSeq );
+        readCycleFromRam( i, symbols.data(), NULL );
+        size_t num_write_bases = fwrite ( symbols.data(), sizeof( char ), nSeq, outputFiles_[i] );
+        checkIfEqual( num_write_bases, nSeq );
         if ( processQualities_ )
         {
-            fclose( outputFilesQual[i] );
+            size_t num_write_qual = fwrite ( qualityCycles_[i].data(), sizeof( char ), nSeq, outputFilesQual[i] );
+            checkIfEqual( num_write_bases, num_write_qual );
         }
     }
-
-    std::cout << "Number of sequences reading/writing: " << nSeq << "\n";
-    std::cout << "Number of characters reading/writing: " << lengthTexts << "\n";
-
-    //    delete pReader;
-    return true;
+    packedCycles_.clear();
+    unpackedSymbols_.clear();
+    qualityCycles_.clear();
 }
 
 bool TransposeFasta::inputCycFile( const string &cycPrefix )
@@ -298,6 +722,47 @@ bool TransposeFasta::inputCycFile( const string &cycPrefix )
     return 1;
 }
 
+bool TransposeFasta::inputBclRunFolder( BclRunFolder &runFolder, const bool processQualities )
+{
+    // Same alphabet as the cyc files
+    freq[int( terminatorChar )] = 1;
+    freq[int( 'A' )] = 1;
+    freq[int( 'C' )] = 1;
+    freq[int( 'G' )] = 1;
+    freq[int( 'N' )] = 1;
+    freq[int( 'T' )] = 1;
+#ifdef USE_EXTRA_CHARACTER_Z
+    freq[int( 'Z' )] = 1;
+#endif
+
+    const unsigned long readCount = runFolder.loadPassFilterFlags();
+    nSeq = readCount;
+    if ( nSeq != readCount )
+    {
+        Logger::error() << "Error: Too many sequences. This version of BEETL was compiled for a maximum of " << maxSequenceNumber << " sequences, but this input has " << readCount << " sequences. You can increase this limit by changing the type definition of 'SequenceNumber' in Types.hh and recompiling BEETL." << endl;
+        exit( -1 );
+    }
+    lengthRead = runFolder.getCycleCount();
+    if ( nSeq == 0 || lengthRead == 0 )
+    {
+        Logger::error() << "Error: No pass-filter reads or no cycles found in the BCL run folder" << endl;
+        exit( -1 );
+    }
+    processQualities_ = processQualities;
+    lengthTexts = lengthRead * nSeq;
+
+    Logger_if( LOG_SHOW_IF_VERBOSE )
+    {
+        Logger::out() << "****processing qualities: " << processQualities_ << "\n";
+        Logger::out() << "****number of sequences: " << nSeq << "\n";
+        Logger::out() << "****length of each sequence: " << lengthRead << "\n";
+        Logger::out() << "****lengthTot: " << lengthTexts << "\n";
+    }
+
+    return 1;
+}
+
+
 
 bool TransposeFasta::convertFromCycFileToFastaOrFastq( const string &fileInputPrefix, const string &fileOutput, bool generatedFilesAreTemporary, SequenceExtractor *sequenceExtractor )
 {
@@ -21,6 +21,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 using std::string;
@@ -31,22 +32,30 @@ using std::vector;
 //#define CYCLENUM 100
 
 
-class SeqReaderFile;
+class BclRunFolder;
+class SeqReaderBase;
+class SeqReaderMmap;
 
 class TransposeFasta
 {
 public:
     TransposeFasta();
-    void init( SeqReaderFile *pReader, const bool processQualities = true );
+    void init( SeqReaderBase *pReader, const bool processQualities = true );
     ~TransposeFasta();
 
-    bool convert( /*const string &input,*/ const string &output, bool generatedFilesAreTemporary = true );   //Input from Fasta file (converts Fasta File into cyc Files)
+    bool convert( /*const string &input,*/ const string &output, bool generatedFilesAreTemporary = true, const uint64_t maxBytesInRam = 0 );   //Input from Fasta file (converts Fasta File into cyc Files, or keeps the cycles in RAM while they fit in maxBytesInRam)
     bool inputCycFile( const string &cycPrefix );                                    //Input from cyc files
+    bool inputBclRunFolder( BclRunFolder &runFolder, const bool processQualities );  //Input from the BCL files of a run folder, which are already cycle-major
     bool convertFromCycFileToFastaOrFastq( const string &fileInputPrefix, const string &fileOutput, bool generatedFilesAreTemporary = true, SequenceExtractor *sequenceExtractor = NULL );      //Convert cyc files into Fasta or Fastq File
     bool hasProcessedQualities() const
     {
         return processQualities_;
     }
+    bool hasCyclesInRam() const
+    {
+        return !packedCycles_.empty();
+    }
+    void readCycleFromRam( const SequenceLength cycle, uchar *symbols, uchar *qualities ) const; // Fills nSeq symbols (and qualities) of a cycle kept in RAM
 
     SequenceLength lengthRead;    //Lenght of each text
     LetterNumber lengthTexts;   //Total length of all texts without $-symbols
@@ -55,14 +64,25 @@ public:
     LetterNumber freq[256];  //contains the distribution of the symbols. It is useful only for testing. It depends on the #characters
 
 private:
-    SeqReaderFile *pReader_;
+    void openOutputFiles( const string &output, bool generatedFilesAreTemporary, vector<FILE *> &outputFilesQual );
+    void appendCycleToRam( const SequenceLength cycle, const SequenceNumber firstRead, const uchar *symbols, const uchar *qualities, const size_t count );
+    void moveCyclesFromRamToFiles( vector<FILE *> &outputFilesQual );
+
+    SeqReaderBase *pReader_;
+    SeqReaderMmap *pMappedReader_; // pReader_, when it is memory-mapped
+    const char *firstSeq_; // entry already parsed by the reader
+    const char *firstQual_;
     uint cycleNum_;
     vector<FILE *> outputFiles_;
-    vector<vector<uchar> > buf_;
     //    FILE* outputFiles_[CYCLENUM];
 
     //    uchar buf_[CYCLENUM][BUFFERSIZE];
     bool processQualities_;
+
+    // Cycles kept in RAM: two 4-bit symbol codes per byte, plus the symbols without code
+    vector< vector<uchar> > packedCycles_; // [cycle]
+    vector< vector< std::pair<SequenceNumber, uchar> > > unpackedSymbols_; // [cycle], ordered by read number
+    vector< vector<uchar> > qualityCycles_; // [cycle]
 };
 
 #endif
@@ -16,6 +16,7 @@
 #include "libzoo/util/Logger.hh"
 
 #include <algorithm>
+#include <typeinfo>
 #include <unistd.h>
 #include <sys/types.h>
 #ifndef DONT_USE_MMAP
@@ -30,7 +31,7 @@ using namespace std;
 
 template< class T >
 BwtReaderIndex<T>::BwtReaderIndex( const string &filename, const string &optionalSharedMemoryPath ):
-    T( filename ),
+    T( filename, optionalSharedMemoryPath ),
     indexFilename_( filename + ".idx" ),
     //    isNextIndex_( false ),
     pIndexFile_( NULL )
@@ -146,6 +147,17 @@ LetterNumber BwtReaderIndex<T>::readAndCount( LetterCount &c, const LetterNumber
 }
 
 
+template< class T >
+void BwtReaderIndex<T>::getIndexPoint( const uint32_t i, LetterNumber &posInBwt, LetterNumber &posInFile, LetterCount &countsThisChunk ) const
+{
+    assert( i < indexSize_ );
+    posInBwt = indexPosBwt_[i];
+    posInFile = indexPosFile_[i];
+    countsThisChunk.clear();
+    countsThisChunk += indexCount_[i];
+} // ~getIndexPoint
+
+
 template< class T >
 void BwtReaderIndex<T>::initIndex( const string &optionalSharedMemoryPath )
 {
@@ -378,15 +390,120 @@ void BwtReaderIndex<T>::initIndex( const string &optionalSharedMemoryPath )
 
 // Index creation
 
-void buildIndex( BwtReaderBase *reader0, FILE *pIndexFile, const int indexBinSize )
+namespace
+{
+
+// Goes through a whole run-length-encoded BWT file, from its current
+// position, calling handler( posInFile, countsThisChunk ) every runsPerChunk
+// runs and at the end of the file. Returns the number of runs.
+template< class IndexPointHandler >
+LetterNumber scanIndexPoints( BwtReaderRunLengthBase *reader, const int runsPerChunk, IndexPointHandler &handler )
 {
-    BwtReaderRunLengthBase *reader = dynamic_cast< BwtReaderRunLengthBase* >( reader0 );
-    const int runsPerChunk( indexBinSize );
     int runsThisChunk( 0 );
     LetterCount countsThisChunk;
-    LetterNumber runsSoFar( 0 ), chunksSoFar( 0 );
+    LetterNumber runsSoFar( 0 );
     bool lastRun = false;
 
+    // V3 files: most runs are decoded in bulk, getRun() only deals with the buffer boundaries
+    BwtReaderRunLengthV3 *readerV3 = dynamic_cast< BwtReaderRunLengthV3* >( reader );
+
+    while ( !lastRun )
+    {
+        if ( readerV3 != NULL )
+        {
+            LetterNumber runsDecoded;
+            reader->currentPos_ += readerV3->countRunsInBuffer( countsThisChunk, maxLetterNumber, runsPerChunk - runsThisChunk, runsDecoded );
+            runsSoFar += runsDecoded;
+            runsThisChunk += runsDecoded;
+        }
+        if ( runsThisChunk < runsPerChunk )
+        {
+            lastRun = !reader->getRun();
+            if (!lastRun)
+            {
+                runsSoFar++;
+                runsThisChunk++;
+
+                countsThisChunk.count_[whichPile[reader->lastChar_]] += reader->runLength_;
+                assert( countsThisChunk.count_[whichPile[reader->lastChar_]] >= reader->runLength_ && "Error: Overflow in buildIndex" );
+                reader->currentPos_ += reader->runLength_;
+            }
+        }
+        if ( runsThisChunk == runsPerChunk || lastRun )
+        {
+#ifdef DEBUG_RAC
+            cout << reader->currentPos_ << " " << runsSoFar << " " << countsThisChunk << endl;
+#endif
+
+            handler( reader->tellg(), countsThisChunk );
+
+            runsThisChunk = 0;
+            countsThisChunk.clear();
+        }
+    }
+    return runsSoFar;
+} // ~scanIndexPoints
+
+struct IndexFileWriter
+{
+    IndexFileWriter( FILE *pIndexFile ) : pIndexFile_( pIndexFile ), chunksSoFar_( 0 ) {}
+
+    void operator()( LetterNumber posInFile, const LetterCount &countsThisChunk )
+    {
+        // don't bother writing the BWT position as can deduce by summing countsThisChunk
+        assert
+        ( fwrite( &posInFile, sizeof( LetterNumber ), 1, pIndexFile_ ) == 1 );
+
+        // In index format v2, we write each LetterCount independently, encoding the number of bytes as first byte
+        for (int i=0; i<alphabetSize; ++i)
+        {
+            LetterNumber val = countsThisChunk.count_[i];
+            int bytesNeeded = 0;
+            while (val >> (8*bytesNeeded))
+                ++bytesNeeded;
+            assert( fwrite( &bytesNeeded, 1, 1, pIndexFile_ ) == 1 );
+            if (bytesNeeded)
+                assert( fwrite( &val, bytesNeeded, 1, pIndexFile_ ) == 1 );
+        }
+
+        chunksSoFar_++;
+    }
+
+    FILE *pIndexFile_;
+    LetterNumber chunksSoFar_;
+};
+
+struct IndexRamWriter
+{
+    IndexRamWriter( vector<LetterNumber> &posBwt, vector<LetterNumber> &posFile, vector<LETTER_COUNT_CLASS> &counts, LetterCount &total )
+        : posBwt_( posBwt ), posFile_( posFile ), counts_( counts ), total_( total ), currentPosBwt_( 0 ) {}
+
+    void operator()( LetterNumber posInFile, const LetterCount &countsThisChunk )
+    {
+        counts_.push_back( LETTER_COUNT_CLASS() );
+        for ( int i( 0 ); i < alphabetSize; i++ )
+        {
+            counts_.back().count_[i] = countsThisChunk.count_[i];
+            currentPosBwt_ += countsThisChunk.count_[i];
+        }
+        posBwt_.push_back( currentPosBwt_ );
+        posFile_.push_back( posInFile );
+        total_ += countsThisChunk;
+    }
+
+    vector<LetterNumber> &posBwt_;
+    vector<LetterNumber> &posFile_;
+    vector<LETTER_COUNT_CLASS> &counts_;
+    LetterCount &total_;
+    LetterNumber currentPosBwt_;
+};
+
+} // anonymous namespace
+
+void buildIndex( BwtReaderBase *reader0, FILE *pIndexFile, const int indexBinSize )
+{
+    BwtReaderRunLengthBase *reader = dynamic_cast< BwtReaderRunLengthBase* >( reader0 );
+
     if (reader == NULL)
     {
         Logger::out() << "Warning: cannot index file " << reader0->filename_ << endl;
@@ -401,54 +518,56 @@ void buildIndex( BwtReaderBase *reader0, FILE *pIndexFile, const int indexBinSiz
     fwrite( &sizeOfAlphabet, sizeof( uint8_t ), 1, pIndexFile );
     fwrite( &sizeOfLetterNumber, sizeof( uint8_t ), 1, pIndexFile );
 
+    IndexFileWriter writer( pIndexFile );
+    const LetterNumber runsSoFar = scanIndexPoints( reader, indexBinSize, writer );
 
-    while ( !lastRun )
-    {
-        lastRun = !reader->getRun();
-        if (!lastRun)
-        {
-            runsSoFar++;
-            runsThisChunk++;
+    cout << "buildIndex: read " << reader->currentPos_ << " bases compressed into " << runsSoFar << " runs" << " over " << reader->tellg() << " bytes." << endl;
+    cout << "buildIndex: generated " << writer.chunksSoFar_ << " index points." << endl;
+} // ~buildIndex
 
-            countsThisChunk.count_[whichPile[reader->lastChar_]] += reader->runLength_;
-            assert( countsThisChunk.count_[whichPile[reader->lastChar_]] >= reader->runLength_ && "Error: Overflow in buildIndex" );
-            reader->currentPos_ += reader->runLength_;
-        }
-        if ( runsThisChunk == runsPerChunk || lastRun )
-        {
-#ifdef DEBUG_RAC
-            cout << reader->currentPos_ << " " << runsSoFar << " " << countsThisChunk << endl;
-#endif
 
-            // don't bother writing this as can deduce by summing countsThisChunk
-            //            assert
-            //            ( fwrite( &reader->currentPos_, sizeof( LetterNumber ), 1, pIndexFile ) == 1 );
+template< class T >
+void BwtReaderIndex<T>::buildIndexInRam( LetterCount &c, const int indexBinSize )
+{
+    T::rewindFile();
+    indexPosBwt0_.clear();
+    indexPosFile0_.clear();
+    indexCount0_.clear();
 
-            LetterNumber posInFile = reader->tellg();
+    IndexRamWriter writer( indexPosBwt0_, indexPosFile0_, indexCount0_, c );
+    scanIndexPoints( this, indexBinSize, writer );
 
-            assert
-            ( fwrite( &posInFile, sizeof( LetterNumber ), 1, pIndexFile ) == 1 );
+    indexSize_ = indexPosBwt0_.size();
+    indexPosBwt_ = indexPosBwt0_.data();
+    indexPosFile_ = indexPosFile0_.data();
+    indexCount_ = indexCount0_.data();
+    rewindFile();
+} // ~buildIndexInRam
 
-            // In index format v2, we write each LetterCount independently, encoding the number of bytes as first byte
-            for (int i=0; i<alphabetSize; ++i)
-            {
-                LetterNumber val = countsThisChunk.count_[i];
-                int bytesNeeded = 0;
-                while (val >> (8*bytesNeeded))
-                    ++bytesNeeded;
-                assert( fwrite( &bytesNeeded, 1, 1, pIndexFile ) == 1 );
-                if (bytesNeeded)
-                    assert( fwrite( &val, bytesNeeded, 1, pIndexFile ) == 1 );
-            }
 
-            chunksSoFar++;
-            runsThisChunk = 0;
-            countsThisChunk.clear();
-        }
+BwtReaderBase *instantiateBwtPileReaderAndCount( const string &pileFilename, const string &useShm, const bool keepBwtInRam, LetterCount &c, const int indexBinSize )
+{
+    BwtReaderBase *reader = instantiateBwtPileReader( pileFilename, useShm, keepBwtInRam );
+
+    // Exact types only: the BwtReaderIndex ones already have an index file
+    if ( typeid( *reader ) == typeid( BwtReaderRunLengthV3 ) )
+    {
+        delete reader;
+        BwtReaderIndex<BwtReaderRunLengthV3> *indexedReader = new BwtReaderIndex<BwtReaderRunLengthV3>( pileFilename, useShm );
+        indexedReader->buildIndexInRam( c, indexBinSize );
+        return indexedReader;
     }
-    cout << "buildIndex: read " << reader->currentPos_ << " bases compressed into " << runsSoFar << " runs" << " over " << reader->tellg() << " bytes." << endl;
-    cout << "buildIndex: generated " << chunksSoFar << " index points." << endl;
-} // ~buildIndex
+    if ( typeid( *reader ) == typeid( BwtReaderRunLength ) )
+    {
+        delete reader;
+        BwtReaderIndex<BwtReaderRunLength> *indexedReader = new BwtReaderIndex<BwtReaderRunLength>( pileFilename, useShm );
+        indexedReader->buildIndexInRam( c, indexBinSize );
+        return indexedReader;
+    }
+
+    reader->readAndCount( c );
+    return reader;
+} // ~instantiateBwtPileReaderAndCount
 
 
 
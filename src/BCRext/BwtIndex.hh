@@ -78,6 +78,18 @@ public:
 
     void initIndex( const string &optionalSharedMemoryPath );
 
+    // Index points are restart positions in the BWT file: after index point i,
+    // decoding can resume at file offset posInFile with BWT position posInBwt
+    uint32_t getIndexSize( void ) const
+    {
+        return indexSize_;
+    }
+    void getIndexPoint( const uint32_t i, LetterNumber &posInBwt, LetterNumber &posInFile, LetterCount &countsThisChunk ) const;
+
+    // Replaces the index with one built in RAM by a full pass over the BWT
+    // file, with an index point every indexBinSize runs. Letters are added to c.
+    void buildIndexInRam( LetterCount &c, const int indexBinSize );
+
     //  bool getRun(void);
 protected:
 
@@ -103,5 +115,11 @@ protected:
 
 void buildIndex( BwtReaderBase *reader, FILE *pFile, const int indexBinSize );
 
+// Same as instantiateBwtPileReader, also counting the letters of the whole
+// pile into c. Run-length-encoded piles without an index file get one built
+// in RAM during this pass, so that the returned reader (and its clones) can
+// jump over long distances.
+BwtReaderBase *instantiateBwtPileReaderAndCount( const string &pileFilename, const string &useShm, const bool keepBwtInRam, LetterCount &c, const int indexBinSize );
+
 
 #endif //ifdef BWT_INDEX_HH
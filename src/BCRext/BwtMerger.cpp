@@ -0,0 +1,412 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "BwtMerger.hh"
+
+#include "Alphabet.hh"
+#include "BwtReader.hh"
+#include "BwtWriter.hh"
+#include "Tools.hh"
+#include "libzoo/util/Logger.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+
+using namespace std;
+
+
+namespace
+{
+
+const LetterNumber mergeBufferSize( 65536 );
+
+string pileFilename( const string &prefix, const char *suffix, const int pile )
+{
+    ostringstream oss;
+    oss << prefix << suffix << pile;
+    return oss.str();
+}
+
+// Sequential access to the decoded symbols of a BWT pile
+class MergeInputPile
+{
+public:
+    MergeInputPile( const string &filename )
+        : filename_( filename )
+        , reader_( instantiateBwtPileReader( filename, "", false, true ) )
+        , buf_( mergeBufferSize )
+        , pos_( 0 )
+        , end_( 0 )
+    {
+    }
+
+    char next()
+    {
+        if ( pos_ == end_ )
+        {
+            end_ = ( *reader_ )( &buf_[0], mergeBufferSize );
+            pos_ = 0;
+            if ( end_ == 0 )
+            {
+                Logger::error() << "Error: Unexpected end of BWT file " << filename_ << endl;
+                exit( EXIT_FAILURE );
+            }
+        }
+        return buf_[pos_++];
+    }
+
+private:
+    const string filename_;
+    unique_ptr<BwtReaderBase> reader_;
+    vector<char> buf_;
+    LetterNumber pos_;
+    LetterNumber end_;
+};
+
+// Sequential access to a metagenomics C file (one file number per BWT position)
+class MergeInputCFile
+{
+public:
+    MergeInputCFile( const string &filename )
+        : filename_( filename )
+        , file_( fopen( filename.c_str(), "rb" ) )
+        , buf_( mergeBufferSize )
+        , pos_( 0 )
+        , end_( 0 )
+    {
+        if ( file_ == NULL )
+        {
+            Logger::error() << "Error: Cannot open C file " << filename_ << endl;
+            exit( EXIT_FAILURE );
+        }
+    }
+    ~MergeInputCFile()
+    {
+        fclose( file_ );
+    }
+
+    MetagFileNumRefType next()
+    {
+        if ( pos_ == end_ )
+        {
+            end_ = fread( &buf_[0], sizeof( MetagFileNumRefType ), mergeBufferSize, file_ );
+            pos_ = 0;
+            if ( end_ == 0 )
+            {
+                Logger::error() << "Error: Unexpected end of C file " << filename_ << endl;
+                exit( EXIT_FAILURE );
+            }
+        }
+        return buf_[pos_++];
+    }
+
+private:
+    const string filename_;
+    FILE *file_;
+    vector<MetagFileNumRefType> buf_;
+    size_t pos_;
+    size_t end_;
+};
+
+void readEndPosHeader( FILE *file, const string &filename, SequenceNumber &seqCount )
+{
+    uint8_t subSequenceCount, hasRevComp;
+    if ( file == NULL
+         || fread( &seqCount, sizeof( SequenceNumber ), 1, file ) != 1
+         || fread( &subSequenceCount, sizeof( uint8_t ), 1, file ) != 1
+         || fread( &hasRevComp, sizeof( uint8_t ), 1, file ) != 1 )
+    {
+        Logger::error() << "Error: Cannot read end-pos file " << filename << endl;
+        exit( EXIT_FAILURE );
+    }
+    if ( subSequenceCount != 1 || hasRevComp != 0 )
+    {
+        Logger::error() << "Error: " << filename << " was built with sub-sequences or reverse-complements, which beetl-merge doesn't support" << endl;
+        exit( EXIT_FAILURE );
+    }
+}
+
+} // anonymous namespace
+
+
+BwtMerger::BwtMerger( const string &prefixA, const string &prefixB, const string &outputPrefix, const bool outputAscii )
+    : prefixA_( prefixA )
+    , prefixB_( prefixB )
+    , outputPrefix_( outputPrefix )
+    , outputAscii_( outputAscii )
+    , mergeEndPos_( false )
+    , mergeCFiles_( false )
+    , fileNumOffsetB_( 0 )
+{
+    bool compressed;
+    string availableLetters;
+    detectInputBwtProperties( prefixA_, pileNamesA_, compressed, availableLetters );
+    detectInputBwtProperties( prefixB_, pileNamesB_, compressed, availableLetters );
+
+    if ( pileNamesA_.empty() || pileNamesB_.empty() )
+    {
+        Logger::error() << "Error: Did not find any BWT files matching prefix " << ( pileNamesA_.empty() ? prefixA_ : prefixB_ ) << endl;
+        exit( EXIT_FAILURE );
+    }
+    if ( pileNamesA_.size() != pileNamesB_.size() )
+    {
+        Logger::error() << "Error: " << prefixA_ << " and " << prefixB_ << " have different numbers of BWT piles" << endl;
+        exit( EXIT_FAILURE );
+    }
+}
+
+void BwtMerger::run()
+{
+    const int pileCount = pileNamesA_.size();
+    countPileSizes();
+
+    // Initial interleave: for each pile, all of A then all of B.
+    // Pile 0 (suffixes starting with '$') is already in its final order,
+    // as A's sequences all precede B's
+    interleave_.clear();
+    interleave_.resize( pileCount, SegmentedBits( pileCount ) );
+    for ( int pile = 0; pile < pileCount; ++pile )
+    {
+        for ( LetterNumber i = 0; i < pileSizesA_[pile]; ++i )
+            interleave_[pile][0].push_back( 0 );
+        for ( LetterNumber i = 0; i < pileSizesB_[pile]; ++i )
+            interleave_[pile][0].push_back( 1 );
+    }
+
+    int iteration = 0;
+    bool changed = true;
+    while ( changed )
+    {
+        changed = iterate();
+        ++iteration;
+        changed |= ( iteration == 1 ); // the first iteration only changes the segmentation
+        Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Merge iteration " << iteration << ( changed ? ": interleave changed" : ": converged" ) << endl;
+    }
+    Logger::out() << "Interleave converged after " << iteration << " iterations" << endl;
+
+    dollarSources_.clear();
+    dollarSources_.resize( pileCount );
+    #pragma omp parallel for schedule(dynamic)
+    for ( int pile = 0; pile < pileCount; ++pile )
+        writeMergedPile( pile );
+
+    if ( mergeEndPos_ )
+        writeMergedEndPosFile();
+
+    interleave_.clear();
+    dollarSources_.clear();
+}
+
+void BwtMerger::countPileSizes()
+{
+    const int pileCount = pileNamesA_.size();
+    pileSizesA_.assign( pileCount, 0 );
+    pileSizesB_.assign( pileCount, 0 );
+
+    #pragma omp parallel for schedule(dynamic)
+    for ( int i = 0; i < 2 * pileCount; ++i )
+    {
+        const int pile = i / 2;
+        const string &name = ( i & 1 ) ? pileNamesB_[pile] : pileNamesA_[pile];
+        unique_ptr<BwtReaderBase> reader( instantiateBwtPileReader( name, "", false, true ) );
+        LetterCount counts;
+        const LetterNumber size = reader->readAndCount( counts, maxLetterNumber );
+        ( ( i & 1 ) ? pileSizesB_ : pileSizesA_ )[pile] = size;
+    }
+
+    if ( pileSizesA_[0] + pileSizesB_[0] < pileSizesA_[0] || pileSizesA_[0] + pileSizesB_[0] > maxSequenceNumber )
+    {
+        Logger::error() << "Error: The merged BWT would contain too many sequences" << endl;
+        exit( EXIT_FAILURE );
+    }
+    Logger::out() << "Merging " << pileSizesA_[0] << " sequences from " << prefixA_ << " with " << pileSizesB_[0] << " sequences from " << prefixB_ << endl;
+}
+
+bool BwtMerger::iterate()
+{
+    const int pileCount = pileNamesA_.size();
+    vector<SegmentedBits> newInterleave( pileCount, SegmentedBits( pileCount ) );
+
+    #pragma omp parallel for schedule(dynamic)
+    for ( int pile = 0; pile < pileCount; ++pile )
+        scanPile( pile, newInterleave );
+
+    bool changed = false;
+    for ( int pile = 1; pile < pileCount; ++pile )
+    {
+        if ( !( newInterleave[pile] == interleave_[pile] ) )
+        {
+            changed = true;
+            interleave_[pile].swap( newInterleave[pile] );
+        }
+    }
+    return changed;
+}
+
+void BwtMerger::scanPile( const int pile, vector<SegmentedBits> &newInterleave ) const
+{
+    // Only writes to newInterleave[*][pile]: no locking needed
+    MergeInputPile inputA( pileNamesA_[pile] );
+    MergeInputPile inputB( pileNamesB_[pile] );
+
+    const SegmentedBits &segments = interleave_[pile];
+    for ( unsigned int s = 0; s < segments.size(); ++s )
+    {
+        const InterleaveBits &bits = segments[s];
+        for ( LetterNumber i = 0; i < bits.size(); ++i )
+        {
+            const bool fromB = bits[i];
+            const char c = fromB ? inputB.next() : inputA.next();
+            const int destPile = whichPile[( int )c];
+            if ( destPile > 0 )
+                newInterleave[destPile][pile].push_back( fromB );
+            else if ( destPile < 0 )
+            {
+                #pragma omp critical (IO)
+                Logger::error() << "Error: Unexpected character '" << c << "' in " << ( fromB ? pileNamesB_ : pileNamesA_ )[pile] << endl;
+                exit( EXIT_FAILURE );
+            }
+        }
+    }
+}
+
+void BwtMerger::writeMergedPile( const int pile )
+{
+    const string outputFilename = pileFilename( outputPrefix_, "-B0", pile );
+    #pragma omp critical (IO)
+    Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Writing " << outputFilename << endl;
+
+    MergeInputPile inputA( pileNamesA_[pile] );
+    MergeInputPile inputB( pileNamesB_[pile] );
+    unique_ptr<BwtWriterBase> writer;
+    if ( outputAscii_ )
+        writer.reset( new BwtWriterASCII( outputFilename ) );
+    else
+        writer.reset( new BwtWriterRunLengthV3( outputFilename ) );
+
+    unique_ptr<MergeInputCFile> cFileA, cFileB;
+    FILE *cFileOut = NULL;
+    vector<MetagFileNumRefType> cBuf;
+    if ( mergeCFiles_ )
+    {
+        cFileA.reset( new MergeInputCFile( pileFilename( prefixA_, "-C0", pile ) ) );
+        cFileB.reset( new MergeInputCFile( pileFilename( prefixB_, "-C0", pile ) ) );
+        const string cFilenameOut = pileFilename( outputPrefix_, "-C0", pile );
+        cFileOut = fopen( cFilenameOut.c_str(), "wb" );
+        if ( cFileOut == NULL )
+        {
+            #pragma omp critical (IO)
+            Logger::error() << "Error: Cannot open " << cFilenameOut << " for writing" << endl;
+            exit( EXIT_FAILURE );
+        }
+        cBuf.reserve( mergeBufferSize );
+    }
+
+    vector<char> buf;
+    buf.reserve( mergeBufferSize );
+    const SegmentedBits &segments = interleave_[pile];
+    for ( unsigned int s = 0; s < segments.size(); ++s )
+    {
+        const InterleaveBits &bits = segments[s];
+        for ( LetterNumber i = 0; i < bits.size(); ++i )
+        {
+            const bool fromB = bits[i];
+            const char c = fromB ? inputB.next() : inputA.next();
+            buf.push_back( c );
+            if ( c == terminatorChar )
+                dollarSources_[pile].push_back( fromB );
+            if ( buf.size() == mergeBufferSize )
+            {
+                ( *writer )( &buf[0], buf.size() );
+                buf.clear();
+            }
+
+            if ( mergeCFiles_ )
+            {
+                cBuf.push_back( fromB ? cFileB->next() + fileNumOffsetB_ : cFileA->next() );
+                if ( cBuf.size() == mergeBufferSize )
+                {
+                    fwrite( &cBuf[0], sizeof( MetagFileNumRefType ), cBuf.size(), cFileOut );
+                    cBuf.clear();
+                }
+            }
+        }
+    }
+    if ( !buf.empty() )
+        ( *writer )( &buf[0], buf.size() );
+    if ( mergeCFiles_ )
+    {
+        if ( !cBuf.empty() )
+            fwrite( &cBuf[0], sizeof( MetagFileNumRefType ), cBuf.size(), cFileOut );
+        fclose( cFileOut );
+    }
+}
+
+void BwtMerger::writeMergedEndPosFile() const
+{
+    const string filenameA = prefixA_ + "-end-pos";
+    const string filenameB = prefixB_ + "-end-pos";
+    const string filenameOut = outputPrefix_ + "-end-pos";
+    Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Writing " << filenameOut << endl;
+
+    FILE *fileA = fopen( filenameA.c_str(), "rb" );
+    FILE *fileB = fopen( filenameB.c_str(), "rb" );
+    SequenceNumber seqCountA, seqCountB;
+    readEndPosHeader( fileA, filenameA, seqCountA );
+    readEndPosHeader( fileB, filenameB, seqCountB );
+    if ( seqCountA != pileSizesA_[0] || seqCountB != pileSizesB_[0] )
+    {
+        Logger::error() << "Error: end-pos files don't match their BWTs' sequence counts" << endl;
+        exit( EXIT_FAILURE );
+    }
+
+    FILE *fileOut = fopen( filenameOut.c_str(), "wb" );
+    if ( fileOut == NULL )
+    {
+        Logger::error() << "Error: Cannot open " << filenameOut << " for writing" << endl;
+        exit( EXIT_FAILURE );
+    }
+    const SequenceNumber seqCount = seqCountA + seqCountB;
+    const uint8_t subSequenceCount = 1;
+    const uint8_t hasRevComp = 0;
+    fwrite( &seqCount, sizeof( SequenceNumber ), 1, fileOut );
+    fwrite( &subSequenceCount, sizeof( uint8_t ), 1, fileOut );
+    fwrite( &hasRevComp, sizeof( uint8_t ), 1, fileOut );
+
+    // The '$' signs are listed in BWT order: follow the merged piles
+    for ( unsigned int pile = 0; pile < dollarSources_.size(); ++pile )
+    {
+        const InterleaveBits &bits = dollarSources_[pile];
+        for ( LetterNumber i = 0; i < bits.size(); ++i )
+        {
+            SequenceNumber seqNum;
+            uint8_t subSeqNum;
+            FILE *fileIn = bits[i] ? fileB : fileA;
+            if ( fread( &seqNum, sizeof( SequenceNumber ), 1, fileIn ) != 1
+                 || fread( &subSeqNum, sizeof( uint8_t ), 1, fileIn ) != 1 )
+            {
+                Logger::error() << "Error: Unexpected end of " << ( bits[i] ? filenameB : filenameA ) << endl;
+                exit( EXIT_FAILURE );
+            }
+            if ( bits[i] )
+                seqNum += seqCountA;
+            fwrite( &seqNum, sizeof( SequenceNumber ), 1, fileOut );
+            fwrite( &subSeqNum, sizeof( uint8_t ), 1, fileOut );
+        }
+    }
+
+    fclose( fileA );
+    fclose( fileB );
+    fclose( fileOut );
+}
@@ -0,0 +1,121 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef BWT_MERGER_HH
+#define BWT_MERGER_HH
+
+#include "Types.hh"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+// InterleaveBits: growable bit vector recording, for each position of a
+// merged BWT pile, whether the symbol comes from BWT A (0) or BWT B (1).
+
+class InterleaveBits
+{
+public:
+    InterleaveBits() : size_( 0 ) {}
+
+    void push_back( const bool bit )
+    {
+        if ( ( size_ & 63 ) == 0 )
+            words_.push_back( 0 );
+        if ( bit )
+            words_.back() |= static_cast<uint64_t>( 1 ) << ( size_ & 63 );
+        ++size_;
+    }
+    bool operator[]( const LetterNumber i ) const
+    {
+        return ( words_[i >> 6] >> ( i & 63 ) ) & 1;
+    }
+    bool operator==( const InterleaveBits &rhs ) const
+    {
+        return size_ == rhs.size_ && words_ == rhs.words_;
+    }
+    LetterNumber size() const
+    {
+        return size_;
+    }
+    void clear()
+    {
+        vector<uint64_t>().swap( words_ );
+        size_ = 0;
+    }
+
+private:
+    vector<uint64_t> words_;
+    LetterNumber size_;
+};
+
+
+// BwtMerger: merges the BWTs of two read collections A and B into the BWT
+// of their concatenation (A's sequences first), without decoding the reads.
+// Holt & McMillan's method: an interleave vector per pile says which input
+// each merged position comes from. Starting from "all of A, then all of B",
+// every iteration scans both BWTs through the current interleave and
+// redistributes its bits to the piles of the preceding symbols; after k
+// iterations the merged order is correct up to k letters, and the process
+// stops when an iteration leaves the interleave unchanged.
+// The piles are scanned in parallel. Each (destination, source) pile pair
+// gets its own segment of interleave bits, so threads never share a word.
+
+class BwtMerger
+{
+public:
+    BwtMerger( const string &prefixA, const string &prefixB, const string &outputPrefix, const bool outputAscii );
+
+    void mergeEndPosFiles( const bool doIt = true )
+    {
+        mergeEndPos_ = doIt;
+    }
+    void mergeCFiles( const bool doIt, const MetagFileNumRefType fileNumOffsetB = 0 )
+    {
+        mergeCFiles_ = doIt;
+        fileNumOffsetB_ = fileNumOffsetB;
+    }
+
+    void run();
+
+private:
+    typedef vector<InterleaveBits> SegmentedBits; // [source pile]
+
+    void countPileSizes();
+    bool iterate(); // returns true if the interleave changed
+    void scanPile( const int pile, vector<SegmentedBits> &newInterleave ) const;
+    void writeMergedPile( const int pile );
+    void writeMergedEndPosFile() const;
+
+    const string prefixA_;
+    const string prefixB_;
+    const string outputPrefix_;
+    const bool outputAscii_;
+    bool mergeEndPos_;
+    bool mergeCFiles_;
+    MetagFileNumRefType fileNumOffsetB_;
+
+    vector<string> pileNamesA_;
+    vector<string> pileNamesB_;
+    vector<LetterNumber> pileSizesA_;
+    vector<LetterNumber> pileSizesB_;
+
+    vector<SegmentedBits> interleave_; // [pile][source pile]
+    vector<InterleaveBits> dollarSources_; // [pile], one bit per '$' of the merged pile
+};
+
+
+#endif //ifndef BWT_MERGER_HH
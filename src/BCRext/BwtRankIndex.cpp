@@ -0,0 +1,527 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "BwtRankIndex.hh"
+
+#include "BwtIndex.hh"
+#include "BwtReader.hh"
+#include "libzoo/util/Logger.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#ifndef DONT_USE_MMAP
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+using namespace std;
+
+
+//
+// BwtRankIndex member function definitions
+//
+
+BwtRankIndex::BwtRankIndex( const string &pileFilename, const int samplingRate, const bool indexPointsOnly )
+    : filename_( pileFilename )
+    , samplingRate_( samplingRate )
+    , isAscii_( false )
+    , fileBuf_( NULL )
+    , fileEnd_( NULL )
+    , fileSize_( 0 )
+    , size_( 0 )
+    , continuationBase_( 1 )
+{
+    assert( samplingRate_ > 0 );
+
+    // The reader parses the file header for us, and gives access to the .idx file if there is one
+    unique_ptr<BwtReaderBase> reader0( instantiateBwtPileReader( pileFilename ) );
+    BwtReaderRunLengthBase *reader = dynamic_cast< BwtReaderRunLengthBase * >( reader0.get() );
+    if ( reader != NULL )
+        setDecodingTables( *reader );
+    else if ( dynamic_cast< BwtReaderASCII * >( reader0.get() ) != NULL )
+    {
+        setAsciiDecodingTables();
+        samplingRate_ *= asciiSamplingRateMultiplier;
+        isAscii_ = true;
+    }
+    else
+    {
+        Logger::error() << "Error: BwtRankIndex needs a run-length encoded or ASCII BWT file. " << pileFilename << " can be converted with beetl-convert." << endl;
+        exit( -1 );
+    }
+
+    mapFile();
+    buildSamples( *reader0, indexPointsOnly );
+} // ~ctor
+
+BwtRankIndex::~BwtRankIndex()
+{
+    if ( fileBuf_ )
+#ifdef DONT_USE_MMAP
+        free( fileBuf_ );
+#else
+        munmap( fileBuf_, fileSize_ );
+#endif
+} // ~dtor
+
+void BwtRankIndex::setDecodingTables( const BwtReaderRunLengthBase &reader )
+{
+    const BwtReaderRunLengthV3 *readerV3 = dynamic_cast< const BwtReaderRunLengthV3 * >( &reader );
+
+    for ( int i = 0; i < alphabetSize + 2; ++i )
+        firstContinuationMultiplier_[i] = 0;
+
+    for ( int i = 0; i < 256; ++i )
+    {
+        lengths_[i] = reader.lengths_[i];
+        if ( readerV3 && reader.codes_[i] == '+' )
+            pileForByte_[i] = continuationPile;
+        else if ( whichPile[reader.codes_[i]] >= 0 && whichPile[reader.codes_[i]] < alphabetSize )
+            pileForByte_[i] = whichPile[reader.codes_[i]];
+        else
+            pileForByte_[i] = invalidPile;
+    }
+
+    if ( readerV3 )
+    {
+        for ( int i = 0; i < alphabetSize; ++i )
+            firstContinuationMultiplier_[i] = readerV3->maxEncodedRunLengthForPile_[i];
+        continuationBase_ = readerV3->maxEncodedRunLengthMultiplierForContinuationSymbol_ + 1;
+    }
+} // ~setDecodingTables
+
+void BwtRankIndex::setAsciiDecodingTables( void )
+{
+    for ( int i = 0; i < alphabetSize + 2; ++i )
+        firstContinuationMultiplier_[i] = 0;
+
+    for ( int i = 0; i < 256; ++i )
+    {
+        lengths_[i] = 1;
+        if ( whichPile[i] >= 0 && whichPile[i] < alphabetSize )
+            pileForByte_[i] = whichPile[i];
+        else
+            pileForByte_[i] = invalidPile;
+    }
+} // ~setAsciiDecodingTables
+
+void BwtRankIndex::mapFile( void )
+{
+    FILE *pFile = fopen( filename_.c_str(), "r" );
+    if ( pFile == NULL )
+    {
+        Logger::error() << "Error: BwtRankIndex failed to open file " << filename_ << endl;
+        exit( -1 );
+    }
+    fseek( pFile, 0, SEEK_END );
+    fileSize_ = ftell( pFile );
+    fseek( pFile, 0, SEEK_SET );
+
+    if ( fileSize_ )
+    {
+#ifdef DONT_USE_MMAP
+        fileBuf_ = ( uchar * ) malloc( fileSize_ );
+        assert( fileBuf_ != 0 && "Not enough RAM to load BWT" );
+        size_t ret = fread( fileBuf_, fileSize_, 1, pFile );
+        assert( ret == 1 );
+#else
+        int fd = fileno( pFile );
+        fileBuf_ = ( uchar * )mmap( NULL, fileSize_, PROT_READ, MAP_SHARED, fd, 0 );
+        if ( fileBuf_ == ( void * ) - 1 )
+        {
+            perror( "Error: Map failed" );
+            exit( -1 );
+        }
+        madvise( fileBuf_, fileSize_, MADV_WILLNEED );
+#endif
+    }
+    fclose( pFile );
+    fileEnd_ = fileBuf_ + fileSize_;
+} // ~mapFile
+
+void BwtRankIndex::buildSamples( BwtReaderBase &reader, const bool indexPointsOnly )
+{
+    // Chunk boundaries: start of data, then each index point if a .idx file is present
+    vector<LetterNumber> chunkPosInBwt( 1, 0 );
+    vector<LetterNumber> chunkPosInFile( 1, reader.tellg() );
+    vector<LetterCount> chunkCounts( 1 );
+
+    BwtReaderIndex<BwtReaderRunLengthV3> *indexV3 = dynamic_cast< BwtReaderIndex<BwtReaderRunLengthV3> * >( &reader );
+    BwtReaderIndex<BwtReaderRunLength> *indexV1 = dynamic_cast< BwtReaderIndex<BwtReaderRunLength> * >( &reader );
+    const uint32_t indexSize = indexV3 ? indexV3->getIndexSize() : ( indexV1 ? indexV1->getIndexSize() : 0 );
+    for ( uint32_t i = 0; i < indexSize; ++i )
+    {
+        LetterNumber posInBwt, posInFile;
+        LetterCount countsThisChunk;
+        if ( indexV3 )
+            indexV3->getIndexPoint( i, posInBwt, posInFile, countsThisChunk );
+        else
+            indexV1->getIndexPoint( i, posInBwt, posInFile, countsThisChunk );
+        if ( posInFile >= fileSize_ )
+            break; // last index point is the end of file
+        chunkPosInBwt.push_back( posInBwt );
+        chunkPosInFile.push_back( posInFile );
+        chunkCounts.push_back( chunkCounts.back() );
+        chunkCounts.back() += countsThisChunk;
+    }
+    const size_t chunkCount = chunkPosInBwt.size();
+
+    vector< vector<LetterNumber> > posInBwtPerChunk( chunkCount ), posInFilePerChunk( chunkCount );
+    vector< vector<LetterCount> > countsPerChunk( chunkCount );
+    vector<LetterCount> endCountsPerChunk( chunkCount );
+
+    #pragma omp parallel for schedule(dynamic)
+    for ( size_t i = 0; i < chunkCount; ++i )
+    {
+        const LetterNumber endPosInFile = ( i + 1 < chunkCount ) ? chunkPosInFile[i + 1] : fileSize_;
+        if ( indexPointsOnly && i + 1 < chunkCount )
+        {
+            posInBwtPerChunk[i].push_back( chunkPosInBwt[i] );
+            posInFilePerChunk[i].push_back( chunkPosInFile[i] );
+            countsPerChunk[i].push_back( chunkCounts[i] );
+            endCountsPerChunk[i] = chunkCounts[i + 1];
+            continue;
+        }
+        sampleChunk( chunkPosInBwt[i], chunkPosInFile[i], chunkCounts[i], endPosInFile,
+                     posInBwtPerChunk[i], posInFilePerChunk[i], countsPerChunk[i], endCountsPerChunk[i] );
+    }
+
+    for ( size_t i = 0; i < chunkCount; ++i )
+    {
+        if ( i + 1 < chunkCount )
+        {
+            for ( int j = 0; j < alphabetSize; ++j )
+                if ( endCountsPerChunk[i].count_[j] != chunkCounts[i + 1].count_[j] )
+                {
+                    Logger::error() << "Error: index file " << filename_ << ".idx is inconsistent with its BWT file. It should be rebuilt with beetl-index." << endl;
+                    exit( -1 );
+                }
+        }
+        samplePosInBwt_.insert( samplePosInBwt_.end(), posInBwtPerChunk[i].begin(), posInBwtPerChunk[i].end() );
+        samplePosInFile_.insert( samplePosInFile_.end(), posInFilePerChunk[i].begin(), posInFilePerChunk[i].end() );
+        sampleCounts_.insert( sampleCounts_.end(), countsPerChunk[i].begin(), countsPerChunk[i].end() );
+    }
+
+    totalCounts_ = endCountsPerChunk.back();
+    size_ = 0;
+    for ( int j = 0; j < alphabetSize; ++j )
+        size_ += totalCounts_.count_[j];
+
+    Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "BwtRankIndex: " << filename_ << ": " << size_ << " bases, " << samplePosInBwt_.size() << " sample points, " << chunkCount << " chunks" << endl;
+} // ~buildSamples
+
+void BwtRankIndex::sampleChunk( const LetterNumber startPosInBwt, const LetterNumber startPosInFile, const LetterCount &startCounts,
+                                const LetterNumber endPosInFile,
+                                vector<LetterNumber> &posInBwt, vector<LetterNumber> &posInFile, vector<LetterCount> &counts,
+                                LetterCount &endCounts ) const
+{
+    LetterCount currentCounts( startCounts );
+    LetterNumber currentPosInBwt = startPosInBwt;
+    const uchar *p = fileBuf_ + startPosInFile;
+    const uchar *pEnd = fileBuf_ + endPosInFile;
+    int runsSinceLastSample = samplingRate_;
+
+    while ( p < pEnd )
+    {
+        if ( runsSinceLastSample == samplingRate_ )
+        {
+            posInBwt.push_back( currentPosInBwt );
+            posInFile.push_back( p - fileBuf_ );
+            counts.push_back( currentCounts );
+            runsSinceLastSample = 0;
+        }
+
+        int letterPile;
+        LetterNumber runLength;
+        p = decodeRun( p, letterPile, runLength );
+        if ( letterPile >= alphabetSize )
+        {
+            Logger::error() << "Error: unexpected byte in BWT file " << filename_ << " at offset " << ( p - fileBuf_ - 1 ) << endl;
+            exit( -1 );
+        }
+        currentCounts.count_[letterPile] += runLength;
+        currentPosInBwt += runLength;
+        ++runsSinceLastSample;
+    }
+    endCounts = currentCounts;
+} // ~sampleChunk
+
+uint32_t BwtRankIndex::findSample( const LetterNumber pos ) const
+{
+    assert( !samplePosInBwt_.empty() );
+    if ( isAscii_ )
+        return pos / samplingRate_; // one letter per run: samples are evenly spaced
+
+    // last sample point located at or before pos
+    vector<LetterNumber>::const_iterator it = upper_bound( samplePosInBwt_.begin(), samplePosInBwt_.end(), pos );
+    assert( it != samplePosInBwt_.begin() );
+    return ( it - samplePosInBwt_.begin() ) - 1;
+} // ~findSample
+
+LetterNumber BwtRankIndex::rank( const int letterPile, const LetterNumber pos ) const
+{
+    assert( pos <= size_ );
+    if ( pos == size_ )
+        return totalCounts_.count_[letterPile];
+
+    const uint32_t sample = findSample( pos );
+    LetterNumber result = sampleCounts_[sample].count_[letterPile];
+    LetterNumber currentPos = samplePosInBwt_[sample];
+    const uchar *p = fileBuf_ + samplePosInFile_[sample];
+
+    while ( currentPos < pos )
+    {
+        int runPile;
+        LetterNumber runLength;
+        p = decodeRun( p, runPile, runLength );
+        if ( runPile == letterPile )
+            result += min( runLength, pos - currentPos );
+        currentPos += runLength;
+    }
+    return result;
+} // ~rank
+
+void BwtRankIndex::occAll( const LetterNumber pos, LetterCount &counts ) const
+{
+    assert( pos <= size_ );
+    if ( pos == size_ )
+    {
+        counts = totalCounts_;
+        return;
+    }
+
+    const uint32_t sample = findSample( pos );
+    counts = sampleCounts_[sample];
+    LetterNumber currentPos = samplePosInBwt_[sample];
+    const uchar *p = fileBuf_ + samplePosInFile_[sample];
+
+    while ( currentPos < pos )
+    {
+        int runPile;
+        LetterNumber runLength;
+        p = decodeRun( p, runPile, runLength );
+        counts.count_[runPile] += min( runLength, pos - currentPos );
+        currentPos += runLength;
+    }
+} // ~occAll
+
+LetterNumber BwtRankIndex::select( const int letterPile, const LetterNumber n ) const
+{
+    assert( n < totalCounts_.count_[letterPile] );
+
+    // last sample point with at most n occurrences before it
+    uint32_t first = 0;
+    uint32_t last = sampleCounts_.size();
+    while ( last - first > 1 )
+    {
+        const uint32_t middle = first + ( last - first ) / 2;
+        if ( sampleCounts_[middle].count_[letterPile] <= n )
+            first = middle;
+        else
+            last = middle;
+    }
+
+    LetterNumber occurrences = sampleCounts_[first].count_[letterPile];
+    LetterNumber currentPos = samplePosInBwt_[first];
+    const uchar *p = fileBuf_ + samplePosInFile_[first];
+    while ( true )
+    {
+        int runPile;
+        LetterNumber runLength;
+        p = decodeRun( p, runPile, runLength );
+        if ( runPile == letterPile )
+        {
+            if ( occurrences + runLength > n )
+                return currentPos + ( n - occurrences );
+            occurrences += runLength;
+        }
+        currentPos += runLength;
+    }
+} // ~select
+
+int BwtRankIndex::letterPileAt( const LetterNumber pos, LetterNumber *rankOfLetter ) const
+{
+    assert( pos < size_ );
+    const uint32_t sample = findSample( pos );
+    LetterNumber currentPos = samplePosInBwt_[sample];
+    const uchar *p = fileBuf_ + samplePosInFile_[sample];
+
+    if ( isAscii_ )
+    {
+        const uchar letter = fileBuf_[pos];
+        if ( rankOfLetter )
+            *rankOfLetter = sampleCounts_[sample].count_[pileForByte_[letter]] + count( p, const_cast<const uchar *>( fileBuf_ + pos ), letter );
+        return pileForByte_[letter];
+    }
+    LetterCount counts;
+    if ( rankOfLetter )
+        counts = sampleCounts_[sample];
+
+    while ( true )
+    {
+        int runPile;
+        LetterNumber runLength;
+        p = decodeRun( p, runPile, runLength );
+        if ( currentPos + runLength > pos )
+        {
+            if ( rankOfLetter )
+                *rankOfLetter = counts.count_[runPile] + ( pos - currentPos );
+            return runPile;
+        }
+        counts.count_[runPile] += runLength;
+        currentPos += runLength;
+    }
+} // ~letterPileAt
+
+
+
+//
+// RankIndexedBwt member function definitions
+//
+
+RankIndexedBwt::RankIndexedBwt( const string &bwtPrefix, const int samplingRate, const bool indexPointsOnly )
+    : piles_( alphabetSize )
+{
+    for ( int i = 0; i < alphabetSize; ++i )
+    {
+        stringstream filenameSS;
+        filenameSS << bwtPrefix << "-B0" << i;
+        piles_[i] = new BwtRankIndex( filenameSS.str(), samplingRate, indexPointsOnly );
+        countsPerPile_[i] = piles_[i]->totalCounts();
+    }
+
+    countsCumulative_ = countsPerPile_;
+    for ( int i = 1; i < alphabetSize; ++i )
+        countsCumulative_[i] += countsCumulative_[i - 1];
+} // ~ctor
+
+RankIndexedBwt::~RankIndexedBwt()
+{
+    for ( int i = 0; i < alphabetSize; ++i )
+        delete piles_[i];
+} // ~dtor
+
+void RankIndexedBwt::extendInterval( const int pileNum, const int letterPile, LetterNumber &start, LetterNumber &end ) const
+{
+    // Suffixes starting with letterPile are in pile letterPile,
+    // after the ones coming from the piles preceding pileNum
+    const LetterNumber base = ( pileNum > 0 ) ? countsCumulative_[pileNum - 1].count_[letterPile] : 0;
+    const BwtRankIndex &rankIndex = *piles_[pileNum];
+    start = base + rankIndex.rank( letterPile, start );
+    end = base + rankIndex.rank( letterPile, end );
+} // ~extendInterval
+
+LetterNumber RankIndexedBwt::findDollarNum( int pileNum, LetterNumber pos, SequenceLength &offset ) const
+{
+    offset = 0;
+    while ( stepBackward( pileNum, pos ) != 0 )
+        ++offset;
+    return pos;
+} // ~findDollarNum
+
+int RankIndexedBwt::stepBackward( int &pileNum, LetterNumber &pos ) const
+{
+    LetterNumber rankOfLetter;
+    const int letterPile = piles_[pileNum]->letterPileAt( pos, &rankOfLetter );
+    const LetterNumber base = ( pileNum > 0 ) ? countsCumulative_[pileNum - 1].count_[letterPile] : 0;
+    pos = base + rankOfLetter;
+    pileNum = letterPile;
+    return letterPile;
+} // ~stepBackward
+
+void RankIndexedBwt::stepForward( int &pileNum, LetterNumber &pos ) const
+{
+    // The letter pileNum was LF-mapped to pos from the pile whose cumulative count covers pos
+    const int letterPile = pileNum;
+    int previousPile = 0;
+    while ( countsCumulative_[previousPile].count_[letterPile] <= pos )
+        ++previousPile;
+    const LetterNumber base = ( previousPile > 0 ) ? countsCumulative_[previousPile - 1].count_[letterPile] : 0;
+    pos = piles_[previousPile]->select( letterPile, pos - base );
+    pileNum = previousPile;
+} // ~stepForward
+
+SequenceNumber RankIndexedBwt::findPile0Position( const LetterNumber dollarNum ) const
+{
+    // The first step finds the '$' sign itself, in front of the whole sequence
+    int pileNum = 0;
+    LetterNumber pos = dollarNum;
+    do
+    {
+        stepForward( pileNum, pos );
+    }
+    while ( pileNum != 0 );
+    return pos;
+} // ~findPile0Position
+
+string RankIndexedBwt::extractSequence( const SequenceNumber seqNum, vector< pair<int, LetterNumber> > *positions, LetterNumber *dollarNum ) const
+{
+    assert( seqNum < piles_[0]->size() );
+    string sequence;
+    if ( positions )
+        positions->clear();
+
+    int pileNum = 0;
+    LetterNumber pos = seqNum;
+    while ( true )
+    {
+        const int previousPile = pileNum;
+        const LetterNumber previousPos = pos;
+        const int letterPile = stepBackward( pileNum, pos );
+        if ( letterPile == 0 )
+            break;
+        sequence.push_back( alphabet[letterPile] );
+        if ( positions )
+            positions->push_back( make_pair( previousPile, previousPos ) );
+    }
+
+    reverse( sequence.begin(), sequence.end() );
+    if ( positions )
+        reverse( positions->begin(), positions->end() );
+    if ( dollarNum )
+        *dollarNum = pos;
+    return sequence;
+} // ~extractSequence
+
+bool RankIndexedBwt::findKmer( const string &kmer, LetterNumber &pos, LetterNumber &num ) const
+{
+    pos = 0;
+    num = 0;
+    if ( kmer.empty() )
+        return false;
+
+    int pileNum = whichPile[( int )kmer[kmer.size() - 1]];
+    if ( pileNum <= 0 )
+        return false;
+    LetterNumber start = 0;
+    LetterNumber end = piles_[pileNum]->size();
+
+    // Empty intervals are still propagated, to report where the k-mer would be inserted
+    for ( int k = ( int )kmer.size() - 2; k >= 0; --k )
+    {
+        const int letterPile = whichPile[( int )kmer[k]];
+        if ( letterPile <= 0 )
+            return false;
+        extendInterval( pileNum, letterPile, start, end );
+        pileNum = letterPile;
+    }
+
+    pos = start;
+    num = end - start;
+    return ( num != 0 );
+} // ~findKmer
@@ -0,0 +1,191 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef BWT_RANK_INDEX_HH
+#define BWT_RANK_INDEX_HH
+
+#include "Alphabet.hh"
+#include "LetterCount.hh"
+#include "Types.hh"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+class BwtReaderBase;
+class BwtReaderRunLengthBase;
+
+// Number of runs between two in-memory sample points.
+// Each query decodes at most this many runs.
+const int defaultRankIndexSamplingRate( 64 );
+const int asciiSamplingRateMultiplier( 4 );
+
+
+// BwtRankIndex: random access rank/occ queries on a single run-length
+// encoded BWT pile (RLE or RLE v3), or on an ASCII pile (read as runs of
+// length 1, sampled asciiSamplingRateMultiplier times less often).
+// The compressed pile is mmap'ed and sampled every samplingRate runs; each
+// sample stores the BWT position, the file offset and the cumulative
+// letter counts at that point. A query binary-searches the samples and
+// decodes the few runs separating the sample from the requested position.
+// When the pile has a .idx file, its index points are used to split the
+// sampling pass into chunks processed in parallel. With indexPointsOnly,
+// the index points become the samples and the sampling pass is skipped,
+// for a quick start when only a few queries are needed.
+
+class BwtRankIndex
+{
+public:
+    BwtRankIndex( const string &pileFilename, const int samplingRate = defaultRankIndexSamplingRate, const bool indexPointsOnly = false );
+    ~BwtRankIndex();
+
+    // Number of occurrences of the letter of pile letterPile in [0,pos)
+    LetterNumber rank( const int letterPile, const LetterNumber pos ) const;
+
+    // Number of occurrences of each letter in [0,pos)
+    void occAll( const LetterNumber pos, LetterCount &counts ) const;
+
+    // Position of the occurrence of rank n (counting from 0) of the letter of
+    // pile letterPile: the inverse of rank (n < totalCounts().count_[letterPile])
+    LetterNumber select( const int letterPile, const LetterNumber n ) const;
+
+    // Letter at position pos (pos < size()), returned as a pile number.
+    // Optionally also returns the letter's rank at pos, in the same pass.
+    int letterPileAt( const LetterNumber pos, LetterNumber *rankOfLetter = NULL ) const;
+
+    LetterNumber size( void ) const
+    {
+        return size_;
+    }
+    const LetterCount &totalCounts( void ) const
+    {
+        return totalCounts_;
+    }
+
+    const string filename_;
+
+private:
+    BwtRankIndex( const BwtRankIndex & ); // no copies: owns the mapping
+
+    void mapFile( void );
+    void setDecodingTables( const BwtReaderRunLengthBase &reader );
+    void setAsciiDecodingTables( void );
+    void buildSamples( BwtReaderBase &reader, const bool indexPointsOnly );
+    void sampleChunk( const LetterNumber startPosInBwt, const LetterNumber startPosInFile, const LetterCount &startCounts,
+                      const LetterNumber endPosInFile,
+                      vector<LetterNumber> &posInBwt, vector<LetterNumber> &posInFile, vector<LetterCount> &counts,
+                      LetterCount &endCounts ) const;
+    uint32_t findSample( const LetterNumber pos ) const;
+
+    // Decodes the run starting at p, including its continuation bytes
+    inline const uchar *decodeRun( const uchar *p, int &letterPile, LetterNumber &runLength ) const
+    {
+        const uchar byte = *p++;
+        letterPile = pileForByte_[byte];
+        runLength = lengths_[byte];
+        LetterNumber multiplier = firstContinuationMultiplier_[letterPile];
+        while ( p != fileEnd_ && pileForByte_[*p] == continuationPile )
+        {
+            runLength += lengths_[*p] * multiplier;
+            multiplier *= continuationBase_;
+            ++p;
+        }
+        return p;
+    }
+
+    static const int continuationPile = alphabetSize;
+    static const int invalidPile = alphabetSize + 1;
+
+    int samplingRate_;
+    bool isAscii_; // one byte per letter: letters are accessed directly
+    uchar *fileBuf_;
+    const uchar *fileEnd_;
+    size_t fileSize_;
+    LetterNumber size_;
+    LetterCount totalCounts_;
+
+    // Decoding tables, from the reader's header
+    int pileForByte_[256];
+    LetterNumber lengths_[256];
+    LetterNumber firstContinuationMultiplier_[alphabetSize + 2];
+    LetterNumber continuationBase_;
+
+    vector<LetterNumber> samplePosInBwt_;
+    vector<LetterNumber> samplePosInFile_;
+    vector<LetterCount> sampleCounts_;
+}; // ~class BwtRankIndex
+
+
+// RankIndexedBwt: rank indexes for all the piles of a BWT, supporting
+// backward search of k-mers without any sequential pass over the piles
+
+class RankIndexedBwt
+{
+public:
+    RankIndexedBwt( const string &bwtPrefix, const int samplingRate = defaultRankIndexSamplingRate, const bool indexPointsOnly = false );
+    ~RankIndexedBwt();
+
+    // Finds the BWT interval of the suffixes starting with kmer.
+    // The interval is [pos,pos+num) in pile whichPile[kmer[0]].
+    // Returns false (num=0) if kmer doesn't occur or contains non-ACGTN letters;
+    // in the former case pos is where kmer would be inserted.
+    bool findKmer( const string &kmer, LetterNumber &pos, LetterNumber &num ) const;
+
+    // LF-mapping of interval [start,end) of pile pileNum by letter letterPile
+    void extendInterval( const int pileNum, const int letterPile, LetterNumber &start, LetterNumber &end ) const;
+
+    // Follows LF-mapping from position pos of pile pileNum until reaching a '$' sign.
+    // Returns the dollar number (as used by the -end-pos file) of the sequence containing
+    // this suffix; offset is set to the position of the suffix in its sequence.
+    LetterNumber findDollarNum( int pileNum, LetterNumber pos, SequenceLength &offset ) const;
+
+    // One LF-mapping step from position pos of pile pileNum: returns the letter
+    // found there (as a pile number) and moves pileNum/pos to the suffix it starts
+    int stepBackward( int &pileNum, LetterNumber &pos ) const;
+
+    // Inverse of stepBackward: moves pileNum/pos from a suffix to the one
+    // following its first letter
+    void stepForward( int &pileNum, LetterNumber &pos ) const;
+
+    // Position in pile 0 of the sequence whose '$' sign has this dollar number,
+    // found by decoding it forwards: the inverse of findDollarNum on pile 0
+    SequenceNumber findPile0Position( const LetterNumber dollarNum ) const;
+
+    // Decodes sequence seqNum backwards from its '$' sign, found at position
+    // seqNum of pile 0 (pile 0 lists the sequences in order).
+    // If positions isn't NULL, it receives the (pile, position) of each letter,
+    // which is also where its quality score is in the -Q0x files.
+    // If dollarNum isn't NULL, it receives the sequence's dollar number, as
+    // returned by findDollarNum.
+    string extractSequence( const SequenceNumber seqNum, vector< std::pair<int, LetterNumber> > *positions = NULL, LetterNumber *dollarNum = NULL ) const;
+
+    const BwtRankIndex &pile( const int pileNum ) const
+    {
+        return *piles_[pileNum];
+    }
+    const LetterCountEachPile &countsPerPile( void ) const
+    {
+        return countsPerPile_;
+    }
+
+private:
+    vector<BwtRankIndex *> piles_;
+    LetterCountEachPile countsPerPile_;
+    LetterCountEachPile countsCumulative_;
+}; // ~class RankIndexedBwt
+
+
+#endif //ifndef BWT_RANK_INDEX_HH
@@ -22,6 +22,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <sstream>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 #ifndef DONT_USE_MMAP
 # include <fcntl.h>
 # include <sys/mman.h>
@@ -39,12 +42,13 @@ using namespace std;
 // BwtReaderBase member function definitions
 //
 
-BwtReaderBase::BwtReaderBase( const string &filename ) :
+BwtReaderBase::BwtReaderBase( const string &filename, const string &pileCacheDirectory ) :
     filename_( filename )
-    , pFile_( fopen( filename.c_str(), "r" ) )
+    , pileCacheDirectory_( pileCacheDirectory )
+    , pFile_( new PrefetchingIFStream( filename.c_str(), pileCacheDirectory ) )
     , buf_( ReadBufferSize )
 {
-    if ( pFile_ == NULL )
+    if ( !pFile_->good() )
     {
         cerr << "!! BwtReaderBase: failed to open file " << filename << endl;
         exit( EXIT_FAILURE );
@@ -56,10 +60,11 @@ BwtReaderBase::BwtReaderBase( const string &filename ) :
 
 BwtReaderBase::BwtReaderBase( const BwtReaderBase &obj ):
     filename_( obj.filename_ )
-    , pFile_( fopen( obj.filename_.c_str(), "r" ) )
+    , pileCacheDirectory_( obj.pileCacheDirectory_ )
+    , pFile_( new PrefetchingIFStream( obj.filename_.c_str(), obj.pileCacheDirectory_ ) )
     , buf_( obj.buf_ )
 {
-    if ( pFile_ == NULL )
+    if ( !pFile_->good() )
     {
         cerr << "!! BwtReaderBase: failed to re-open file " << filename_ << endl;
         exit( EXIT_FAILURE );
@@ -74,8 +79,7 @@ BwtReaderBase::BwtReaderBase( const BwtReaderBase &obj ):
 
 BwtReaderBase::~BwtReaderBase()
 {
-    if ( pFile_ )
-        fclose( pFile_ );
+    delete pFile_;
 #ifdef DEBUG
     cout << "BwtReaderBase: closed file " << pFile_ << endl;
 #endif
@@ -230,8 +234,8 @@ LetterNumber BwtReaderASCII::operator()( char *p, LetterNumber numChars )
 // BwtReaderRunLengthBase member function definitions
 //
 
-BwtReaderRunLengthBase::BwtReaderRunLengthBase( const string &filename ):
-    BwtReaderBase( filename ),
+BwtReaderRunLengthBase::BwtReaderRunLengthBase( const string &filename, const string &pileCacheDirectory ):
+    BwtReaderBase( filename, pileCacheDirectory ),
     lengths_( 256 ),
     codes_( 256 ),
     pBuf_( buf_.data() + ReadBufferSize ),
@@ -426,8 +430,8 @@ LetterNumber BwtReaderRunLengthBase::operator()( char *p, LetterNumber numChars
 // BwtReaderRunLength member function definitions
 //
 
-BwtReaderRunLength::BwtReaderRunLength( const string &filename ):
-    BwtReaderRunLengthBase( filename )
+BwtReaderRunLength::BwtReaderRunLength( const string &filename, const string &pileCacheDirectory ):
+    BwtReaderRunLengthBase( filename, pileCacheDirectory )
 {
 } // ~ctor
 
@@ -479,13 +483,50 @@ bool BwtReaderRunLength::getRun( void )
 // BwtReaderRunLengthV3 member function definitions
 //
 
-BwtReaderRunLengthV3::BwtReaderRunLengthV3( const string &filename ):
-    BwtReaderRunLengthBase( filename ),
+// Run handlers for BwtReaderRunLengthV3::decodeRunsInBuffer
+// operator() takes one run, block() 16 single-byte runs along with their letter counts
+struct RunCounter
+{
+    RunCounter( LetterCount &c ) : c_( c ) {}
+    void operator()( const int pile, const LetterNumber runLength )
+    {
+        c_.count_[pile] += runLength;
+    }
+    void block( const uchar *, const LetterNumber *blockCounts )
+    {
+        for ( int i = 0; i < alphabetSize; ++i )
+            c_.count_[i] += blockCounts[i];
+    }
+    LetterCount &c_;
+};
+
+struct RunSender
+{
+    RunSender( BwtWriterBase &writer, const uchar *pileFor, const uint *lengths ) : writer_( writer ), pileFor_( pileFor ), lengths_( lengths ) {}
+    void operator()( const int pile, const LetterNumber runLength )
+    {
+        writer_.sendRun( alphabet[pile], runLength );
+    }
+    void block( const uchar *p, const LetterNumber * )
+    {
+        for ( int i = 0; i < 16; ++i )
+            writer_.sendRun( alphabet[pileFor_[p[i]]], lengths_[p[i]] );
+    }
+    BwtWriterBase &writer_;
+    const uchar *pileFor_;
+    const uint *lengths_;
+};
+
+BwtReaderRunLengthV3::BwtReaderRunLengthV3( const string &filename, const string &pileCacheDirectory ):
+    BwtReaderRunLengthBase( filename, pileCacheDirectory ),
     symbolForRunLength1ForPile_( 0 ),
     maxEncodedRunLengthForPile_( 0 ),
     firstContinuationSymbol_( 0 ),
     maxEncodedRunLengthMultiplierForContinuationSymbol_( 0 ),
     firstDataByteInFile_( 0 ),
+    pileForBytecode_( 256 ),
+    maxSingleByteRunLength_( 0 ),
+    singleByteRunsArePileRanges_( false ),
     prefetchedByte_( 0 )
 {
     // Check file header
@@ -523,6 +564,11 @@ BwtReaderRunLengthV3::BwtReaderRunLengthV3( const string &filename ):
         assert( fread( &base, sizeof( base ), 1, pFile_ ) == 1 );
         assert( fread( &rangeLength, sizeof( rangeLength ), 1, pFile_ ) == 1 );
         assert( fread( &firstRunLength, sizeof( firstRunLength ), 1, pFile_ ) == 1 );
+        if ( base != '+' && whichPile[base] < 0 )
+        {
+            Logger::error() << "Error: invalid letter code " << ( int )base << " in the header of " << filename << endl;
+            exit( EXIT_FAILURE );
+        }
 
         for (int i=0; i<rangeLength; ++i)
         {
@@ -547,6 +593,37 @@ BwtReaderRunLengthV3::BwtReaderRunLengthV3( const string &filename ):
     }
     assert (firstBytecode == 256 );
 
+    // Tables for bulk decoding
+    int continuationBytecodeCount = 0;
+    for ( int i = 0; i < 256; ++i )
+    {
+        if ( codes_[i] == '+' )
+        {
+            pileForBytecode_[i] = alphabetSize;
+            ++continuationBytecodeCount;
+        }
+        else
+        {
+            pileForBytecode_[i] = whichPile[codes_[i]];
+            maxSingleByteRunLength_ = max( maxSingleByteRunLength_, lengths_[i] );
+        }
+    }
+    int pileRangesBytecodeCount = 0;
+    singleByteRunsArePileRanges_ = true;
+    for ( int pile = 0; pile < alphabetSize && singleByteRunsArePileRanges_; ++pile )
+    {
+        const LetterNumber rangeLength = maxEncodedRunLengthForPile_[pile];
+        singleByteRunsArePileRanges_ = ( rangeLength < 256 && symbolForRunLength1ForPile_[pile] + rangeLength <= 256 );
+        for ( LetterNumber i = 0; i < rangeLength && singleByteRunsArePileRanges_; ++i )
+        {
+            const int bytecode = symbolForRunLength1ForPile_[pile] + i;
+            singleByteRunsArePileRanges_ = ( codes_[bytecode] == alphabet[pile] && lengths_[bytecode] == i + 1 );
+        }
+        pileRangesBytecodeCount += rangeLength;
+    }
+    if ( pileRangesBytecodeCount + continuationBytecodeCount != 256 )
+        singleByteRunsArePileRanges_ = false;
+
     currentPosInFile_ = firstDataByteInFile_ = ftell( pFile_ );
     prefetchNextByte();
 } // ~ctor
@@ -558,10 +635,203 @@ BwtReaderRunLengthV3::BwtReaderRunLengthV3( const BwtReaderRunLengthV3 &obj ):
     firstContinuationSymbol_( obj.firstContinuationSymbol_ ),
     maxEncodedRunLengthMultiplierForContinuationSymbol_( obj.maxEncodedRunLengthMultiplierForContinuationSymbol_ ),
     firstDataByteInFile_( obj.firstDataByteInFile_ ),
+    pileForBytecode_( obj.pileForBytecode_ ),
+    maxSingleByteRunLength_( obj.maxSingleByteRunLength_ ),
+    singleByteRunsArePileRanges_( obj.singleByteRunsArePileRanges_ ),
     prefetchedByte_( obj.prefetchedByte_ )
 {
 } // ~ctor
 
+LetterNumber BwtReaderRunLengthV3::readAndCount( LetterCount &c, const LetterNumber numChars )
+{
+    LetterNumber charsLeft( numChars );
+    RunCounter counter( c );
+    while ( charsLeft > runLength_ )
+    {
+        if ( runLength_ )
+        {
+            c.count_[whichPile[lastChar_]] += runLength_;
+            charsLeft -= runLength_;
+            runLength_ = 0;
+        }
+
+        LetterNumber runsDecoded;
+        charsLeft -= decodeRunsInBuffer( counter, charsLeft, maxLetterNumber, runsDecoded );
+        if ( charsLeft == 0 )
+            break;
+
+        // Runs crossing the buffer boundary or longer than what is left
+        if ( getRun() == false )
+        {
+            currentPos_ += ( numChars - charsLeft );
+            return ( numChars - charsLeft );
+        } // ~if
+    } // ~while
+
+    if ( charsLeft )
+    {
+        c.count_[whichPile[lastChar_]] += charsLeft;
+        runLength_ -= charsLeft;
+    }
+    currentPos_ += numChars;
+    return numChars;
+} // ~readAndCount
+
+LetterNumber BwtReaderRunLengthV3::readAndSend( BwtWriterBase &writer, const LetterNumber numChars )
+{
+    LetterNumber charsLeft( numChars );
+    RunSender sender( writer, pileForBytecode_.data(), lengths_.data() );
+    while ( charsLeft > runLength_ )
+    {
+        if ( runLength_ )
+        {
+            writer.sendRun( lastChar_, runLength_ );
+            charsLeft -= runLength_;
+            runLength_ = 0;
+        }
+
+        LetterNumber runsDecoded;
+        charsLeft -= decodeRunsInBuffer( sender, charsLeft, maxLetterNumber, runsDecoded );
+        if ( charsLeft == 0 )
+            break;
+
+        if ( getRun() == false )
+        {
+            currentPos_ += ( numChars - charsLeft );
+            return ( numChars - charsLeft );
+        } // ~if
+    } // ~while
+
+    if ( charsLeft )
+    {
+        writer.sendRun( lastChar_, charsLeft );
+        runLength_ -= charsLeft;
+    }
+    currentPos_ += numChars;
+    return numChars;
+} // ~readAndSend
+
+LetterNumber BwtReaderRunLengthV3::countRunsInBuffer( LetterCount &c, const LetterNumber maxChars, const LetterNumber maxRuns, LetterNumber &runsDecoded )
+{
+    RunCounter counter( c );
+    return decodeRunsInBuffer( counter, maxChars, maxRuns, runsDecoded );
+}
+
+template< class RunHandler >
+LetterNumber BwtReaderRunLengthV3::decodeRunsInBuffer( RunHandler &handler, const LetterNumber maxChars, const LetterNumber maxRuns, LetterNumber &runsDecoded )
+{
+    runsDecoded = 0;
+    if ( prefetchedByte_ == EOF )
+        return 0;
+
+    const int continuationPile = alphabetSize;
+    const uchar *pileFor = pileForBytecode_.data();
+    const uint *lengths = lengths_.data();
+    const uchar *pStart = pBuf_ - 1; // prefetched byte
+    const uchar *p = pStart;
+    const uchar *pEnd = pBufMax_;
+    LetterNumber charsLeft = maxChars;
+    LetterNumber runsLeft = maxRuns;
+    int lastPile = -1;
+    bool stop = false;
+
+    while ( !stop )
+    {
+#ifdef __SSE2__
+        // Blocks of 16 single-byte runs, counted with SIMD range checks: the
+        // offset of a byte in the bytecode range of its pile is its run length-1
+        if ( singleByteRunsArePileRanges_ )
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i one = _mm_set1_epi8( 1 );
+            const LetterNumber maxBlockChars = 16 * ( LetterNumber )maxSingleByteRunLength_;
+            while ( p + 16 < pEnd && charsLeft >= maxBlockChars && runsLeft >= 16 )
+            {
+                const __m128i bytes = _mm_loadu_si128( ( const __m128i * )p );
+                __m128i isSingleByteRun = zero;
+                LetterNumber blockCounts[alphabetSize];
+                LetterNumber blockChars = 0;
+                for ( int pile = 0; pile < alphabetSize; ++pile )
+                {
+                    blockCounts[pile] = 0;
+                    if ( maxEncodedRunLengthForPile_[pile] == 0 )
+                        continue;
+                    const __m128i offsets = _mm_sub_epi8( bytes, _mm_set1_epi8( ( char )symbolForRunLength1ForPile_[pile] ) );
+                    const __m128i maxOffset = _mm_set1_epi8( ( char )( maxEncodedRunLengthForPile_[pile] - 1 ) );
+                    const __m128i inRange = _mm_cmpeq_epi8( _mm_min_epu8( offsets, maxOffset ), offsets );
+                    const __m128i sums = _mm_sad_epu8( _mm_and_si128( _mm_add_epi8( offsets, one ), inRange ), zero );
+                    blockCounts[pile] = _mm_extract_epi16( sums, 0 ) + _mm_extract_epi16( sums, 4 );
+                    blockChars += blockCounts[pile];
+                    isSingleByteRun = _mm_or_si128( isSingleByteRun, inRange );
+                }
+                // Continuation bytes, in the block or extending its last run, are left to the loop below
+                if ( _mm_movemask_epi8( isSingleByteRun ) != 0xFFFF || pileFor[p[16]] == continuationPile )
+                    break;
+
+                handler.block( p, blockCounts );
+                lastPile = pileFor[p[15]];
+                charsLeft -= blockChars;
+                runsLeft -= 16;
+                p += 16;
+            }
+        }
+#endif //ifdef __SSE2__
+
+        // One run at a time, including continuation bytes, until the next block may be tried
+        int runsThisRound = 0;
+        while ( runsThisRound < 16 && runsLeft > 0 )
+        {
+            const int pile = pileFor[*p];
+            if ( pile == continuationPile )
+            {
+                Logger::error() << "Error: run continuation without a run at byte " << currentPosInFile_ + ( p - pStart ) << " of " << filename_ << endl;
+                exit( EXIT_FAILURE );
+            }
+            LetterNumber runLength = lengths[*p];
+            const uchar *q = p + 1;
+            if ( q != pEnd && pileFor[*q] == continuationPile )
+            {
+                LetterNumber multiplier = maxEncodedRunLengthForPile_[pile];
+                do
+                {
+                    runLength += lengths[*q] * multiplier;
+                    multiplier *= maxEncodedRunLengthMultiplierForContinuationSymbol_ + 1;
+                    ++q;
+                }
+                while ( q != pEnd && pileFor[*q] == continuationPile );
+            }
+
+            // A run reaching the end of the buffer may have more continuation bytes in the next one
+            if ( q == pEnd || runLength > charsLeft )
+            {
+                stop = true;
+                break;
+            }
+
+            handler( pile, runLength );
+            lastPile = pile;
+            charsLeft -= runLength;
+            --runsLeft;
+            ++runsThisRound;
+            p = q;
+        }
+        if ( runsThisRound == 0 )
+            stop = true;
+    }
+
+    // p always stays inside the buffer, as the last run of the buffer is left to getRun()
+    assert( p < pEnd );
+    if ( p != pStart )
+    {
+        currentPosInFile_ += p - pStart;
+        lastChar_ = alphabet[lastPile];
+        prefetchedByte_ = *p;
+        pBuf_ = const_cast<uchar *>( p ) + 1;
+    }
+    runsDecoded = maxRuns - runsLeft;
+    return maxChars - charsLeft;
+} // ~decodeRunsInBuffer
+
 bool BwtReaderRunLengthV3::getRun( void )
 {
     if ( prefetchedByte_ == EOF )
@@ -582,7 +852,11 @@ bool BwtReaderRunLengthV3::getRun( void )
         }
         else
         {
-            assert( currentContinuationMultiplier != 0 );
+            if ( currentContinuationMultiplier == 0 )
+            {
+                Logger::error() << "Error: run continuation without a run at byte " << currentPosInFile_ << " of " << filename_ << endl;
+                exit( EXIT_FAILURE );
+            }
             runLength_ += lengths_[prefetchedByte_] * currentContinuationMultiplier;
             currentContinuationMultiplier *= maxEncodedRunLengthMultiplierForContinuationSymbol_ + 1;
         }
@@ -1388,7 +1662,7 @@ BwtReaderRunLengthRam::BwtReaderRunLengthRam( const string &filename ):
     posInFullFileBuf_ = 0;
 
     // This file shouldn't be needed anymore
-    fclose( pFile_ );
+    delete pFile_;
     pFile_ = NULL;
 
     for ( unsigned int i( 0 ); i < 256; i++ )
@@ -1414,7 +1688,7 @@ BwtReaderRunLengthRam::BwtReaderRunLengthRam( const BwtReaderRunLengthRam &obj )
     posInFullFileBuf_ = 0;
 
     // This file shouldn't be needed anymore
-    fclose( pFile_ );
+    delete pFile_;
     pFile_ = NULL;
 
     for ( unsigned int i( 0 ); i < 256; i++ )
@@ -1620,7 +1894,7 @@ BwtReaderBase* instantiateBwtPileReader( const string &pileFilename, const strin
         }
         else
         {
-            return new BwtReaderRunLengthV3( pileFilename );
+            return new BwtReaderRunLengthV3( pileFilename, useShm );
         }
     }
     else
@@ -1646,7 +1920,7 @@ BwtReaderBase* instantiateBwtPileReader( const string &pileFilename, const strin
         {
             // ASCII detected
             Logger_if( LOG_SHOW_IF_VERY_VERBOSE ) Logger::out() << "BWT file " << pileFilename << " detected as ASCII" << endl;
-            return new BwtReaderASCII( pileFilename );
+            return new BwtReaderASCII( pileFilename, useShm );
         }
         else
         {
@@ -1659,7 +1933,7 @@ BwtReaderBase* instantiateBwtPileReader( const string &pileFilename, const strin
             }
             else
             {
-                return new BwtReaderRunLength( pileFilename );
+                return new BwtReaderRunLength( pileFilename, useShm );
             }
         }
     }
@@ -17,6 +17,7 @@
 #include "Config.hh"
 #include "LetterCount.hh"
 #include "Types.hh"
+#include "libzoo/io/PrefetchingIFStream.hh"
 
 #include <cassert>
 #include <cstdio>
@@ -27,11 +28,12 @@
 
 
 class BwtWriterBase;
+class BwtRankIndex;
 
 class BwtReaderBase
 {
 public:
-    BwtReaderBase( const string &filename );
+    BwtReaderBase( const string &filename, const string &pileCacheDirectory = "" );
     BwtReaderBase( const BwtReaderBase &obj );
     virtual ~BwtReaderBase();
     virtual BwtReaderBase *clone() const = 0;
@@ -47,15 +49,16 @@ public:
 
     const string filename_;
 protected:
-    FILE *pFile_;
+    const string pileCacheDirectory_; // where PrefetchingIFStream looks for a cached copy of the pile
+    PrefetchingIFStream *pFile_;
     vector<uchar> buf_;
 }; // ~class BwtReaderBase
 
 class BwtReaderASCII : public BwtReaderBase
 {
 public:
-    BwtReaderASCII( const string &filename ) :
-        BwtReaderBase( filename ),
+    BwtReaderASCII( const string &filename, const string &pileCacheDirectory = "" ) :
+        BwtReaderBase( filename, pileCacheDirectory ),
         currentPos_( 0 ),
         lastChar_( notInAlphabet ),
         runLength_( 0 )
@@ -96,7 +99,7 @@ protected:
 class BwtReaderRunLengthBase : public BwtReaderBase
 {
 public:
-    BwtReaderRunLengthBase( const string &filename );
+    BwtReaderRunLengthBase( const string &filename, const string &pileCacheDirectory = "" );
     BwtReaderRunLengthBase( const BwtReaderRunLengthBase &obj );
 
     virtual ~BwtReaderRunLengthBase() {}
@@ -114,6 +117,7 @@ public:
     virtual bool getRun( void ) = 0;
 
 protected:
+    friend class BwtRankIndex; // uses the decoding tables
     vector<uint> lengths_;
     vector<uchar> codes_;
     uchar *pBuf_;
@@ -130,7 +134,7 @@ public: // exposed for buildIndex. TODO: make private again
 class BwtReaderRunLength : public BwtReaderRunLengthBase
 {
 public:
-    BwtReaderRunLength( const string &filename );
+    BwtReaderRunLength( const string &filename, const string &pileCacheDirectory = "" );
     BwtReaderRunLength( const BwtReaderRunLength &obj );
 
     virtual ~BwtReaderRunLength() {}
@@ -146,7 +150,7 @@ const vector<char> rleV3Header = { 'B', 'W', 'T', 13, 10, 26, 3, 0 };
 class BwtReaderRunLengthV3 : public BwtReaderRunLengthBase
 {
 public:
-    BwtReaderRunLengthV3( const string &filename );
+    BwtReaderRunLengthV3( const string &filename, const string &pileCacheDirectory = "" );
     BwtReaderRunLengthV3( const BwtReaderRunLengthV3 &obj );
 
     virtual ~BwtReaderRunLengthV3() {}
@@ -155,18 +159,37 @@ public:
         return new BwtReaderRunLengthV3( *this );
     };
 
+    virtual LetterNumber readAndCount( LetterCount &c, const LetterNumber numChars );
+    virtual LetterNumber readAndSend( BwtWriterBase &writer, const LetterNumber numChars );
+
     virtual bool getRun( void );
     virtual void rewindFile( void );
     virtual LetterNumber tellg( void ) const;
     virtual int seek( const LetterNumber posInFile, const LetterNumber baseNumber );
 
+    // Bulk decoding of the complete runs available in the read buffer, adding their
+    // letters to c. Stops before exceeding maxChars letters or maxRuns runs, and at
+    // the end of the buffer: the caller then continues with getRun().
+    // The current run (runLength_) is considered as already consumed by the caller.
+    // Returns the number of letters decoded; runsDecoded is set to the number of runs.
+    LetterNumber countRunsInBuffer( LetterCount &c, const LetterNumber maxChars, const LetterNumber maxRuns, LetterNumber &runsDecoded );
+
 protected:
+    friend class BwtRankIndex; // uses the decoding tables
     vector<uchar> symbolForRunLength1ForPile_;
     vector<LetterNumber> maxEncodedRunLengthForPile_;
     uchar firstContinuationSymbol_;
     LetterNumber maxEncodedRunLengthMultiplierForContinuationSymbol_;
     long firstDataByteInFile_;
 
+    // Tables for bulk decoding
+    vector<uchar> pileForBytecode_; // alphabetSize for continuation bytecodes
+    uint maxSingleByteRunLength_;
+    bool singleByteRunsArePileRanges_; // run length n of pile p is bytecode symbolForRunLength1ForPile_[p]+n-1
+
+    template< class RunHandler >
+    LetterNumber decodeRunsInBuffer( RunHandler &handler, const LetterNumber maxChars, const LetterNumber maxRuns, LetterNumber &runsDecoded );
+
     void prefetchNextByte();
     int prefetchedByte_;
 };
@@ -29,7 +29,7 @@ using namespace std;
 // BwtWriterBase member function definitions
 //
 
-BwtWriterFile::BwtWriterFile( const string &fileName ) : pFile_( fopen( fileName.c_str(), "wb" ) )
+BwtWriterFile::BwtWriterFile( const string &fileName ) : pFile_( fopen( fileName.c_str(), "wb" ) ), pSamples_( NULL )
 {
 #ifdef DEBUG
     cout << "BwtWriterFile opened file " << fileName << " " << pFile_ << endl;
@@ -52,6 +52,26 @@ void BwtWriterFile::flush()
     fflush( pFile_ );
 }
 
+void BwtWriterFile::enableSampling( vector<BwtFileSample> *samples, const LetterNumber sampleInterval )
+{
+    pSamples_ = samples;
+    pSamples_->clear();
+    sampleInterval_ = sampleInterval;
+    nextSampleLetterPos_ = 0;
+    lettersWritten_ = 0;
+    sampleCounts_.clear();
+}
+
+void BwtWriterFile::addSample( const LetterNumber posInFile )
+{
+    BwtFileSample sample;
+    sample.posInFile = posInFile;
+    sample.letterPos = lettersWritten_;
+    sample.counts = sampleCounts_;
+    pSamples_->push_back( sample );
+    nextSampleLetterPos_ = lettersWritten_ + sampleInterval_;
+}
+
 //
 // BwtWriterASCII member function definitions
 //
@@ -78,6 +98,12 @@ void BwtWriterASCII::operator()( const char *p, LetterNumber numChars )
 #endif
 
 
+    if ( pSamples_ != NULL )
+    {
+        for ( LetterNumber i( 0 ); i < numChars; i++ )
+            sampleRun( lettersWritten_, p[i], 1 );
+    }
+
     size_t bytesWritten = fwrite( p, sizeof( char ), numChars, pFile_ );
     if ( bytesWritten != ( size_t )numChars )
     {
@@ -94,6 +120,8 @@ void BwtWriterASCII::sendRun( char c, LetterNumber runLength )
 {
     if ( runLength )
     {
+        if ( pSamples_ != NULL )
+            sampleRun( lettersWritten_, c, runLength );
         for ( LetterNumber i( 0 ); i < runLength; i++ ) fputc( c, pFile_ );
         lastChar_ = c;
     }
@@ -163,7 +191,7 @@ void BwtWriterRunLengthBase::operator()( const char *p, LetterNumber numChars )
         {
             if ( runLength_ > 0 )
             {
-                encodeRun( lastChar_, runLength_ );
+                sampleAndEncodeRun( lastChar_, runLength_ );
             } // ~if
             runLength_ = 1;
             lastChar_ = *p;
@@ -248,7 +276,7 @@ void BwtWriterRunLengthBase::sendRun( char c, LetterNumber runLength )
         }
         else
         {
-            if ( runLength_ != 0 ) encodeRun( lastChar_, runLength_ );
+            if ( runLength_ != 0 ) sampleAndEncodeRun( lastChar_, runLength_ );
             lastChar_ = c;
             runLength_ = runLength;
         }
@@ -265,7 +293,7 @@ void BwtWriterRunLengthBase::flush()
 {
     if ( runLength_ != 0 )
     {
-        encodeRun( lastChar_, runLength_ );
+        sampleAndEncodeRun( lastChar_, runLength_ );
         lastChar_ = notInAlphabet;
         runLength_ = 0;
     }
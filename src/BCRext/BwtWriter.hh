@@ -22,8 +22,18 @@
 #include <cstdio>
 #include <map>
 #include <string>
+#include <vector>
 
 
+// Position of a run boundary in a BWT file, with the letter counts up to it,
+// from where a reader can start reading (see BwtReaderBase::seek)
+struct BwtFileSample
+{
+    LetterNumber posInFile;
+    LetterNumber letterPos;
+    LetterCount counts;
+};
+
 struct BwtWriterBase
 {
     virtual ~BwtWriterBase() {};
@@ -47,6 +57,12 @@ struct BwtWriterBase
     {
         assert( false && "virtual method needs implementing" );
     }
+    // Records a sample in *samples every sampleInterval letters or so.
+    // Writers that don't support it leave *samples empty.
+    virtual void enableSampling( vector<BwtFileSample> *samples, const LetterNumber /*sampleInterval*/ )
+    {
+        samples->clear();
+    }
 }; // ~BwtWriterBase
 
 struct BwtWriterFile : public BwtWriterBase
@@ -56,9 +72,32 @@ struct BwtWriterFile : public BwtWriterBase
     virtual ~BwtWriterFile();
 
     virtual void flush();
+    virtual void enableSampling( vector<BwtFileSample> *samples, const LetterNumber sampleInterval );
 
 
     FILE *pFile_;
+
+protected:
+    // To be called by the ASCII and run-length writers before writing each run
+    void sampleRun( const LetterNumber posInFile, const char c, const LetterNumber runLength )
+    {
+        if ( lettersWritten_ >= nextSampleLetterPos_ )
+            addSample( posInFile );
+        const int pile = whichPile[( int )c];
+        if ( pile < alphabetSize )
+            sampleCounts_.count_[pile] += runLength;
+        lettersWritten_ += runLength;
+    }
+
+    vector<BwtFileSample> *pSamples_;
+    LetterNumber lettersWritten_;
+
+private:
+    void addSample( const LetterNumber posInFile );
+
+    LetterNumber sampleInterval_;
+    LetterNumber nextSampleLetterPos_;
+    LetterCount sampleCounts_;
 }; // ~BwtWriterBase
 
 
@@ -101,6 +140,12 @@ struct BwtWriterRunLengthBase : public BwtWriterFile
     void sendChar( char c );
 
     virtual void encodeRun( char c, LetterNumber runLength );
+    void sampleAndEncodeRun( char c, LetterNumber runLength )
+    {
+        if ( pSamples_ != NULL )
+            sampleRun( ftell( pFile_ ) + ( pBuf_ - buf_ ), c, runLength );
+        encodeRun( c, runLength );
+    }
 
     virtual void sendRun( char c, LetterNumber runLength );
     virtual char getLastChar();
@@ -0,0 +1,239 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "SampledSuffixArray.hh"
+
+#include "BwtRankIndex.hh"
+#include "Filename.hh"
+#include "libzoo/util/Logger.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+
+namespace
+{
+
+const char saFileMagic[] = "BWTSA";
+
+// Sequences are processed in blocks, so that each thread appends its samples in bulk
+const SequenceNumber saBuildBlockSize = 4096;
+
+// Samples are stored field by field, without the padding of the in-memory struct
+const size_t serialisedSampleSize = sizeof( LetterNumber ) + sizeof( SequenceNumber ) + sizeof( SequenceLength );
+
+void serialiseSamples( const vector<SampledSuffixArray::Sample> &samples, vector<char> &buf )
+{
+    buf.resize( samples.size() * serialisedSampleSize );
+    char *p = buf.empty() ? NULL : &buf[0];
+    for ( size_t i = 0; i < samples.size(); ++i )
+    {
+        memcpy( p, &samples[i].pos, sizeof( LetterNumber ) );
+        p += sizeof( LetterNumber );
+        memcpy( p, &samples[i].seqNum, sizeof( SequenceNumber ) );
+        p += sizeof( SequenceNumber );
+        memcpy( p, &samples[i].offset, sizeof( SequenceLength ) );
+        p += sizeof( SequenceLength );
+    }
+}
+
+void deserialiseSamples( const vector<char> &buf, vector<SampledSuffixArray::Sample> &samples )
+{
+    samples.resize( buf.size() / serialisedSampleSize );
+    const char *p = buf.empty() ? NULL : &buf[0];
+    for ( size_t i = 0; i < samples.size(); ++i )
+    {
+        memcpy( &samples[i].pos, p, sizeof( LetterNumber ) );
+        p += sizeof( LetterNumber );
+        memcpy( &samples[i].seqNum, p, sizeof( SequenceNumber ) );
+        p += sizeof( SequenceNumber );
+        memcpy( &samples[i].offset, p, sizeof( SequenceLength ) );
+        p += sizeof( SequenceLength );
+    }
+}
+
+// Reads the sequence number of each '$' sign from an end-pos file, numbered
+// as EndPosFile does. Returns false if there is no such file.
+bool readEndPosFile( const string &endPosFilename, const SequenceNumber dollarCount, vector<SequenceNumber> &seqNumOfDollar )
+{
+    FILE *endPosFile = fopen( endPosFilename.c_str(), "rb" );
+    if ( endPosFile == NULL )
+        return false;
+    SequenceNumber sequenceGroupCount = 0;
+    uint8_t sequenceCountInGroup = 0;
+    uint8_t hasRevComp = 0;
+    bool isOk = ( fread( &sequenceGroupCount, sizeof( SequenceNumber ), 1, endPosFile ) == 1
+                  && fread( &sequenceCountInGroup, sizeof( uint8_t ), 1, endPosFile ) == 1
+                  && fread( &hasRevComp, sizeof( uint8_t ), 1, endPosFile ) == 1 );
+    seqNumOfDollar.resize( dollarCount );
+    for ( SequenceNumber dollarNum = 0; isOk && dollarNum < dollarCount; ++dollarNum )
+    {
+        SequenceNumber sequenceGroupNum;
+        uint8_t positionInGroup;
+        isOk = ( fread( &sequenceGroupNum, sizeof( SequenceNumber ), 1, endPosFile ) == 1
+                 && fread( &positionInGroup, sizeof( uint8_t ), 1, endPosFile ) == 1 );
+        seqNumOfDollar[dollarNum] = sequenceGroupNum + positionInGroup * sequenceGroupCount;
+    }
+    fclose( endPosFile );
+    if ( !isOk )
+    {
+        Logger::error() << "Error: " << endPosFilename << " doesn't match the BWT's " << dollarCount << " sequences" << endl;
+        exit( EXIT_FAILURE );
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+
+void SampledSuffixArray::build( const RankIndexedBwt &bwt, const string &bwtPrefix, const int samplingRate )
+{
+    assert( samplingRate > 0 );
+    const SequenceNumber seqCount = bwt.pile( 0 ).size();
+    const SequenceNumber blockCount = ( seqCount + saBuildBlockSize - 1 ) / saBuildBlockSize;
+    vector<Sample> samples[alphabetSize];
+
+    // Pile 0 only lists the sequences in input order without --sap-ordering and
+    // --add-rev-comp: the end-pos file gives the number of each '$' sign
+    vector<SequenceNumber> seqNumOfDollar;
+    const bool hasEndPosFile = readEndPosFile( bwtPrefix + "-end-pos", seqCount, seqNumOfDollar );
+
+    #pragma omp parallel for schedule(dynamic)
+    for ( SequenceNumber block = 0; block < blockCount; ++block )
+    {
+        vector<Sample> blockSamples[alphabetSize];
+        vector<int> rowPiles;
+        vector<LetterNumber> rowPositions;
+        const SequenceNumber blockEnd = min( seqCount, ( block + 1 ) * saBuildBlockSize );
+        for ( SequenceNumber pile0Pos = block * saBuildBlockSize; pile0Pos < blockEnd; ++pile0Pos )
+        {
+            // Rows of the suffixes starting at offsets length-1, length-2, ..., 0
+            rowPiles.clear();
+            rowPositions.clear();
+            int pileNum = 0;
+            LetterNumber pos = pile0Pos;
+            while ( bwt.stepBackward( pileNum, pos ) != 0 )
+            {
+                rowPiles.push_back( pileNum );
+                rowPositions.push_back( pos );
+            }
+            // pos is now the dollar number of the sequence
+            const SequenceNumber seqNum = hasEndPosFile ? seqNumOfDollar[pos] : pile0Pos;
+
+            const SequenceLength length = rowPiles.size();
+            for ( SequenceLength offset = 0; offset < length; offset += samplingRate )
+            {
+                const SequenceLength i = length - 1 - offset;
+                Sample sample;
+                sample.pos = rowPositions[i];
+                sample.seqNum = seqNum;
+                sample.offset = offset;
+                blockSamples[rowPiles[i]].push_back( sample );
+            }
+        }
+
+        #pragma omp critical (SA_SAMPLES)
+        for ( int i = 1; i < alphabetSize; ++i )
+            samples[i].insert( samples[i].end(), blockSamples[i].begin(), blockSamples[i].end() );
+    }
+
+    Filename saFilename( bwtPrefix, "-sa" );
+    ofstream os( saFilename.str().c_str(), ios::binary );
+    const uint32_t samplingRate32 = samplingRate;
+    os.write( saFileMagic, strlen( saFileMagic ) );
+    os.write( reinterpret_cast<const char *>( &samplingRate32 ), sizeof( samplingRate32 ) );
+    LetterNumber totalSamples = 0;
+    vector<char> buf;
+    for ( int i = 1; i < alphabetSize; ++i )
+    {
+        sort( samples[i].begin(), samples[i].end() );
+        const uint64_t sampleCount = samples[i].size();
+        os.write( reinterpret_cast<const char *>( &sampleCount ), sizeof( sampleCount ) );
+        serialiseSamples( samples[i], buf );
+        if ( sampleCount )
+            os.write( &buf[0], buf.size() );
+        totalSamples += sampleCount;
+    }
+    if ( !os.good() )
+    {
+        Logger::error() << "Error: Cannot write " << saFilename << endl;
+        exit( EXIT_FAILURE );
+    }
+    Logger::out() << "Sampled suffix array: " << totalSamples << " samples for " << seqCount << " sequences written to " << saFilename << endl;
+} // ~build
+
+SampledSuffixArray::SampledSuffixArray( const string &bwtPrefix )
+    : samplingRate_( 0 )
+{
+    Filename saFilename( bwtPrefix, "-sa" );
+    ifstream is( saFilename.str().c_str(), ios::binary );
+    char magic[sizeof( saFileMagic ) - 1];
+    uint32_t samplingRate32 = 0;
+    is.read( magic, sizeof( magic ) );
+    is.read( reinterpret_cast<char *>( &samplingRate32 ), sizeof( samplingRate32 ) );
+    if ( !is.good() || memcmp( magic, saFileMagic, sizeof( magic ) ) != 0 || samplingRate32 == 0 )
+    {
+        Logger::error() << "Error: " << saFilename << " is not a sampled suffix array file" << endl;
+        exit( EXIT_FAILURE );
+    }
+    samplingRate_ = samplingRate32;
+
+    vector<char> buf;
+    for ( int i = 1; i < alphabetSize; ++i )
+    {
+        uint64_t sampleCount = 0;
+        is.read( reinterpret_cast<char *>( &sampleCount ), sizeof( sampleCount ) );
+        buf.resize( is.good() ? sampleCount * serialisedSampleSize : 0 );
+        if ( !buf.empty() )
+            is.read( &buf[0], buf.size() );
+        if ( !is.good() )
+        {
+            Logger::error() << "Error: " << saFilename << " is truncated" << endl;
+            exit( EXIT_FAILURE );
+        }
+        deserialiseSamples( buf, samples_[i] );
+    }
+} // ~ctor
+
+void SampledSuffixArray::locate( const RankIndexedBwt &bwt, int pileNum, LetterNumber pos, SequenceNumber &seqNum, SequenceLength &offset ) const
+{
+    assert( pileNum > 0 && "pile 0 only holds empty suffixes" );
+    SequenceLength steps = 0;
+    while ( !findSample( pileNum, pos, seqNum, offset ) )
+    {
+        // Offset 0 is always sampled: a '$' sign can't be reached
+        const int letterPile = bwt.stepBackward( pileNum, pos );
+        assert( letterPile != 0 );
+        ( void )letterPile;
+        ++steps;
+    }
+    offset += steps;
+} // ~locate
+
+bool SampledSuffixArray::findSample( const int pileNum, const LetterNumber pos, SequenceNumber &seqNum, SequenceLength &offset ) const
+{
+    Sample key;
+    key.pos = pos;
+    vector<Sample>::const_iterator it = lower_bound( samples_[pileNum].begin(), samples_[pileNum].end(), key );
+    if ( it == samples_[pileNum].end() || it->pos != pos )
+        return false;
+    seqNum = it->seqNum;
+    offset = it->offset;
+    return true;
+} // ~findSample
@@ -0,0 +1,79 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef SAMPLED_SUFFIX_ARRAY_HH
+#define SAMPLED_SUFFIX_ARRAY_HH
+
+#include "Alphabet.hh"
+#include "Types.hh"
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+class RankIndexedBwt;
+
+
+// SampledSuffixArray: (sequence number, offset) of the BWT positions whose
+// suffix starts at an offset multiple of samplingRate, stored in <prefix>-sa.
+// Offset 0 is always sampled, so locating any BWT position takes at most
+// samplingRate-1 LF-mapping steps, for 16/samplingRate bytes per base
+// instead of the 8 bytes per base of a full generalised suffix array.
+// File format: "BWTSA" magic, samplingRate (uint32), then for piles 1 to
+// alphabetSize-1: sample count (uint64) followed by the samples sorted by
+// position, each one as its position (LetterNumber), sequence number
+// (SequenceNumber) and offset (SequenceLength), unpadded.
+// Pile 0 isn't stored: it only holds the empty suffixes.
+// Sequences are numbered in input order through <prefix>-end-pos when it
+// exists (needed with --sap-ordering and --add-rev-comp), else in the order
+// of pile 0.
+
+class SampledSuffixArray
+{
+public:
+    struct Sample
+    {
+        LetterNumber pos;
+        SequenceNumber seqNum;
+        SequenceLength offset;
+
+        bool operator<( const Sample &rhs ) const
+        {
+            return pos < rhs.pos;
+        }
+    };
+
+    // Walks every sequence of the BWT backwards from its '$' sign and writes <bwtPrefix>-sa
+    static void build( const RankIndexedBwt &bwt, const string &bwtPrefix, const int samplingRate );
+
+    // Loads <bwtPrefix>-sa
+    SampledSuffixArray( const string &bwtPrefix );
+
+    // Sequence number and offset of the suffix at position pos of pile pileNum
+    void locate( const RankIndexedBwt &bwt, int pileNum, LetterNumber pos, SequenceNumber &seqNum, SequenceLength &offset ) const;
+
+    int samplingRate() const
+    {
+        return samplingRate_;
+    }
+
+private:
+    bool findSample( const int pileNum, const LetterNumber pos, SequenceNumber &seqNum, SequenceLength &offset ) const;
+
+    int samplingRate_;
+    vector<Sample> samples_[alphabetSize]; // [pile]
+};
+
+
+#endif // SAMPLED_SUFFIX_ARRAY_HH
@@ -83,13 +83,15 @@ struct IntervalHandlerBase
     )
     {
         //        assert( false );
-        static Range r;
-        r = Range( word, pos, num, isBkptExtension );
-        return r;
+        subIntervalRange_ = Range( word, pos, num, isBkptExtension );
+        return subIntervalRange_;
     }
 
     void createOutputFile( const int subsetThreadNum, const int i, const int j, const int cycle, const string &outputDirectory );
     std::ofstream outFile_;
+
+private:
+    Range subIntervalRange_; // per handler, as handlers run in parallel
 };
 
 typedef void ( IntervalHandlerBase::*IntervalHandler_FoundCallbackPtr ) (
@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <functional>
 #include <inttypes.h>
 #include <sstream>
 #include <unistd.h>
@@ -111,6 +112,7 @@ void RangeStoreExternal::swap( void )
 void RangeStoreExternal::setCycleNum( const int cycleNum )
 {
     Logger_if( LOG_SHOW_IF_VERY_VERBOSE ) Logger::out() << "RangeStoreExternal: setting cycle num " << cycleNum << endl;
+    outputLetterCounts_.clear();
     //    Logger::out( LOG_SHOW_IF_VERY_VERBOSE ) << fileStemIn_ << " " << fileStemOut_ << endl;
     //    const string fileStem_ = "compareIntervals";
     {
@@ -134,7 +136,7 @@ void RangeStoreExternal::setPortion( int pileNum, int portionNum )
     string fileName;
     getFileName( fileStemIn_, pileNum, portionNum, fileName );
     Logger_if( LOG_SHOW_IF_VERY_VERBOSE ) Logger::out() << "Opening input portion file " << fileName << endl;
-    stateIn_.pFile_ = LOCAL_DEF__TEMPORARY_FILE__READ_MODE::fopen( fileName.c_str(), "rb" );
+    stateIn_.pFile_ = openInputFile( fileName );
     if ( stateIn_.pFile_ == NULL )
     {
         Logger_if( LOG_SHOW_IF_VERY_VERBOSE ) Logger::out() << "Warning: no file " << fileName
@@ -151,7 +153,7 @@ void RangeStoreExternal::deleteInputPortion( int i, int j )
     getFileName( fileStemIn_, i, j, fileName );
     Logger_if( LOG_SHOW_IF_VERY_VERBOSE ) Logger::out() << "Deleting input portion file " << fileName << endl;
 #ifndef DONT_DELETE_PREVIOUS_CYCLE_FILES
-    if ( LOCAL_DEF__TEMPORARY_FILE__READ_MODE::remove( fileName.c_str() ) != 0 )
+    if ( removeFile( fileName ) != 0 )
     {
         Logger_if( LOG_SHOW_IF_VERY_VERBOSE ) Logger::out() << "Could not remove " << fileName << endl;
     }
@@ -208,7 +210,7 @@ bool RangeStoreExternal::isRangeKnown( const Range &r, const int pileNum, const
     {
         string fileName;
         getFileName( fileStemIn_, pileNum, portionNum, fileName );
-        stateInForComparison_[pileNum][portionNum].pFile_ = LOCAL_DEF__TEMPORARY_FILE__READ_MODE::fopen( fileName.c_str(), "rb" );
+        stateInForComparison_[pileNum][portionNum].pFile_ = openInputFile( fileName );
 #ifdef ENCODE_POSITIONS_AS_OFFSETS
         stateInForComparison_[pileNum][portionNum].lastProcessedPos_ = 0;
 #endif
@@ -256,11 +258,7 @@ void RangeStoreExternal::addRange( const Range &r, const int pileNum, const int
         getFileName( fileStemOut_, pileNum, portionNum, fileName );
         Logger_if( LOG_SHOW_IF_VERY_VERBOSE ) Logger::out() << "Made output file name " << fileName << endl;
 
-#ifdef USE_RAM_FILES_FOR_WRITE_MODE
-        stateOut_[pileNum][portionNum].pFile_ = LOCAL_DEF__TEMPORARY_FILE__WRITE_MODE::fopen( fileName.c_str(), "wb", static_cast<uint64_t>( TemporaryFilesManager::get().ramLimitMB_ * 1024 * ( 1024 / 64 ) * 0.5 ) ); // Reserves half of the available RAM for temporary files
-#else
-        stateOut_[pileNum][portionNum].pFile_ = LOCAL_DEF__TEMPORARY_FILE__WRITE_MODE::fopen( fileName.c_str(), "wb" );
-#endif
+        stateOut_[pileNum][portionNum].pFile_ = openOutputFile( fileName );
 
         //#ifdef PROPAGATE_SEQUENCE
         stateOut_[pileNum][portionNum].lastProcessedPos_ = 0;
@@ -268,6 +266,7 @@ void RangeStoreExternal::addRange( const Range &r, const int pileNum, const int
     }
 
     stateOut_[pileNum][portionNum] << r;
+    outputLetterCounts_.count_[pileNum] += r.num_;
 }
 
 
@@ -307,7 +306,7 @@ void RangeStoreExternal::clear( bool doDeleteFiles )
 #ifndef DONT_DELETE_PREVIOUS_CYCLE_FILES
                 string fileName;
                 getFileName( fileStemIn_, i, j, fileName );
-                if ( LOCAL_DEF__TEMPORARY_FILE__READ_MODE::remove( fileName.c_str() ) != 0 )
+                if ( removeFile( fileName ) != 0 )
                 {
                     Logger_if( LOG_SHOW_IF_VERY_VERBOSE ) Logger::out() << "Could not remove " << fileName << endl;
                 }
@@ -334,3 +333,242 @@ void RangeStoreExternal::getFileName( const string &stem, const int pile, const
     }
 
 }
+
+TemporaryFile *RangeStoreExternal::openInputFile( const string &fileName )
+{
+    return LOCAL_DEF__TEMPORARY_FILE__READ_MODE::fopen( fileName.c_str(), "rb" );
+}
+
+TemporaryFile *RangeStoreExternal::openOutputFile( const string &fileName )
+{
+#ifdef USE_RAM_FILES_FOR_WRITE_MODE
+    return LOCAL_DEF__TEMPORARY_FILE__WRITE_MODE::fopen( fileName.c_str(), "wb", static_cast<uint64_t>( TemporaryFilesManager::get().ramLimitMB_ * 1024 * ( 1024 / 64 ) * 0.5 ) ); // Reserves half of the available RAM for temporary files
+#else
+    return LOCAL_DEF__TEMPORARY_FILE__WRITE_MODE::fopen( fileName.c_str(), "wb" );
+#endif
+}
+
+bool RangeStoreExternal::removeFile( const string &fileName )
+{
+    return LOCAL_DEF__TEMPORARY_FILE__READ_MODE::remove( fileName.c_str() );
+}
+
+
+//
+// RangeStoreRamFile
+//
+
+// RAM blocks grow from 4KB to 1MB, as most files stay tiny
+static const size_t ramFileFirstBlockSize( 4096 );
+static const size_t ramFileMaxBlockSize( 1024 * 1024 );
+
+RangeStoreRamFileContent::~RangeStoreRamFileContent()
+{
+    size_t bytes = 0;
+    for ( unsigned int i = 0; i < blocks_.size(); ++i )
+        bytes += blocks_[i].capacity();
+    RangeStoreRam::releaseRam( bytes );
+}
+
+RangeStoreRamFile::RangeStoreRamFile( const string &fileName, const char *mode, const shared_ptr< RangeStoreRamFileContent > &content )
+    : TemporaryFile()
+    , fileName_( fileName )
+    , content_( content )
+    , currentBlock_( 0 )
+    , posInBlock_( 0 )
+    , currentPos_( 0 )
+    , eof_( false )
+{
+    assert( ( mode[0] == 'r' || mode[0] == 'w' ) && "invalid file open mode" );
+    if ( mode[0] == 'w' )
+        assert( content_->blocks_.empty() && !content_->continuesOnDisk_ );
+    else if ( content_->continuesOnDisk_ )
+    {
+        // Opened straight away, so that the disk part survives a concurrent removal
+        open( fileName_.c_str(), "rb" );
+    }
+}
+
+size_t RangeStoreRamFile::read( void *ptr, size_t size, size_t nmemb )
+{
+    const size_t totalSize = size * nmemb;
+    char *dest = reinterpret_cast<char *>( ptr );
+    size_t remaining = totalSize;
+    vector< vector<char> > &blocks = content_->blocks_;
+
+    while ( remaining > 0 && currentBlock_ < blocks.size() )
+    {
+        const vector<char> &block = blocks[currentBlock_];
+        const size_t toCopy = min( remaining, block.size() - posInBlock_ );
+        memcpy( dest, &block[posInBlock_], toCopy );
+        dest += toCopy;
+        remaining -= toCopy;
+        posInBlock_ += toCopy;
+        if ( posInBlock_ == block.size() )
+        {
+            ++currentBlock_;
+            posInBlock_ = 0;
+        }
+    }
+
+    if ( remaining > 0 && f_ != NULL )
+        remaining -= ::fread( dest, 1, remaining, f_ );
+
+    currentPos_ += totalSize - remaining;
+    if ( remaining > 0 )
+    {
+        eof_ = true;
+        return size ? ( totalSize - remaining ) / size : 0;
+    }
+    return nmemb;
+}
+
+size_t RangeStoreRamFile::write( const void *ptr, size_t size, size_t nmemb )
+{
+    const size_t totalSize = size * nmemb;
+    const char *src = reinterpret_cast<const char *>( ptr );
+    size_t remaining = totalSize;
+    vector< vector<char> > &blocks = content_->blocks_;
+
+    while ( remaining > 0 && !content_->continuesOnDisk_ )
+    {
+        if ( blocks.empty() || blocks.back().size() == blocks.back().capacity() )
+        {
+            const size_t newBlockSize = blocks.empty() ? ramFileFirstBlockSize : min( 2 * blocks.back().capacity(), ramFileMaxBlockSize );
+            if ( RangeStoreRam::reserveRam( newBlockSize ) )
+            {
+                blocks.push_back( vector<char>() );
+                blocks.back().reserve( newBlockSize );
+            }
+            else
+            {
+                // RAM allowance exhausted: the rest of this file goes to disk
+                open( fileName_.c_str(), "wb" );
+                if ( f_ == NULL )
+                {
+                    perror( ( "Error: cannot create " + fileName_ ).c_str() );
+                    exit( -1 );
+                }
+                content_->continuesOnDisk_ = true;
+                Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "RAM allowance exhausted: " << fileName_ << " continues on disk" << endl;
+                break;
+            }
+        }
+        vector<char> &block = blocks.back();
+        const size_t toCopy = min( remaining, block.capacity() - block.size() );
+        block.insert( block.end(), src, src + toCopy );
+        src += toCopy;
+        remaining -= toCopy;
+    }
+
+    if ( remaining > 0 && ::fwrite( src, remaining, 1, f_ ) != 1 )
+    {
+        currentPos_ += totalSize - remaining;
+        return size ? ( totalSize - remaining ) / size : 0;
+    }
+
+    currentPos_ += totalSize;
+    return nmemb;
+}
+
+
+//
+// RangeStoreRam
+//
+
+size_t RangeStoreRam::ramUsed_ = 0;
+
+RangeStoreRam::RangeStoreRam( const bool propagateSequence, const string fileStem )
+    : RangeStoreExternal( propagateSequence, fileStem )
+    , ramFiles_( new RamFiles )
+{
+}
+
+RangeStoreRam::~RangeStoreRam()
+{
+}
+
+bool RangeStoreRam::reserveRam( const size_t bytes )
+{
+    // Half of the available RAM is reserved for temporary files, as with TemporaryRamFile
+    const size_t ramLimit = TemporaryFilesManager::get().ramLimitMB_ * 1024 * 1024 / 2;
+    bool success = false;
+    #pragma omp critical (RANGE_STORE_RAM_USAGE)
+    {
+        if ( ramUsed_ + bytes <= ramLimit )
+        {
+            ramUsed_ += bytes;
+            success = true;
+        }
+    }
+    return success;
+}
+
+void RangeStoreRam::releaseRam( const size_t bytes )
+{
+    #pragma omp critical (RANGE_STORE_RAM_USAGE)
+    ramUsed_ -= bytes;
+}
+
+TemporaryFile *RangeStoreRam::openInputFile( const string &fileName )
+{
+    shared_ptr< RangeStoreRamFileContent > content;
+    #pragma omp critical (RANGE_STORE_RAM_FILES)
+    {
+        RamFiles::iterator it = ramFiles_->find( fileName );
+        if ( it != ramFiles_->end() )
+            content = it->second;
+    }
+    if ( !content )
+        return NULL;
+    return new RangeStoreRamFile( fileName, "rb", content );
+}
+
+TemporaryFile *RangeStoreRam::openOutputFile( const string &fileName )
+{
+    shared_ptr< RangeStoreRamFileContent > content( new RangeStoreRamFileContent );
+    #pragma omp critical (RANGE_STORE_RAM_FILES)
+    ( *ramFiles_ )[fileName] = content;
+    return new RangeStoreRamFile( fileName, "wb", content );
+}
+
+bool RangeStoreRam::removeFile( const string &fileName )
+{
+    // Readers still holding this file keep its content alive until they close it
+    shared_ptr< RangeStoreRamFileContent > content;
+    #pragma omp critical (RANGE_STORE_RAM_FILES)
+    {
+        RamFiles::iterator it = ramFiles_->find( fileName );
+        if ( it != ramFiles_->end() )
+        {
+            content = it->second;
+            ramFiles_->erase( it );
+        }
+    }
+    if ( !content )
+        return true;
+    if ( content->continuesOnDisk_ )
+        RangeStoreExternal::removeFile( fileName );
+    return false;
+}
+
+
+int splitIntervalsIntoSubsets( const LetterCountEachPile &sizes, const int maxSubsetCount, vector<int> &subsetOfInterval )
+{
+    vector< pair<LetterNumber, int> > intervalSizes;
+    for ( int i( 1 ); i < alphabetSize; ++i )
+        for ( int j( 1 ); j < alphabetSize; ++j )
+            if ( sizes[i].count_[j] != 0 )
+                intervalSizes.push_back( make_pair( sizes[i].count_[j], i * alphabetSize + j ) );
+    stable_sort( intervalSizes.begin(), intervalSizes.end(), greater< pair<LetterNumber, int> >() );
+
+    vector<LetterNumber> subsetSizes( min<size_t>( intervalSizes.size(), max( maxSubsetCount, 1 ) ), 0 );
+    subsetOfInterval.assign( alphabetSize * alphabetSize, -1 );
+    for ( unsigned int k = 0; k < intervalSizes.size(); ++k )
+    {
+        const int subsetNum = min_element( subsetSizes.begin(), subsetSizes.end() ) - subsetSizes.begin();
+        subsetOfInterval[intervalSizes[k].second] = subsetNum;
+        subsetSizes[subsetNum] += intervalSizes[k].first;
+    }
+    return subsetSizes.size();
+} // ~splitIntervalsIntoSubsets
@@ -20,6 +20,7 @@
 #include "Tools.hh"
 #include "libzoo/util/TemporaryFilesManager.hh"
 
+#include <map>
 #include <string>
 
 
@@ -51,6 +52,12 @@ struct RangeStoreExternal : public RangeStore
 
     virtual ~RangeStoreExternal();
 
+    // Copy for a parallel thread, keeping the actual store type
+    virtual RangeStoreExternal *clone() const
+    {
+        return new RangeStoreExternal( *this );
+    }
+
     //    virtual void swap( void );
     virtual void setCycleNum( const int cycleNum );
 
@@ -68,6 +75,13 @@ struct RangeStoreExternal : public RangeStore
     void getFileName( const string &stem, const int pile, const int portion,
                       string &fileName );
 
+    // Makes the intervals added to this store go to the files of another
+    // store, which reads them at its next cycle. Call after setCycleNum.
+    void setOutputFileStem( const RangeStoreExternal &other )
+    {
+        fileStemOut_ = other.fileStemOut_;
+    }
+
     string fileStem_;
     string fileStemIn_;
     string fileStemOut_;
@@ -75,6 +89,16 @@ struct RangeStoreExternal : public RangeStore
     RangeState stateIn_;
     vector< vector< RangeState > > stateOut_; //[alphabetSize][alphabetSize];
 
+    // Letters covered by the intervals added since setCycleNum, indexed by pile
+    LetterCount outputLetterCounts_;
+
+protected:
+    // Storage of the intervals files; returns NULL if the file can't be opened
+    virtual TemporaryFile *openInputFile( const string &fileName );
+    virtual TemporaryFile *openOutputFile( const string &fileName );
+    // Returns false on success, like TemporaryFile::remove
+    virtual bool removeFile( const string &fileName );
+
 private:
     bool getRange( RangeState &stateFile, Range &thisRange );
 
@@ -83,4 +107,94 @@ private:
     vector< std::pair< Range, AlphabetSymbol > > outOfOrderRangesForPile0_;
 }; // ~struct RangeStoreExternal
 
+
+//
+// RangeStoreRamFile: intervals file kept in RAM blocks, which continues on
+// disk when the RAM allowance of RangeStoreRam is exhausted
+//
+struct RangeStoreRamFileContent
+{
+    RangeStoreRamFileContent() : continuesOnDisk_( false ) {}
+    ~RangeStoreRamFileContent();
+
+    vector< vector<char> > blocks_;
+    bool continuesOnDisk_;
+};
+
+class RangeStoreRamFile : public TemporaryFile
+{
+public:
+    RangeStoreRamFile( const string &fileName, const char *mode, const shared_ptr< RangeStoreRamFileContent > &content );
+    virtual ~RangeStoreRamFile() {}
+
+    virtual size_t read( void *ptr, size_t size, size_t nmemb );
+    virtual size_t write( const void *ptr, size_t size, size_t nmemb );
+    virtual size_t tell()
+    {
+        return currentPos_;
+    }
+    virtual bool eof()
+    {
+        return eof_;
+    }
+
+private:
+    const string fileName_;
+    shared_ptr< RangeStoreRamFileContent > content_;
+    size_t currentBlock_;
+    size_t posInBlock_;
+    size_t currentPos_;
+    bool eof_;
+};
+
+
+//
+// RangeStoreRam: same as RangeStoreExternal, but the intervals files are
+// kept in RAM (in their compressed form), up to half of
+// TemporaryFilesManager::ramLimitMB_ for all the stores together.
+// Beyond this limit, the files being written continue on disk.
+// Copies made with clone() share the same files.
+//
+struct RangeStoreRam : public RangeStoreExternal
+{
+    RangeStoreRam( const bool propagateSequence = false, const string fileStem = "Intervals" );
+    virtual ~RangeStoreRam();
+
+    virtual RangeStoreExternal *clone() const
+    {
+        return new RangeStoreRam( *this );
+    }
+
+    // Global RAM allowance shared by all the RAM files
+    static bool reserveRam( const size_t bytes );
+    static void releaseRam( const size_t bytes );
+
+protected:
+    virtual TemporaryFile *openInputFile( const string &fileName );
+    virtual TemporaryFile *openOutputFile( const string &fileName );
+    virtual bool removeFile( const string &fileName );
+
+private:
+    typedef std::map< string, shared_ptr< RangeStoreRamFileContent > > RamFiles;
+    shared_ptr< RamFiles > ramFiles_;
+
+    static size_t ramUsed_;
+}; // ~struct RangeStoreRam
+
+
+//
+// Parallel backtracking of beetl-correct: the intervals are partitioned into
+// subsets, each with its own RangeStore, and every cycle each (subset, pile)
+// pair is processed as an independent task
+//
+const int intervalSubsetsPerThread( 4 );
+
+// Assigns the intervals of the first cycle to at most maxSubsetCount subsets of
+// similar total sizes: the largest intervals go first, each to the currently
+// smallest subset. sizes[i].count_[j] is the size of the interval of suffix
+// alphabet[j]alphabet[i] (pile 0 and '$' letters are ignored).
+// subsetOfInterval[i * alphabetSize + j] receives its subset number, or -1 if
+// it is empty. Returns the number of subsets.
+int splitIntervalsIntoSubsets( const LetterCountEachPile &sizes, const int maxSubsetCount, vector<int> &subsetOfInterval );
+
 #endif
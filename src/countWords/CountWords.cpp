@@ -12,11 +12,13 @@
 
 #include "CountWords.hh"
 
+#include "BwtIndex.hh"
 #include "Timer.hh"
 #include "Tools.hh"
 #include "config.h"
 #include "libzoo/util/Logger.hh"
 
+#include <algorithm>
 #include <fcntl.h>
 #include <sstream>
 #include <sys/mman.h>
@@ -34,6 +36,33 @@ using namespace std;
 //#define FIRST_CYCLE 14
 
 
+namespace
+{
+
+// Index points of the piles without index file, every bwtIndexBinSize runs
+const int bwtIndexBinSize( 8192 );
+
+// A task holding more than 1/targetTaskCount of the intervals of cycle 0
+// moves the intervals it generates to a new chunk
+const int targetTaskCount( 256 );
+
+// Backtracking of the intervals of one chunk in one pile, for one cycle
+struct ChunkPileTask
+{
+    int chunkNum;
+    int pileNum;
+    int outputChunkNum;
+    LetterNumber letterCount;
+};
+
+bool isLargerTask( const ChunkPileTask &t1, const ChunkPileTask &t2 )
+{
+    return t1.letterCount > t2.letterCount;
+}
+
+} // anonymous namespace
+
+
 CountWords::CountWords( bool inputACompressed,
                         bool inputBCompressed, char whichHandler,
                         int paramN, int paramK, const vector<string> &setA,
@@ -121,196 +150,65 @@ void CountWords::run( void )
     Timer  timer;
     LetterCountEachPile countsPerPileA;
     LetterCountEachPile countsPerPileB;
-    const bool useThreadsForSubsets = true;
     int cyclesToSkipComparisonFor = -1;
     int previousComparisonDeactivationLength = 0;
 
 #ifdef _OPENMP
-    // Use nested openmp parallelisation
-    omp_set_nested( 1 );
+    if ( ( *compareParams_ )["threads"].isSet() )
+        omp_set_num_threads( ( *compareParams_ )["threads"] );
+    Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Using " << omp_get_max_threads() << " threads" << endl;
 #endif
 
     // Metagenomics-specific stuff
     if ( mode_ == BeetlCompareParameters::MODE_METAGENOMICS )
         initialiseMetagomeMode();
 
-    vector<RangeStoreExternal *> rangeStoresA;
-    vector<RangeStoreExternal *> rangeStoresB;
-    vector<int> pileToThread;
-    if ( !useThreadsForSubsets )
-    {
-        rangeStoresA.push_back( new RangeStoreExternal( propagateSequence_, "Intervals_setA" ) );
-        rangeStoresB.push_back( new RangeStoreExternal( propagateSequence_, "Intervals_setB" ) );
-        pileToThread.resize( alphabetSize, 0 ); // All piles point to thread 0
-    }
-    else
-    {
-        for ( int i = 0; i < 4; ++i )
-        {
-            ostringstream oss;
-            oss << "Intervals_subset" << i;
-            rangeStoresA.push_back( new RangeStoreExternal( propagateSequence_, oss.str() + "_setA" ) );
-            rangeStoresB.push_back( new RangeStoreExternal( propagateSequence_, oss.str() + "_setB" ) );
-        }
-        pileToThread.resize( alphabetSize, 0 );
-        pileToThread[whichPile['A']] = 0; // pile 'A' processed by thread 0
-        pileToThread[whichPile['C']] = 1; // pile 'C' processed by thread 1
-        pileToThread[whichPile['G']] = 2; // pile 'G' processed by thread 2
-        pileToThread[whichPile['T']] = 3; // pile 'T' processed by thread 3
-        pileToThread[whichPile['N']] = 1; // pile 'N' processed by thread 1
-#ifdef USE_EXTRA_CHARACTER_Z
-        pileToThread[whichPile['Z']] = 2; // pile 'Z' processed by thread 2
-#endif
-    }
-
-    //    cout << "OMP threadCount: " << omp_get_num_threads() << endl;
-    //omp_set_num_threads( 2 * alphabetSize );
-
-    // We reproduce the same nested parallel distribution here than during the real processing loops, in order to load the BWT data in the most appropriate NUMA nodes
-    const int subsetThreadCount = rangeStoresA.size();
-#if defined(_OPENMP)
-    omp_set_num_threads( subsetThreadCount * alphabetSize );
-#endif
-
-    #pragma omp parallel for
-    for ( int threadNum = 0; threadNum < subsetThreadCount * alphabetSize; ++threadNum )
+    // Each (set, pile) is read and counted by its own task
+    #pragma omp parallel for schedule(dynamic)
+    for ( int task = 0; task < 2 * alphabetSize; ++task )
     {
-        int subsetThreadNum = threadNum / alphabetSize; // for ( int subsetThreadNum = 0; subsetThreadNum < subsetThreadCount; ++subsetThreadNum )
-        int i = threadNum % alphabetSize; // for ( int i = 0; i < alphabetSize; ++i )
-
-        int datasetAorB;
-        switch ( subsetThreadNum )
-        {
-                // set A goes to same node as subsets 0&1: node 0
-                // We distribute the read&Count as follows: ACGT=>subset 0's cpus, others=>subset 1's cpus
-            case 0:
-                if ( alphabet[i] == 'A' || alphabet[i] == 'C' || alphabet[i] == 'G' || alphabet[i] == 'T' )
-                    datasetAorB = 0;
-                else
-                    continue;
-                break;
-            case 1:
-                if ( alphabet[i] == 'A' || alphabet[i] == 'C' || alphabet[i] == 'G' || alphabet[i] == 'T' )
-                    continue;
-                else
-                    datasetAorB = 0;
-                break;
-
-                // set B goes to same node as subsets 2&3: node 1
-                // We distribute the read&Count as follows: ACGT=>subset 2's cpus, others=>subset 3's cpus
-            case 2:
-                if ( alphabet[i] == 'A' || alphabet[i] == 'C' || alphabet[i] == 'G' || alphabet[i] == 'T' )
-                    datasetAorB = 1;
-                else
-                    continue;
-                break;
-            case 3:
-                if ( alphabet[i] == 'A' || alphabet[i] == 'C' || alphabet[i] == 'G' || alphabet[i] == 'T' )
-                    continue;
-                else
-                    datasetAorB = 1;
-                break;
+        const bool isSetA = ( task < alphabetSize );
+        const int i = task % alphabetSize;
+        if ( !isDistributedProcessResponsibleForPile( i ) )
+            continue;
 
-            default:
-                continue;
-        }
-        /*
-                omp_set_num_threads( alphabetSize );
-                #pragma omp parallel for
-                for ( int i = 0; i < alphabetSize; ++i )
-        */
+        Logger_if( LOG_SHOW_IF_VERY_VERBOSE )
         {
-            Logger_if( LOG_SHOW_IF_VERY_VERBOSE )
-            {
-                int pid = -1;
-                int numThreads = -1;
-                int processor = -1;
-                readProcSelfStat( pid, numThreads, processor );
-                #pragma omp critical (IO)
-                cerr << "Reading BWT: subsetThreadNum=" << subsetThreadNum << " i=" << i << " pid=" << pid << " numThreads=" << numThreads << " processor=" << processor << endl;
-            }
-            if ( !isDistributedProcessResponsibleForPile( i ) )
-                continue;
-
-            Logger_if( LOG_SHOW_IF_VERY_VERBOSE )
+            #pragma omp critical (IO)
             {
-                #pragma omp critical (IO)
-                {
-                    Logger::out() << "i=" << i << ", alphabet[i]=" << alphabet[i] << ": ";
-                    if ( datasetAorB == 0 )
-                        Logger::out() << "setA[i]=" << setA_[i] << endl;
-                    else
-                        Logger::out() << "setB[i]=" << setB_[i] << endl;
-                }
+                Logger::out() << "i=" << i << ", alphabet[i]=" << alphabet[i] << ": ";
+                if ( isSetA )
+                    Logger::out() << "setA[i]=" << setA_[i] << endl;
+                else
+                    Logger::out() << "setB[i]=" << setB_[i] << endl;
             }
+        }
 
-            if ( datasetAorB == 0 )
-            {
-                inBwtA_[i] = instantiateBwtPileReader( setA_[i], compareParams_->getStringValue( "use shm" ), bwtInRam_ );
-#ifndef DEBUG__SKIP_ITERATION0
-                Logger_if( LOG_SHOW_IF_VERY_VERBOSE )
-                {
-                    int pid = -1;
-                    int numThreads = -1;
-                    int processor = -1;
-                    readProcSelfStat( pid, numThreads, processor );
-                    #pragma omp critical (IO)
-                    Logger::out() << "ReadAndCount set=A i=" << i << " pid=" << pid << " numThreads=" << numThreads << " processor=" << processor << endl;
-                }
-                inBwtA_[i]->readAndCount( countsPerPileA[i] );
-#endif //ifndef DEBUG__SKIP_ITERATION0
-            }
-            else
-            {
-                inBwtB_[i] = instantiateBwtPileReader( setB_[i], compareParams_->getStringValue( "use shm" ), bwtInRam_ );
-#ifndef DEBUG__SKIP_ITERATION0
-                Logger_if( LOG_SHOW_IF_VERY_VERBOSE )
-                {
-                    int pid = -1;
-                    int numThreads = -1;
-                    int processor = -1;
-                    readProcSelfStat( pid, numThreads, processor );
-                    #pragma omp critical (IO)
-                    Logger::out() << "ReadAndCount set=B i=" << i << " pid=" << pid << " numThreads=" << numThreads << " processor=" << processor << endl;
-                }
-                inBwtB_[i]->readAndCount( countsPerPileB[i] );
-#endif //ifndef DEBUG__SKIP_ITERATION0
-            }
+        vector<BwtReaderBase *> &inBwt = isSetA ? inBwtA_ : inBwtB_;
+        LetterCountEachPile &countsPerPile = isSetA ? countsPerPileA : countsPerPileB;
+#ifdef DEBUG__SKIP_ITERATION0
+        inBwt[i] = instantiateBwtPileReader( isSetA ? setA_[i] : setB_[i], compareParams_->getStringValue( "use shm" ), bwtInRam_ );
+#else
+        // The piles without index file get one in RAM, letting each task jump to its own intervals
+        inBwt[i] = instantiateBwtPileReaderAndCount( isSetA ? setA_[i] : setB_[i], compareParams_->getStringValue( "use shm" ), bwtInRam_, countsPerPile[i], bwtIndexBinSize );
 
-            Logger_if( LOG_SHOW_IF_VERY_VERBOSE )
-            {
-                #pragma omp critical (IO)
-                {
-                    if ( datasetAorB == 0 )
-                        Logger::out() << "countsPerPileA[i=" << i << "]: " << countsPerPileA[i] << endl;
-                    else
-                        Logger::out() << "countsPerPileB[i=" << i << "]: " << countsPerPileB[i] << endl;
-                }
-            }
+        Logger_if( LOG_SHOW_IF_VERY_VERBOSE )
+        {
+            #pragma omp critical (IO)
+            Logger::out() << "countsPerPile" << ( isSetA ? 'A' : 'B' ) << "[i=" << i << "]: " << countsPerPile[i] << endl;
+        }
 
-#ifndef DEBUG__SKIP_ITERATION0
-            // Share counts via files if distributed processing
+        // Share counts via files if distributed processing
 #ifndef DEBUG__FORCE_WRITE_COUNT
-            if ( ( *compareParams_ )["4-way distributed"].isSet() )
+        if ( ( *compareParams_ )["4-way distributed"].isSet() )
 #endif
-            {
-                if ( datasetAorB == 0 )
-                {
-                    stringstream ss;
-                    ss << "counts.A." << i;
-                    ofstream ofs( ss.str() );
-                    ofs << countsPerPileA[i] << endl;
-                }
-                else
-                {
-                    stringstream ss;
-                    ss << "counts.B." << i;
-                    ofstream ofs( ss.str() );
-                    ofs << countsPerPileB[i] << endl;
-                }
-            }
-#endif //ifndef DEBUG__SKIP_ITERATION0
+        {
+            stringstream ss;
+            ss << "counts." << ( isSetA ? 'A' : 'B' ) << "." << i;
+            ofstream ofs( ss.str() );
+            ofs << countsPerPile[i] << endl;
         }
+#endif //ifndef DEBUG__SKIP_ITERATION0
     }
 
     // Free bwt-B00, especially useful when keeping BWT in RAM
@@ -386,22 +284,54 @@ void CountWords::run( void )
         countsCumulativeB_.print();
     }
 
-    /*
-        #pragma omp parallel for
-        for ( int subsetNum = 0; subsetNum < 4; subsetNum++ )
-        {
-            string subsetValues[] = { "A", "C", "G", "T" };
-            string threadSubset = subsetValues[subsetNum];
-    */
-
-#ifndef DEBUG__SKIP_ITERATION0
+    // Intervals are partitioned into chunks, each with its own RangeStore, initially one per
+    // two-letter suffix. The intervals generated by a chunk stay in it, unless they come
+    // from a too large task: these then form a new chunk.
+    // Intervals are kept in RAM (up to the memory limit), except when they need to be shared with the other processes
     const int dontKnowIndex( whichPile[( int )dontKnowChar] );
+    const bool keepIntervalsInRam = !( *compareParams_ )["4-way distributed"].isSet();
+    LetterCountEachPile intervalSizes( countsPerPileA );
+    intervalSizes += countsPerPileB;
+    intervalSizes[dontKnowIndex].clear(); // don't process ranges with N in them
+    for ( int i( 1 ); i < alphabetSize; ++i )
+        intervalSizes[i].count_[dontKnowIndex] = 0;
 
+    // Chunks are split by size only, whatever the number of threads, so that the output
+    // doesn't depend on it. The processes of a distributed run don't know the sizes of
+    // each other's intervals, and keep the initial chunks.
+    const bool doSplitChunks = keepIntervalsInRam;
+    LetterNumber maxTaskLetterCount( 0 );
+    for ( int i( 1 ); i < alphabetSize; ++i )
+        for ( int j( 1 ); j < alphabetSize; ++j )
+            maxTaskLetterCount += intervalSizes[i].count_[j];
+    maxTaskLetterCount /= targetTaskCount;
+
+    // The chunks share the RAM files of these stores, so that a task can write to another chunk
+    RangeStoreExternal *baseRangeStoreA = newRangeStore( keepIntervalsInRam, "Intervals_setA" );
+    RangeStoreExternal *baseRangeStoreB = newRangeStore( keepIntervalsInRam, "Intervals_setB" );
+    vector<RangeStoreExternal *> rangeStoresA;
+    vector<RangeStoreExternal *> rangeStoresB;
+    vector<LetterCount> chunkSizes; // letters of each chunk's intervals, for each pile
+    int chunksCreated = 0;
+    auto addChunk = [&]( const int cycle )
+    {
+        ostringstream oss;
+        oss << "Intervals_chunk" << chunksCreated++;
+        rangeStoresA.push_back( baseRangeStoreA->clone() );
+        rangeStoresA.back()->fileStem_ = oss.str() + "_setA";
+        rangeStoresA.back()->setCycleNum( cycle );
+        rangeStoresB.push_back( baseRangeStoreB->clone() );
+        rangeStoresB.back()->fileStem_ = oss.str() + "_setB";
+        rangeStoresB.back()->setCycleNum( cycle );
+        chunkSizes.push_back( LetterCount() );
+        return ( int )rangeStoresA.size() - 1;
+    };
+
+#ifndef DEBUG__SKIP_ITERATION0
     // sort out first iter
     string currentWord = "xx";
     for ( int i( 1 ); i < alphabetSize; ++i )
     {
-        const int subsetThreadNum = pileToThread[i];
         if ( propagateSequence_ )
             currentWord[1] = alphabet[i];
         for ( int j( 1 ); j < alphabetSize; ++j )
@@ -428,16 +358,18 @@ void CountWords::run( void )
                                     }
             */
 
-            if ( ( i != dontKnowIndex ) && ( j != dontKnowIndex ) ) // don't process ranges with N in them
+            if ( intervalSizes[i].count_[j] != 0 )
             {
+                const int chunkNum = addChunk( 0 );
+                chunkSizes[chunkNum].count_[j] = intervalSizes[i].count_[j];
                 if ( countsPerPileA[i].count_[j] != 0 )
-                    rangeStoresA[subsetThreadNum]->addRange( Range(  currentWord,
+                    rangeStoresA[chunkNum]->addRange( Range(  currentWord,
                             ( countsCumulativeA_[i - 1].count_[j]
                               | ( matchFlag * ( LetterNumber )( countsPerPileB[i].count_[j] != 0 ) ) ),
                             countsPerPileA[i].count_[j], false )
                             , j, i, subset_, 1 );
                 if ( countsPerPileB[i].count_[j] != 0 )
-                    rangeStoresB[subsetThreadNum]->addRange( Range( currentWord,
+                    rangeStoresB[chunkNum]->addRange( Range( currentWord,
                             ( countsCumulativeB_[i - 1].count_[j]
                               | ( matchFlag * ( countsPerPileA[i].count_[j] != 0 ) ) ),
                             countsPerPileB[i].count_[j], false )
@@ -446,6 +378,7 @@ void CountWords::run( void )
         } // ~for j
     } // ~for i
 #endif //ifndef DEBUG__SKIP_ITERATION0
+    Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Intervals split into " << rangeStoresA.size() << " chunks" << endl;
 
     // Get ready for next cycle (flush current files and delete next cycle's output files)
     for ( auto rangeStore : rangeStoresA )
@@ -478,43 +411,60 @@ void CountWords::run( void )
         numSkippedA_ = 0;
         numSkippedB_ = 0;
 
-        /*
-                #pragma omp parallel for
-                for ( int subsetThreadNum = 0; subsetThreadNum < subsetThreadCount; ++subsetThreadNum )
-                {
-
-                    rangeStoresA[subsetThreadNum]->setCycleNum( cycle );
-                    rangeStoresB[subsetThreadNum]->setCycleNum( cycle );
-
-                    CountWords_parallelSubsetThread(
-                        subsetThreadNum
-                        , cycle
-                        , *( rangeStoresA[subsetThreadNum] )
-                        , *( rangeStoresB[subsetThreadNum] )
-                    );
-                }
-        */
         // Sequential initialisation before the big parallel loop
-        for ( int subsetThreadNum = 0; subsetThreadNum < subsetThreadCount; ++subsetThreadNum )
+        for ( auto rangeStore : rangeStoresA )
+            rangeStore->setCycleNum( cycle );
+        for ( auto rangeStore : rangeStoresB )
+            rangeStore->setCycleNum( cycle );
+
+        // One task per (chunk, pile) holding intervals. Too large tasks send the
+        // intervals they generate to a new chunk, splitting them by portion at the
+        // next cycle. Tasks are taken, largest first, by the threads as they become free.
+        vector<ChunkPileTask> tasks;
+        const int chunkCount = rangeStoresA.size();
+        for ( int chunkNum = 0; chunkNum < chunkCount; ++chunkNum )
         {
-            rangeStoresA[subsetThreadNum]->setCycleNum( cycle );
-            rangeStoresB[subsetThreadNum]->setCycleNum( cycle );
+            int nonEmptyPileCount = 0;
+            for ( int i( 1 ); i < alphabetSize; ++i )
+                if ( chunkSizes[chunkNum].count_[i] != 0 )
+                    ++nonEmptyPileCount;
+            for ( int i( 1 ); i < alphabetSize; ++i )
+            {
+                const LetterNumber letterCount = chunkSizes[chunkNum].count_[i];
+                if ( doSplitChunks && letterCount == 0 )
+                    continue;
+                ChunkPileTask task = { chunkNum, i, chunkNum, letterCount };
+                // (a chunk with a single pile would just move to the new one)
+                if ( doSplitChunks && letterCount > maxTaskLetterCount && nonEmptyPileCount > 1 )
+                    task.outputChunkNum = addChunk( cycle );
+                tasks.push_back( task );
+            }
         }
+        stable_sort( tasks.begin(), tasks.end(), isLargerTask );
+        Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Cycle " << cycle << ": " << tasks.size() << " tasks over " << rangeStoresA.size() << " chunks" << endl;
 
-        #pragma omp parallel for
-        for ( int threadNum = 0; threadNum < subsetThreadCount * alphabetSize; ++threadNum )
+        vector<LetterCount> taskOutputSizes( tasks.size() );
+        #pragma omp parallel for schedule(dynamic)
+        for ( int taskNum = 0; taskNum < ( int )tasks.size(); ++taskNum )
         {
-            const int subsetThreadNum = threadNum / alphabetSize; // for ( int subsetThreadNum = 0; subsetThreadNum < subsetThreadCount; ++subsetThreadNum )
-            //const int i = threadNum % alphabetSize; // for ( int i = 0; i < alphabetSize; ++i )
-
-            CountWords_parallelSubsetThread(
-                threadNum
+            const ChunkPileTask &task = tasks[taskNum];
+            CountWords_chunkPileTask(
+                task.chunkNum
+                , task.pileNum
                 , cycle
-                , *( rangeStoresA[subsetThreadNum] )
-                , *( rangeStoresB[subsetThreadNum] )
+                , *( rangeStoresA[task.chunkNum] )
+                , *( rangeStoresB[task.chunkNum] )
+                , *( rangeStoresA[task.outputChunkNum] )
+                , *( rangeStoresB[task.outputChunkNum] )
+                , taskOutputSizes[taskNum]
             );
         }
 
+        // Sizes of the chunks at the next cycle
+        for ( auto &sizes : chunkSizes )
+            sizes.clear();
+        for ( unsigned int taskNum = 0; taskNum < tasks.size(); ++taskNum )
+            chunkSizes[tasks[taskNum].outputChunkNum] += taskOutputSizes[taskNum];
 
         cerr << "Finished cycle " << cycle << ": ranges=" << numRanges_
              << " singletons=" << numSingletonRanges_
@@ -610,10 +560,36 @@ void CountWords::run( void )
         if ( doPauseBetweenCycles_ )
             pauseBetweenCycles();
 
+        // Input files are only deleted now, as tasks look up the ones of other piles in isRangeKnown
         for ( auto rangeStore : rangeStoresA )
-            rangeStore->clear( false );
+            rangeStore->clear();
         for ( auto rangeStore : rangeStoresB )
-            rangeStore->clear( false );
+            rangeStore->clear();
+
+        // Forget the chunks left without intervals
+        if ( doSplitChunks )
+        {
+            int chunksKept = 0;
+            for ( unsigned int chunkNum = 0; chunkNum < rangeStoresA.size(); ++chunkNum )
+            {
+                LetterNumber chunkSize = 0;
+                for ( int i( 0 ); i < alphabetSize; ++i )
+                    chunkSize += chunkSizes[chunkNum].count_[i];
+                if ( chunkSize == 0 )
+                {
+                    delete rangeStoresA[chunkNum];
+                    delete rangeStoresB[chunkNum];
+                    continue;
+                }
+                rangeStoresA[chunksKept] = rangeStoresA[chunkNum];
+                rangeStoresB[chunksKept] = rangeStoresB[chunkNum];
+                chunkSizes[chunksKept] = chunkSizes[chunkNum];
+                ++chunksKept;
+            }
+            rangeStoresA.resize( chunksKept );
+            rangeStoresB.resize( chunksKept );
+            chunkSizes.resize( chunksKept );
+        }
 
         if ( numRanges_ == 0 ) break;
     } // ~for c
@@ -625,6 +601,8 @@ void CountWords::run( void )
         delete rangeStore;
     rangeStoresA.clear();
     rangeStoresB.clear();
+    delete baseRangeStoreA;
+    delete baseRangeStoreB;
     for ( auto & bwtReader : inBwtA_ )
     {
         delete bwtReader;
@@ -642,31 +620,18 @@ void CountWords::run( void )
 } // countWords::run()
 
 
-void CountWords::CountWords_parallelSubsetThread(
-    const int threadNum
+void CountWords::CountWords_chunkPileTask(
+    const int chunkNum
+    , const int i
     , const int cycle
     , RangeStoreExternal &rangeStoreA
     , RangeStoreExternal &rangeStoreB
+    , const RangeStoreExternal &outputRangeStoreA
+    , const RangeStoreExternal &outputRangeStoreB
+    , LetterCount &outputSizes
 )
 {
     string currentWord( cycle + 2, 'x' );
-    int subsetThreadNum = threadNum / alphabetSize; // for ( int subsetThreadNum = 0; subsetThreadNum < subsetThreadCount; ++subsetThreadNum )
-    int i = threadNum % alphabetSize; // for ( int i = 0; i < alphabetSize; ++i )
-    /*
-        {
-            int pid = -1;
-            int numThreads = -1;
-            int processor = -1;
-            readProcSelfStat( pid, numThreads, processor );
-            #pragma omp critical (IO)
-            cerr << "CountWords_parallelSubsetThread header cycle=" << cycle << " subsetThreadNum=" << subsetThreadNum << " pid=" << pid << " numThreads=" << numThreads << " processor=" << processor << endl;
-            usleep( 100 );
-        }
-
-        omp_set_num_threads( alphabetSize );
-        #pragma omp parallel for
-        for ( int i = 0; i < alphabetSize; ++i )
-    */
     {
         Logger_if( LOG_SHOW_IF_VERY_VERBOSE )
         {
@@ -675,10 +640,9 @@ void CountWords::CountWords_parallelSubsetThread(
             int processor = -1;
             readProcSelfStat( pid, numThreads, processor );
             #pragma omp critical (IO)
-            Logger::out() << "CountWords_parallelSubsetThread cycle=" << cycle << " subsetThreadNum=" << subsetThreadNum << " i=" << i << " pid=" << pid << " numThreads=" << numThreads << " processor=" << processor << endl;
+            Logger::out() << "CountWords_chunkPileTask cycle=" << cycle << " chunkNum=" << chunkNum << " i=" << i << " pid=" << pid << " numThreads=" << numThreads << " processor=" << processor << endl;
         }
 
-        if ( i == 0 ) return;
         if ( !isDistributedProcessResponsibleForPile( i ) )
             return;
 
@@ -690,8 +654,10 @@ void CountWords::CountWords_parallelSubsetThread(
         LetterCount countsSoFarA, countsSoFarB;
         LetterNumber currentPosA, currentPosB;
 
-        RangeStoreExternal parallel_rA( rangeStoreA );
-        RangeStoreExternal parallel_rB( rangeStoreB );
+        RangeStoreExternal *parallel_rA = rangeStoreA.clone();
+        RangeStoreExternal *parallel_rB = rangeStoreB.clone();
+        parallel_rA->setOutputFileStem( outputRangeStoreA );
+        parallel_rB->setOutputFileStem( outputRangeStoreB );
 
         inBwtA->rewindFile();
         inBwtB->rewindFile();
@@ -705,12 +671,12 @@ void CountWords::CountWords_parallelSubsetThread(
         for ( int j( 1 ); j < alphabetSize; ++j )
         {
             Logger_if( LOG_FOR_DEBUGGING ) Logger::out() << "positions - A: " << currentPosA << " B: " << currentPosB << endl;
-            parallel_rA.setPortion( i, j );
-            parallel_rB.setPortion( i, j );
+            parallel_rA->setPortion( i, j );
+            parallel_rB->setPortion( i, j );
 
             TwoBwtBackTracker backTracker( inBwtA, inBwtB
                                            , currentPosA, currentPosB
-                                           , parallel_rA, parallel_rB, countsSoFarA, countsSoFarB
+                                           , *parallel_rA, *parallel_rB, countsSoFarA, countsSoFarB
                                            , minOcc_, numCycles_, subset_, cycle + 1
                                            , doesPropagateBkptToSeqNumInSetA_
                                            , doesPropagateBkptToSeqNumInSetB_
@@ -728,7 +694,7 @@ void CountWords::CountWords_parallelSubsetThread(
                 case BeetlCompareParameters::MODE_METAGENOMICS:
                 {
                     IntervalHandlerMetagenome intervalHandler( minOcc_, setC_, mmappedCFiles_, fileNumToTaxIds_, testDB_, minWordLen_, numCycles_ );
-                    intervalHandler.createOutputFile( subsetThreadNum, i, j, cycle + 1, outputDirectory_ );
+                    intervalHandler.createOutputFile( chunkNum, i, j, cycle + 1, outputDirectory_ );
                     backTracker.process( i, currentWord, intervalHandler );
                 }
                 break;
@@ -741,7 +707,7 @@ void CountWords::CountWords_parallelSubsetThread(
                 case BeetlCompareParameters::MODE_TUMOUR_NORMAL:
                 {
                     IntervalHandlerTumourNormal intervalHandler( minOcc_, fsizeRatio_ );
-                    intervalHandler.createOutputFile( subsetThreadNum, i, j, cycle + 1, outputDirectory_ );
+                    intervalHandler.createOutputFile( chunkNum, i, j, cycle + 1, outputDirectory_ );
                     backTracker.process( i, currentWord, intervalHandler );
                 }
                 break;
@@ -762,12 +728,16 @@ void CountWords::CountWords_parallelSubsetThread(
             #pragma omp atomic
             numSkippedB_ += backTracker.numSkippedB_;
 
-            parallel_rA.deleteInputPortion( i, j );
-            parallel_rB.deleteInputPortion( i, j );
+            // The input portion is only deleted at the end of the cycle,
+            // as the tasks of other piles look it up in isRangeKnown
         } // ~for j
         //cerr << "Done i " << i <<endl;
-        parallel_rA.clear( false );
-        parallel_rB.clear( false );
+        parallel_rA->clear( false );
+        parallel_rB->clear( false );
+        outputSizes = parallel_rA->outputLetterCounts_;
+        outputSizes += parallel_rB->outputLetterCounts_;
+        delete parallel_rA;
+        delete parallel_rB;
 
 
         delete inBwtA;
@@ -776,6 +746,15 @@ void CountWords::CountWords_parallelSubsetThread(
 }
 
 
+RangeStoreExternal *CountWords::newRangeStore( const bool inRam, const string &fileStem ) const
+{
+    if ( inRam )
+        return new RangeStoreRam( propagateSequence_, fileStem );
+    else
+        return new RangeStoreExternal( propagateSequence_, fileStem );
+}
+
+
 /*
   @taxIdNames , file containing the taxonomic information about the database
   loads the taxonomic information so it is known which file number corresponds to which taxa
@@ -48,12 +48,19 @@ public:
 private:
     void initialiseMetagomeMode();
     void releaseMetagomeMode();
-    void CountWords_parallelSubsetThread(
-        const int subsetThreadNum
+    // Backtracking of the intervals of one chunk in one pile, for one cycle.
+    // The generated intervals go to the output stores, and their sizes to outputSizes.
+    void CountWords_chunkPileTask(
+        const int chunkNum
+        , const int pileNum
         , const int cycle
         , RangeStoreExternal &rangeStoreA
         , RangeStoreExternal &rangeStoreB
+        , const RangeStoreExternal &outputRangeStoreA
+        , const RangeStoreExternal &outputRangeStoreB
+        , LetterCount &outputSizes
     );
+    RangeStoreExternal *newRangeStore( const bool inRam, const string &fileStem ) const;
 
     bool inputACompressed_;
     bool inputBCompressed_;
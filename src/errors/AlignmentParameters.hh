@@ -91,9 +91,11 @@ public:
         addEntry( PARAMETER_SW_MISMATCH_PENALTY, "mismatch penalty", "--mismatch-penalty", "-m", "Mismatch penalty for Smith-Waterman alignment", "", TYPE_INT );
         addEntry( PARAMETER_SW_DELETION_PENALTY, "deletion penalty", "--deletion-penalty", "-d", "Deletion penalty for Smith-Waterman alignment", "", TYPE_INT );
         addEntry( PARAMETER_SW_INSERTION_PENALTY, "insertion penalty", "--insertion-penalty" , "-n", "Insertion penalty for Smith-Waterman alignment", "", TYPE_INT );
+        addEntry( -1, "band width", "--band-width", "", "Only align within this many diagonals of the read end in Smith-Waterman alignment (default: full matrix)", "", TYPE_INT );
         addEntry( PARAMETER_CORRECTION_QUALITY, "correction quality", "--correction-quality" , "-q", "Correction string letter quality character", "", TYPE_STRING );
         addEntry( PARAMETER_MIN_WITNESS_LENGTH, "min witness length", "--min-witness-length" , "", "Minimum length of witness to use correction", "", TYPE_INT );
         addEntry( PARAMETER_TRIM_CORRECTED_READS, "trim corrected reads", "--trim" , "-t", "Trim corrected reads and quality strings to length of originals", "", TYPE_SWITCH );
+        addEntry( -1, "threads", "--threads", "-j", "Number of threads (default: all available cores)", "", TYPE_INT );
         addDefaultVerbosityAndHelpEntries();
     }
 };
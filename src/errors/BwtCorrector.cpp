@@ -14,6 +14,7 @@
 
 #include "BCRext.hh"
 #include "BCRexternalBWT.hh"
+#include "CorrectionsFile.hh"
 #include "Timer.hh"
 #include "config.h"
 #include "parameters/BwtParameters.hh"
@@ -25,9 +26,63 @@
 #include <sstream>
 #include <algorithm>
 
+#ifdef _OPENMP
+# include <omp.h>
+#endif //ifdef _OPENMP
+
 using namespace std;
 using namespace BeetlBwtParameters;
 
+
+namespace
+{
+
+// Output order of a correction, as given by ErrorInfo::SortByRead
+struct CorrectionKey
+{
+    int seqNum;
+    int positionInRead;
+    int correctorStart;
+    ErrorStore::ErrorId id;
+};
+
+class CorrectionBuilder
+{
+public:
+    CorrectionBuilder( const ErrorStore &errors, const int numberOfReads, const int readLength )
+        : errors_( errors )
+        , numberOfReads_( numberOfReads )
+        , readLength_( readLength )
+    {}
+
+    ErrorInfo operator()( const ErrorStore::ErrorId id ) const
+    {
+        ErrorInfo correction = errors_.errorInfo( id );
+        ErrorInfo::ConvertRCCorrectionToOriginal( correction, numberOfReads_, readLength_ );
+        return correction;
+    }
+
+    // Only builds the correctors to break ties
+    bool operator()( const CorrectionKey &a, const CorrectionKey &b ) const
+    {
+        if ( a.seqNum != b.seqNum )
+            return a.seqNum < b.seqNum;
+        if ( a.positionInRead != b.positionInRead )
+            return a.positionInRead < b.positionInRead;
+        if ( a.correctorStart != b.correctorStart )
+            return a.correctorStart < b.correctorStart;
+        return ( *this )( a.id ).corrector < ( *this )( b.id ).corrector;
+    }
+
+private:
+    const ErrorStore &errors_;
+    const int numberOfReads_;
+    const int readLength_;
+};
+
+} // anonymous namespace
+
+
 int BwtCorrector::getMinSupport( int cycle )
 {
     //Decide on minimum support to use based on cycle.
@@ -60,14 +115,21 @@ ErrorStore BwtCorrector::findErrors()
 
     LetterCountEachPile countsPerPile, countsCumulative;
 
-    RangeStoreExternal r;
-
     int numCycles( readLength_ );
     //    int minOcc( numberOfReads_ );
 
+#ifdef _OPENMP
+    if ( ( *correctorParams_ )["threads"].isSet() )
+        omp_set_num_threads( ( *correctorParams_ )["threads"] );
+    const int threadCount = omp_get_max_threads();
+#else
+    const int threadCount = 1;
+#endif
+
     inBwt = instantiateBwtPileReaders( indexPrefix_, correctorParams_->getStringValue( "use shm" ) );
 
-    for ( int i( 0 ); i < alphabetSize; i++ )
+    #pragma omp parallel for schedule(dynamic)
+    for ( int i = 0; i < alphabetSize; i++ )
     {
         inBwt[i]->  readAndCount( countsPerPile[i] );
     }
@@ -77,6 +139,18 @@ ErrorStore BwtCorrector::findErrors()
 
     countsCumulative.print();
 
+    // Intervals are partitioned into subsets, each (subset, pile) being backtracked by a separate task
+    vector<int> subsetOfInterval;
+    const int subsetCount = splitIntervalsIntoSubsets( countsPerPile, intervalSubsetsPerThread * threadCount, subsetOfInterval );
+    vector<RangeStoreRam *> rangeStores;
+    for ( int subsetNum = 0; subsetNum < subsetCount; ++subsetNum )
+    {
+        ostringstream oss;
+        oss << "Intervals_subset" << subsetNum;
+        rangeStores.push_back( new RangeStoreRam( propagateSequence, oss.str() ) );
+    }
+    Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Using " << threadCount << " threads and " << subsetCount << " interval subsets" << endl;
+
     string currentWord = "xx";
     for ( int i( 1 ); i < alphabetSize; ++i )
     {
@@ -88,7 +162,7 @@ ErrorStore BwtCorrector::findErrors()
                 currentWord[0] = alphabet[j];
 
             if ( countsPerPile[i].count_[j] != 0 )
-                r.addRange(
+                rangeStores[subsetOfInterval[i * alphabetSize + j]]->addRange(
                     ErrorCorrectionRange(
                         currentWord,
                         countsCumulative[i - 1].count_[j],
@@ -103,11 +177,10 @@ ErrorStore BwtCorrector::findErrors()
         } // ~for j
     } // ~for i
 
-    LetterCount countsSoFar;
-    LetterNumber currentPos;
     LetterNumber numRanges, numSingletonRanges;
 
-    r.clear();
+    for ( auto rangeStore : rangeStores )
+        rangeStore->clear();
     for ( int c( 0 ); c < numCycles; ++c )
     {
         int minimumSupport = getMinSupport( c );
@@ -122,34 +195,35 @@ ErrorStore BwtCorrector::findErrors()
 
         numRanges = 0;
         numSingletonRanges = 0;
-        r.setCycleNum( c + 1 );
+        for ( auto rangeStore : rangeStores )
+            rangeStore->setCycleNum( c + 1 );
+
+        // Each task buffers its changes to the error store, which stays read-only until the end of the cycle
+        const int taskCount = subsetCount * ( alphabetSize - 1 );
+        vector<ErrorStoreUpdates> errorStoreUpdates( taskCount );
 
-        for ( int i( 1 ); i < alphabetSize; ++i )
+        #pragma omp parallel for schedule(dynamic)
+        for ( int task = 0; task < taskCount; ++task )
         {
+            const int subsetNum = task / ( alphabetSize - 1 );
+            const int i = 1 + task % ( alphabetSize - 1 );
             string thisWord( c + 3, 'x' );
 
-            inBwt[i]->rewindFile();
-            currentPos = 0;
-            countsSoFar.clear();
+            BwtReaderBase *parallel_inBwt = inBwt[i]->clone();
+            RangeStoreExternal *parallel_r = rangeStores[subsetNum]->clone();
+            parallel_inBwt->rewindFile();
+            LetterNumber currentPos = 0;
+            LetterCount countsSoFar;
             countsSoFar += countsCumulative[i - 1];
-#ifdef PROB_NOT_NEEDED
-            BwtReaderRunLengthIndex *pRun;
-
-            pRun = dynamic_cast<BwtReaderRunLengthIndex *>( inBwt[i] );
-            if ( pRun != NULL )
-                pRun->initIndex( countsSoFar );
-            else
-                inBwtA[i]->rewindFile();
-#endif
 
             for ( int j( 1 ); j < alphabetSize; ++j )
             {
-                r.setPortion( i, j );
+                parallel_r->setPortion( i, j );
 
                 OneBwtBackTracker backTracker(
-                    inBwt[i],
+                    parallel_inBwt,
                     currentPos,
-                    r,
+                    *parallel_r,
                     countsSoFar,
                     //                    numCycles,
                     subset_,
@@ -160,26 +234,36 @@ ErrorStore BwtCorrector::findErrors()
                     endPosFile_
                 );
 
-                BwtCorrectorIntervalHandler intervalHandler( result, minWitnessLength_, minimumSupport, c + 2 );
+                BwtCorrectorIntervalHandler intervalHandler( result, errorStoreUpdates[task], minWitnessLength_, minimumSupport, c + 2 );
                 ErrorCorrectionRange rangeObject;
                 backTracker.process( i, thisWord, intervalHandler, rangeObject );
 
+                #pragma omp atomic
                 numRanges += backTracker.numRanges_;
+                #pragma omp atomic
                 numSingletonRanges += backTracker.numSingletonRanges_;
 
+                parallel_r->deleteInputPortion( i, j );
             } // ~for j
-            //cerr << "Done i " << i <<endl;
-        }     // ~for i
-        r.clear();
+            parallel_r->clear( false );
+            delete parallel_r;
+            delete parallel_inBwt;
+        } // ~for task
+
+        result.apply( errorStoreUpdates );
+        for ( auto rangeStore : rangeStores )
+            rangeStore->clear();
         //    return 0; // %%%
         Logger_if( LOG_SHOW_IF_VERBOSE )
         {
-            Logger::out() << "Finished cycle " << c << ": ranges=" << numRanges << " singletons=" << numSingletonRanges << endl;
+            Logger::out() << "Finished cycle " << c << ": ranges=" << numRanges << " singletons=" << numSingletonRanges << " errors=" << result.size() << endl;
         }
 
         if ( numRanges == 0 ) break;
 
     } // ~for c
+    for ( auto rangeStore : rangeStores )
+        delete rangeStore;
     for ( int i = 0; i < alphabetSize; i++ )
         delete inBwt[i];
 
@@ -200,38 +284,47 @@ void BwtCorrector::run()
 {
     //run the backtracking algorithm and create the error objects...
     ErrorStore errors = findErrors();
-    vector<ErrorInfo> errorLocations;
 
     int numErrors = errors.size();
     cout << "There were " << numErrors << " errors discovered..." << endl;
 
-    //we have completed the error info, we do not need the bwt-positions... so just load them into a vector...
-    for ( map<LetterNumber, ErrorInfo>::iterator it = errors.begin(); it != errors.end(); ++it )
-        errorLocations.push_back(
-            ErrorInfo(
-                it->second.seqNum,
-                it->second.readEnd,
-                it->second.lastCycle,
-                it->second.firstCycle,
-                it->second.corrector
-            )
-        );
+    //we have completed the error info, we do not need the bwt-positions...
+    //the errors are then turned into ErrorInfo objects one at a time, so that their corrector strings never all exist at once
+    errors.finishDetection();
 
-    //the ErrorInfo objects have their seqNum fields set to the position of the target read as if it was
+    //the errors have their seqNum fields set to the position of the target read as if it was
     //sorted alphabetically, so map it back to the original ordering (as it appeared in the FAST* file )
     //using the -end-pos file and the SetReadNumbersToOriginal method...
-    string endPosFileName = indexPrefix_ + "-end-pos";
-    std::sort( errorLocations.begin(), errorLocations.end(), ErrorInfo::SortByRead );
-    ErrorInfo::SetReadNumbersToOriginal( ( char * )endPosFileName.c_str(), errorLocations );
+    {
+        vector< pair<int, ErrorStore::ErrorId> > bySortedRead( numErrors );
+        for ( ErrorStore::ErrorId id = 0; id < bySortedRead.size(); ++id )
+            bySortedRead[id] = make_pair( errors.seqNum( id ), id );
+        std::sort( bySortedRead.begin(), bySortedRead.end() );
+        vector<int> seqNums( numErrors );
+        for ( unsigned int i = 0; i < bySortedRead.size(); ++i )
+            seqNums[i] = bySortedRead[i].first;
+        string endPosFileName = indexPrefix_ + "-end-pos";
+        ErrorInfo::SetReadNumbersToOriginal( endPosFileName.c_str(), seqNums );
+        for ( unsigned int i = 0; i < bySortedRead.size(); ++i )
+            errors.setSeqNum( bySortedRead[i].second, seqNums[i] );
+    }
 
-    //the ErrorInfo objects still have read numbers that refer to any of the original reads or their reverse complements
+    //the errors still have read numbers that refer to any of the original reads or their reverse complements
     //however we are only interested in the original reads, so we map errors discovered in the reverse complements back
-    //to the originals with ConvertRCCorrectionsToOriginal...
-    ErrorInfo::ConvertRCCorrectionsToOriginal( errorLocations, numberOfReads_, readLength_ );
-
-    std::sort( errorLocations.begin(), errorLocations.end(), ErrorInfo::SortByRead );
+    //to the originals with ConvertRCCorrectionToOriginal...
+    const CorrectionBuilder buildCorrection( errors, numberOfReads_, readLength_ );
+    vector<CorrectionKey> keys( numErrors );
+    for ( ErrorStore::ErrorId id = 0; id < keys.size(); ++id )
+    {
+        const ErrorInfo correction = buildCorrection( id );
+        const CorrectionKey key = { correction.seqNum, correction.positionInRead, correction.correctorStart, id };
+        keys[id] = key;
+    }
+    std::sort( keys.begin(), keys.end(), buildCorrection );
 
-    ErrorInfo::CorrectionsToCsv( outputFile_, errorLocations );
+    CorrectionsWriter correctionsWriter( outputFile_, ( CorrectionsFormat )correctorParams_->getValue( "corrections format" ) );
+    for ( unsigned int i = 0; i < keys.size(); ++i )
+        correctionsWriter.write( buildCorrection( keys[i].id ) );
 
     cout << "Done!" << endl;
 }
@@ -18,6 +18,7 @@
 #include "BwtCorrectorParameters.hh"
 #include "Config.hh"
 #include "ErrorInfo.hh"
+#include "ErrorStore.hh"
 #include "HiTECStats.hh"
 #include "LetterCount.hh"
 #include "OneBwtBackTracker.hh"
@@ -95,11 +95,10 @@ void BwtCorrectorIntervalHandler::foundInAOnly(
         {
             if ( bwtSubstring[relPos] == alphabet[0] )
             {
-                if ( errorStore_[thisRangeA.data_.errorsForBwtPosns[relPos]].seqNum == -1 )
-                {
-                    errorStore_[thisRangeA.data_.errorsForBwtPosns[relPos]].seqNum = countsSoFarA.count_[0] + dollarCount;
-                    errorStore_[thisRangeA.data_.errorsForBwtPosns[relPos]].readEnd = intervalWordLength_;
-                }
+                const ErrorStore::ErrorId error = errorStore_.find( thisRangeA.data_.errorsForBwtPosns[relPos] );
+                assert( error != ErrorStore::notFound );
+                if ( errorStore_.seqNum( error ) == -1 )
+                    errorStoreUpdates_.setReadEnd( error, countsSoFarA.count_[0] + dollarCount, intervalWordLength_ );
                 dollarCount++;
             }
 
@@ -133,13 +132,10 @@ void BwtCorrectorIntervalHandler::foundInAOnly(
                 for ( int i = 0; i < alphabetSize; i++ )
                     errBwtPos += countsSoFarA.count_[i];
 
-                if ( errorStore_.find( errBwtPos ) == errorStore_.end() )
+                const ErrorStore::ErrorId error = errorStore_.find( errBwtPos );
+                if ( error == ErrorStore::notFound )
                 {
-                    ErrorInfo newError;
-                    newError.firstCycle = intervalWordLength_;
-                    newError.lastCycle = intervalWordLength_;
-                    newError.corrector += alphabet[correct];
-                    errorStore_[errBwtPos] = newError;
+                    errorStoreUpdates_.addError( errBwtPos, intervalWordLength_, alphabet[correct] );
 
                     //finding putative error for the first time, so flag next generation of intervals...
 
@@ -157,7 +153,7 @@ void BwtCorrectorIntervalHandler::foundInAOnly(
                 else
                 {
                     //re-finding, so don't flag any intervals... just update 'last cycle we saw this error'
-                    errorStore_[errBwtPos].lastCycle = intervalWordLength_;
+                    errorStoreUpdates_.setLastCycle( error, intervalWordLength_ );
                 }
             }
     }
@@ -185,7 +181,9 @@ void BwtCorrectorIntervalHandler::foundInAOnly(
             //and add it to BWT positions with which the extension by the 'dominator' is tagged...
             for ( uint errNo = 0; errNo < thisRangeA.data_.correctionForBwtPosns.size(); ++errNo )
             {
-                errorStore_[thisRangeA.data_.correctionForBwtPosns[errNo]].corrector += alphabet[dominator];
+                const ErrorStore::ErrorId error = errorStore_.find( thisRangeA.data_.correctionForBwtPosns[errNo] );
+                assert( error != ErrorStore::notFound );
+                errorStoreUpdates_.extendCorrector( error, alphabet[dominator] );
                 thisRangeA.getDataForSubInterval( dominator ).correctionForBwtPosns.push_back( thisRangeA.data_.correctionForBwtPosns[errNo] );
             }
         }
@@ -14,8 +14,8 @@
 #define INCLUDED_BWTCORRECTORINTERVALHANDLER_HH
 
 #include "Config.hh"
-#include "ErrorInfo.hh"
 #include "ErrorCorrectionRange.hh"
+#include "ErrorStore.hh"
 #include "IntervalHandlerBase.hh"
 #include "RangeStore.hh"
 
@@ -28,12 +28,14 @@ using namespace std;
 struct BwtCorrectorIntervalHandler : public IntervalHandlerBase
 {
     BwtCorrectorIntervalHandler(
-        ErrorStore &inErrorStore,
+        const ErrorStore &inErrorStore,
+        ErrorStoreUpdates &inErrorStoreUpdates,
         int minWitnessLength,
         int minOccurrences,
         int cycle
     ):
         errorStore_( inErrorStore ),
+        errorStoreUpdates_( inErrorStoreUpdates ),
         minWitnessLength_( minWitnessLength ),
         minOccurrences_( minOccurrences )
     {
@@ -95,15 +97,16 @@ struct BwtCorrectorIntervalHandler : public IntervalHandlerBase
         const int subIntervalNum
     )
     {
-        static ErrorCorrectionRange r;
-        r = ErrorCorrectionRange( word, pos, num, isBkptExtension, parentRange, subIntervalNum );
-        return r;
+        subIntervalRange_ = ErrorCorrectionRange( word, pos, num, isBkptExtension, parentRange, subIntervalNum );
+        return subIntervalRange_;
     }
 
-    //errorStore_ - a reference to the ErrorStore owned by the BwtCorrector algorithm, so that in processing this interval, we can
-    //add/update error objects for BWT positions (bwtposn's) should we come across new/existing bwtposn's which are likely errors
-    //in this interval
-    ErrorStore &errorStore_;
+    //errorStore_ - a reference to the ErrorStore owned by the BwtCorrector algorithm, holding the errors found in the previous cycles
+    //errorStoreUpdates_ - where we add/update error objects for BWT positions (bwtposn's) should we come across new/existing bwtposn's
+    //which are likely errors in this interval. They are applied to the ErrorStore at the end of the cycle.
+    const ErrorStore &errorStore_;
+    ErrorStoreUpdates &errorStoreUpdates_;
+    ErrorCorrectionRange subIntervalRange_;
 
     //the smallest length of substring Q for which the Q-interval should be inspected for errors.
     int minWitnessLength_;
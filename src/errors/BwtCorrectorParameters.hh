@@ -98,6 +98,16 @@ static const string intermediateStorageMediumLabels[] =
 };
 
 
+// options: corrections file format
+
+static const string correctionsFormatLabels[] =
+{
+    "binary",
+    "csv",
+    "" // end marker
+};
+
+
 // Option container
 
 enum BwtCorrectorParameterIds
@@ -135,7 +145,10 @@ public:
         addEntry( PARAMETER_DONT_RUN, "don't run", "--dont-run", "-X", "Don't run the algorithm - just show execution plan", "", TYPE_SWITCH );
         addEntry( -1, "subset", "--subset", "", "Restrict computation to this suffix - Used for distributed computing", "", TYPE_STRING );
         addEntry( PARAMETER_CORRECTIONS_FILE, "corrections output filename", "--corrections-file", "-o", "File to which corrections are written", "", TYPE_STRING | REQUIRED );
+        addEntry( -1, "corrections format", "--corrections-format", "", "Format of the corrections file (csv is human-readable, binary is smaller; both are read by beetl-correct-apply-corrections)", "csv", TYPE_CHOICE, correctionsFormatLabels );
         addEntry( PARAMETER_MIN_SUPPORT, "min support", "--minimum-support", "", "Fixed minimum occurrences for a base in an interval to be 'correct'", "", TYPE_INT );
+        addEntry( -1, "threads", "--threads", "-j", "Number of threads (default: all available cores)", "", TYPE_INT );
+        addEntry( -1, "memory limit MB", "--memory-limit", "-M", "RAM constraint in MB (default: smallest of ulimit -v and /proc/meminfo)", "", TYPE_INT | AUTOMATED );
         addDefaultVerbosityAndHelpEntries();
     }
 
@@ -12,25 +12,40 @@
 
 #include "CorrectionAligner.hh"
 
+#include <cassert>
+#include <cstdlib>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif //ifdef __SSE2__
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif //ifdef _OPENMP
+
 using namespace std;
 
-template <class T>
-T **makeMatrix( int rows, int cols )
+namespace
 {
-    T **result = new T*[rows];
-    for ( int row = 0; row < rows; row++ )
-        result[row] = new T[cols];
-    return result;
+
+// Reads are corrected in parallel by batches, and written in their original order
+const int correctionBatchSize = 4096;
+
+// Anti-diagonal cells processed per SSE2 vector of 16-bit scores
+const int simdCellCount = 8;
+
+inline int floorHalf( const int x )
+{
+    return ( x >= 0 ) ? x / 2 : -( ( -x + 1 ) / 2 );
 }
 
-template <class T>
-void zapMatrix( T **matrix, int rows )
+inline int ceilHalf( const int x )
 {
-    for ( int row = 0; row < rows; row++ )
-        delete[] matrix[row];
-    delete[] matrix;
+    return -floorHalf( -x );
 }
 
+} // anonymous namespace
+
 struct CorrectionInterval
 {
     CorrectionInterval( int inStart, int inLengthOnRead, int inCorrectionLength ): correctionLength( inCorrectionLength ), lengthOnRead( inLengthOnRead ), start( inStart ) {}
@@ -58,7 +73,7 @@ bool CorrectionAligner::SortByLastCycle( ErrorInfo *a, ErrorInfo *b )
 
 void CorrectionAligner::ApplyCorrections(
     SeqReaderFile *readsFile,
-    vector<ErrorInfo> &corrections,
+    CorrectionsReader &corrections,
     const string &outFile,
     bool correctionsOnly,
     ReadsFormat fileType
@@ -71,7 +86,7 @@ void CorrectionAligner::ApplyCorrections(
 
 void CorrectionAligner::ApplyCorrections(
     SeqReaderFile *readsFile,
-    vector<ErrorInfo> &corrections,
+    CorrectionsReader &corrections,
     ostream &correctedReadsOut,
     bool correctionsOnly,
     ReadsFormat fileType
@@ -80,43 +95,79 @@ void CorrectionAligner::ApplyCorrections(
 
     uint readLength = readsFile->length();
     readsFile->rewindFile();
-    uint currentCorrection = 0;
     int currentRead = 0;
 
-    while ( readsFile->readNext(), !readsFile->allRead() )
-    {
-        string name = string( readsFile->thisName() );
-        string readStr = string( readsFile->thisSeq() ).substr( 0, readLength );
+    // Next correction to apply, read ahead of the reads it belongs to
+    ErrorInfo nextCorrection;
+    bool hasNextCorrection = corrections.read( nextCorrection );
 
-        string qStr = string( readsFile->thisQual() );
-        if ( qStr.size() > readLength )
-            qStr = qStr.substr( 0, readLength );
+    vector<string> names( correctionBatchSize ), readStrs( correctionBatchSize ), qStrs( correctionBatchSize ), records( correctionBatchSize );
+    vector< vector<ErrorInfo> > correctionsOfReads( correctionBatchSize );
+    vector< vector<ErrorInfo *> > correctionsForReads( correctionBatchSize );
+    int batchSize = correctionBatchSize;
 
-        if ( currentCorrection < corrections.size() && corrections[currentCorrection].seqNum == currentRead )
+    while ( batchSize == correctionBatchSize )
+    {
+        // Reading is sequential...
+        batchSize = 0;
+        while ( batchSize < correctionBatchSize && ( readsFile->readNext(), !readsFile->allRead() ) )
         {
-            vector<ErrorInfo *> correctionsForCurrentRead;
-            while ( currentCorrection < corrections.size() && corrections[currentCorrection].seqNum == currentRead )
-            {
-                correctionsForCurrentRead.push_back( &corrections[currentCorrection] );
-                ++currentCorrection;
-            }
+            names[batchSize] = readsFile->thisName();
+            readStrs[batchSize] = string( readsFile->thisSeq() ).substr( 0, readLength );
 
-            string correctedRead, correctedQstr;
+            string &qStr = qStrs[batchSize];
+            qStr = readsFile->thisQual();
+            if ( qStr.size() > readLength )
+                qStr.resize( readLength );
 
-            CorrectRead( correctionsForCurrentRead, readStr, qStr, correctedRead, correctedQstr );
-            if ( fileType == READS_FORMAT_FASTQ )
-                correctedReadsOut << MakeFastqRecord( currentRead, name, correctedRead, correctedQstr );
-            else if ( fileType == READS_FORMAT_FASTA )
-                correctedReadsOut << MakeFastaRecord( currentRead, name, correctedRead, correctedQstr );
+            if ( hasNextCorrection && nextCorrection.seqNum < currentRead )
+            {
+                cerr << "Error: Corrections are not sorted by read number (read " << nextCorrection.seqNum << " found after read " << currentRead - 1 << ")" << endl;
+                exit( EXIT_FAILURE );
+            }
+            vector<ErrorInfo> &correctionsOfCurrentRead = correctionsOfReads[batchSize];
+            correctionsOfCurrentRead.clear();
+            while ( hasNextCorrection && nextCorrection.seqNum == currentRead )
+            {
+                correctionsOfCurrentRead.push_back( nextCorrection );
+                hasNextCorrection = corrections.read( nextCorrection );
+            }
+            std::sort( correctionsOfCurrentRead.begin(), correctionsOfCurrentRead.end(), ErrorInfo::SortByRead );
+            vector<ErrorInfo *> &correctionsForCurrentRead = correctionsForReads[batchSize];
+            correctionsForCurrentRead.clear();
+            for ( unsigned int j = 0; j < correctionsOfCurrentRead.size(); ++j )
+                correctionsForCurrentRead.push_back( &correctionsOfCurrentRead[j] );
+            ++batchSize;
+            ++currentRead;
         }
-        else if ( !correctionsOnly )
+
+        // ...correcting is done in parallel
+        const int firstReadOfBatch = currentRead - batchSize;
+        #pragma omp parallel for schedule(dynamic)
+        for ( int i = 0; i < batchSize; ++i )
         {
-            if ( fileType == READS_FORMAT_FASTQ )
-                correctedReadsOut << MakeFastqRecord( currentRead, name, readStr, qStr );
-            else if ( fileType == READS_FORMAT_FASTA )
-                correctedReadsOut << MakeFastaRecord( currentRead, name, readStr, qStr );
+            records[i].clear();
+            if ( !correctionsForReads[i].empty() )
+            {
+                string correctedRead, correctedQstr;
+
+                CorrectRead( correctionsForReads[i], readStrs[i], qStrs[i], correctedRead, correctedQstr );
+                if ( fileType == READS_FORMAT_FASTQ )
+                    records[i] = MakeFastqRecord( firstReadOfBatch + i, names[i], correctedRead, correctedQstr );
+                else if ( fileType == READS_FORMAT_FASTA )
+                    records[i] = MakeFastaRecord( firstReadOfBatch + i, names[i], correctedRead, correctedQstr );
+            }
+            else if ( !correctionsOnly )
+            {
+                if ( fileType == READS_FORMAT_FASTQ )
+                    records[i] = MakeFastqRecord( firstReadOfBatch + i, names[i], readStrs[i], qStrs[i] );
+                else if ( fileType == READS_FORMAT_FASTA )
+                    records[i] = MakeFastaRecord( firstReadOfBatch + i, names[i], readStrs[i], qStrs[i] );
+            }
         }
-        currentRead++;
+
+        for ( int i = 0; i < batchSize; ++i )
+            correctedReadsOut << records[i];
     }
 
 }
@@ -144,52 +195,204 @@ enum AlignType
     SEQ2_GAP
 };
 
-void SmithWatermanCorrectionAligner::Align( const string &seq1, const string &seq2, int &lengthOnSeq1, int &lengthOnSeq2 )
+SmithWatermanCorrectionAligner::SmithWatermanCorrectionAligner( int m, int mm, int d, int i, int bandWidth )
+    : matchScore_( m )
+    , mismatchScore_( mm )
+    , deletionScore_( d )
+    , insertionScore_( i )
+    , bandWidth_( bandWidth )
 {
-    int **matrix = makeMatrix<int>( seq1.size() + 1, seq2.size() + 1 );
-    AlignType **pointers = makeMatrix<AlignType>( seq1.size() + 1, seq2.size() + 1 );
+#ifdef _OPENMP
+    scratch_.resize( omp_get_max_threads() );
+#else
+    scratch_.resize( 1 );
+#endif //ifdef _OPENMP
+}
 
-    for ( uint seq1pos = 0; seq1pos <= seq1.size(); seq1pos++ )
-        matrix[seq1pos][0] = 0;
-    for ( uint seq2pos = 0; seq2pos <= seq2.size(); seq2pos++ )
-        matrix[0][seq2pos] = 0;
+namespace
+{
 
-    for ( uint seq1pos = 1; seq1pos <= seq1.size(); seq1pos++ )
-        for ( uint seq2pos = 1; seq2pos <= seq2.size(); seq2pos++ )
+#ifdef __SSE2__
+// Scores and AlignTypes of the cells of an anti-diagonal, from firstCell on, 8 at a time.
+// May compute up to 7 cells past lastCell. Returns the first cell left to compute.
+int computeCellsSimd(
+    const int firstCell, const int lastCell,
+    const int16_t *prevScores, const int16_t *prevPrevScores, int16_t *scores, char *pointers,
+    const char *seq1, const char *seq2Reversed,
+    const int matchScore, const int mismatchScore, const int deletionScore, const int insertionScore
+)
+{
+    const __m128i match = _mm_set1_epi16( matchScore );
+    const __m128i mismatch = _mm_set1_epi16( mismatchScore );
+    const __m128i deletion = _mm_set1_epi16( deletionScore );
+    const __m128i insertion = _mm_set1_epi16( insertionScore );
+    const __m128i seq1Gap = _mm_set1_epi16( SEQ1_GAP );
+    const __m128i seq2Gap = _mm_set1_epi16( SEQ2_GAP );
+
+    int cell = firstCell;
+    for ( ; cell <= lastCell; cell += simdCellCount, pointers += simdCellCount )
+    {
+        const __m128i letters1 = _mm_loadl_epi64( ( const __m128i * )( seq1 + cell - 1 ) );
+        const __m128i letters2 = _mm_loadl_epi64( ( const __m128i * )( seq2Reversed + cell ) );
+        const __m128i isMatch8 = _mm_cmpeq_epi8( letters1, letters2 );
+        const __m128i isMatch = _mm_unpacklo_epi8( isMatch8, isMatch8 );
+        const __m128i matchScores = _mm_or_si128( _mm_and_si128( isMatch, match ), _mm_andnot_si128( isMatch, mismatch ) );
+
+        const __m128i up = _mm_add_epi16( _mm_loadu_si128( ( const __m128i * )( prevScores + cell - 1 ) ), deletion );
+        const __m128i left = _mm_add_epi16( _mm_loadu_si128( ( const __m128i * )( prevScores + cell ) ), insertion );
+        const __m128i diagonal = _mm_add_epi16( _mm_loadu_si128( ( const __m128i * )( prevPrevScores + cell - 1 ) ), matchScores );
+
+        // Same precedence as the scalar code: a later candidate only wins with a strictly better score
+        __m128i score = _mm_setzero_si128();
+        __m128i alignType = _mm_setzero_si128(); // POSITION_MATCH
+        __m128i isBetter = _mm_cmpgt_epi16( up, score );
+        score = _mm_max_epi16( score, up );
+        alignType = _mm_or_si128( _mm_and_si128( isBetter, seq2Gap ), _mm_andnot_si128( isBetter, alignType ) );
+        isBetter = _mm_cmpgt_epi16( left, score );
+        score = _mm_max_epi16( score, left );
+        alignType = _mm_or_si128( _mm_and_si128( isBetter, seq1Gap ), _mm_andnot_si128( isBetter, alignType ) );
+        isBetter = _mm_cmpgt_epi16( diagonal, score );
+        score = _mm_max_epi16( score, diagonal );
+        alignType = _mm_andnot_si128( isBetter, alignType );
+
+        _mm_storeu_si128( ( __m128i * )( scores + cell ), score );
+        _mm_storel_epi64( ( __m128i * )pointers, _mm_packs_epi16( alignType, alignType ) );
+    }
+    return cell;
+}
+#else
+// No SIMD kernel: the scalar loop computes every cell
+int computeCellsSimd(
+    const int firstCell, const int /*lastCell*/,
+    const int16_t * /*prevScores*/, const int16_t * /*prevPrevScores*/, int16_t * /*scores*/, char * /*pointers*/,
+    const char * /*seq1*/, const char * /*seq2Reversed*/,
+    const int /*matchScore*/, const int /*mismatchScore*/, const int /*deletionScore*/, const int /*insertionScore*/
+)
+{
+    return firstCell;
+}
+#endif //ifdef __SSE2__
+
+// 32-bit scores, only used when 16-bit ones could overflow, have no SIMD kernel
+int computeCellsSimd(
+    const int firstCell, const int /*lastCell*/,
+    const int * /*prevScores*/, const int * /*prevPrevScores*/, int * /*scores*/, char * /*pointers*/,
+    const char * /*seq1*/, const char * /*seq2Reversed*/,
+    const int /*matchScore*/, const int /*mismatchScore*/, const int /*deletionScore*/, const int /*insertionScore*/
+)
+{
+    return firstCell;
+}
+
+} // anonymous namespace
+
+template <typename Score>
+void SmithWatermanCorrectionAligner::computeScores( Scratch &scratch, vector<Score>( &scores )[3], const int seq1Length, const int seq2Length, const Score unreachable )
+{
+    const int n = seq1Length;
+    const int m = seq2Length;
+    const int diagonalCount = n + m + 1;
+    const int traceDiagonal = n - m; // seq1pos - seq2pos at the end of the alignment
+    const int bandWidth = ( bandWidth_ > 0 ) ? bandWidth_ : n + m;
+
+    for ( int k = 0; k < 3; ++k )
+        scores[k].resize( n + 1 + simdCellCount );
+
+    // Cell (seq1pos, seq2pos) belongs to anti-diagonal seq1pos+seq2pos, at index seq1pos
+    scratch.diagonalStart.resize( diagonalCount );
+    scratch.diagonalFirstCell.resize( diagonalCount );
+    int pointerCount = 0;
+    for ( int d = 0; d < diagonalCount; ++d )
+    {
+        const int firstCell = max( max( 1, d - m ), ceilHalf( d + traceDiagonal - bandWidth ) );
+        const int lastCell = min( min( n, d - 1 ), floorHalf( d + traceDiagonal + bandWidth ) );
+        scratch.diagonalStart[d] = pointerCount;
+        scratch.diagonalFirstCell[d] = firstCell;
+        pointerCount += max( 0, lastCell - firstCell + 1 );
+    }
+    scratch.pointers.resize( pointerCount + simdCellCount );
+
+    for ( int d = 0; d < diagonalCount; ++d )
+    {
+        const Score *prevScores = &scores[( d + 2 ) % 3][0];
+        const Score *prevPrevScores = &scores[( d + 1 ) % 3][0];
+        Score *thisScores = &scores[d % 3][0];
+        char *pointers = &scratch.pointers[scratch.diagonalStart[d]];
+        const int firstCell = scratch.diagonalFirstCell[d];
+        const int lastCell = min( min( n, d - 1 ), floorHalf( d + traceDiagonal + bandWidth ) );
+        const char *seq2Reversed = scratch.seq2Reversed.data() + m - d; // seq2Reversed[cell] == seq2[d - cell - 1]
+
+        int cell = computeCellsSimd( firstCell, lastCell, prevScores, prevPrevScores, thisScores, pointers,
+                                     scratch.seq1.data(), seq2Reversed,
+                                     matchScore_, mismatchScore_, deletionScore_, insertionScore_ );
+        for ( ; cell <= lastCell; ++cell )
         {
             AlignType alignType = POSITION_MATCH;
             int score = 0;
-            int matchScore;
-            if ( seq1[seq1pos - 1] == seq2[seq2pos - 1] )
-                matchScore = matchScore_;
-            else
-                matchScore = mismatchScore_;
+            const int matchScore = ( scratch.seq1[cell - 1] == seq2Reversed[cell] ) ? matchScore_ : mismatchScore_;
 
-            if ( score < matrix[seq1pos - 1][seq2pos] + deletionScore_ )
+            if ( score < prevScores[cell - 1] + deletionScore_ )
             {
-                score = matrix[seq1pos - 1][seq2pos] + deletionScore_;
+                score = prevScores[cell - 1] + deletionScore_;
                 alignType = SEQ2_GAP;
             }
-            if ( score < matrix[seq1pos][seq2pos - 1] + insertionScore_ )
+            if ( score < prevScores[cell] + insertionScore_ )
             {
-                score = matrix[seq1pos][seq2pos - 1] + insertionScore_;
+                score = prevScores[cell] + insertionScore_;
                 alignType = SEQ1_GAP;
             }
-            if ( score < matrix[seq1pos - 1][seq2pos - 1] + matchScore )
+            if ( score < prevPrevScores[cell - 1] + matchScore )
             {
-                score = matrix[seq1pos - 1][seq2pos - 1] + matchScore;
+                score = prevPrevScores[cell - 1] + matchScore;
                 alignType = POSITION_MATCH;
             }
-            matrix[seq1pos][seq2pos] = score;
-            pointers[seq1pos][seq2pos] = alignType;
+            thisScores[cell] = score;
+            pointers[cell - firstCell] = alignType;
         }
 
+        // Neighbours read by the next two anti-diagonals: first row and column are 0, cells outside the band unreachable
+        const int windowStart = max( 0, ceilHalf( d + traceDiagonal - bandWidth ) - 1 );
+        const int windowEnd = min( n, floorHalf( d + traceDiagonal + bandWidth ) + 1 );
+        for ( int i = windowStart; i <= min( windowEnd, firstCell - 1 ); ++i )
+            thisScores[i] = ( i == 0 || i == d ) ? 0 : unreachable;
+        for ( int i = max( windowStart, lastCell + 1 ); i <= windowEnd; ++i )
+            thisScores[i] = ( i == 0 || i == d ) ? 0 : unreachable;
+    }
+}
+
+void SmithWatermanCorrectionAligner::Align( const string &seq1, const string &seq2, int &lengthOnSeq1, int &lengthOnSeq2 )
+{
+#ifdef _OPENMP
+    const unsigned int threadNum = omp_get_thread_num();
+#else
+    const unsigned int threadNum = 0;
+#endif //ifdef _OPENMP
+    assert( threadNum < scratch_.size() );
+    Scratch &scratch = scratch_[threadNum];
+
+    // Sequences are padded for the 8-cell SIMD loads
+    const int n = seq1.size();
+    const int m = seq2.size();
+    scratch.seq1.assign( seq1 );
+    scratch.seq1.append( simdCellCount, '\0' );
+    scratch.seq2Reversed.assign( seq2.rbegin(), seq2.rend() );
+    scratch.seq2Reversed.append( simdCellCount, '\0' );
+
+    // 16-bit scores whenever they can't overflow
+    const int maxStepScore = max( max( abs( matchScore_ ), abs( mismatchScore_ ) ), max( abs( deletionScore_ ), abs( insertionScore_ ) ) );
+    if ( ( int64_t )maxStepScore * ( n + m + 1 ) < 16000 )
+        computeScores<int16_t>( scratch, scratch.scores16, n, m, -16384 );
+    else
+        computeScores<int>( scratch, scratch.scores, n, m, numeric_limits<int>::min() / 2 );
+
     int pos1 = seq1.size() - 1;
     int pos2 = seq2.size() - 1;
 
     while ( ( pos1 > 0 ) && ( pos2 > 0 ) )
     {
-        switch ( pointers[pos1][pos2] )
+        const int d = pos1 + pos2;
+        assert( pos1 >= scratch.diagonalFirstCell[d] );
+        switch ( scratch.pointers[scratch.diagonalStart[d] + pos1 - scratch.diagonalFirstCell[d]] )
         {
             case POSITION_MATCH:
                 pos1--;
@@ -208,9 +411,6 @@ void SmithWatermanCorrectionAligner::Align( const string &seq1, const string &se
 
     lengthOnSeq1 = seq1.size() - pos1;
     lengthOnSeq2 = seq2.size() - pos2;
-
-    zapMatrix<AlignType>( pointers, seq1.size() + 1 );
-    zapMatrix<int>( matrix, seq1.size() + 1 );
 }
 
 void SmithWatermanCorrectionAligner::Align( const string &seq1, const string &seq2, int &lengthOnSeq1, int &lengthOnSeq2, bool correctForwards )
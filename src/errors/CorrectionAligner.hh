@@ -17,8 +17,10 @@
 #include <vector>
 #include <math.h>
 #include <limits>
+#include <stdint.h>
 
 #include "AlignmentParameters.hh"
+#include "CorrectionsFile.hh"
 #include "ErrorInfo.hh"
 
 #ifndef INCLUDED_CORRECTIONALIGNER_HH
@@ -27,11 +29,6 @@
 using namespace std;
 using namespace BeetlAlignParameters;
 
-template <class T>
-void zapMatrix( T **matrix, int rows );
-template <class T>
-T **makeMatrix( int rows, int cols );
-
 class CorrectionAligner
 {
 public:
@@ -40,9 +37,11 @@ public:
     static string MakeFastqRecord( int currentRead, string name, string sequence, string quality );
     static bool SortByLastCycle( ErrorInfo *a, ErrorInfo *b );
 
+    // Corrections are streamed read by read: they must come sorted by read number,
+    // as CorrectionsWriter writes them
     void ApplyCorrections(
         SeqReaderFile *readsFile,
-        vector<ErrorInfo> &corrections,
+        CorrectionsReader &corrections,
         ostream &correctedReadsOut,
         bool correctionsOnly,
         ReadsFormat fileType
@@ -50,7 +49,7 @@ public:
 
     void ApplyCorrections(
         SeqReaderFile *readsFile,
-        vector<ErrorInfo> &corrections,
+        CorrectionsReader &corrections,
         const string &outFile,
         bool correctionsOnly,
         ReadsFormat fileType
@@ -70,10 +69,13 @@ public:
 
 };
 
+// Scores are computed one anti-diagonal at a time (SSE2 when available), optionally
+// restricted to a band of +/- bandWidth diagonals around the one ending the alignment.
+// Each thread reuses its own scratch buffers.
 class SmithWatermanCorrectionAligner : public CorrectionAligner
 {
 public:
-    SmithWatermanCorrectionAligner( int m, int mm, int d, int i ): matchScore_( m ), mismatchScore_( mm ), deletionScore_( d ), insertionScore_( i ) {}
+    SmithWatermanCorrectionAligner( int m, int mm, int d, int i, int bandWidth = 0 );
 
     void Align( const string &seq1, const string &seq2, int &lengthOnSeq1, int &lengthOnSeq2 );
     void Align( const string &seq1, const string &seq2, int &lengthOnSeq1, int &lengthOnSeq2, bool correctForwards );
@@ -82,10 +84,26 @@ public:
     string Correct( const string &errorContainingRead, vector<ErrorInfo *> &corrections );
 
 private:
+    struct Scratch
+    {
+        vector<int16_t> scores16[3]; // last three anti-diagonals, indexed by position in seq1
+        vector<int> scores[3]; // same, when scores may not fit in 16 bits
+        vector<char> pointers; // AlignType of each cell, anti-diagonal by anti-diagonal
+        vector<int> diagonalStart; // index in pointers of the first cell of each anti-diagonal
+        vector<int> diagonalFirstCell; // seq1 position of this first cell
+        string seq1;
+        string seq2Reversed;
+    };
+
+    template <typename Score>
+    void computeScores( Scratch &scratch, vector<Score>( &scores )[3], const int seq1Length, const int seq2Length, const Score unreachable );
+
     int matchScore_;
     int mismatchScore_;
     int deletionScore_;
     int insertionScore_;
+    int bandWidth_;
+    vector<Scratch> scratch_; // one per thread
 };
 
 class StitchAligner : public CorrectionAligner
@@ -0,0 +1,225 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "CorrectionsFile.hh"
+
+#include "libzoo/util/Logger.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+using namespace std;
+
+
+namespace
+{
+
+const char correctionsFileMagic[] = "BWTCORR";
+const char packedLetters[] = "ACGT";
+
+uint64_t zigzagEncode( const int64_t value )
+{
+    return ( static_cast<uint64_t>( value ) << 1 ) ^ static_cast<uint64_t>( value >> 63 );
+}
+
+int64_t zigzagDecode( const uint64_t value )
+{
+    return static_cast<int64_t>( value >> 1 ) ^ -static_cast<int64_t>( value & 1 );
+}
+
+} // anonymous namespace
+
+
+CorrectionsWriter::CorrectionsWriter( const string &fileName, const CorrectionsFormat format )
+    : fileName_( fileName )
+    , format_( format )
+    , os_( fileName.c_str(), ios::binary )
+    , previousSeqNum_( 0 )
+{
+    if ( !os_.good() )
+    {
+        Logger::error() << "Error: Cannot write " << fileName_ << endl;
+        exit( EXIT_FAILURE );
+    }
+    if ( format_ == CORRECTIONS_FORMAT_BINARY )
+        os_.write( correctionsFileMagic, strlen( correctionsFileMagic ) );
+    else
+        os_ << "read position reverse_strand correction corrector_start shortest_witness longest_witness" << endl; //the columns of the output csv file.
+}
+
+CorrectionsWriter::~CorrectionsWriter()
+{
+    os_.close();
+    if ( os_.fail() )
+    {
+        Logger::error() << "Error: Cannot write " << fileName_ << endl;
+        exit( EXIT_FAILURE );
+    }
+}
+
+void CorrectionsWriter::write( const ErrorInfo &correction )
+{
+    if ( format_ == CORRECTIONS_FORMAT_CSV )
+    {
+        os_
+                << correction.seqNum << " "
+                << correction.positionInRead << " "
+                << correction.reverseStrand << " "
+                << correction.corrector << " "
+                << correction.correctorStart << " "
+                << correction.firstCycle << " "
+                << correction.lastCycle << '\n';
+        return;
+    }
+
+    writeVarint( zigzagEncode( ( int64_t )correction.seqNum - previousSeqNum_ ) );
+    writeVarint( zigzagEncode( correction.positionInRead ) );
+    writeVarint( correction.reverseStrand ? 1 : 0 );
+    writeVarint( zigzagEncode( correction.correctorStart ) );
+    writeVarint( correction.firstCycle );
+    writeVarint( correction.lastCycle );
+
+    // Correctors made of ACGT only are packed 4 letters per byte
+    const string &corrector = correction.corrector;
+    const bool isPacked = ( corrector.find_first_not_of( packedLetters ) == string::npos );
+    writeVarint( ( corrector.size() << 1 ) | ( isPacked ? 1 : 0 ) );
+    if ( !isPacked )
+        os_.write( corrector.data(), corrector.size() );
+    else
+        for ( unsigned int i = 0; i < corrector.size(); i += 4 )
+        {
+            char byte = 0;
+            for ( unsigned int j = i; j < i + 4 && j < corrector.size(); ++j )
+                byte |= ( char )( ( strchr( packedLetters, corrector[j] ) - packedLetters ) << ( 2 * ( j - i ) ) );
+            os_.put( byte );
+        }
+    previousSeqNum_ = correction.seqNum;
+}
+
+void CorrectionsWriter::writeVarint( uint64_t value )
+{
+    char bytes[10];
+    int byteCount = 0;
+    while ( value >= 0x80 )
+    {
+        bytes[byteCount++] = ( char )( ( value & 0x7F ) | 0x80 );
+        value >>= 7;
+    }
+    bytes[byteCount++] = ( char )value;
+    os_.write( bytes, byteCount );
+}
+
+
+CorrectionsReader::CorrectionsReader( const string &fileName )
+    : fileName_( fileName )
+    , format_( CORRECTIONS_FORMAT_CSV )
+    , is_( fileName.c_str(), ios::binary )
+    , previousSeqNum_( 0 )
+{
+    if ( !is_.good() )
+    {
+        Logger::error() << "Error: Cannot read " << fileName_ << endl;
+        exit( EXIT_FAILURE );
+    }
+
+    char magic[sizeof( correctionsFileMagic ) - 1];
+    is_.read( magic, sizeof( magic ) );
+    if ( is_.gcount() == sizeof( magic ) && memcmp( magic, correctionsFileMagic, sizeof( magic ) ) == 0 )
+        format_ = CORRECTIONS_FORMAT_BINARY;
+    else
+    {
+        // Text file: skips the header line
+        is_.clear();
+        is_.seekg( 0 );
+        string header;
+        getline( is_, header );
+    }
+}
+
+bool CorrectionsReader::read( ErrorInfo &correction )
+{
+    correction = ErrorInfo();
+    if ( format_ == CORRECTIONS_FORMAT_CSV )
+    {
+        string correctionRecord;
+        if ( !getline( is_, correctionRecord ) )
+            return false;
+        stringstream ss( correctionRecord );
+
+        ss >> correction.seqNum;
+        ss >> correction.positionInRead;
+        ss >> correction.reverseStrand;
+        ss >> correction.corrector;
+        ss >> correction.correctorStart;
+        ss >> correction.firstCycle;
+        ss >> correction.lastCycle;
+    }
+    else
+    {
+        uint64_t seqNumDelta, positionInRead, reverseStrand, correctorStart, firstCycle, lastCycle, correctorLength;
+        if ( !readVarint( seqNumDelta ) )
+            return false;
+        if ( !readVarint( positionInRead ) || !readVarint( reverseStrand ) || !readVarint( correctorStart )
+             || !readVarint( firstCycle ) || !readVarint( lastCycle ) || !readVarint( correctorLength ) )
+        {
+            Logger::error() << "Error: " << fileName_ << " is truncated" << endl;
+            exit( EXIT_FAILURE );
+        }
+
+        correction.seqNum = previousSeqNum_ + zigzagDecode( seqNumDelta );
+        correction.positionInRead = zigzagDecode( positionInRead );
+        correction.reverseStrand = ( reverseStrand != 0 );
+        correction.correctorStart = zigzagDecode( correctorStart );
+        correction.firstCycle = firstCycle;
+        correction.lastCycle = lastCycle;
+        const bool isPacked = ( correctorLength & 1 );
+        correctorLength >>= 1;
+        correction.corrector.resize( correctorLength );
+        if ( !isPacked )
+        {
+            if ( correctorLength )
+                is_.read( &correction.corrector[0], correctorLength );
+        }
+        else
+            for ( unsigned int i = 0; i < correctorLength; i += 4 )
+            {
+                const char byte = is_.get();
+                for ( unsigned int j = i; j < i + 4 && j < correctorLength; ++j )
+                    correction.corrector[j] = packedLetters[( byte >> ( 2 * ( j - i ) ) ) & 3];
+            }
+        if ( !is_.good() )
+        {
+            Logger::error() << "Error: " << fileName_ << " is truncated" << endl;
+            exit( EXIT_FAILURE );
+        }
+        previousSeqNum_ = correction.seqNum;
+    }
+
+    correction.readEnd = correction.positionInRead + correction.firstCycle + 1;
+    return true;
+}
+
+bool CorrectionsReader::readVarint( uint64_t &value )
+{
+    value = 0;
+    for ( int shift = 0; shift < 64; shift += 7 )
+    {
+        const int c = is_.get();
+        if ( c == EOF )
+            return false;
+        value |= static_cast<uint64_t>( c & 0x7F ) << shift;
+        if ( ( c & 0x80 ) == 0 )
+            return true;
+    }
+    return false;
+}
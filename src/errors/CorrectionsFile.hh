@@ -0,0 +1,77 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef INCLUDED_CORRECTIONSFILE_HH
+#define INCLUDED_CORRECTIONSFILE_HH
+
+#include "ErrorInfo.hh"
+
+#include <fstream>
+#include <stdint.h>
+#include <string>
+
+using std::string;
+
+
+enum CorrectionsFormat
+{
+    CORRECTIONS_FORMAT_BINARY,
+    CORRECTIONS_FORMAT_CSV
+};
+
+// Class Name : CorrectionsWriter
+// Description: Writes corrections one at a time, either as space-separated text
+// (one line per correction, after a header line) or in a compact binary format:
+//   "BWTCORR" magic, then for each correction, as LEB128 varints:
+//   seqNum delta from the previous correction (zigzag), positionInRead (zigzag),
+//   reverseStrand, correctorStart (zigzag), firstCycle, lastCycle,
+//   corrector length * 2 + 1 followed by its letters packed 2 bits each (A=0,
+//   C=1, G=2, T=3, lowest bits first), or, if it holds any other letter,
+//   corrector length * 2 followed by its letters as bytes
+class CorrectionsWriter
+{
+public:
+    CorrectionsWriter( const string &fileName, const CorrectionsFormat format );
+    ~CorrectionsWriter();
+
+    void write( const ErrorInfo &correction );
+
+private:
+    void writeVarint( uint64_t value );
+
+    const string fileName_;
+    const CorrectionsFormat format_;
+    std::ofstream os_;
+    int previousSeqNum_;
+};
+
+// Class Name : CorrectionsReader
+// Description: Reads corrections one at a time from a file written by
+// CorrectionsWriter, detecting its format
+class CorrectionsReader
+{
+public:
+    CorrectionsReader( const string &fileName );
+
+    // Returns false at the end of the file
+    bool read( ErrorInfo &correction );
+
+private:
+    bool readVarint( uint64_t &value );
+
+    const string fileName_;
+    CorrectionsFormat format_;
+    std::ifstream is_;
+    int previousSeqNum_;
+};
+
+#endif
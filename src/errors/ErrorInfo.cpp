@@ -46,7 +46,7 @@ void ErrorInfo::print() const
     cout << endl;
 }
 
-void ErrorInfo::SetReadNumbersToOriginal( char *endPosFileName, vector<ErrorInfo> &errorsInSortedReads )
+void ErrorInfo::SetReadNumbersToOriginal( const char *endPosFileName, vector<int> &sortedSeqNums )
 {
     //loop through all the errors and for each one look up which read it comes from
     LetterNumber numchar;
@@ -71,7 +71,7 @@ void ErrorInfo::SetReadNumbersToOriginal( char *endPosFileName, vector<ErrorInfo
     uint currentSortedReadIndex = 0;
     SequenceNumber i = 0;
 
-    while ( currentSortedReadIndex < errorsInSortedReads.size() )
+    while ( currentSortedReadIndex < sortedSeqNums.size() )
     {
         numchar = fread ( &triple.seqN, sizeof( SequenceNumber ), 1 , InFileEndPos );
         checkIfEqual( numchar, 1 );
@@ -84,11 +84,11 @@ void ErrorInfo::SetReadNumbersToOriginal( char *endPosFileName, vector<ErrorInfo
         checkIfEqual( numchar, 1 );
 
         while (
-            i == ( SequenceNumber )( errorsInSortedReads[currentSortedReadIndex].seqNum )
+            currentSortedReadIndex < sortedSeqNums.size()
             &&
-            currentSortedReadIndex < errorsInSortedReads.size()
+            i == ( SequenceNumber )( sortedSeqNums[currentSortedReadIndex] )
         )
-            errorsInSortedReads[currentSortedReadIndex++].seqNum = triple.seqN;
+            sortedSeqNums[currentSortedReadIndex++] = triple.seqN;
         i++;
     }
 
@@ -105,77 +105,21 @@ string strreverse( const string &inStr )
     return result;
 }
 
-void ErrorInfo::ConvertRCCorrectionsToOriginal( vector<ErrorInfo> &corrections, int numberOfReads, int readLength )
+void ErrorInfo::ConvertRCCorrectionToOriginal( ErrorInfo &correction, int numberOfReads, int readLength )
 {
-    for ( uint errNo = 0; errNo < corrections.size(); errNo++ )
-        if ( corrections[errNo].seqNum >= numberOfReads )
-        {
-            corrections[errNo].seqNum -= numberOfReads;
-            corrections[errNo].positionInRead = readLength - 1 - corrections[errNo].positionInRead;
-            for ( uint i = 0; i < corrections[errNo].corrector.size(); i++ )
-                corrections[errNo].corrector[i] = complementaryAlphabet[whichPile[( int )corrections[errNo].corrector[i]]];
-            corrections[errNo].correctorStart = corrections[errNo].positionInRead;
-            corrections[errNo].reverseStrand = true;
-        }
-        else
-        {
-            corrections[errNo].correctorStart = corrections[errNo].positionInRead - ( corrections[errNo].corrector.size() - 1 );
-            corrections[errNo].corrector = strreverse( corrections[errNo].corrector );
-            corrections[errNo].reverseStrand = false;
-        }
-}
-
-void ErrorInfo::CorrectionsToCsv( const string &fileName, vector<ErrorInfo> &corrections )
-{
-    ofstream correctionsFile;
-    correctionsFile.open( fileName.c_str() );
-    correctionsFile << "read position reverse_strand correction corrector_start shortest_witness longest_witness" << endl; //the columns of the output csv file.
-
-    for ( uint errNo = 0; errNo < corrections.size(); errNo++ )
-        correctionsFile
-                << corrections[errNo].seqNum << " "
-                << corrections[errNo].positionInRead << " "
-                << corrections[errNo].reverseStrand << " "
-                << corrections[errNo].corrector << " "
-                << corrections[errNo].correctorStart << " "
-                << corrections[errNo].firstCycle << " "
-                << corrections[errNo].lastCycle << endl;
-
-    correctionsFile.close();
-}
-
-vector<ErrorInfo> ErrorInfo::ReadCorrectionsFromCsv( const string &fileName )
-{
-    vector<ErrorInfo> result;
-    ifstream in( fileName.c_str() );
-    string correctionRecord;
-    bool firstLine = true;
-
-    while ( getline( in, correctionRecord ) )
+    if ( correction.seqNum >= numberOfReads )
     {
-        if ( firstLine )
-        {
-            firstLine = false;
-            continue;
-        }
-
-        ErrorInfo correction;
-        stringstream ss( correctionRecord );
-
-        ss >> correction.seqNum;
-        ss >> correction.positionInRead;
-        ss >> correction.reverseStrand;
-        ss >> correction.corrector;
-        ss >> correction.correctorStart;
-        ss >> correction.firstCycle;
-        ss >> correction.lastCycle;
-
-        correction.readEnd = correction.positionInRead + correction.firstCycle + 1;
-
-        result.push_back( correction );
+        correction.seqNum -= numberOfReads;
+        correction.positionInRead = readLength - 1 - correction.positionInRead;
+        for ( uint i = 0; i < correction.corrector.size(); i++ )
+            correction.corrector[i] = complementaryAlphabet[whichPile[( int )correction.corrector[i]]];
+        correction.correctorStart = correction.positionInRead;
+        correction.reverseStrand = true;
+    }
+    else
+    {
+        correction.correctorStart = correction.positionInRead - ( correction.corrector.size() - 1 );
+        correction.corrector = strreverse( correction.corrector );
+        correction.reverseStrand = false;
     }
-
-    in.close();
-    return result;
 }
-
@@ -81,22 +81,15 @@ struct ErrorInfo
     int correctorStart; //zero indexed position of first character in correction string relative to the original read before alignment
     bool reverseStrand; //flag depicting which strand the correction was noticed on
 
-    //use the -end-pos file to map the alphabetical read positions back to the original ordering
-    static void SetReadNumbersToOriginal( char *endPosFileName, vector<ErrorInfo> &errorsInSortedReads );
+    //use the -end-pos file to map the alphabetical read positions (sorted in increasing order) back to the original ordering
+    static void SetReadNumbersToOriginal( const char *endPosFileName, vector<int> &sortedSeqNums );
 
-    //make sure seqNum field for ErrorInfo objects refers to one of the original reads (as oppposed to their reverse complements)
-    //and  make sure that the corrector strings are running in the correct direction (L2R for reverse strand, R2L otherwise)
-    static void ConvertRCCorrectionsToOriginal( vector<ErrorInfo> &errors, int numberOfReads, int readLength );
-
-    //write a vector of ErrorInfo objects to a csv file with the fields in the order that is understood by 'ReadCorrectionsFromCsv'
-    static void CorrectionsToCsv( const string &fileName, vector<ErrorInfo> &corrections );
-    //read a vector of ErrorInfo objects from a file written by CorrectionsToCsv
-    static vector<ErrorInfo> ReadCorrectionsFromCsv( const string &fileName );
+    //make sure seqNum field for an ErrorInfo object refers to one of the original reads (as oppposed to their reverse complements)
+    //and  make sure that the corrector string is running in the correct direction (L2R for reverse strand, R2L otherwise)
+    static void ConvertRCCorrectionToOriginal( ErrorInfo &correction, int numberOfReads, int readLength );
 
 };
 
-typedef map<LetterNumber, ErrorInfo> ErrorStore;
-
 string strreverse( const string &inStr );
 
 #endif
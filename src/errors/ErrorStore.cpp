@@ -0,0 +1,132 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "ErrorStore.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+using namespace std;
+
+
+ErrorStore::ErrorId ErrorStore::find( const LetterNumber bwtPos ) const
+{
+    Key key;
+    key.bwtPos = bwtPos;
+    for ( unsigned int i = 0; i < runs_.size(); ++i )
+    {
+        vector<Key>::const_iterator it = lower_bound( runs_[i].begin(), runs_[i].end(), key );
+        if ( it != runs_[i].end() && it->bwtPos == bwtPos )
+            return it->id;
+    }
+    return notFound;
+} // ~find
+
+void ErrorStore::apply( vector<ErrorStoreUpdates> &updates )
+{
+    // New errors first, as the other changes may only refer to errors of previous cycles
+    vector<Key> run;
+    for ( unsigned int t = 0; t < updates.size(); ++t )
+    {
+        const vector<ErrorStoreUpdates::NewError> &newErrors = updates[t].newErrors_;
+        for ( unsigned int i = 0; i < newErrors.size(); ++i )
+        {
+            Key key = { newErrors[i].bwtPos, ( ErrorId )records_.size() };
+            Record record = { newErrors[i].cycle, newErrors[i].cycle, 0, -1 };
+            assert( records_.size() < notFound );
+            records_.push_back( record );
+            appendCorrectorLetter( key.id, newErrors[i].correctLetter );
+            run.push_back( key );
+        }
+    }
+    addRun( run );
+
+    for ( unsigned int t = 0; t < updates.size(); ++t )
+    {
+        ErrorStoreUpdates &u = updates[t];
+        for ( unsigned int i = 0; i < u.lastCycles_.size(); ++i )
+            records_[u.lastCycles_[i].first].lastCycle = u.lastCycles_[i].second;
+        for ( unsigned int i = 0; i < u.readEnds_.size(); ++i )
+        {
+            Record &record = records_[u.readEnds_[i].id];
+            record.seqNum = u.readEnds_[i].seqNum;
+            record.readEnd = u.readEnds_[i].readEnd;
+        }
+        for ( unsigned int i = 0; i < u.correctorLetters_.size(); ++i )
+            appendCorrectorLetter( u.correctorLetters_[i].first, u.correctorLetters_[i].second );
+        u.clear();
+    }
+} // ~apply
+
+void ErrorStore::addRun( vector<Key> &run )
+{
+    if ( run.empty() )
+        return;
+    sort( run.begin(), run.end() );
+    runs_.push_back( vector<Key>() );
+    runs_.back().swap( run );
+
+    // Merges the newest runs until each run is more than twice as big as the next one
+    while ( runs_.size() >= 2 && runs_[runs_.size() - 2].size() <= 2 * runs_.back().size() )
+    {
+        vector<Key> &older = runs_[runs_.size() - 2];
+        vector<Key> &newer = runs_.back();
+        vector<Key> merged;
+        merged.reserve( older.size() + newer.size() );
+        merge( older.begin(), older.end(), newer.begin(), newer.end(), back_inserter( merged ) );
+        runs_.pop_back();
+        runs_.back().swap( merged );
+    }
+} // ~addRun
+
+void ErrorStore::appendCorrectorLetter( const ErrorId id, const char letter )
+{
+    correctorIds_.push_back( id );
+    correctorLetters_.push_back( letter );
+} // ~appendCorrectorLetter
+
+void ErrorStore::finishDetection()
+{
+    vector< vector<Key> >().swap( runs_ );
+
+    // Counting sort of the arena by error; letters stay in order of cycle within an error
+    correctorOffsets_.assign( records_.size() + 1, 0 );
+    for ( LetterNumber i = 0; i < correctorIds_.size(); ++i )
+        ++correctorOffsets_[correctorIds_[i] + 1];
+    for ( ErrorId id = 0; id < records_.size(); ++id )
+        correctorOffsets_[id + 1] += correctorOffsets_[id];
+
+    vector<LetterNumber> next( correctorOffsets_.begin(), correctorOffsets_.end() - 1 );
+    vector<char> groupedLetters( correctorLetters_.size() );
+    for ( LetterNumber i = 0; i < correctorIds_.size(); ++i )
+        groupedLetters[next[correctorIds_[i]]++] = correctorLetters_[i];
+    vector<ErrorId>().swap( correctorIds_ );
+    correctorLetters_.swap( groupedLetters );
+} // ~finishDetection
+
+ErrorInfo ErrorStore::errorInfo( const ErrorId id ) const
+{
+    assert( correctorOffsets_.size() == records_.size() + 1 );
+    const Record &record = records_[id];
+    return ErrorInfo( record.seqNum, record.readEnd, record.lastCycle, record.firstCycle,
+                      string( correctorLetters_.begin() + correctorOffsets_[id], correctorLetters_.begin() + correctorOffsets_[id + 1] ) );
+} // ~errorInfo
+
+
+void ErrorStoreUpdates::clear()
+{
+    newErrors_.clear();
+    lastCycles_.clear();
+    readEnds_.clear();
+    correctorLetters_.clear();
+} // ~clear
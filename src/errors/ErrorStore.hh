@@ -0,0 +1,148 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef INCLUDED_ERRORSTORE_HH
+#define INCLUDED_ERRORSTORE_HH
+
+#include "ErrorInfo.hh"
+#include "Types.hh"
+
+#include <stdint.h>
+#include <vector>
+
+using std::vector;
+
+
+class ErrorStoreUpdates;
+
+// Class Name : ErrorStore
+// Description: Errors found by BwtCorrector, indexed by the BWT position of the
+// erroneous letter. Each error gets a fixed-size record, numbered in order of
+// creation. The BWT positions of the errors created in a cycle form one sorted
+// run; runs are merged LSM-style, so that there are O(log n) of them to search.
+// The corrector strings grow by one letter per cycle and are kept in an
+// append-only arena of (error, letter) pairs. Once the detection is over,
+// finishDetection() drops the BWT positions and groups the letters by error,
+// so that each error can be turned into an ErrorInfo on its own.
+class ErrorStore
+{
+public:
+    typedef uint32_t ErrorId;
+    static const ErrorId notFound = ~( ErrorId )0;
+
+    // Error at this BWT position, or notFound. Thread-safe while the store isn't modified.
+    ErrorId find( const LetterNumber bwtPos ) const;
+    int seqNum( const ErrorId id ) const
+    {
+        return records_[id].seqNum;
+    }
+    size_t size() const
+    {
+        return records_.size();
+    }
+
+    // Applies the changes of all the threads, in order, and clears them
+    void apply( vector<ErrorStoreUpdates> &updates );
+
+    // Frees the BWT position index and the arena, keeping the letters grouped by error.
+    // Only seqNum(), setSeqNum() and errorInfo() may be used afterwards.
+    void finishDetection();
+    void setSeqNum( const ErrorId id, const int seqNum )
+    {
+        records_[id].seqNum = seqNum;
+    }
+    ErrorInfo errorInfo( const ErrorId id ) const;
+
+private:
+    struct Record
+    {
+        int firstCycle;
+        int lastCycle;
+        int readEnd;
+        int seqNum;
+    };
+
+    struct Key
+    {
+        LetterNumber bwtPos;
+        ErrorId id;
+
+        bool operator<( const Key &rhs ) const
+        {
+            return bwtPos < rhs.bwtPos;
+        }
+    };
+
+    void addRun( vector<Key> &run );
+    void appendCorrectorLetter( const ErrorId id, const char letter );
+
+    vector<Record> records_;
+    vector< vector<Key> > runs_; // sorted, sizes decreasing at least geometrically
+    vector<ErrorId> correctorIds_;
+    vector<char> correctorLetters_; // in arena order, then grouped by error after finishDetection()
+    vector<LetterNumber> correctorOffsets_; // after finishDetection(): letters of error i are at [offsets[i], offsets[i+1])
+};
+
+
+// Changes to an ErrorStore found by one thread during a cycle of error detection.
+// The store is only read while the cycle runs, and ErrorStore::apply() merges the
+// changes of all the threads once it is over. Within a cycle, each BWT position
+// belongs to a single interval, so the changes of different threads concern
+// different errors.
+class ErrorStoreUpdates
+{
+public:
+    void addError( const LetterNumber bwtPos, const int cycle, const char correctLetter )
+    {
+        NewError update = { bwtPos, cycle, correctLetter };
+        newErrors_.push_back( update );
+    }
+    void setLastCycle( const ErrorStore::ErrorId id, const int cycle )
+    {
+        lastCycles_.push_back( make_pair( id, cycle ) );
+    }
+    void setReadEnd( const ErrorStore::ErrorId id, const int seqNum, const int readEnd )
+    {
+        ReadEnd update = { id, seqNum, readEnd };
+        readEnds_.push_back( update );
+    }
+    void extendCorrector( const ErrorStore::ErrorId id, const char letter )
+    {
+        correctorLetters_.push_back( make_pair( id, letter ) );
+    }
+
+private:
+    friend class ErrorStore;
+
+    struct NewError
+    {
+        LetterNumber bwtPos;
+        int cycle;
+        char correctLetter;
+    };
+
+    struct ReadEnd
+    {
+        ErrorStore::ErrorId id;
+        int seqNum;
+        int readEnd;
+    };
+
+    void clear();
+
+    vector<NewError> newErrors_;
+    vector< pair<ErrorStore::ErrorId, int> > lastCycles_;
+    vector<ReadEnd> readEnds_;
+    vector< pair<ErrorStore::ErrorId, char> > correctorLetters_;
+};
+
+#endif
@@ -19,7 +19,9 @@
 #include "parameters/BwtParameters.hh"
 #include "config.h"
 #include "libzoo/cli/Common.hh"
+#include "libzoo/io/CompressedInputStream.hh"
 #include "libzoo/util/Logger.hh"
+#include "errors/CorrectionsFile.hh"
 #include "errors/ErrorInfo.hh"
 #include "errors/WitnessReader.hh"
 #include "errors/AlignmentParameters.hh"
@@ -36,6 +38,10 @@
 #include <string>
 #include <vector>
 
+#ifdef _OPENMP
+# include <omp.h>
+#endif //ifdef _OPENMP
+
 using namespace std;
 
 int main( const int argc, const char **argv )
@@ -47,11 +53,15 @@ int main( const int argc, const char **argv )
         exit( params["help"] == 0 );
     }
 
-    //read the corrections to be applied out of the corrections file...
-    vector<ErrorInfo> corrections = ErrorInfo::ReadCorrectionsFromCsv( params.getStringValue( "input corrections file" ) );
-    std::sort( corrections.begin(), corrections.end(), ErrorInfo::SortByRead );
+    //the corrections get streamed from the corrections file, read by read, as the reads are corrected
+    CorrectionsReader correctionsReader( params.getStringValue( "input corrections file" ) );
+
+    cout << "Applying corrections from " << params.getStringValue( "input corrections file" ) << "..." << endl;
+#ifdef _OPENMP
+    if ( params["threads"].isSet() )
+        omp_set_num_threads( params["threads"] );
+#endif //ifdef _OPENMP
 
-    cout << "Attempting to make " << corrections.size() << " corrections..." << endl;
     unique_ptr<CorrectionAligner> aligner;
 
     int alignmentType = params.getValue( "alignment type" );
@@ -63,12 +73,18 @@ int main( const int argc, const char **argv )
             cout << "Smith waterman alignment requires you to set the mismatch/deletion/insertion penalties and the witness length used to generate the corrections..." << endl;
             exit( 1 );
         }
+        if ( params["band width"].isSet() && params.getValue( "band width" ) < 1 )
+        {
+            cout << "Smith waterman band width must be at least 1..." << endl;
+            exit( 1 );
+        }
         cout << "Using Smith-Water man local alignment to position the corrections..." << endl;
         aligner.reset( new SmithWatermanCorrectionAligner(
                            2,
                            params.getValue( "mismatch penalty" ),
                            params.getValue( "deletion penalty" ),
-                           params.getValue( "insertion penalty" )
+                           params.getValue( "insertion penalty" ),
+                           params["band width"].isSet() ? params.getValue( "band width" ) : 0
                        )
                      );
     }
@@ -100,6 +116,26 @@ int main( const int argc, const char **argv )
 
     string readsFileName = params.getStringValue( "input reads file" );
     FILE *reads = fopen( readsFileName.c_str(), "r" );
+    if ( reads == NULL )
+    {
+        cerr << "Error: Cannot open " << readsFileName << endl;
+        exit( 1 );
+    }
+    FILE *compressedReads = NULL;
+    unsigned char magic[compressionMagicSize];
+    const size_t magicSize = readMagicBytes( reads, magic, sizeof( magic ) );
+    if ( isGzipMagic( magic, magicSize ) )
+    {
+        compressedReads = reads;
+        reads = openGzipDecompressingStream( compressedReads, magic, magicSize );
+    }
+    else if ( isZstdMagic( magic, magicSize ) )
+    {
+        compressedReads = reads;
+        reads = openZstdDecompressingStream( compressedReads, magic, magicSize );
+    }
+    else
+        reads = unreadBytes( reads, magic, magicSize );
 
     string outputReadsFile = params.getStringValue( "corrected reads output file" );
     cout << "Writing corrector-aligned reads to " << outputReadsFile << "..." << endl;
@@ -133,9 +169,11 @@ int main( const int argc, const char **argv )
             exit( 1 );
     }
 
-    aligner->ApplyCorrections( readsFile, corrections, outputReadsFile, false, outFormat );
+    aligner->ApplyCorrections( readsFile, correctionsReader, outputReadsFile, false, outFormat );
 
     fclose( reads );
+    if ( compressedReads )
+        fclose( compressedReads );
     delete readsFile;
     cout << "Done" << endl;
     return 0;
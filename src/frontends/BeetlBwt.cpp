@@ -19,6 +19,7 @@
 #include "parameters/BwtParameters.hh"
 #include "config.h"
 #include "libzoo/cli/Common.hh"
+#include "libzoo/io/PrefetchingIFStream.hh"
 #include "libzoo/util/Logger.hh"
 
 #include <algorithm>
@@ -456,6 +457,7 @@ ResourceEstimate estimateResourcesFor( BwtParameters &paramValues )
                     break;
                 case INPUT_FORMAT_CYC:
                 case INPUT_FORMAT_BCL:
+                case INPUT_FORMAT_RUNFOLDER:
                     break;
             }
 
@@ -510,6 +512,7 @@ ResourceEstimate estimateResourcesFor( BwtParameters &paramValues )
             {
                 case INPUT_FORMAT_CYC:
                 case INPUT_FORMAT_BCL:
+                case INPUT_FORMAT_RUNFOLDER:
                     dataRead += static_cast<uint64_t>( nReads * datasetMetadata.nCycles );
                     dataWritten += static_cast<uint64_t>( nReads * datasetMetadata.nCycles );
                     break;
@@ -602,9 +605,15 @@ void printUsage()
 //    cout << "    multiRLE : run-length-encoded using an incremental strategy with multiple files" << endl;
     cout << "    SAP      : implicit permutation to obtain more compressible BWT" << endl;
     cout << "    LCP      : length of Longest Common Prefix shared between a BWT letter and the next one. Stored using 4 bytes per BWT letter in files with -Lxx suffix." << endl;
-    cout << "               (Note: forces algorithm=bcr, non-parallel and intermediate-format=ascii)" << endl;
-    cout << "               (++++ Sorry, for computing the LCP array, you must set BUILD_LCP to 1 in src/shared/Tools.hh and compile again! ++++)" << endl;   
+    cout << "               (Note: forces algorithm=bcr and intermediate-format=ascii. Intermediate LCP files use about 1 byte per letter)" << endl;
     cout << "    PBE      : prediction-based encoding" << endl;
+    cout << "    SA       : with --sa-sampling-rate=k, the (sequence number, offset) of every k-th position of each sequence is stored in a -sa file," << endl;
+    cout << "               using 16/k bytes per base. beetl-search --random-access --locate then needs at most k-1 LF steps per occurrence." << endl;
+    cout << "    runFolder: Illumina run folder. The pass-filter reads of all its lanes and tiles are read cycle by cycle from the (possibly gzipped) BCL files, without transposition." << endl;
+    cout << "    Compressed input: fasta/fastq/seq files may be gzip, BGZF or zstd-compressed (.gz, .bgz, .zst). BGZF blocks and zstd frames recording their size (e.g. from pzstd)" << endl;
+    cout << "               are decompressed in parallel. zstd needs a build where configure found the zstd library." << endl;
+    cout << "    Append   : the input sequences are inserted into an existing BWT, keeping its sequence numbers and appending theirs." << endl;
+    cout << "               Its -end-pos and .idx files are updated if present. --qualities=permute needs its -Q0? files." << endl;
 #ifndef _OPENMP
     cout << endl;
     cout << "Warning:" << endl;
@@ -690,22 +699,88 @@ int main( const int argc, const char **argv )
         }
     }
 
+    // Special case of appending to an existing BWT
+    if ( params["append to"].isSet() )
+    {
+        if ( params["add reverse complement"] == 1
+             || params["sub-sequence length"].isSet()
+             || params["paired-reads input"] == "all1all2"
+             || params["SAP ordering"] == 1
+             || params["generate LCP"] == 1
+           )
+        {
+            cerr << "Error: --append-to cannot be combined with --add-rev-comp, --sub-sequence-length, --paired-reads-input, --sap-ordering or --generate-lcp" << endl;
+            exit( -1 );
+        }
+        if ( !params["algorithm"].isSet() || strcasecmp( params["algorithm"].userValue.c_str(), "bcr" ) != 0 )
+        {
+            clog << "Warning: Forcing algorithm=bcr for --append-to" << endl;
+            params["algorithm"] = "bcr";
+        }
+
+        // The existing end-pos file, if any, is extended with the new sequences
+        const string existingEndPosFilename = params.getStringValue( "append to" ) + "-end-pos";
+        if ( readWriteCheck( existingEndPosFilename.c_str(), false, false ) )
+        {
+            params["generate endPosFile"] = 1;
+        }
+        else if ( params["generate endPosFile"] == 1 )
+        {
+            cerr << "Error: --generate-end-pos-file needs " << existingEndPosFilename << " when appending" << endl;
+            exit( -1 );
+        }
+    }
+
+    // Special case of sampled suffix array generation
+    if ( params["SA sampling rate"].isSet() )
+    {
+        if ( params["SA sampling rate"] <= 0 )
+        {
+            cerr << "Error: --sa-sampling-rate must be positive" << endl;
+            exit( -1 );
+        }
+        if ( params["output format"] == OUTPUT_FORMAT_HUFFMAN )
+        {
+            cerr << "Error: --sa-sampling-rate needs ASCII or RLE output" << endl;
+            exit( -1 );
+        }
+        if ( !params["algorithm"].isSet() || strcasecmp( params["algorithm"].userValue.c_str(), "bcr" ) != 0 )
+        {
+            clog << "Warning: Forcing algorithm=bcr for --sa-sampling-rate" << endl;
+            params["algorithm"] = "bcr";
+        }
+        // Sampled positions are numbered through the end-pos file, as pile 0 isn't
+        // in input order with --sap-ordering or --add-rev-comp (which --append-to
+        // excludes, its end-pos file being set up above)
+        if ( !params["append to"].isSet() )
+        {
+            params["generate endPosFile"] = 1;
+        }
+    }
+
     // Switches only available with the BCR algorithm
     if ( params["reverse"] == 1
          || params["pause between cycles"] == 1
          || params["process qualities"] == "permute"
          || params["add reverse complement"] == 1
+         || params["input format"] == INPUT_FORMAT_RUNFOLDER
        )
     {
         if ( !params["algorithm"].isSet() || strcasecmp( params["algorithm"].userValue.c_str(), "bcr" ) != 0 )
         {
-            clog << "Warning: Forcing algorithm=bcr for --reverse/--pause-between-cycle/--qualities=permute/--add-rev-comp" << endl;
+            clog << "Warning: Forcing algorithm=bcr for --reverse/--pause-between-cycle/--qualities=permute/--add-rev-comp/--input-format=runFolder" << endl;
             params["algorithm"] = "bcr";
         }
     }
 
     // Use default parameter values where needed
     params.commitDefaultValues();
+    if ( params["read block size KB"] < 1 )
+    {
+        cerr << "Error: --read-block-size must be at least 1 KB" << endl;
+        exit( -1 );
+    }
+    PrefetchingIFStream::setBlockSize( ( size_t )params.getValue( "read block size KB" ) * 1024 );
 
     datasetMetadata.init( params["input filename"], params["input format"] );
     // TODO: hardwareConstraints.init( params["HardwareConstraints"] );
@@ -0,0 +1,153 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "BeetlCache.hh"
+
+#include "BwtReader.hh"
+#include "Tools.hh"
+#include "config.h"
+#include "parameters/CacheParameters.hh"
+#include "libzoo/cli/Common.hh"
+#include "libzoo/io/PileCache.hh"
+#include "libzoo/util/Logger.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <unistd.h>
+
+using namespace std;
+using namespace BeetlCacheParameters;
+
+
+CacheParameters params;
+
+void printUsage()
+{
+    cout << "Usage: beetl-cache {load|unload|status} <prefix> [--use-shm=<directory>]" << endl;
+    cout << endl;
+    params.printUsage();
+
+    cout << "Notes:" << endl;
+    cout << "    load copies the BWT piles {prefix}-B0x into the shared memory directory given by --use-shm (default: /dev/shm)." << endl;
+    cout << "    Any tool run with the same --use-shm value then maps these copies instead of reading the piles," << endl;
+    cout << "    so that all the concurrent processes share a single copy in RAM." << endl;
+    cout << "    With .idx files (see beetl-index), the index gets loaded into the shared memory directory too." << endl;
+    cout << "    Copies of piles modified since they were loaded are ignored. unload removes the copies." << endl;
+    cout << endl;
+}
+
+// Shared memory files created by BwtReaderIndex::initIndex
+void unloadIndex( const string &shmDirectory, const string &pileName )
+{
+    string pileNameWithoutSlash = pileName;
+    replace( pileNameWithoutSlash.begin(), pileNameWithoutSlash.end(), '/', '_' );
+    const string prefixes[] = { "/BeetlIndexPosFile_", "/BeetlIndexCount_", "/BeetlIndexPosBwt_" };
+    for ( unsigned int i = 0; i < sizeof( prefixes ) / sizeof( prefixes[0] ); ++i )
+        unlink( ( shmDirectory + prefixes[i] + pileNameWithoutSlash ).c_str() );
+}
+
+void launchBeetlCache()
+{
+    const string bwtPrefix = params.getStringValue( "input" );
+    const string shmDirectory = params.getStringValue( "use shm" );
+    const PileCache cache( shmDirectory );
+
+    vector<string> pileNames;
+    bool compressed;
+    string availableFileLetters;
+    detectInputBwtProperties( bwtPrefix, pileNames, compressed, availableFileLetters );
+    if ( pileNames.empty() )
+    {
+        cerr << "Did not find any BWT files matching prefix " << bwtPrefix << "." << endl;
+        exit( EXIT_FAILURE );
+    }
+
+    bool success = true;
+    for ( unsigned int i = 0; i < pileNames.size(); ++i )
+    {
+        const string &pileName = pileNames[i];
+        switch ( params["action"] )
+        {
+            case ACTION_LOAD:
+                if ( !cache.load( pileName ) )
+                {
+                    success = false;
+                    break;
+                }
+                if ( readWriteCheck( ( pileName + ".idx" ).c_str(), false, false ) )
+                {
+                    // Builds the index vectors in shared memory, unless they are already there
+                    unique_ptr<BwtReaderBase> reader( instantiateBwtPileReader( pileName, shmDirectory ) );
+                }
+                break;
+
+            case ACTION_UNLOAD:
+                if ( cache.unload( pileName ) )
+                    Logger::out() << "Removed " << cache.cachedFilename( pileName ) << endl;
+                unloadIndex( shmDirectory, pileName );
+                break;
+
+            case ACTION_STATUS:
+                cout << pileName << ": " << ( cache.isLoaded( pileName ) ? "cached as " + cache.cachedFilename( pileName ) : "not cached" ) << endl;
+                break;
+        }
+    }
+
+    if ( !success )
+        exit( EXIT_FAILURE );
+}
+
+int main( const int argc, const char **argv )
+{
+    // Generated using: http://patorjk.com/software/taag/#p=display&f=Soft&t=BEETL%20cache
+    cout << ",-----.  ,------.,------.,--------.,--.                              ,--.              " << endl;
+    cout << "|  |) /_ |  .---'|  .---''--.  .--'|  |        ,---.  ,--,--.  ,---. |  ,---.   ,---.  " << endl;
+    cout << "|  .-.  \\|  `--, |  `--,    |  |   |  |       | .--' ' ,-.  | | .--' |  .-.  | | .-. : " << endl;
+    cout << "|  '--' /|  `---.|  `---.   |  |   |  '--.    \\ `--. \\ '-'  | \\ `--. |  | |  | \\   --. " << endl;
+    cout << "`------' `------'`------'   `--'   `-----'     `---'  `--`--'  `---' `--' `--'  `----' " << endl;
+    cout << "Version " << PACKAGE_VERSION << endl;
+    cout << endl;
+
+    cout << "Command called:" << endl << "   ";
+    for ( int i = 0; i < argc; ++i )
+    {
+        cout << " " << argv[i];
+    }
+    cout << "\n" << endl;
+
+    // Action and prefix may be given as leading plain arguments
+    vector<string> args( argv, argv + argc );
+    const char *positionalOptions[] = { "--action", "--input" };
+    for ( unsigned int i = 0; i < 2 && 1 + 2 * i < args.size() && args[1 + 2 * i][0] != '-'; ++i )
+        args.insert( args.begin() + 1 + 2 * i, positionalOptions[i] );
+    vector<const char *> argvWithOptions;
+    for ( unsigned int i = 0; i < args.size(); ++i )
+        argvWithOptions.push_back( args[i].c_str() );
+
+    if ( !params.parseArgv( argvWithOptions.size(), argvWithOptions.data() ) || params["help"] == 1 || !params.chechRequiredParameters() )
+    {
+        printUsage();
+        exit( params["help"] == 0 );
+    }
+
+    // Use default parameter values where needed
+    params.commitDefaultValues();
+    if ( !params["use shm"].isSet() )
+        params["use shm"] = string( "/dev/shm" );
+
+    // Launch
+    launchBeetlCache();
+
+    return 0;
+}
@@ -17,6 +17,7 @@
 #include "countWords/CountWords.hh"
 #include "parameters/CompareParameters.hh"
 #include "libzoo/cli/Common.hh"
+#include "libzoo/io/PrefetchingIFStream.hh"
 #include "libzoo/util/Logger.hh"
 #include "libzoo/util/TemporaryFilesManager.hh"
 
@@ -119,6 +120,12 @@ void launchBeetlCompare()
 
     // Use default parameter values where needed
     params.commitDefaultValues();
+    if ( params["read block size KB"] < 1 )
+    {
+        cerr << "Error: --read-block-size must be at least 1 KB" << endl;
+        exit( 1 );
+    }
+    PrefetchingIFStream::setBlockSize( ( size_t )params.getValue( "read block size KB" ) * 1024 );
 
     // Update variable with optinal user values
     setA_isBwtCompressed = ( params["inputA format"] == INPUT_FORMAT_BWT_RLE );
@@ -88,6 +88,18 @@ void skipLineInMissingDataFile( ifstream &missingDataFile )
     }
 }
 
+// Transposes a sequence file into cycle files.
+// Uncompressed input files are memory-mapped, the others are streamed.
+void convertToCycFiles( const string &inputFilename, const string &outputPrefix )
+{
+    TransposeFasta trasp;
+    unique_ptr<SeqReaderBase> pReader( SeqReaderMmap::open( inputFilename ) );
+    if ( !pReader )
+        pReader.reset( SeqReaderFile::getReader( fopen( inputFilename.c_str(), "rb" ) ) );
+    trasp.init( pReader.get() );
+    trasp.convert( outputPrefix, false );
+}
+
 void launchBeetlConvert()
 {
     cout << "Conversion from " << params.getStringValue( "input format" ) << " to " << params.getStringValue( "output format" ) << " (" << params.getStringValue( "input filename" ) << " -> " << params.getStringValue( "output filename" ) << ")" << endl;
@@ -120,7 +132,8 @@ void launchBeetlConvert()
         else if ( params["output format"] == OUTPUT_FORMAT_SEQ )
         {
             // FASTA -> SEQ
-            ifstream inputStream( params.getStringValue( "input filename" ).c_str() );
+            shared_ptr<istream> inputStreamPtr = openInputFileOrDashAsCin( params.getStringValue( "input filename" ) );
+            istream &inputStream( *inputStreamPtr );
             ofstream outputStream( params.getStringValue( "output filename" ).c_str() );
             string str1, str2;
             while ( getline( inputStream, str1 ) &&
@@ -134,10 +147,7 @@ void launchBeetlConvert()
         else if ( params["output format"] == OUTPUT_FORMAT_CYC )
         {
             // FASTA -> CYC
-            unique_ptr<SeqReaderFile> pReader( SeqReaderFile::getReader( fopen( params.getStringValue( "input filename" ).c_str(), "rb" ) ) );
-            TransposeFasta trasp;
-            trasp.init( pReader.get() );
-            trasp.convert( params.getStringValue( "output filename" ), false );
+            convertToCycFiles( params.getStringValue( "input filename" ), params.getStringValue( "output filename" ) );
             return;
         }
         else if ( params["output format"] == OUTPUT_FORMAT_BWT_ASCII || params["output format"] == OUTPUT_FORMAT_BWT_RLE )
@@ -152,7 +162,8 @@ void launchBeetlConvert()
         if ( params["output format"] == OUTPUT_FORMAT_FASTA )
         {
             // FASTQ -> FASTA
-            ifstream inputStream( params.getStringValue( "input filename" ).c_str() );
+            shared_ptr<istream> inputStreamPtr = openInputFileOrDashAsCin( params.getStringValue( "input filename" ) );
+            istream &inputStream( *inputStreamPtr );
             ofstream outputStream( params.getStringValue( "output filename" ).c_str() );
             string str1, str2, str3, str4;
             while ( getline( inputStream, str1 ) &&
@@ -169,7 +180,8 @@ void launchBeetlConvert()
         else if ( params["output format"] == OUTPUT_FORMAT_SEQ )
         {
             // FASTQ -> SEQ
-            ifstream inputStream( params.getStringValue( "input filename" ).c_str() );
+            shared_ptr<istream> inputStreamPtr = openInputFileOrDashAsCin( params.getStringValue( "input filename" ) );
+            istream &inputStream( *inputStreamPtr );
             ofstream outputStream( params.getStringValue( "output filename" ).c_str() );
             string str1, str2, str3, str4;
             while ( getline( inputStream, str1 ) &&
@@ -185,10 +197,7 @@ void launchBeetlConvert()
         else if ( params["output format"] == OUTPUT_FORMAT_CYC )
         {
             // FASTQ -> CYC
-            unique_ptr<SeqReaderFile> pReader( SeqReaderFile::getReader( fopen( params.getStringValue( "input filename" ).c_str(), "rb" ) ) );
-            TransposeFasta trasp;
-            trasp.init( pReader.get() );
-            trasp.convert( params.getStringValue( "output filename" ), false );
+            convertToCycFiles( params.getStringValue( "input filename" ), params.getStringValue( "output filename" ) );
             return;
         }
         else if ( params["output format"] == OUTPUT_FORMAT_BWT_ASCII || params["output format"] == OUTPUT_FORMAT_BWT_RLE )
@@ -249,7 +258,8 @@ void launchBeetlConvert()
         if ( params["output format"] == OUTPUT_FORMAT_FASTA )
         {
             // SEQ -> FASTA
-            ifstream inputStream( params.getStringValue( "input filename" ).c_str() );
+            shared_ptr<istream> inputStreamPtr = openInputFileOrDashAsCin( params.getStringValue( "input filename" ) );
+            istream &inputStream( *inputStreamPtr );
             ofstream outputStream( params.getStringValue( "output filename" ).c_str() );
             int seqNum = 0;
             string str;
@@ -274,7 +284,8 @@ void launchBeetlConvert()
                 cerr << "Error: seq->fastq needs extra qualities (see --use-missing-data-from)" << endl;
                 exit( 2 );
             }
-            ifstream inputStream( params.getStringValue( "input filename" ).c_str() );
+            shared_ptr<istream> inputStreamPtr = openInputFileOrDashAsCin( params.getStringValue( "input filename" ) );
+            istream &inputStream( *inputStreamPtr );
             ofstream outputStream( params.getStringValue( "output filename" ).c_str() );
             int seqNum = 0;
             string str;
@@ -20,6 +20,7 @@
 #include "config.h"
 #include "libzoo/cli/Common.hh"
 #include "libzoo/util/Logger.hh"
+#include "libzoo/util/TemporaryFilesManager.hh"
 #include "errors/WitnessReader.hh"
 #include "errors/HiTECStats.hh"
 #include "errors/BwtCorrectorParameters.hh"
@@ -57,6 +58,13 @@ int main( const int argc, const char **argv )
     // Use default parameter values where needed
     params.commitDefaultValues();
 
+    // Auto-detection of missing arguments
+    if ( !params["memory limit MB"].isSet() )
+    {
+        params["memory limit MB"] = detectMemoryLimitInMB();
+    }
+    TemporaryFilesManager::get().setRamLimit( params["memory limit MB"] );
+
     string indexPrefix = params.getStringValue( "input filename" );
 
     int readLength = params.getValue( "read length" );
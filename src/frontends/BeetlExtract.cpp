@@ -0,0 +1,329 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "BeetlExtract.hh"
+
+#include "BwtRankIndex.hh"
+#include "EndPosFile.hh"
+#include "Tools.hh"
+#include "config.h"
+#include "parameters/ExtractParameters.hh"
+#include "libzoo/cli/Common.hh"
+#include "libzoo/util/Logger.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace BeetlExtractParameters;
+
+
+ExtractParameters params;
+
+void printUsage()
+{
+    params.printUsage();
+
+    cout << "Notes:" << endl;
+    cout << "    At least one of --seq-num and --seq-num-file is required." << endl;
+    cout << "    Sequences are numbered in input order, using {input}-end-pos (see beetl-bwt --generate-end-pos-file)." << endl;
+    cout << "    Without it, they are numbered in the order of pile 0, which is only the input order for BWTs built" << endl;
+    cout << "    without --sap-ordering or --add-rev-comp." << endl;
+    cout << "    Fastq output requires {input}-Q0x quality files to be present." << endl;
+    cout << "    With .idx files (see beetl-index), only the index points get loaded: no pass over the BWT is needed." << endl;
+    cout << endl;
+}
+
+void addSequenceNumbers( const string &list, const char separator, vector<SequenceNumber> &seqNums )
+{
+    istringstream iss( list );
+    string item;
+    while ( getline( iss, item, separator ) )
+    {
+        if ( item.find_first_not_of( " \t\r" ) == string::npos )
+            continue;
+        char *end;
+        const unsigned long long seqNum = strtoull( item.c_str(), &end, 10 );
+        if ( *end != '\0' && string( end ).find_first_not_of( " \t\r" ) != string::npos )
+        {
+            cerr << "Error: Invalid sequence number \"" << item << "\"" << endl;
+            exit( EXIT_FAILURE );
+        }
+        seqNums.push_back( static_cast<SequenceNumber>( seqNum ) );
+    }
+}
+
+// Finds the dollar number of the requested sequences in one pass over an
+// end-pos file, for the ones whose numbers differ in pile 0 (e.g. with
+// --sap-ordering). Sequences are numbered as EndPosFile does.
+void findDollarNums( const string &endPosFilename, const vector<SequenceNumber> &seqNums, vector<LetterNumber> &dollarNums )
+{
+    FILE *endPosFile = fopen( endPosFilename.c_str(), "rb" );
+    if ( endPosFile == NULL )
+    {
+        cerr << "Error: Cannot open " << endPosFilename << endl;
+        exit( EXIT_FAILURE );
+    }
+    SequenceNumber sequenceGroupCount = 0;
+    uint8_t sequenceCountInGroup = 0;
+    uint8_t hasRevComp = 0;
+    if ( fread( &sequenceGroupCount, sizeof( SequenceNumber ), 1, endPosFile ) != 1
+         || fread( &sequenceCountInGroup, sizeof( uint8_t ), 1, endPosFile ) != 1
+         || fread( &hasRevComp, sizeof( uint8_t ), 1, endPosFile ) != 1 )
+    {
+        cerr << "Error: Cannot read " << endPosFilename << endl;
+        exit( EXIT_FAILURE );
+    }
+
+    vector< pair<SequenceNumber, unsigned int> > requests;
+    for ( unsigned int i = 0; i < seqNums.size(); ++i )
+        requests.push_back( make_pair( seqNums[i], i ) );
+    sort( requests.begin(), requests.end() );
+    dollarNums.assign( seqNums.size(), maxLetterNumber );
+
+    unsigned int foundCount = 0;
+    for ( LetterNumber dollarNum = 0; foundCount < seqNums.size(); ++dollarNum )
+    {
+        SequenceNumber sequenceGroupNum;
+        uint8_t positionInGroup;
+        if ( fread( &sequenceGroupNum, sizeof( SequenceNumber ), 1, endPosFile ) != 1
+             || fread( &positionInGroup, sizeof( uint8_t ), 1, endPosFile ) != 1 )
+            break;
+        const SequenceNumber seqNum = sequenceGroupNum + positionInGroup * sequenceGroupCount;
+        vector< pair<SequenceNumber, unsigned int> >::const_iterator it = lower_bound( requests.begin(), requests.end(), make_pair( seqNum, 0u ) );
+        for ( ; it != requests.end() && it->first == seqNum; ++it )
+        {
+            dollarNums[it->second] = dollarNum;
+            ++foundCount;
+        }
+    }
+    fclose( endPosFile );
+
+    for ( unsigned int i = 0; i < seqNums.size(); ++i )
+    {
+        if ( dollarNums[i] == maxLetterNumber )
+        {
+            cerr << "Error: Sequence number " << seqNums[i] << " not found in " << endPosFilename << endl;
+            exit( EXIT_FAILURE );
+        }
+    }
+}
+
+// Decodes the sequence at position pile0Pos of pile 0, with its quality scores if qualFds isn't empty
+void extractSequence( const RankIndexedBwt &bwt, const vector<int> &qualFds, const SequenceNumber pile0Pos,
+                      string &sequence, string &quality, LetterNumber &dollarNum )
+{
+    if ( qualFds.empty() )
+    {
+        sequence = bwt.extractSequence( pile0Pos, NULL, &dollarNum );
+        return;
+    }
+
+    vector< pair<int, LetterNumber> > positions;
+    sequence = bwt.extractSequence( pile0Pos, &positions, &dollarNum );
+    quality.resize( positions.size() );
+    for ( unsigned int j = 0; j < positions.size(); ++j )
+    {
+        if ( pread( qualFds[positions[j].first], &quality[j], 1, positions[j].second ) != 1 )
+        {
+            #pragma omp critical (IO)
+            cerr << "Error: Cannot read quality score at position " << positions[j].second << " of pile " << positions[j].first << endl;
+            exit( EXIT_FAILURE );
+        }
+    }
+}
+
+void launchBeetlExtract()
+{
+    const string bwtPrefix = params.getStringValue( "input" );
+    const bool outputIsFastq = ( params["output format"] == OUTPUT_FORMAT_FASTQ );
+
+    vector<SequenceNumber> seqNums;
+    if ( params["sequence numbers"].isSet() )
+        addSequenceNumbers( params.getStringValue( "sequence numbers" ), ',', seqNums );
+    if ( params["sequence numbers file"].isSet() )
+    {
+        ifstream seqNumFile( params.getStringValue( "sequence numbers file" ).c_str() );
+        if ( !seqNumFile.good() )
+        {
+            cerr << "Error: Cannot open " << params.getStringValue( "sequence numbers file" ) << endl;
+            exit( EXIT_FAILURE );
+        }
+        stringstream buffer;
+        buffer << seqNumFile.rdbuf();
+        addSequenceNumbers( buffer.str(), '\n', seqNums );
+    }
+    if ( seqNums.empty() )
+    {
+        cerr << "Error: No sequence number to extract" << endl;
+        printUsage();
+        exit( EXIT_FAILURE );
+    }
+
+    vector<string> pileNames;
+    bool compressed;
+    string availableFileLetters;
+    detectInputBwtProperties( bwtPrefix, pileNames, compressed, availableFileLetters );
+    if ( pileNames.empty() )
+    {
+        cerr << "Did not find any BWT files matching prefix " << bwtPrefix << "." << endl;
+        exit( EXIT_FAILURE );
+    }
+    bool allPilesIndexed = true;
+    for ( unsigned int i = 0; i < pileNames.size(); ++i )
+        allPilesIndexed &= readWriteCheck( ( pileNames[i] + ".idx" ).c_str(), false, false );
+    if ( !allPilesIndexed )
+        Logger::out() << "Warning: Some piles have no .idx file: their whole BWT gets sampled first. Run beetl-index to make this faster." << endl;
+
+    RankIndexedBwt bwt( bwtPrefix, defaultRankIndexSamplingRate, allPilesIndexed );
+    const SequenceNumber seqCount = bwt.pile( 0 ).size();
+    for ( unsigned int i = 0; i < seqNums.size(); ++i )
+    {
+        if ( seqNums[i] >= seqCount )
+        {
+            cerr << "Error: Sequence number " << seqNums[i] << " out of range: the BWT contains " << seqCount << " sequences" << endl;
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    // Quality scores are read one by one, at the positions of the decoded letters
+    vector<int> qualFds;
+    if ( outputIsFastq )
+    {
+        for ( int pileNum = 0; pileNum < alphabetSize; ++pileNum )
+        {
+            ostringstream qualFilename;
+            qualFilename << bwtPrefix << "-Q0" << pileNum;
+            qualFds.push_back( open( qualFilename.str().c_str(), O_RDONLY ) );
+            if ( qualFds.back() < 0 )
+            {
+                cerr << "Error: Cannot open " << qualFilename.str() << endl;
+                exit( EXIT_FAILURE );
+            }
+        }
+    }
+
+    // Sequences are first decoded from the pile 0 position matching their number,
+    // which usually is their position in the input
+    vector<string> sequences( seqNums.size() );
+    vector<string> qualities( seqNums.size() );
+    vector<LetterNumber> dollarNums( seqNums.size() );
+    #pragma omp parallel for schedule(dynamic)
+    for ( unsigned int i = 0; i < seqNums.size(); ++i )
+        extractSequence( bwt, qualFds, seqNums[i], sequences[i], qualities[i], dollarNums[i] );
+
+    // The end-pos file tells which sequence each decoded one really is: only the
+    // records of the requested dollar numbers get read
+    const string endPosFilename = bwtPrefix + "-end-pos";
+    if ( readWriteCheck( endPosFilename.c_str(), false, false ) )
+    {
+        EndPosFile endPosFile( bwtPrefix );
+        vector<SequenceNumber> misplacedSeqNums;
+        vector<unsigned int> misplacedIndices;
+        for ( unsigned int i = 0; i < seqNums.size(); ++i )
+        {
+            if ( endPosFile.convertDollarNumToSequenceNum( dollarNums[i] ) != seqNums[i] )
+            {
+                misplacedSeqNums.push_back( seqNums[i] );
+                misplacedIndices.push_back( i );
+            }
+        }
+
+        // Otherwise (e.g. --sap-ordering), each remaining sequence is decoded
+        // forwards from its '$' sign to find its position in pile 0
+        if ( !misplacedSeqNums.empty() )
+        {
+            Logger::out() << "Pile 0 isn't in input order: locating " << misplacedSeqNums.size() << " sequences" << endl;
+            vector<LetterNumber> misplacedDollarNums;
+            findDollarNums( endPosFilename, misplacedSeqNums, misplacedDollarNums );
+            #pragma omp parallel for schedule(dynamic)
+            for ( unsigned int k = 0; k < misplacedIndices.size(); ++k )
+            {
+                const unsigned int i = misplacedIndices[k];
+                extractSequence( bwt, qualFds, bwt.findPile0Position( misplacedDollarNums[k] ), sequences[i], qualities[i], dollarNums[i] );
+            }
+        }
+    }
+    else
+        Logger::out() << "Warning: " << endPosFilename << " not found: sequences are numbered in the order of pile 0, which only matches the input order for BWTs built without --sap-ordering or --add-rev-comp" << endl;
+
+    for ( unsigned int i = 0; i < qualFds.size(); ++i )
+        close( qualFds[i] );
+
+    ofstream outFile( params.getStringValue( "output filename" ).c_str() );
+    if ( !outFile.good() )
+    {
+        cerr << "Error: Cannot open " << params.getStringValue( "output filename" ) << " for writing" << endl;
+        exit( EXIT_FAILURE );
+    }
+    for ( unsigned int i = 0; i < seqNums.size(); ++i )
+    {
+        if ( outputIsFastq )
+            outFile << "@Read" << seqNums[i] << '\n' << sequences[i] << "\n+\n" << qualities[i] << '\n';
+        else
+            outFile << "> Read " << seqNums[i] << '\n' << sequences[i] << '\n';
+    }
+    Logger::out() << "Extracted " << seqNums.size() << " sequences" << endl;
+}
+
+int main( const int argc, const char **argv )
+{
+    // Generated using: http://patorjk.com/software/taag/#p=display&f=Soft&t=BEETL%20extract
+    cout << ",-----.  ,------.,------.,--------.,--.                    ,--.                        ,--.   " << endl;
+    cout << "|  |) /_ |  .---'|  .---''--.  .--'|  |       ,---. ,--.  ,--.,-'  '-.,--.--. ,--,--. ,---.,-'  '-. " << endl;
+    cout << "|  .-.  \\|  `--, |  `--,    |  |   |  |      | .-. : \\  `'  / '-.  .-'|  .--'' ,-.  || .--''-.  .-' " << endl;
+    cout << "|  '--' /|  `---.|  `---.   |  |   |  '--.   \\   --. /  /.  \\   |  |  |  |   \\ '-'  |\\ `--.  |  |   " << endl;
+    cout << "`------' `------'`------'   `--'   `-----'    `----''--'  '--'  `--'  `--'    `--`--' `---'  `--'   " << endl;
+    cout << "Version " << PACKAGE_VERSION << endl;
+    cout << endl;
+
+    cout << "Command called:" << endl << "   ";
+    for ( int i = 0; i < argc; ++i )
+    {
+        cout << " " << argv[i];
+    }
+    cout << "\n" << endl;
+
+    if ( !params.parseArgv( argc, argv ) || params["help"] == 1 || !params.chechRequiredParameters() )
+    {
+        printUsage();
+        exit( params["help"] == 0 );
+    }
+
+    // Use default parameter values where needed
+    params.commitDefaultValues();
+
+    // Auto-detection of missing arguments
+    if ( !params["output format"].isSet() )
+    {
+        const string &filename = params["output filename"];
+        string fileFormat = detectFileFormat( filename );
+        if ( fileFormat.empty() )
+        {
+            cerr << "Error: file format not recognised for " << filename << endl;
+            exit( -1 );
+        }
+        params["output format"] = fileFormat;
+    }
+    checkFileFormat( params["output filename"], params["output format"] );
+
+    // Launch
+    launchBeetlExtract();
+
+    return 0;
+}
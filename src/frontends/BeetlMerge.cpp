@@ -0,0 +1,95 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "BeetlMerge.hh"
+
+#include "BwtMerger.hh"
+#include "config.h"
+#include "parameters/MergeParameters.hh"
+#include "libzoo/cli/Common.hh"
+#include "libzoo/util/Logger.hh"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+using namespace BeetlMergeParameters;
+
+
+MergeParameters params;
+
+void printUsage()
+{
+    params.printUsage();
+
+    cout << "Notes:" << endl;
+    cout << "    The merged BWT contains the sequences of Set A followed by the sequences of Set B," << endl;
+    cout << "    i.e. the same BWT as building Set A and Set B's sequences together." << endl;
+    cout << "    Sets built with sub-sequences or reverse-complements are not supported." << endl;
+    cout << endl;
+}
+
+void launchBeetlMerge()
+{
+    BwtMerger merger( params.getStringValue( "inputA" ), params.getStringValue( "inputB" ), params.getStringValue( "output" ),
+                      params["output format"] == OUTPUT_FORMAT_ASCII );
+
+    if ( params["merge end-pos"].isSet() )
+        merger.mergeEndPosFiles();
+
+    if ( params["merge C files"].isSet() )
+    {
+        const int fileNumOffset = params["C file offset"];
+        if ( fileNumOffset < 0 )
+        {
+            cerr << "Error: C file offset must be positive" << endl;
+            exit( EXIT_FAILURE );
+        }
+        merger.mergeCFiles( true, fileNumOffset );
+    }
+
+    merger.run();
+}
+
+int main( const int argc, const char **argv )
+{
+    // Generated using: http://patorjk.com/software/taag/#p=display&f=Soft&t=BEETL%20merge
+    cout << ",-----.  ,------.,------.,--------.,--.                                             " << endl;
+    cout << "|  |) /_ |  .---'|  .---''--.  .--'|  |       ,--,--,--. ,---. ,--.--. ,---.  ,---. " << endl;
+    cout << "|  .-.  \\|  `--, |  `--,    |  |   |  |       |        || .-. :|  .--'| .-. || .-. :" << endl;
+    cout << "|  '--' /|  `---.|  `---.   |  |   |  '--.    |  |  |  |\\   --.|  |   ' '-' '\\   --." << endl;
+    cout << "`------' `------'`------'   `--'   `-----'    `--`--`--' `----'`--'   .`-  /  `----'" << endl;
+    cout << "                                                                      `---'         " << endl;
+    cout << "Version " << PACKAGE_VERSION << endl;
+    cout << endl;
+
+    cout << "Command called:" << endl << "   ";
+    for ( int i = 0; i < argc; ++i )
+    {
+        cout << " " << argv[i];
+    }
+    cout << "\n" << endl;
+
+    if ( !params.parseArgv( argc, argv ) || params["help"] == 1 || !params.chechRequiredParameters() )
+    {
+        printUsage();
+        exit( params["help"] == 0 );
+    }
+
+    // Use default parameter values where needed
+    params.commitDefaultValues();
+
+    // Launch
+    launchBeetlMerge();
+
+    return 0;
+}
@@ -13,6 +13,7 @@
 #include "BeetlSearch.hh"
 
 #include "config.h"
+#include "search/SearchServer.hh"
 #include "search/SearchUsingBacktracker.hh"
 #include "parameters/SearchParameters.hh"
 
@@ -24,14 +25,22 @@ void printUsage()
     params.printUsage();
 
     cout << "Notes:" << endl;
-    cout << "    -j and -k are mutually exclusive, one of them being required.\n" << endl;
+    cout << "    -j and -k are mutually exclusive, one of them being required (except with --serve).\n" << endl;
     cout << endl;
 }
 
 void launchBeetlSearch()
 {
-    SearchUsingBacktracker search( params );
-    search.run();
+    if ( params["serve"].isSet() )
+    {
+        SearchServer server( params );
+        server.run();
+    }
+    else
+    {
+        SearchUsingBacktracker search( params );
+        search.run();
+    }
 }
 
 int main( const int argc, const char **argv )
@@ -58,11 +67,17 @@ int main( const int argc, const char **argv )
         exit( params["help"] == 0 );
     }
 
+    if ( params["locate"] == 1 && params["random access"] != 1 )
+    {
+        clog << "Warning: Forcing --random-access for --locate" << endl;
+        params["random access"] = 1;
+    }
+
     // Use default parameter values where needed
     params.commitDefaultValues();
 
     // Checking for required parameters
-    if ( ! ( params["kmers input file"].isSet() ^ params["one kmer string"].isSet() ) )
+    if ( !params["serve"].isSet() && ! ( params["kmers input file"].isSet() ^ params["one kmer string"].isSet() ) )
     {
         cerr << "Error: Missing or incorrect arguments: -i is required; -j and -k are mutually exclusive, one of them being required\n" << endl;
         printUsage();
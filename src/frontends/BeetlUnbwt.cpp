@@ -50,7 +50,7 @@ void printUsage()
     params.printUsage();
 
     cout << "Notes:" << endl;
-    cout << "    Input must be a set of ASCII-encoded BWT files (not run-length-encoded)" << endl;
+    cout << "    Input must be a set of ASCII-encoded BWT files, or run-length-encoded ones with --decode-method=rank-index (default)" << endl;
     cout << "    Fastq output requires {input}-Q0x quality files to be present" << endl;
     cout << endl;
 }
@@ -113,8 +113,12 @@ int main( const int argc, const char **argv )
 
         if ( isBwtCompressed )
         {
-            cerr << "Error: BWT files don't seem to be in ASCII format (they probably got created as run-length-encoded)" << endl;
-            exit( -1 );
+            if ( params["decode method"] != DECODE_METHOD_RANK_INDEX || params["decode direction"] != DECODE_DIRECTION_BACKWARD )
+            {
+                cerr << "Error: BWT files don't seem to be in ASCII format (they probably got created as run-length-encoded)" << endl;
+                exit( -1 );
+            }
+            params["input format"] = "BWT_RLE";
         }
         else
         {
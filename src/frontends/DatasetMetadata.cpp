@@ -15,12 +15,46 @@
 #include "SeqReader.hh"
 #include "TransposeFasta.hh"
 #include "libzoo/cli/Common.hh"
+#include "libzoo/io/Bcl.hh"
+
+#include <stdint.h>
 
 using namespace std;
 
 
 DatasetMetadata datasetMetadata;
 
+namespace
+{
+
+// Only used when the decompressed size isn't recorded in the file: a typical ratio for FASTQ
+const long assumedCompressionRatio = 3;
+
+// Decompressed size of a compressed file, estimated without decompressing it.
+// Single-member gzip files end with the decompressed size modulo 2^32 (ISIZE);
+// for other files (BGZF, whose last block is empty, zstd...) the size is guessed
+// from assumedCompressionRatio.
+long estimateDecompressedSize( FILE *f, const long fileSize )
+{
+    unsigned char magic[2], trailer[4];
+    if ( fileSize >= 18
+         && fseek( f, 0, SEEK_SET ) == 0 && fread( magic, 1, 2, f ) == 2 && magic[0] == 0x1f && magic[1] == 0x8b
+         && fseek( f, -4, SEEK_END ) == 0 && fread( trailer, 1, 4, f ) == 4 )
+    {
+        uint64_t size = trailer[0] | ( trailer[1] << 8 ) | ( trailer[2] << 16 ) | ( ( uint64_t )trailer[3] << 24 );
+        if ( size > 0 )
+        {
+            // Files bigger than 4GB: assumes the decompressed file is at least as big as the compressed one
+            while ( size < ( uint64_t )fileSize )
+                size += ( uint64_t )1 << 32;
+            return size;
+        }
+    }
+    return fileSize * assumedCompressionRatio;
+}
+
+} // anonymous namespace
+
 
 void DatasetMetadata::init( const string &input, const string &inputFormat )
 {
@@ -32,6 +66,14 @@ void DatasetMetadata::init( const string &input, const string &inputFormat )
         nReads = transp.nSeq;
         nCycles = transp.lengthRead;
     }
+    else if ( inputFormat == "runFolder" )
+    {
+        BclRunFolder runFolder( input, "", "" );
+        TransposeFasta transp;
+        transp.inputBclRunFolder( runFolder, false );
+        nReads = transp.nSeq;
+        nCycles = transp.lengthRead;
+    }
     else
     {
         if ( input == "-" || beginsWith( input, "/dev/fd" ) )
@@ -56,6 +98,12 @@ void DatasetMetadata::init( const string &input, const string &inputFormat )
             long entrySize = ftell( f );
             fseek( f, 0, SEEK_END );
             long fileSize = ftell( f );
+            if ( pReader->file() != f )
+            {
+                // Compressed input: use the decompressed entry and file sizes
+                entrySize = ftell( pReader->file() );
+                fileSize = estimateDecompressedSize( f, fileSize );
+            }
             nReads = fileSize / entrySize;
             delete pReader;
             fclose( f );
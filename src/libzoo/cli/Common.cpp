@@ -36,7 +36,15 @@ bool endsWith( const string &s, const string &suffix )
 
 string detectFileFormat( const string &inputFilename )
 {
-    if ( endsWith( inputFilename, ".fa" ) || endsWith( inputFilename, ".fasta" ) )
+    if ( endsWith( inputFilename, ".gz" ) || endsWith( inputFilename, ".bgz" ) || endsWith( inputFilename, ".zst" ) )
+    {
+        // Only the sequence file readers decompress their input
+        string format = detectFileFormat( inputFilename.substr( 0, inputFilename.rfind( '.' ) ) );
+        if ( format == fileFormatLabels[FILE_FORMAT_FASTA] || format == fileFormatLabels[FILE_FORMAT_FASTQ] || format == fileFormatLabels[FILE_FORMAT_SEQ] )
+            return format;
+        return "";
+    }
+    else if ( endsWith( inputFilename, ".fa" ) || endsWith( inputFilename, ".fasta" ) )
     {
         return fileFormatLabels[FILE_FORMAT_FASTA];
     }
@@ -13,10 +13,13 @@
 #include "Bcl.hh"
 
 #include "libzoo/cli/Common.hh"
+#include "libzoo/io/CompressedInputStream.hh"
 
+#include <cassert>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <unistd.h>
 
@@ -37,6 +40,7 @@ BclRunFolder::BclRunFolder( const string &runFolder, const string &laneFormat, c
     : runFolder_( runFolder )
     , cycleCount_( 0 )
     , laneAndTileIndex_( -1 )
+    , passFilterOnly_( true )
 {
 #ifdef _OPENMP
     omp_set_nested( 1 );
@@ -311,3 +315,89 @@ void BclRunFolder::reportProgress( float step )
         clog << "Progress: " << floorf( potentialReport * 100 ) << "% complete" << endl;
     }
 }
+
+unsigned long BclRunFolder::loadPassFilterFlags( const bool passFilterOnly )
+{
+    passFilterOnly_ = passFilterOnly;
+    passFilterFlags_.resize( lanesAndTiles_.size() );
+    firstReadOfTile_.resize( lanesAndTiles_.size() );
+    unsigned long keptReadCount = 0;
+    for ( unsigned int i = 0; i < lanesAndTiles_.size(); ++i )
+    {
+        const string filename = runFolder_ + "/Data/Intensities/BaseCalls/" + lanesAndTiles_[i].first + "/" + lanesAndTiles_[i].second + ".filter";
+        ifstream filterFile( filename.c_str(), ios_base::binary );
+        unsigned int header[3] = { 0, 0, 0 }; // zero, version, read count
+        filterFile.read( reinterpret_cast<char *>( header ), sizeof( header ) );
+        if ( !filterFile.good() || header[1] != 3 )
+        {
+            cerr << "Error: We only support filter files version 3. Cannot read " << filename << endl;
+            exit( -1 );
+        }
+
+        vector< char > &flags = passFilterFlags_[i];
+        flags.resize( header[2] );
+        if ( header[2] != 0 && !filterFile.read( &flags[0], header[2] ) )
+        {
+            cerr << "Error: " << filename << " is truncated" << endl;
+            exit( -1 );
+        }
+
+        firstReadOfTile_[i] = keptReadCount;
+        for ( unsigned int j = 0; j < flags.size(); ++j )
+            keptReadCount += ( flags[j] || !passFilterOnly_ );
+    }
+    clog << "BclRunFolder: " << keptReadCount << " reads kept in " << lanesAndTiles_.size() << " tiles" << endl;
+    return keptReadCount;
+}
+
+string BclRunFolder::bclFilename( const unsigned int laneAndTileIndex, const unsigned int cycle ) const
+{
+    stringstream filenameBase;
+    filenameBase << runFolder_ << "/Data/Intensities/BaseCalls/" << lanesAndTiles_[laneAndTileIndex].first << "/C" << cycle << ".1/" << lanesAndTiles_[laneAndTileIndex].second << ".bcl";
+    const string filename = filenameBase.str();
+    if ( !doesFileExist( filename ) && doesFileExist( filename + ".gz" ) )
+        return filename + ".gz";
+    return filename;
+}
+
+void BclRunFolder::readCycle( const unsigned int cycle, unsigned char *bases, unsigned char *qualities ) const
+// cycle is 1-based, as in the run folder
+// Each BCL byte holds the base in its 2 lowest bits and the quality in the other ones, 0 meaning no call
+{
+    assert( passFilterFlags_.size() == lanesAndTiles_.size() && "loadPassFilterFlags must be called first" );
+    static const char bclBases[] = "ACGT";
+
+    #pragma omp parallel for schedule(dynamic)
+    for ( unsigned int i = 0; i < lanesAndTiles_.size(); ++i )
+    {
+        const string filename = bclFilename( i, cycle );
+        const vector< char > &flags = passFilterFlags_[i];
+        unique_ptr< istream > bclFile( openPossiblyCompressedInputFile( filename ) );
+        unsigned int readCountCheck = 0;
+        bclFile->read( reinterpret_cast<char *>( &readCountCheck ), 4 );
+        vector< char > bclValues( flags.size() );
+        if ( !flags.empty() )
+            bclFile->read( &bclValues[0], flags.size() );
+        if ( !bclFile->good() || readCountCheck != flags.size() )
+        {
+            #pragma omp critical (IO)
+            {
+                cerr << "Error: " << filename << " is missing or doesn't contain the " << flags.size() << " entries of its filter file" << endl;
+                exit( -1 );
+            }
+        }
+
+        unsigned long outPos = firstReadOfTile_[i];
+        for ( unsigned int j = 0; j < bclValues.size(); ++j )
+        {
+            if ( !flags[j] && passFilterOnly_ )
+                continue;
+            const unsigned char c = bclValues[j];
+            const unsigned char q = c >> 2;
+            bases[outPos] = q ? bclBases[c & 3] : 'N';
+            if ( qualities )
+                qualities[outPos] = 33 + q;
+            ++outPos;
+        }
+    }
+}
@@ -31,8 +31,14 @@ public:
     bool getRead( vector< unsigned int > &bclValues, bool *passFilter = NULL );
     void reportProgress( float step = 0.01 );
 
+    // Cycle-major access to all the lanes and tiles, as a BCL run folder is already transposed
+    // loadPassFilterFlags returns the number of reads kept by readCycle
+    unsigned long loadPassFilterFlags( const bool passFilterOnly = true );
+    void readCycle( const unsigned int cycle, unsigned char *bases, unsigned char *qualities ) const;
+
 private:
     void generateLanesAndTilesList( const string &laneFormat, const string &tileFormat );
+    string bclFilename( const unsigned int laneAndTileIndex, const unsigned int cycle ) const;
 
     const string runFolder_;
     string lane_;
@@ -47,6 +53,9 @@ private:
     unsigned int lastReportedReadNum_;
     vector< std::pair< string, string > > lanesAndTiles_;
     int laneAndTileIndex_;
+    vector< vector< char > > passFilterFlags_; // [lane and tile index][read]
+    vector< unsigned long > firstReadOfTile_; // [lane and tile index] position of its first kept read in a cycle
+    bool passFilterOnly_;
 };
 
 #endif //ifndef BCL_HH
@@ -0,0 +1,660 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "CompressedInputStream.hh"
+
+#include "config.h"
+#include "libzoo/util/Logger.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <streambuf>
+#include <stdint.h>
+#include <vector>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif //ifdef HAVE_ZSTD
+
+using namespace std;
+
+
+bool isGzipMagic( const unsigned char *bytes, const size_t size )
+{
+    return size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b;
+}
+
+bool isZstdMagic( const unsigned char *bytes, const size_t size )
+{
+    return size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd;
+}
+
+size_t readMagicBytes( FILE *pFile, unsigned char *bytes, const size_t size )
+{
+    return fread( bytes, 1, size, pFile );
+}
+
+
+namespace
+{
+
+FILE *openCookieStream( void *cookie, cookie_io_functions_t functions )
+{
+    FILE *f = fopencookie( cookie, "r", functions );
+    if ( f == NULL )
+    {
+        perror( "Error: fopencookie" );
+        exit( EXIT_FAILURE );
+    }
+    return f;
+}
+
+
+// Bytes already read from a non-seekable file, delivered again before the rest of it
+
+struct ReplayStreamState
+{
+    FILE *in;
+    vector<char> prefix;
+    size_t prefixPos;
+    off64_t totalOut;
+};
+
+ssize_t replayStreamRead( void *cookie, char *buf, size_t size )
+{
+    ReplayStreamState *s = static_cast<ReplayStreamState *>( cookie );
+    const size_t n = min( size, s->prefix.size() - s->prefixPos );
+    memcpy( buf, &s->prefix[0] + s->prefixPos, n );
+    s->prefixPos += n;
+    const size_t copied = n + ( ( n < size ) ? fread( buf + n, 1, size - n, s->in ) : 0 );
+    s->totalOut += copied;
+    return copied;
+}
+
+int replayStreamSeek( void *cookie, off64_t *offset, int whence )
+{
+    ReplayStreamState *s = static_cast<ReplayStreamState *>( cookie );
+    if ( whence == SEEK_CUR && *offset == 0 )
+    {
+        *offset = s->totalOut;
+        return 0;
+    }
+    if ( whence != SEEK_SET || *offset != 0 || fseek( s->in, 0, SEEK_SET ) != 0 )
+        return -1;
+
+    // The whole file is read again from 'in'
+    s->prefixPos = s->prefix.size();
+    s->totalOut = 0;
+    return 0;
+}
+
+int replayStreamClose( void *cookie )
+{
+    delete static_cast<ReplayStreamState *>( cookie );
+    return 0;
+}
+
+struct GzipStreamState
+{
+    FILE *in;
+    z_stream strm;
+    vector<Bytef> inBuf;
+    bool endOfMember;
+};
+
+ssize_t gzipStreamRead( void *cookie, char *buf, size_t size )
+{
+    GzipStreamState *s = static_cast<GzipStreamState *>( cookie );
+    s->strm.next_out = reinterpret_cast<Bytef *>( buf );
+    s->strm.avail_out = size;
+
+    while ( s->strm.avail_out > 0 )
+    {
+        if ( s->strm.avail_in == 0 )
+        {
+            size_t n = fread( s->inBuf.data(), 1, s->inBuf.size(), s->in );
+            if ( n == 0 )
+            {
+                if ( !s->endOfMember )
+                {
+                    Logger::error() << "Error: Unexpected end of gzip input, incomplete file?" << endl;
+                    exit( EXIT_FAILURE );
+                }
+                break;
+            }
+            s->strm.next_in = s->inBuf.data();
+            s->strm.avail_in = n;
+        }
+
+        if ( s->endOfMember )
+        {
+            // Next member of a multi-member file
+            inflateReset( &s->strm );
+            s->endOfMember = false;
+        }
+
+        int ret = inflate( &s->strm, Z_NO_FLUSH );
+        if ( ret == Z_STREAM_END )
+            s->endOfMember = true;
+        else if ( ret != Z_OK && ret != Z_BUF_ERROR )
+        {
+            Logger::error() << "Error: gzip decompression failed (" << ( s->strm.msg ? s->strm.msg : "corrupted input" ) << ")" << endl;
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    return size - s->strm.avail_out;
+}
+
+int gzipStreamSeek( void *cookie, off64_t *offset, int whence )
+{
+    GzipStreamState *s = static_cast<GzipStreamState *>( cookie );
+    if ( whence == SEEK_CUR && *offset == 0 )
+    {
+        *offset = s->strm.total_out;
+        return 0;
+    }
+    if ( whence != SEEK_SET || *offset != 0 )
+        return -1;
+
+    rewind( s->in );
+    inflateReset( &s->strm );
+    s->strm.avail_in = 0;
+    s->endOfMember = false;
+    return 0;
+}
+
+int gzipStreamClose( void *cookie )
+{
+    GzipStreamState *s = static_cast<GzipStreamState *>( cookie );
+    inflateEnd( &s->strm );
+    delete s;
+    return 0;
+}
+
+
+// BGZF: series of gzip members of at most 64KB each, whose header gives the
+// compressed size, so that batches of blocks can be inflated in parallel.
+
+const size_t bgzfHeaderSize = 18;
+const size_t bgzfFooterSize = 8; // CRC32, ISIZE
+const int bgzfBlocksPerBatch = 256; // up to 16MB of decompressed data
+
+bool isBgzfHeader( const uint8_t *header, const size_t length )
+{
+    return length >= bgzfHeaderSize
+           && header[0] == 0x1f && header[1] == 0x8b && header[2] == 8 && ( header[3] & 4 ) // FEXTRA
+           && header[10] == 6 && header[11] == 0 // XLEN
+           && header[12] == 'B' && header[13] == 'C' && header[14] == 2 && header[15] == 0;
+}
+
+uint32_t readLittleEndian32( const uint8_t *p )
+{
+    return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( ( uint32_t )p[3] << 24 );
+}
+
+struct BgzfStreamState
+{
+    FILE *in;
+    vector<uint8_t> pendingInput; // bytes read from 'in' but not yet decompressed
+    vector<uint8_t> outBuf;
+    size_t outPos;
+    off64_t totalOut;
+};
+
+void bgzfFailure( const char *reason )
+{
+    Logger::error() << "Error: BGZF decompression failed (" << reason << ")" << endl;
+    exit( EXIT_FAILURE );
+}
+
+// Reads the next batch of blocks and inflates them into outBuf, one thread per block
+bool bgzfDecompressBatch( BgzfStreamState *s )
+{
+    vector<size_t> blockStarts, outStarts;
+    size_t inPos = 0, outSize = 0;
+    while ( ( int )blockStarts.size() < bgzfBlocksPerBatch )
+    {
+        if ( s->pendingInput.size() < inPos + bgzfHeaderSize )
+        {
+            const size_t oldSize = s->pendingInput.size();
+            s->pendingInput.resize( inPos + 1024 * 1024 );
+            s->pendingInput.resize( oldSize + fread( &s->pendingInput[oldSize], 1, s->pendingInput.size() - oldSize, s->in ) );
+            if ( s->pendingInput.size() == inPos )
+                break;
+        }
+        if ( !isBgzfHeader( &s->pendingInput[inPos], s->pendingInput.size() - inPos ) )
+            bgzfFailure( "corrupted block header" );
+        const size_t blockSize = ( s->pendingInput[inPos + 16] | ( s->pendingInput[inPos + 17] << 8 ) ) + 1;
+        if ( blockSize < bgzfHeaderSize + bgzfFooterSize )
+            bgzfFailure( "corrupted block header" );
+        if ( s->pendingInput.size() < inPos + blockSize )
+        {
+            const size_t oldSize = s->pendingInput.size();
+            s->pendingInput.resize( inPos + blockSize );
+            if ( fread( &s->pendingInput[oldSize], 1, s->pendingInput.size() - oldSize, s->in ) != s->pendingInput.size() - oldSize )
+                bgzfFailure( "unexpected end of input, incomplete file?" );
+        }
+        blockStarts.push_back( inPos );
+        outStarts.push_back( outSize );
+        outSize += readLittleEndian32( &s->pendingInput[inPos + blockSize - 4] );
+        inPos += blockSize;
+    }
+    blockStarts.push_back( inPos );
+    outStarts.push_back( outSize );
+
+    const int blockCount = blockStarts.size() - 1;
+    s->outBuf.resize( outSize );
+    s->outPos = 0;
+    bool failed = false;
+    #pragma omp parallel for schedule(dynamic) reduction(||:failed)
+    for ( int i = 0; i < blockCount; ++i )
+    {
+        const uint8_t *block = &s->pendingInput[blockStarts[i]];
+        const size_t blockSize = blockStarts[i + 1] - blockStarts[i];
+        const uInt expectedSize = outStarts[i + 1] - outStarts[i];
+        z_stream strm;
+        memset( &strm, 0, sizeof( strm ) );
+        if ( inflateInit2( &strm, -15 ) != Z_OK ) // raw deflate data, the header has already been parsed
+        {
+            failed = true;
+            continue;
+        }
+        strm.next_in = const_cast<Bytef *>( block + bgzfHeaderSize );
+        strm.avail_in = blockSize - bgzfHeaderSize - bgzfFooterSize;
+        Bytef emptyOutput; // zlib refuses a NULL output pointer, even for the empty end-of-file block
+        strm.next_out = expectedSize ? &s->outBuf[outStarts[i]] : &emptyOutput;
+        strm.avail_out = expectedSize;
+        const int ret = inflate( &strm, Z_FINISH );
+        inflateEnd( &strm );
+        if ( ret != Z_STREAM_END || strm.avail_out != 0
+             || crc32( crc32( 0, NULL, 0 ), strm.next_out - expectedSize, expectedSize ) != readLittleEndian32( block + blockSize - 8 ) )
+            failed = true;
+    }
+    if ( failed )
+        bgzfFailure( "corrupted block" );
+
+    s->pendingInput.erase( s->pendingInput.begin(), s->pendingInput.begin() + inPos );
+    return blockCount > 0;
+}
+
+ssize_t bgzfStreamRead( void *cookie, char *buf, size_t size )
+{
+    BgzfStreamState *s = static_cast<BgzfStreamState *>( cookie );
+    size_t copied = 0;
+    while ( copied < size )
+    {
+        if ( s->outPos == s->outBuf.size() && !bgzfDecompressBatch( s ) )
+            break;
+        const size_t n = min( size - copied, s->outBuf.size() - s->outPos );
+        memcpy( buf + copied, &s->outBuf[s->outPos], n );
+        s->outPos += n;
+        copied += n;
+    }
+    s->totalOut += copied;
+    return copied;
+}
+
+int bgzfStreamSeek( void *cookie, off64_t *offset, int whence )
+{
+    BgzfStreamState *s = static_cast<BgzfStreamState *>( cookie );
+    if ( whence == SEEK_CUR && *offset == 0 )
+    {
+        *offset = s->totalOut;
+        return 0;
+    }
+    if ( whence != SEEK_SET || *offset != 0 )
+        return -1;
+
+    rewind( s->in );
+    s->pendingInput.clear();
+    s->outBuf.clear();
+    s->outPos = 0;
+    s->totalOut = 0;
+    return 0;
+}
+
+int bgzfStreamClose( void *cookie )
+{
+    delete static_cast<BgzfStreamState *>( cookie );
+    return 0;
+}
+
+#ifdef HAVE_ZSTD
+
+// zstd: frames whose header gives their decompressed size (as written by
+// pzstd, or by concatenating separately compressed chunks) are read whole and
+// decompressed in parallel, in batches. Frames of unknown size, such as those
+// of a single-threaded compression of a pipe, can only be streamed.
+
+const size_t zstdFrameHeaderMaxSize = 18;
+const size_t zstdMaxParallelFrameSize = 32 * 1024 * 1024; // larger frames are streamed
+const size_t zstdBatchSize = 64 * 1024 * 1024; // decompressed data
+
+struct ZstdStreamState
+{
+    FILE *in;
+    vector<uint8_t> pendingInput; // bytes read from 'in' but not yet decompressed
+    vector<uint8_t> outBuf;
+    size_t outPos;
+    off64_t totalOut;
+    ZSTD_DStream *dstream;
+    bool inStreamedFrame;
+};
+
+void zstdFailure( const char *reason )
+{
+    Logger::error() << "Error: zstd decompression failed (" << reason << ")" << endl;
+    exit( EXIT_FAILURE );
+}
+
+// Reads more input until pendingInput holds size bytes, or the input ends
+void zstdReadInput( ZstdStreamState *s, const size_t size )
+{
+    if ( s->pendingInput.size() >= size )
+        return;
+    const size_t oldSize = s->pendingInput.size();
+    s->pendingInput.resize( max( size, oldSize + 1024 * 1024 ) );
+    s->pendingInput.resize( oldSize + fread( &s->pendingInput[oldSize], 1, s->pendingInput.size() - oldSize, s->in ) );
+}
+
+// Decompresses the next part of a streamed frame into outBuf
+void zstdDecompressStreamedChunk( ZstdStreamState *s )
+{
+    s->outBuf.resize( ZSTD_DStreamOutSize() );
+    ZSTD_outBuffer out = { &s->outBuf[0], s->outBuf.size(), 0 };
+    while ( s->inStreamedFrame && out.pos < out.size )
+    {
+        zstdReadInput( s, 1 );
+        if ( s->pendingInput.empty() )
+            zstdFailure( "unexpected end of input, incomplete file?" );
+        ZSTD_inBuffer in = { &s->pendingInput[0], s->pendingInput.size(), 0 };
+        const size_t ret = ZSTD_decompressStream( s->dstream, &out, &in );
+        if ( ZSTD_isError( ret ) )
+            zstdFailure( ZSTD_getErrorName( ret ) );
+        s->pendingInput.erase( s->pendingInput.begin(), s->pendingInput.begin() + in.pos );
+        if ( ret == 0 )
+            s->inStreamedFrame = false;
+    }
+    s->outBuf.resize( out.pos );
+}
+
+// Reads the next batch of frames and decompresses them into outBuf, one thread per frame
+bool zstdDecompressBatch( ZstdStreamState *s )
+{
+    s->outPos = 0;
+    if ( s->inStreamedFrame )
+    {
+        zstdDecompressStreamedChunk( s );
+        return true;
+    }
+
+    vector<size_t> frameStarts, outStarts;
+    size_t inPos = 0, outSize = 0;
+    while ( outSize < zstdBatchSize )
+    {
+        zstdReadInput( s, inPos + zstdFrameHeaderMaxSize );
+        if ( s->pendingInput.size() == inPos )
+            break;
+        const unsigned long long contentSize = ZSTD_getFrameContentSize( &s->pendingInput[inPos], s->pendingInput.size() - inPos );
+        if ( contentSize == ZSTD_CONTENTSIZE_ERROR )
+            zstdFailure( "corrupted frame header" );
+        if ( contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize > zstdMaxParallelFrameSize )
+        {
+            if ( !frameStarts.empty() )
+                break;
+            ZSTD_initDStream( s->dstream );
+            s->inStreamedFrame = true;
+            zstdDecompressStreamedChunk( s );
+            return true;
+        }
+
+        size_t frameSize;
+        while ( ZSTD_isError( frameSize = ZSTD_findFrameCompressedSize( &s->pendingInput[inPos], s->pendingInput.size() - inPos ) ) )
+        {
+            const size_t oldSize = s->pendingInput.size();
+            zstdReadInput( s, oldSize + 1 );
+            if ( s->pendingInput.size() == oldSize )
+                zstdFailure( "unexpected end of input, incomplete file?" );
+        }
+        frameStarts.push_back( inPos );
+        outStarts.push_back( outSize );
+        outSize += contentSize;
+        inPos += frameSize;
+    }
+    frameStarts.push_back( inPos );
+    outStarts.push_back( outSize );
+
+    const int frameCount = frameStarts.size() - 1;
+    s->outBuf.resize( outSize );
+    bool failed = false;
+    #pragma omp parallel for schedule(dynamic) reduction(||:failed)
+    for ( int i = 0; i < frameCount; ++i )
+    {
+        const size_t expectedSize = outStarts[i + 1] - outStarts[i];
+        const size_t ret = ZSTD_decompress( s->outBuf.data() + outStarts[i], expectedSize,
+                                            &s->pendingInput[frameStarts[i]], frameStarts[i + 1] - frameStarts[i] );
+        if ( ZSTD_isError( ret ) || ret != expectedSize )
+            failed = true;
+    }
+    if ( failed )
+        zstdFailure( "corrupted frame" );
+
+    s->pendingInput.erase( s->pendingInput.begin(), s->pendingInput.begin() + inPos );
+    return frameCount > 0;
+}
+
+ssize_t zstdStreamRead( void *cookie, char *buf, size_t size )
+{
+    ZstdStreamState *s = static_cast<ZstdStreamState *>( cookie );
+    size_t copied = 0;
+    while ( copied < size )
+    {
+        if ( s->outPos == s->outBuf.size() && !zstdDecompressBatch( s ) )
+            break;
+        const size_t n = min( size - copied, s->outBuf.size() - s->outPos );
+        memcpy( buf + copied, s->outBuf.data() + s->outPos, n );
+        s->outPos += n;
+        copied += n;
+    }
+    s->totalOut += copied;
+    return copied;
+}
+
+int zstdStreamSeek( void *cookie, off64_t *offset, int whence )
+{
+    ZstdStreamState *s = static_cast<ZstdStreamState *>( cookie );
+    if ( whence == SEEK_CUR && *offset == 0 )
+    {
+        *offset = s->totalOut;
+        return 0;
+    }
+    if ( whence != SEEK_SET || *offset != 0 )
+        return -1;
+
+    rewind( s->in );
+    s->pendingInput.clear();
+    s->outBuf.clear();
+    s->outPos = 0;
+    s->totalOut = 0;
+    s->inStreamedFrame = false;
+    return 0;
+}
+
+int zstdStreamClose( void *cookie )
+{
+    ZstdStreamState *s = static_cast<ZstdStreamState *>( cookie );
+    ZSTD_freeDStream( s->dstream );
+    delete s;
+    return 0;
+}
+
+#endif //ifdef HAVE_ZSTD
+
+// istream reading a decompressing FILE*, closing both FILE*s on destruction.
+// (stdio_filebuf can't be used: it reads from the file descriptor, which a
+// cookie stream doesn't have.)
+class DecompressingInputStream : public istream
+{
+public:
+    DecompressingInputStream( FILE *pCompressedFile, FILE *pDecompressedFile )
+        : istream( NULL )
+        , pCompressedFile_( pCompressedFile )
+        , buf_( pDecompressedFile )
+    {
+        rdbuf( &buf_ );
+    }
+    ~DecompressingInputStream()
+    {
+        fclose( buf_.file );
+        fclose( pCompressedFile_ );
+    }
+
+private:
+    struct FileReadBuffer : public streambuf
+    {
+        FileReadBuffer( FILE *f ) : file( f ), buffer( 1024 * 1024 ) {}
+
+        int_type underflow()
+        {
+            const size_t n = fread( buffer.data(), 1, buffer.size(), file );
+            if ( n == 0 )
+                return traits_type::eof();
+            setg( buffer.data(), buffer.data(), buffer.data() + n );
+            return traits_type::to_int_type( buffer[0] );
+        }
+
+        FILE *file;
+        vector<char> buffer;
+    };
+
+    FILE *pCompressedFile_;
+    FileReadBuffer buf_;
+};
+
+} // anonymous namespace
+
+
+FILE *unreadBytes( FILE *pFile, const unsigned char *bytes, const size_t size )
+{
+    if ( size == 0 || fseek( pFile, -( long )size, SEEK_CUR ) == 0 )
+        return pFile;
+
+    ReplayStreamState *s = new ReplayStreamState;
+    s->in = pFile;
+    s->prefix.assign( bytes, bytes + size );
+    s->prefixPos = 0;
+    s->totalOut = 0;
+
+    cookie_io_functions_t functions;
+    functions.read = replayStreamRead;
+    functions.write = NULL;
+    functions.seek = replayStreamSeek;
+    functions.close = replayStreamClose;
+    return openCookieStream( s, functions );
+}
+
+FILE *openGzipDecompressingStream( FILE *pCompressedFile, const unsigned char *prefix, const size_t prefixSize )
+{
+    // The first bytes tell BGZF from plain gzip; they are kept as pending input
+    vector<uint8_t> header( prefix, prefix + prefixSize );
+    if ( header.size() < bgzfHeaderSize )
+    {
+        const size_t oldSize = header.size();
+        header.resize( bgzfHeaderSize );
+        header.resize( oldSize + fread( &header[oldSize], 1, header.size() - oldSize, pCompressedFile ) );
+    }
+
+    if ( isBgzfHeader( &header[0], header.size() ) )
+    {
+        Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Input is BGZF-compressed: decompressing blocks in parallel" << endl;
+        BgzfStreamState *s = new BgzfStreamState;
+        s->in = pCompressedFile;
+        s->pendingInput.swap( header );
+        s->outPos = 0;
+        s->totalOut = 0;
+
+        cookie_io_functions_t functions;
+        functions.read = bgzfStreamRead;
+        functions.write = NULL;
+        functions.seek = bgzfStreamSeek;
+        functions.close = bgzfStreamClose;
+        return openCookieStream( s, functions );
+    }
+
+    GzipStreamState *s = new GzipStreamState;
+    s->in = pCompressedFile;
+    s->inBuf.resize( 1024 * 1024 );
+    s->endOfMember = false;
+    memset( &s->strm, 0, sizeof( s->strm ) );
+    if ( inflateInit2( &s->strm, 15 + 16 ) != Z_OK ) // 15+16: gzip header
+    {
+        Logger::error() << "Error: Cannot initialise gzip decompression" << endl;
+        exit( EXIT_FAILURE );
+    }
+    copy( header.begin(), header.end(), s->inBuf.begin() );
+    s->strm.next_in = s->inBuf.data();
+    s->strm.avail_in = header.size();
+
+    cookie_io_functions_t functions;
+    functions.read = gzipStreamRead;
+    functions.write = NULL;
+    functions.seek = gzipStreamSeek;
+    functions.close = gzipStreamClose;
+    return openCookieStream( s, functions );
+}
+
+FILE *openZstdDecompressingStream( FILE *pCompressedFile, const unsigned char *prefix, const size_t prefixSize )
+{
+#ifdef HAVE_ZSTD
+    ZstdStreamState *s = new ZstdStreamState;
+    s->in = pCompressedFile;
+    s->pendingInput.assign( prefix, prefix + prefixSize );
+    s->outPos = 0;
+    s->totalOut = 0;
+    s->dstream = ZSTD_createDStream();
+    s->inStreamedFrame = false;
+    if ( s->dstream == NULL )
+    {
+        Logger::error() << "Error: Cannot initialise zstd decompression" << endl;
+        exit( EXIT_FAILURE );
+    }
+
+    cookie_io_functions_t functions;
+    functions.read = zstdStreamRead;
+    functions.write = NULL;
+    functions.seek = zstdStreamSeek;
+    functions.close = zstdStreamClose;
+    return openCookieStream( s, functions );
+#else
+    Logger::error() << "Error: zstd-compressed input is not supported by this build (zstd wasn't found by configure), please decompress it first (zstd -dc) or use gzip/BGZF" << endl;
+    exit( EXIT_FAILURE );
+#endif //ifdef HAVE_ZSTD
+}
+
+istream *openPossiblyCompressedInputFile( const string &filename )
+{
+    FILE *f = fopen( filename.c_str(), "rb" );
+    if ( f != NULL )
+    {
+        unsigned char magic[compressionMagicSize];
+        const size_t magicSize = readMagicBytes( f, magic, sizeof( magic ) );
+        if ( isGzipMagic( magic, magicSize ) )
+            return new DecompressingInputStream( f, openGzipDecompressingStream( f, magic, magicSize ) );
+        if ( isZstdMagic( magic, magicSize ) )
+            return new DecompressingInputStream( f, openZstdDecompressingStream( f, magic, magicSize ) );
+        fclose( f );
+    }
+    return new ifstream( filename.c_str() );
+}
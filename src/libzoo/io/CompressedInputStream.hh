@@ -0,0 +1,56 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef COMPRESSED_INPUT_STREAM_HH
+#define COMPRESSED_INPUT_STREAM_HH
+
+#include <istream>
+#include <stdio.h>
+#include <string>
+
+
+// Compressed input detection from the first bytes of a stream
+// (the whole magic number must be present)
+const size_t compressionMagicSize = 4;
+bool isGzipMagic( const unsigned char *bytes, const size_t size );
+bool isZstdMagic( const unsigned char *bytes, const size_t size );
+
+// Reads up to size bytes from the start of pFile, to detect its compression.
+// Returns how many bytes were available. These bytes are consumed: hand them
+// over to openGzipDecompressingStream or unreadBytes.
+size_t readMagicBytes( FILE *pFile, unsigned char *bytes, const size_t size );
+
+// Gives back the size bytes just read from pFile: returns pFile itself, seeked
+// back, when it is seekable, or else a read-only FILE* replaying these bytes
+// before the rest of pFile (e.g. for pipes). Closing the returned FILE*
+// doesn't close pFile.
+FILE *unreadBytes( FILE *pFile, const unsigned char *bytes, const size_t size );
+
+// Returns a read-only FILE* delivering the decompressed content of the gzip
+// stream made of prefix followed by the rest of pCompressedFile (multi-member
+// files are supported). BGZF files are detected from their first block header
+// and decompressed in batches of blocks inflated in parallel.
+// Only rewind() is supported as a seek operation.
+// Closing the returned FILE* doesn't close pCompressedFile.
+FILE *openGzipDecompressingStream( FILE *pCompressedFile, const unsigned char *prefix = NULL, const size_t prefixSize = 0 );
+
+// Same for zstd streams. Frames that record their decompressed size (e.g.
+// written by pzstd) are decompressed in parallel, in batches; other frames are
+// decompressed sequentially.
+// Exits with an error if BEETL was built without zstd.
+FILE *openZstdDecompressingStream( FILE *pCompressedFile, const unsigned char *prefix = NULL, const size_t prefixSize = 0 );
+
+// Opens filename as an istream, decompressing it on the fly if it is gzip/BGZF/zstd-compressed
+std::istream *openPossiblyCompressedInputFile( const std::string &filename );
+
+
+#endif //ifndef COMPRESSED_INPUT_STREAM_HH
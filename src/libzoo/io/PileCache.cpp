@@ -0,0 +1,233 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "PileCache.hh"
+
+#include "libzoo/util/Logger.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <set>
+#include <sstream>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+
+namespace
+{
+
+const char pileCacheMagic[8] = "BWTPILE";
+const size_t dataOffset = 2 * 1024 * 1024; // one huge page; the gap after the header is a hole
+const size_t copyChunkSize = 4 * 1024 * 1024;
+
+struct Header
+{
+    char magic[8];
+    uint64_t dataOffset;
+    uint64_t size;
+    int64_t mtime;
+    uint64_t inode;
+};
+
+// Checks that fd is a complete cached copy of the file described by original
+bool isUpToDate( const int fd, const struct stat &original, Header &header )
+{
+    struct stat st;
+    if ( pread( fd, &header, sizeof( header ), 0 ) != sizeof( header ) || fstat( fd, &st ) != 0 )
+        return false;
+    return memcmp( header.magic, pileCacheMagic, sizeof( pileCacheMagic ) ) == 0
+           && header.size == ( uint64_t )original.st_size
+           && header.mtime == ( int64_t )original.st_mtime
+           && header.inode == ( uint64_t )original.st_ino
+           && ( uint64_t )st.st_size == header.dataOffset + header.size;
+}
+
+} // anonymous namespace
+
+
+PileCache::PileCache( const string &directory )
+    : directory_( directory )
+{
+}
+
+string PileCache::cachedFilename( const string &filename ) const
+{
+    // Named after the absolute path, so that all the processes find the same copy
+    char *absolutePath = realpath( filename.c_str(), NULL );
+    string filenameWithoutSlash = absolutePath ? absolutePath : filename;
+    free( absolutePath );
+    replace( filenameWithoutSlash.begin(), filenameWithoutSlash.end(), '/', '_' );
+    return directory_ + "/BeetlPile_" + filenameWithoutSlash;
+}
+
+bool PileCache::load( const string &filename ) const
+{
+    struct stat original;
+    if ( stat( filename.c_str(), &original ) != 0 )
+    {
+        Logger::error() << "Error: Cannot read " << filename << ": " << strerror( errno ) << endl;
+        return false;
+    }
+    if ( isLoaded( filename ) )
+    {
+        Logger::out() << filename << " is already cached" << endl;
+        return true;
+    }
+
+    // Copies to a temporary file, renamed once complete, so that readers never see a partial copy
+    const string cached = cachedFilename( filename );
+    ostringstream oss;
+    oss << cached << ".tmp." << getpid();
+    const string tmpFilename = oss.str();
+    const int in = open( filename.c_str(), O_RDONLY );
+    int error = errno;
+    const int out = ( in >= 0 ) ? open( tmpFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 ) : -1;
+    if ( in >= 0 && out < 0 )
+        error = errno;
+    bool success = ( in >= 0 && out >= 0 );
+    string failedFilename = ( in < 0 ) ? filename : tmpFilename;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    if ( in >= 0 )
+        posix_fadvise( in, 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+    vector<char> buf( success ? copyChunkSize : 0 );
+    uint64_t copied = 0;
+    while ( success )
+    {
+        const ssize_t n = read( in, &buf[0], buf.size() );
+        if ( n == 0 )
+            break;
+        if ( n < 0 || pwrite( out, &buf[0], n, dataOffset + copied ) != n )
+        {
+            failedFilename = ( n < 0 ) ? filename : tmpFilename;
+            error = errno;
+            success = false;
+            break;
+        }
+        copied += n;
+    }
+
+    if ( success )
+    {
+        Header header;
+        memcpy( header.magic, pileCacheMagic, sizeof( pileCacheMagic ) );
+        header.dataOffset = dataOffset;
+        header.size = copied;
+        header.mtime = original.st_mtime;
+        header.inode = original.st_ino;
+        if ( ftruncate( out, dataOffset + copied ) != 0 || pwrite( out, &header, sizeof( header ), 0 ) != sizeof( header ) )
+        {
+            failedFilename = tmpFilename;
+            error = errno;
+            success = false;
+        }
+    }
+    if ( in >= 0 )
+        close( in );
+    if ( out >= 0 && close( out ) != 0 && success )
+    {
+        error = errno;
+        success = false;
+    }
+    if ( success && rename( tmpFilename.c_str(), cached.c_str() ) != 0 )
+    {
+        failedFilename = cached;
+        error = errno;
+        success = false;
+    }
+
+    if ( !success )
+    {
+        Logger::error() << "Error: Cannot cache " << filename << " (" << failedFilename << ": " << strerror( error ) << ")" << endl;
+        unlink( tmpFilename.c_str() );
+        return false;
+    }
+    Logger::out() << "Cached " << filename << " as " << cached << " (" << copied << " bytes)" << endl;
+    return true;
+}
+
+bool PileCache::unload( const string &filename ) const
+{
+    return unlink( cachedFilename( filename ).c_str() ) == 0;
+}
+
+bool PileCache::isLoaded( const string &filename ) const
+{
+    struct stat original;
+    if ( stat( filename.c_str(), &original ) != 0 )
+        return false;
+    const int fd = open( cachedFilename( filename ).c_str(), O_RDONLY );
+    if ( fd < 0 )
+        return false;
+    Header header;
+    const bool upToDate = isUpToDate( fd, original, header );
+    close( fd );
+    return upToDate;
+}
+
+bool PileCache::attach( const string &filename, Mapping &mapping ) const
+{
+    struct stat original;
+    if ( stat( filename.c_str(), &original ) != 0 )
+        return false;
+    const string cached = cachedFilename( filename );
+    const int fd = open( cached.c_str(), O_RDONLY );
+    if ( fd < 0 )
+        return false;
+
+    Header header;
+    if ( !isUpToDate( fd, original, header ) )
+    {
+        // Once per file, as readers get cloned for each thread
+        static set<string> warnedFilenames;
+        #pragma omp critical (PILE_CACHE_WARNINGS)
+        if ( warnedFilenames.insert( cached ).second )
+            Logger::out() << "Warning: Ignoring out-of-date cached copy " << cached << " of " << filename << " (run beetl-cache load again)" << endl;
+        close( fd );
+        return false;
+    }
+
+    const size_t length = header.dataOffset + header.size;
+    void *base = mmap( NULL, length, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( base == MAP_FAILED )
+    {
+        Logger::out() << "Warning: Cannot map " << cached << ": " << strerror( errno ) << endl;
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise( base, length, MADV_HUGEPAGE );
+#endif
+
+    mapping.base = base;
+    mapping.length = length;
+    mapping.data = reinterpret_cast<const char *>( base ) + header.dataOffset;
+    mapping.size = header.size;
+    Logger_if( LOG_SHOW_IF_VERY_VERBOSE ) Logger::out() << "Info: Using cached BWT pile " << cached << endl;
+    return true;
+}
+
+void PileCache::detach( Mapping &mapping )
+{
+    if ( mapping.base )
+        munmap( mapping.base, mapping.length );
+    mapping = Mapping();
+}
@@ -0,0 +1,66 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef PILE_CACHE_HH
+#define PILE_CACHE_HH
+
+#include <stddef.h>
+#include <string>
+
+using std::string;
+
+
+// PileCache: read-only copies of BWT piles in a shared memory directory
+// (e.g. /dev/shm), populated once by beetl-cache and mapped by every process
+// that reads these piles, so that they all share the same physical pages.
+// Each cached file starts with a header recording the size, modification time
+// and inode of its original file: copies that don't match the original any
+// more are ignored. The data starts at a huge page boundary, to let the kernel
+// back the mappings with transparent huge pages.
+
+class PileCache
+{
+public:
+    struct Mapping
+    {
+        Mapping()
+            : base( NULL )
+            , length( 0 )
+            , data( NULL )
+            , size( 0 )
+        {}
+
+        void *base;
+        size_t length;
+        const char *data; // contents of the original file
+        size_t size;
+    };
+
+    PileCache( const string &directory );
+
+    string cachedFilename( const string &filename ) const;
+
+    // Copies the file into the cache, unless an up-to-date copy is there already
+    bool load( const string &filename ) const;
+    bool unload( const string &filename ) const;
+    bool isLoaded( const string &filename ) const;
+
+    // Maps the up-to-date copy of the file, if there is one
+    bool attach( const string &filename, Mapping &mapping ) const;
+    static void detach( Mapping &mapping );
+
+private:
+    const string directory_;
+};
+
+
+#endif //ifndef PILE_CACHE_HH
@@ -0,0 +1,222 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "PrefetchingIFStream.hh"
+
+#include "libzoo/util/Logger.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+size_t PrefetchingIFStream::defaultBlockSize_ = 256 * 1024;
+unsigned int PrefetchingIFStream::defaultBlocksAhead_ = 4;
+static const size_t minFillSize = 16 * 1024;
+
+
+PrefetchingIFStream::PrefetchingIFStream( const char *filename, const string &pileCacheDirectory )
+    : fd_( -1 )
+    , blockSize_( defaultBlockSize_ )
+    , blocksAhead_( defaultBlocksAhead_ )
+    , bufData_( NULL )
+    , bufStartInFile_( 0 )
+    , bufLength_( 0 )
+    , bufPos_( 0 )
+    , fillSize_( blockSize_ )
+    , readAheadEnd_( 0 )
+{
+    if ( !pileCacheDirectory.empty() && PileCache( pileCacheDirectory ).attach( filename, mapping_ ) )
+    {
+        bufData_ = mapping_.data;
+        bufLength_ = mapping_.size;
+        return;
+    }
+
+    fd_ = open( filename, O_RDONLY );
+#ifdef POSIX_FADV_SEQUENTIAL
+    if ( fd_ >= 0 )
+        posix_fadvise( fd_, 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+}
+
+PrefetchingIFStream::~PrefetchingIFStream()
+{
+    if ( fd_ >= 0 )
+        close( fd_ );
+    PileCache::detach( mapping_ );
+}
+
+void PrefetchingIFStream::setBlockSize( const size_t blockSize )
+{
+    assert( blockSize > 0 );
+    defaultBlockSize_ = blockSize;
+    Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "BWT read-ahead block size set to " << blockSize << " bytes" << endl;
+}
+
+void PrefetchingIFStream::setBlocksAhead( const unsigned int blocksAhead )
+{
+    defaultBlocksAhead_ = blocksAhead;
+}
+
+size_t PrefetchingIFStream::read( void *ptr, size_t size, size_t count )
+{
+    char *dest = reinterpret_cast<char *>( ptr );
+    const size_t bytesRequested = size * count;
+    size_t bytesRead = 0;
+
+    while ( bytesRead < bytesRequested )
+    {
+        if ( bufPos_ == bufLength_ )
+        {
+            if ( isMapped() )
+                break;
+
+            // Large reads go straight to their destination
+            if ( bytesRequested - bytesRead >= blockSize_ )
+            {
+                bufStartInFile_ += bufLength_;
+                bufLength_ = bufPos_ = 0;
+                adviseReadAhead();
+                ssize_t n = pread( fd_, dest + bytesRead, bytesRequested - bytesRead, bufStartInFile_ );
+                if ( n <= 0 )
+                    break;
+                bytesRead += n;
+                bufStartInFile_ += n;
+                continue;
+            }
+            if ( !fillBuffer() )
+                break;
+        }
+
+        const size_t n = min( bytesRequested - bytesRead, bufLength_ - bufPos_ );
+        memcpy( dest + bytesRead, bufData_ + bufPos_, n );
+        bufPos_ += n;
+        bytesRead += n;
+    }
+
+    return size ? ( bytesRead / size ) : 0;
+}
+
+int PrefetchingIFStream::getc()
+{
+    if ( bufPos_ == bufLength_ && !fillBuffer() )
+        return EOF;
+    return ( unsigned char )bufData_[bufPos_++];
+}
+
+int PrefetchingIFStream::seek( const off_t offset, const int whence )
+{
+    off_t newPos;
+    switch ( whence )
+    {
+        case SEEK_SET:
+            newPos = offset;
+            break;
+        case SEEK_CUR:
+            newPos = tell() + offset;
+            break;
+        case SEEK_END:
+        {
+            if ( isMapped() )
+            {
+                newPos = mapping_.size + offset;
+                break;
+            }
+            struct stat st;
+            if ( fstat( fd_, &st ) != 0 )
+                return -1;
+            newPos = st.st_size + offset;
+            break;
+        }
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+    if ( newPos < 0 )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ( isMapped() )
+    {
+        // The whole file is in the buffer, which only gets emptied by seeks past its end
+        const bool isInFile = ( newPos <= ( off_t )mapping_.size );
+        bufStartInFile_ = isInFile ? 0 : newPos;
+        bufLength_ = isInFile ? mapping_.size : 0;
+        bufPos_ = isInFile ? newPos : 0;
+    }
+    else if ( newPos >= bufStartInFile_ && newPos <= bufStartInFile_ + ( off_t )bufLength_ )
+    {
+        // Inside the current block
+        bufPos_ = newPos - bufStartInFile_;
+    }
+    else
+    {
+        bufStartInFile_ = newPos;
+        bufLength_ = bufPos_ = 0;
+        fillSize_ = min( blockSize_, minFillSize );
+    }
+    return 0;
+}
+
+bool PrefetchingIFStream::fillBuffer()
+{
+    assert( bufPos_ == bufLength_ );
+    if ( isMapped() )
+        return false;
+    if ( buf_.empty() )
+    {
+        buf_.resize( blockSize_ );
+        bufData_ = &buf_[0];
+    }
+
+    bufStartInFile_ += bufLength_;
+    bufLength_ = bufPos_ = 0;
+    adviseReadAhead();
+
+    ssize_t n = pread( fd_, &buf_[0], fillSize_, bufStartInFile_ );
+    fillSize_ = min( 2 * fillSize_, blockSize_ );
+    if ( n <= 0 )
+        return false;
+    bufLength_ = n;
+    return true;
+}
+
+void PrefetchingIFStream::adviseReadAhead()
+{
+#ifdef POSIX_FADV_WILLNEED
+    // Only for sequential streams
+    if ( blocksAhead_ == 0 || fillSize_ < blockSize_ )
+        return;
+
+    // Restart the read-ahead after a seek
+    const off_t nextBlock = bufStartInFile_ + blockSize_;
+    if ( readAheadEnd_ < nextBlock || readAheadEnd_ > nextBlock + ( off_t )( blocksAhead_ * blockSize_ ) )
+        readAheadEnd_ = nextBlock;
+
+    // Keep blocksAhead_ blocks in flight, topping up one block at a time
+    const off_t wantedEnd = nextBlock + blocksAhead_ * blockSize_;
+    if ( readAheadEnd_ + ( off_t )blockSize_ <= wantedEnd )
+    {
+        posix_fadvise( fd_, readAheadEnd_, wantedEnd - readAheadEnd_, POSIX_FADV_WILLNEED );
+        readAheadEnd_ = wantedEnd;
+    }
+#endif
+}
@@ -0,0 +1,106 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef PREFETCHING_IFSTREAM_HH
+#define PREFETCHING_IFSTREAM_HH
+
+#include "PileCache.hh"
+
+#include <stdio.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+// PrefetchingIFStream: read-only replacement for FILE*, used by the BWT readers.
+// Data is read in large blocks, and the kernel is asked (posix_fadvise) to
+// asynchronously fetch the next few blocks, so that the disk keeps working
+// while the current block is being decoded.
+// Seeks inside the current block don't trigger any I/O. After a seek outside
+// of it, reads start small and grow back to the full block size, so that
+// random accesses don't pay for large reads.
+// If a pile cache directory is given and holds an up-to-date copy of the file
+// (see PileCache), the stream reads from a shared mapping of it instead, which
+// is then its single buffer.
+
+class PrefetchingIFStream
+{
+public:
+    PrefetchingIFStream( const char *filename, const string &pileCacheDirectory = "" );
+    ~PrefetchingIFStream();
+
+    bool good() const
+    {
+        return fd_ >= 0 || isMapped();
+    }
+    bool isMapped() const
+    {
+        return mapping_.data != NULL;
+    }
+    size_t read( void *ptr, size_t size, size_t count );
+    int getc();
+    int seek( const off_t offset, const int whence );
+    off_t tell() const
+    {
+        return bufStartInFile_ + bufPos_;
+    }
+
+    // Global settings, applied to the streams opened afterwards
+    static void setBlockSize( const size_t blockSize );
+    static void setBlocksAhead( const unsigned int blocksAhead );
+
+    friend size_t fread( void *ptr, size_t size, size_t count, PrefetchingIFStream *stream )
+    {
+        return stream->read( ptr, size, count );
+    }
+    friend int fgetc( PrefetchingIFStream *stream )
+    {
+        return stream->getc();
+    }
+    friend int fseek( PrefetchingIFStream *stream, long offset, int whence )
+    {
+        return stream->seek( offset, whence );
+    }
+    friend long ftell( PrefetchingIFStream *stream )
+    {
+        return stream->tell();
+    }
+    friend void rewind( PrefetchingIFStream *stream )
+    {
+        stream->seek( 0, SEEK_SET );
+    }
+
+private:
+    bool fillBuffer();
+    void adviseReadAhead();
+
+    int fd_;
+    const size_t blockSize_;
+    const unsigned int blocksAhead_;
+    vector<char> buf_;
+    PileCache::Mapping mapping_;
+    const char *bufData_; // &buf_[0], or the whole file when mapped
+    off_t bufStartInFile_; // file offset of bufData_[0]
+    size_t bufLength_; // number of valid bytes in bufData_
+    size_t bufPos_;
+    size_t fillSize_; // size of the next read, growing up to blockSize_
+    off_t readAheadEnd_; // end of the region already advised to the kernel
+
+    static size_t defaultBlockSize_;
+    static unsigned int defaultBlocksAhead_;
+};
+
+
+#endif //ifndef PREFETCHING_IFSTREAM_HH
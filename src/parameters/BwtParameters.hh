@@ -32,6 +32,7 @@ enum InputFormat
     INPUT_FORMAT_CYC,
     INPUT_FORMAT_SEQ,
     INPUT_FORMAT_BCL,
+    INPUT_FORMAT_RUNFOLDER,
     INPUT_FORMAT_COUNT
 };
 
@@ -42,6 +43,7 @@ static const string inputFormatLabels[] =
     "cyc",
     "seq",
     "bcl",
+    "runFolder",
     "" // end marker
 };
 
@@ -218,6 +220,45 @@ static const string generateCycleQualLabels[] =
 
 
 
+// options: cycles in RAM auto/on/off
+
+enum CyclesInRam
+{
+    CYCLES_IN_RAM_AUTO,
+    CYCLES_IN_RAM_ON,
+    CYCLES_IN_RAM_OFF,
+    CYCLES_IN_RAM_COUNT
+};
+
+static const string cyclesInRamLabels[] =
+{
+    "auto",
+    "on",
+    "off",
+    "" // end marker
+};
+
+
+// options: phase profile off/JSON/CSV
+
+enum PhaseProfile
+{
+    PHASE_PROFILE_OFF,
+    PHASE_PROFILE_JSON,
+    PHASE_PROFILE_CSV,
+    PHASE_PROFILE_COUNT
+};
+
+static const string phaseProfileLabels[] =
+{
+    "off",
+    "JSON",
+    "CSV",
+    "" // end marker
+};
+
+
+
 // Option container
 
 enum BwtParameterIds
@@ -246,6 +287,11 @@ enum BwtParameterIds
     PARAMETER_GENERATE_CYCLE_BWT,
     PARAMETER_GENERATE_CYCLE_QUAL,
     PARAMETER_PAUSE_BETWEEN_CYCLES,
+    PARAMETER_READ_BLOCK_SIZE,
+    PARAMETER_CYCLES_IN_RAM,
+    PARAMETER_APPEND_TO,
+    PARAMETER_SA_SAMPLING_RATE,
+    PARAMETER_PHASE_PROFILE,
     PARAMETER_COUNT // end marker
 };
 
@@ -262,6 +308,7 @@ public:
         using namespace BeetlBwtParameters;
         addEntry( PARAMETER_INPUT_FILENAME, "input filename", "--input", "-i", "Input file name or prefix", "", TYPE_STRING | REQUIRED );
         addEntry( PARAMETER_OUTPUT_FILENAME, "output filename", "--output", "-o", "Output file name or prefix", "outBWT", TYPE_STRING | REQUIRED );
+        addEntry( PARAMETER_APPEND_TO, "append to", "--append-to", "", "Insert the input sequences into the existing BWT <prefix>-B0? (see append note below)", "", TYPE_STRING );
         addEntry( PARAMETER_INPUT_FORMAT, "input format", "--input-format", "", "", "detect", TYPE_CHOICE | REQUIRED, inputFormatLabels );
         addEntry( PARAMETER_OUTPUT_FORMAT, "output format", "--output-format", "", "", "rle", TYPE_CHOICE | REQUIRED, outputFormatLabels );
         addEntry( PARAMETER_INTERMEDIATE_FORMAT, "intermediate format", "--intermediate-format", "", "", "", TYPE_CHOICE | REQUIRED | AUTOMATED, intermediateFormatLabels );
@@ -277,6 +324,7 @@ public:
         addEntry( PARAMETER_PAIRED_READS_INPUT, "paired-reads input", "--paired-reads-input", "", "If your input file contains paired reads", "none", TYPE_CHOICE, pairedReadsInputLabels );
         addEntry( PARAMETER_SAP_ORDERING, "SAP ordering", "--sap-ordering", "", "Use SAP ordering (see SAP note below)", "", TYPE_SWITCH );
         addEntry( PARAMETER_GENERATE_ENDPOSFILE, "generate endPosFile", "--generate-end-pos-file", "", "Generate mapping between BWT '$' signs and sequence numbers", "", TYPE_SWITCH );
+        addEntry( PARAMETER_SA_SAMPLING_RATE, "SA sampling rate", "--sa-sampling-rate", "", "Store every k-th suffix array entry of each sequence in <output>-sa, for locate queries (see SA note below)", "", TYPE_INT );
         addEntry( PARAMETER_GENERATE_LCP, "generate LCP", "--generate-lcp", "", "Generate Longest Common Prefix lengths (see LCP note below)", "", TYPE_SWITCH );
         addEntry( PARAMETER_GENERATE_CYCLE_BWT, "generate cycle BWT", "--cycle-bwt", "", "PBE=Generate cycle-by-cycle BWT with prediction-based encoding", "off", TYPE_CHOICE, generateCycleBwtLabels );
         addEntry( PARAMETER_GENERATE_CYCLE_QUAL, "generate cycle qualities", "--cycle-qual", "", "PBE=Generate cycle-by-cycle qualities zeroed at correctly-predicted bases", "off", TYPE_CHOICE, generateCycleQualLabels );
@@ -286,6 +334,9 @@ public:
 #endif //ifdef _OPENMP
         //    addEntry( PARAMETER_, "", " --hw-constraints         File describing hardware constraints for speed estimates", "", TYPE_STRING );
         addEntry( PARAMETER_PAUSE_BETWEEN_CYCLES, "pause between cycles", "--pause-between-cycles", "", "Wait for a key press after each cycle", "", TYPE_SWITCH );
+        addEntry( PARAMETER_READ_BLOCK_SIZE, "read block size KB", "--read-block-size", "", "Size of the read-ahead blocks used to stream BWT files, in KB", "256", TYPE_INT );
+        addEntry( PARAMETER_PHASE_PROFILE, "phase profile", "--profile", "", "Write per-iteration, per-pile phase timings, I/O and RSS to <output>-profile.jsonl or .csv", "off", TYPE_CHOICE, phaseProfileLabels );
+        addEntry( PARAMETER_CYCLES_IN_RAM, "cycles in RAM", "--cycles-in-ram", "", "Keep transposed input cycles in RAM instead of cycle files (auto: if they fit in a quarter of the memory limit)", "auto", TYPE_CHOICE, cyclesInRamLabels );
 
         addDefaultVerbosityAndHelpEntries();
     }
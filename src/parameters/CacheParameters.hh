@@ -0,0 +1,61 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef BEETL_CACHE_PARAMETERS_HH
+#define BEETL_CACHE_PARAMETERS_HH
+
+#include "libzoo/cli/ToolParameters.hh"
+
+#include <string>
+
+using std::string;
+
+
+namespace BeetlCacheParameters
+{
+
+// options: action
+
+enum Action
+{
+    ACTION_LOAD,
+    ACTION_UNLOAD,
+    ACTION_STATUS,
+    ACTION_COUNT
+};
+
+static const string actionLabels[] =
+{
+    "load",
+    "unload",
+    "status",
+    "" // end marker
+};
+
+} // namespace BeetlCacheParameters
+
+
+class CacheParameters : public ToolParameters
+{
+public:
+    CacheParameters()
+    {
+        using namespace BeetlCacheParameters;
+        addEntry( -1, "action", "--action", "-a", "Action (also accepted as first argument)", "", TYPE_CHOICE | REQUIRED, actionLabels );
+        addEntry( -1, "input", "--input", "-i", "Input filename prefix (i.e. BWT files are \"prefix-B0[0-6]\", also accepted as second argument)", "", TYPE_STRING | REQUIRED );
+
+        addDefaultVerbosityAndHelpEntries();
+    }
+};
+
+
+#endif //ifndef BEETL_CACHE_PARAMETERS_HH
@@ -0,0 +1,62 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef BEETL_EXTRACT_PARAMETERS_HH
+#define BEETL_EXTRACT_PARAMETERS_HH
+
+#include "libzoo/cli/ToolParameters.hh"
+
+#include <string>
+
+using std::string;
+
+
+namespace BeetlExtractParameters
+{
+
+// options: output format
+
+enum OutputFormat
+{
+    OUTPUT_FORMAT_FASTA,
+    OUTPUT_FORMAT_FASTQ,
+    OUTPUT_FORMAT_COUNT
+};
+
+static const string outputFormatLabels[] =
+{
+    "fasta",
+    "fastq",
+    "" // end marker
+};
+
+} // namespace BeetlExtractParameters
+
+
+class ExtractParameters : public ToolParameters
+{
+public:
+    ExtractParameters()
+    {
+        using namespace BeetlExtractParameters;
+        addEntry( -1, "input", "--input", "-i", "Input filename prefix (i.e. BWT files are \"prefix-B0[0-6]\")", "", TYPE_STRING | REQUIRED );
+        addEntry( -1, "sequence numbers", "--seq-num", "-n", "Comma-separated list of sequence numbers to extract (first sequence is 0)", "", TYPE_STRING );
+        addEntry( -1, "sequence numbers file", "--seq-num-file", "", "File containing the sequence numbers to extract, one per line", "", TYPE_STRING );
+        addEntry( -1, "output filename", "--output", "-o", "Output file name", "extracted.fasta", TYPE_STRING | REQUIRED );
+        addEntry( -1, "output format", "--output-format", "", "", "detect", TYPE_CHOICE | REQUIRED, outputFormatLabels );
+
+        addDefaultVerbosityAndHelpEntries();
+    }
+};
+
+
+#endif //ifndef BEETL_EXTRACT_PARAMETERS_HH
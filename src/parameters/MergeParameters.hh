@@ -0,0 +1,64 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef BEETL_MERGE_PARAMETERS_HH
+#define BEETL_MERGE_PARAMETERS_HH
+
+#include "libzoo/cli/ToolParameters.hh"
+
+#include <string>
+
+using std::string;
+
+
+namespace BeetlMergeParameters
+{
+
+// options: output format
+
+enum OutputFormat
+{
+    OUTPUT_FORMAT_ASCII,
+    OUTPUT_FORMAT_RLE,
+    OUTPUT_FORMAT_COUNT
+};
+
+static const string outputFormatLabels[] =
+{
+    "ASCII",
+    "RLE",
+    "" // end marker
+};
+
+} // namespace BeetlMergeParameters
+
+
+class MergeParameters : public ToolParameters
+{
+public:
+    MergeParameters()
+    {
+        using namespace BeetlMergeParameters;
+        addEntry( -1, "inputA", "--inputA", "-a", "Input filename prefix for Set A (i.e. BWT files are \"prefixA-B0[0-6]\")", "", TYPE_STRING | REQUIRED );
+        addEntry( -1, "inputB", "--inputB", "-b", "Input filename prefix for Set B (i.e. BWT files are \"prefixB-B0[0-6]\")", "", TYPE_STRING | REQUIRED );
+        addEntry( -1, "output", "--output", "-o", "Output filename prefix for the merged BWT", "", TYPE_STRING | REQUIRED );
+        addEntry( -1, "output format", "--output-format", "", "", "RLE", TYPE_CHOICE | REQUIRED, outputFormatLabels );
+        addEntry( -1, "merge end-pos", "--merge-end-pos", "", "Also merge the \"prefix-end-pos\" files", "", TYPE_SWITCH );
+        addEntry( -1, "merge C files", "--merge-c-files", "", "Also merge the metagenomics file number files \"prefix-C0[0-6]\"", "", TYPE_SWITCH );
+        addEntry( -1, "C file offset", "--c-file-offset", "", "Value added to Set B's file numbers when merging C files", "0", TYPE_INT );
+
+        addDefaultVerbosityAndHelpEntries();
+    }
+};
+
+
+#endif //ifndef BEETL_MERGE_PARAMETERS_HH
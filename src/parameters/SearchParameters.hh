@@ -41,6 +41,9 @@ public:
         addEntry( -1, "output", "--output", "-o", "Output filename", "searchedKmers_positions", TYPE_STRING | REQUIRED );
         addEntry( -1, "kmers input file", "--kmers", "-j", "File containing a list of k-mers to be searched for (one k-mer per line) OR", "", TYPE_STRING );
         addEntry( -1, "one kmer string", "--kmer", "-k", "Single k-mer string to be searched for", "", TYPE_STRING );
+        addEntry( -1, "serve", "--serve", "", "Keep running and answer queries (\"count <kmer>\", \"locate <kmer> [max]\", \"quit\", \"shutdown\") from stdin (--serve=-) or from a UNIX socket (--serve=<socket path>)", "", TYPE_STRING );
+        addEntry( -1, "random access", "--random-access", "", "Search each k-mer independently using in-memory rank indexes of the BWT piles, instead of sequential passes over the piles (faster for small numbers of k-mers; needs RLE piles)", "", TYPE_SWITCH );
+        addEntry( -1, "locate", "--locate", "", "With --random-access, also report the sequence number and offset of each occurrence (needs the -sa file of beetl-bwt --sa-sampling-rate)", "", TYPE_SWITCH );
 
         //addEntry( -1, "add rev comp", "--add-rev-comp", "", "Also search for reverse-complemented k-mers (reported as distinct k-mers)", "", TYPE_SWITCH );
         //        addEntry( -1, "pause between cycles", "--pause-between-cycles", "", "Wait for a key press after each cycle", "", TYPE_SWITCH );
@@ -26,12 +26,14 @@ namespace BeetlUnbwtParameters
 enum InputFormat
 {
     INPUT_FORMAT_BWT_ASCII,
+    INPUT_FORMAT_BWT_RLE,
     INPUT_FORMAT_COUNT
 };
 
 static const string inputFormatLabels[] =
 {
     "BWT_ASCII",
+    "BWT_RLE",
     "" // end marker
 };
 
@@ -105,6 +107,24 @@ static const string useVectorLabels[] =
 
 
 
+// options: decode method
+
+enum DecodeMethod
+{
+    DECODE_METHOD_RANK_INDEX,
+    DECODE_METHOD_CYCLES,
+    DECODE_METHOD_COUNT,
+};
+
+static const string decodeMethodLabels[] =
+{
+    "rank-index",
+    "cycles",
+    "" // end marker
+};
+
+
+
 // Option container
 
 enum UnbwtOptions
@@ -112,6 +132,7 @@ enum UnbwtOptions
     //    PARAMETER_PROCESS_QUALITIES,
     PARAMETER_DECODE_DIRECTION,
     PARAMETER_USE_VECTOR,
+    PARAMETER_DECODE_METHOD,
     PARAMETER_COUNT // end marker
 };
 
@@ -130,6 +151,7 @@ public:
         addEntry( -1, "output format", "--output-format", "", "", "detect", TYPE_CHOICE | REQUIRED, outputFormatLabels );
         addEntry( PARAMETER_DECODE_DIRECTION, "decode direction", "--decode-direction", "-d", "", "backward", TYPE_CHOICE, decodeDirectionLabels );
         addEntry( PARAMETER_USE_VECTOR, "use vector", "--use-vector", "", "", "on", TYPE_CHOICE, useVectorLabels );
+        addEntry( PARAMETER_DECODE_METHOD, "decode method", "--decode-method", "", "Backward decoding with rank-indexed piles kept in RAM, or by cycles", "rank-index", TYPE_CHOICE, decodeMethodLabels );
 
         addDefaultVerbosityAndHelpEntries();
     }
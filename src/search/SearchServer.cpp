@@ -0,0 +1,234 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "SearchServer.hh"
+
+#include "BwtRankIndex.hh"
+#include "EndPosFile.hh"
+#include "SampledSuffixArray.hh"
+#include "Timer.hh"
+#include "Tools.hh"
+#include "parameters/SearchParameters.hh"
+#include "libzoo/util/Logger.hh"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+SearchServer::SearchServer( const SearchParameters &searchParams )
+    : searchParams_( searchParams )
+    , bwt_( NULL )
+    , endPosFile_( NULL )
+    , sampledSA_( NULL )
+{
+}
+
+SearchServer::~SearchServer()
+{
+    delete bwt_;
+    delete endPosFile_;
+    delete sampledSA_;
+}
+
+void SearchServer::run()
+{
+    Timer timer;
+    const string bwtPrefix = searchParams_["input"];
+
+    bwt_ = new RankIndexedBwt( bwtPrefix );
+    if ( readWriteCheck( ( bwtPrefix + "-sa" ).c_str(), false, false ) )
+        sampledSA_ = new SampledSuffixArray( bwtPrefix );
+    else if ( readWriteCheck( ( bwtPrefix + "-end-pos" ).c_str(), false, false ) )
+        endPosFile_ = new EndPosFile( bwtPrefix );
+    else
+        clog << "Warning: " << bwtPrefix << "-end-pos not found. \"locate\" queries will report dollar numbers instead of sequence numbers." << endl;
+
+    // Logged to stderr, as stdout carries the responses with --serve=-
+    clog << "BWT loaded and indexed. time now: " << timer.timeNow();
+    clog << "   usage: " << timer << endl;
+
+    const string serveTarget = searchParams_["serve"];
+    if ( serveTarget == "-" )
+    {
+        clog << "Ready: reading queries from stdin" << endl;
+        processQueries( stdin, stdout );
+    }
+    else
+        serveUnixSocket( serveTarget );
+}
+
+void SearchServer::serveUnixSocket( const string &socketPath )
+{
+    struct sockaddr_un addr;
+    if ( socketPath.size() >= sizeof( addr.sun_path ) )
+    {
+        Logger::error() << "Error: socket path too long: " << socketPath << endl;
+        exit( -1 );
+    }
+
+    int listenFd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( listenFd < 0 )
+    {
+        perror( "Error: socket" );
+        exit( -1 );
+    }
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    strncpy( addr.sun_path, socketPath.c_str(), sizeof( addr.sun_path ) - 1 );
+    unlink( socketPath.c_str() );
+    if ( bind( listenFd, ( struct sockaddr * )&addr, sizeof( addr ) ) != 0 || listen( listenFd, 16 ) != 0 )
+    {
+        perror( ( "Error: cannot listen on " + socketPath ).c_str() );
+        exit( -1 );
+    }
+    clog << "Ready: listening on " << socketPath << endl;
+
+    // A client disconnecting early shouldn't kill the server
+    signal( SIGPIPE, SIG_IGN );
+
+    // Connections are served one at a time; each query only takes a few rank operations
+    bool shutdownRequested = false;
+    while ( !shutdownRequested )
+    {
+        int fd = accept( listenFd, NULL, NULL );
+        if ( fd < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+            perror( "Error: accept" );
+            break;
+        }
+        FILE *in = fdopen( fd, "r" );
+        FILE *out = fdopen( dup( fd ), "w" );
+        if ( in == NULL || out == NULL )
+        {
+            perror( "Error: fdopen" );
+            exit( -1 );
+        }
+        shutdownRequested = processQueries( in, out );
+        fclose( out );
+        fclose( in );
+    }
+
+    close( listenFd );
+    unlink( socketPath.c_str() );
+}
+
+bool SearchServer::processQueries( FILE *in, FILE *out )
+{
+    char *lineBuf = NULL;
+    size_t lineBufSize = 0;
+    ssize_t lineLength;
+    bool endOfConnection = false;
+    bool shutdownRequested = false;
+
+    while ( !endOfConnection && ( lineLength = getline( &lineBuf, &lineBufSize, in ) ) != -1 )
+    {
+        string line( lineBuf, lineLength );
+        processOneQuery( line, out, endOfConnection, shutdownRequested );
+        fflush( out );
+    }
+    free( lineBuf );
+    return shutdownRequested;
+}
+
+void SearchServer::processOneQuery( const string &line, FILE *out, bool &endOfConnection, bool &shutdownRequested )
+{
+    istringstream iss( line );
+    string command, kmer;
+    if ( !( iss >> command ) )
+        return; // empty line
+
+    if ( command == "quit" )
+    {
+        endOfConnection = true;
+        return;
+    }
+    if ( command == "shutdown" )
+    {
+        endOfConnection = true;
+        shutdownRequested = true;
+        return;
+    }
+
+    if ( command == "count" || command == "locate" )
+    {
+        if ( !( iss >> kmer ) )
+        {
+            fprintf( out, "ERROR missing k-mer\n" );
+            return;
+        }
+    }
+    else
+    {
+        kmer = command;
+        command = "count";
+    }
+
+    for ( unsigned int i = 0; i < kmer.size(); ++i )
+    {
+        if ( whichPile[( int )kmer[i]] <= 0 )
+        {
+            fprintf( out, "ERROR invalid k-mer: %s\n", kmer.c_str() );
+            return;
+        }
+    }
+
+    if ( command == "count" )
+    {
+        LetterNumber pos, num;
+        bwt_->findKmer( kmer, pos, num );
+        fprintf( out, "%s %lu %lu\n", kmer.c_str(), ( unsigned long )pos, ( unsigned long )num );
+    }
+    else
+    {
+        LetterNumber maxOccurrences = maxLetterNumber;
+        unsigned long val;
+        if ( iss >> val )
+            maxOccurrences = val;
+        locate( kmer, maxOccurrences, out );
+    }
+}
+
+void SearchServer::locate( const string &kmer, LetterNumber maxOccurrences, FILE *out )
+{
+    LetterNumber pos, num;
+    bwt_->findKmer( kmer, pos, num );
+    fprintf( out, "%s %lu %lu:", kmer.c_str(), ( unsigned long )pos, ( unsigned long )num );
+
+    const int pileNum = whichPile[( int )kmer[0]];
+    const LetterNumber numToLocate = ( num < maxOccurrences ) ? num : maxOccurrences;
+    for ( LetterNumber i = 0; i < numToLocate; ++i )
+    {
+        SequenceLength offset;
+        if ( sampledSA_ )
+        {
+            SequenceNumber seqNum;
+            sampledSA_->locate( *bwt_, pileNum, pos + i, seqNum, offset );
+            fprintf( out, " %lu:%u", ( unsigned long )seqNum, ( unsigned int )offset );
+            continue;
+        }
+        LetterNumber dollarNum = bwt_->findDollarNum( pileNum, pos + i, offset );
+        if ( endPosFile_ )
+            dollarNum = endPosFile_->convertDollarNumToSequenceNum( dollarNum );
+        fprintf( out, " %lu:%u", ( unsigned long )dollarNum, ( unsigned int )offset );
+    }
+    fprintf( out, "\n" );
+}
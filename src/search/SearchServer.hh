@@ -0,0 +1,63 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef SEARCH_SERVER_HH
+#define SEARCH_SERVER_HH
+
+#include "Algorithm.hh"
+#include "Types.hh"
+
+#include <cstdio>
+#include <string>
+
+using std::string;
+class EndPosFile;
+class RankIndexedBwt;
+class SampledSuffixArray;
+class SearchParameters;
+
+
+// SearchServer: long-running k-mer search service (beetl-search --serve).
+// The BWT piles are mapped and rank-indexed once, then queries are answered
+// over stdin/stdout (--serve=-) or a local UNIX socket (--serve=<path>),
+// using a line protocol:
+//   count <kmer>           -> <kmer> <position> <count>
+//   <kmer>                 -> same as "count <kmer>"
+//   locate <kmer> [<max>]  -> <kmer> <position> <count>: <seqNum>[:<offset>] ...
+//                             (sequence numbers come from <prefix>-sa if present, else from <prefix>-end-pos)
+//   quit                   -> closes the current connection
+//   shutdown               -> stops the server
+// Errors are reported as a single line starting with "ERROR".
+
+class SearchServer : public Algorithm
+{
+public:
+    SearchServer( const SearchParameters &searchParams );
+    virtual ~SearchServer();
+    virtual void run( void );
+
+private:
+    void serveUnixSocket( const string &socketPath );
+
+    // Processes queries until end of input, "quit" or "shutdown".
+    // Returns true if a shutdown was requested.
+    bool processQueries( FILE *in, FILE *out );
+    void processOneQuery( const string &line, FILE *out, bool &endOfConnection, bool &shutdownRequested );
+    void locate( const string &kmer, LetterNumber maxOccurrences, FILE *out );
+
+    const SearchParameters &searchParams_;
+    RankIndexedBwt *bwt_;
+    EndPosFile *endPosFile_;
+    SampledSuffixArray *sampledSA_;
+};
+
+#endif // SEARCH_SERVER_HH
@@ -12,12 +12,14 @@
 
 #include "SearchUsingBacktracker.hh"
 
+#include "BwtRankIndex.hh"
 #include "BwtReader.hh"
 #include "IntervalFile.hh"
 #include "KmerSearchIntervalHandler.hh"
 #include "KmerSearchRange.hh"
 #include "OneBwtBackTracker.hh"
 #include "RangeStore.hh"
+#include "SampledSuffixArray.hh"
 #include "Timer.hh"
 #include "Tools.hh"
 #include "config.h"
@@ -25,6 +27,7 @@
 #include "libzoo/util/Logger.hh"
 
 #include <algorithm>
+#include <memory>
 #include <sstream>
 
 #ifdef _OPENMP
@@ -80,6 +83,12 @@ void SearchUsingBacktracker::run()
         }
     }
 
+    if ( searchParams_["random access"] == 1 )
+    {
+        runUsingRankIndex( kmerList );
+        return;
+    }
+
     SequenceNumber originalIndex = 0;
     for ( auto kmer : kmerList )
     {
@@ -253,3 +262,90 @@ void SearchUsingBacktracker::run()
         }
     }
 }
+
+void SearchUsingBacktracker::runUsingRankIndex( const vector<string> &kmerList )
+{
+    Timer timer;
+    const string bwtPrefix = searchParams_["input"];
+    RankIndexedBwt bwt( bwtPrefix );
+    const bool locateOccurrences = ( searchParams_["locate"] == 1 );
+    unique_ptr<SampledSuffixArray> sampledSA;
+    if ( locateOccurrences )
+    {
+        if ( !readWriteCheck( ( bwtPrefix + "-sa" ).c_str(), false, false ) )
+        {
+            Logger::error() << "Error: --locate needs " << bwtPrefix << "-sa (see beetl-bwt --sa-sampling-rate)" << endl;
+            exit( -1 );
+        }
+        sampledSA.reset( new SampledSuffixArray( bwtPrefix ) );
+    }
+
+    Logger_if( LOG_SHOW_IF_VERBOSE )
+    {
+        Logger::out() << "Rank indexes loaded. time now: " << timer.timeNow();
+        Logger::out() << "   usage: " << timer << endl;
+    }
+
+    // Same output order as the backtracker: sorted by reversed k-mer
+    vector<KmerSearchItem> kmerItems;
+    SequenceNumber originalIndex = 0;
+    for ( auto kmer : kmerList )
+    {
+        std::reverse( kmer.begin(), kmer.end() );
+        kmerItems.push_back( KmerSearchItem( kmer, 0, 0, originalIndex++ ) );
+    }
+    std::sort( kmerItems.begin(), kmerItems.end() );
+
+    // (sequence number, offset) of each occurrence, with --locate
+    vector< vector< pair<SequenceNumber, SequenceLength> > > occurrences( locateOccurrences ? kmerItems.size() : 0 );
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for ( size_t i = 0; i < kmerItems.size(); ++i )
+    {
+        const string &kmer = kmerList[kmerItems[i].originalIndex];
+        bwt.findKmer( kmer, kmerItems[i].position, kmerItems[i].count );
+        if ( locateOccurrences )
+        {
+            const int pileNum = whichPile[( int )kmer[0]];
+            occurrences[i].resize( kmerItems[i].count );
+            for ( LetterNumber j = 0; j < kmerItems[i].count; ++j )
+                sampledSA->locate( bwt, pileNum, kmerItems[i].position + j, occurrences[i][j].first, occurrences[i][j].second );
+        }
+    }
+
+    Logger_if( LOG_SHOW_IF_VERBOSE )
+    {
+        Logger::out() << "Searched " << kmerItems.size() << " k-mers. time now: " << timer.timeNow();
+        Logger::out() << "   usage: " << timer << endl;
+    }
+
+    // Output
+    ostream *outputStreamPtr = &std::cout;
+    string outputFilename = searchParams_["output"];
+    ofstream ofs;
+    if ( outputFilename != "-" )
+    {
+        ofs.open( outputFilename );
+        if ( ofs.good() )
+            outputStreamPtr = &ofs;
+        else
+            cerr << "Warning: Couldn't open output file " << outputFilename << ". Sending output to stdout." << endl;
+    }
+
+    IntervalWriter writer( *outputStreamPtr );
+    for ( size_t i = 0; i < kmerItems.size(); ++i )
+    {
+        IntervalRecord rec( kmerList[kmerItems[i].originalIndex], kmerItems[i].position, kmerItems[i].count );
+        if ( locateOccurrences )
+        {
+            // Same format as the "locate" queries of --serve
+            ostream &os = *outputStreamPtr;
+            os << rec.kmer << ' ' << rec.position << ' ' << rec.count << ':';
+            for ( auto occurrence : occurrences[i] )
+                os << ' ' << occurrence.first << ':' << occurrence.second;
+            os << endl;
+        }
+        else
+            writer.write( rec );
+    }
+}
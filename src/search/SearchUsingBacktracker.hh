@@ -16,8 +16,10 @@
 #include "Algorithm.hh"
 
 #include <string>
+#include <vector>
 
 using std::string;
+using std::vector;
 class SearchParameters;
 
 
@@ -33,6 +35,8 @@ public:
     virtual void run( void );
 
 private:
+    void runUsingRankIndex( const vector<string> &kmerList );
+
     const SearchParameters &searchParams_;
 };
 
@@ -0,0 +1,169 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#include "PhaseProfiler.hh"
+
+#include "libzoo/util/Logger.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+namespace
+{
+
+// rchar and wchar of a /proc/.../io file: bytes passed to read() and write()
+// style syscalls, whether or not they hit the disk. Zero if unavailable.
+void readIoCounters( const char *filename, uint64_t &bytesRead, uint64_t &bytesWritten )
+{
+    bytesRead = bytesWritten = 0;
+    FILE *f = fopen( filename, "r" );
+    if ( f == NULL )
+        return;
+    char line[256];
+    while ( fgets( line, sizeof( line ), f ) )
+    {
+        unsigned long long value;
+        if ( sscanf( line, "rchar: %llu", &value ) == 1 )
+            bytesRead = value;
+        else if ( sscanf( line, "wchar: %llu", &value ) == 1 )
+            bytesWritten = value;
+    }
+    fclose( f );
+}
+
+uint64_t currentRssBytes()
+{
+    unsigned long long totalPages = 0, residentPages = 0;
+    FILE *f = fopen( "/proc/self/statm", "r" );
+    if ( f == NULL )
+        return 0;
+    if ( fscanf( f, "%llu %llu", &totalPages, &residentPages ) != 2 )
+        residentPages = 0;
+    fclose( f );
+    return residentPages * sysconf( _SC_PAGESIZE );
+}
+
+} // anonymous namespace
+
+
+PhaseProfiler::PhaseProfiler( const string &filename, const Format format )
+    : os_( filename.c_str() )
+    , format_( format )
+    , iterationStartTime_( now() )
+{
+    if ( !os_.good() )
+    {
+        Logger::error() << "Error: Cannot write " << filename << endl;
+        exit( EXIT_FAILURE );
+    }
+    if ( format_ == FORMAT_CSV )
+        os_ << "iteration,phase,pile,seconds,bytesRead,bytesWritten,rssBytes" << endl;
+    readIoCounters( "/proc/self/io", iterationStartBytesRead_, iterationStartBytesWritten_ );
+} // ~PhaseProfiler::PhaseProfiler
+
+void PhaseProfiler::add( const char *phase, const int pile, const double seconds, const uint64_t bytesRead, const uint64_t bytesWritten )
+{
+    #pragma omp critical (PHASE_PROFILER)
+    {
+        // Records of a phase are kept together, ordered by pile
+        vector<Record>::iterator it = records_.begin();
+        while ( it != records_.end() && it->phase != phase )
+            ++it;
+        while ( it != records_.end() && it->phase == phase && it->pile < pile )
+            ++it;
+        if ( it == records_.end() || it->phase != phase || it->pile != pile )
+        {
+            Record record = { phase, pile, 0, 0, 0 };
+            it = records_.insert( it, record );
+        }
+        it->seconds += seconds;
+        it->bytesRead += bytesRead;
+        it->bytesWritten += bytesWritten;
+    }
+} // ~PhaseProfiler::add
+
+void PhaseProfiler::endIteration( const unsigned int iteration )
+{
+    const double endTime = now();
+    uint64_t bytesRead, bytesWritten;
+    readIoCounters( "/proc/self/io", bytesRead, bytesWritten );
+    const uint64_t rssBytes = currentRssBytes();
+
+    for ( unsigned int i = 0; i < records_.size(); ++i )
+        writeRecord( iteration, records_[i], rssBytes );
+    const Record total = { "iteration", -1, endTime - iterationStartTime_, bytesRead - iterationStartBytesRead_, bytesWritten - iterationStartBytesWritten_ };
+    writeRecord( iteration, total, rssBytes );
+    os_.flush();
+
+    records_.clear();
+    iterationStartTime_ = endTime;
+    iterationStartBytesRead_ = bytesRead;
+    iterationStartBytesWritten_ = bytesWritten;
+} // ~PhaseProfiler::endIteration
+
+void PhaseProfiler::writeRecord( const unsigned int iteration, const Record &record, const uint64_t rssBytes )
+{
+    if ( format_ == FORMAT_JSON )
+        os_ << "{\"iteration\":" << iteration << ",\"phase\":\"" << record.phase << "\",\"pile\":" << record.pile
+            << ",\"seconds\":" << record.seconds << ",\"bytesRead\":" << record.bytesRead << ",\"bytesWritten\":" << record.bytesWritten
+            << ",\"rssBytes\":" << rssBytes << "}\n";
+    else
+        os_ << iteration << "," << record.phase << "," << record.pile << "," << record.seconds << ","
+            << record.bytesRead << "," << record.bytesWritten << "," << rssBytes << "\n";
+} // ~PhaseProfiler::writeRecord
+
+double PhaseProfiler::now()
+{
+    timeval t;
+    gettimeofday( &t, NULL );
+    return t.tv_sec + t.tv_usec / 1000000.0;
+} // ~PhaseProfiler::now
+
+
+PhaseProfiler::Scope::Scope( PhaseProfiler *profiler, const char *phase, const int pile )
+    : profiler_( profiler )
+    , phase_( phase )
+    , pile_( pile )
+    , startTime_( now() )
+    , startBytesRead_( 0 )
+    , startBytesWritten_( 0 )
+{
+    if ( profiler_ )
+        readIoCounters( "/proc/thread-self/io", startBytesRead_, startBytesWritten_ );
+} // ~PhaseProfiler::Scope::Scope
+
+PhaseProfiler::Scope::~Scope()
+{
+    stop();
+} // ~PhaseProfiler::Scope::~Scope
+
+void PhaseProfiler::Scope::stop()
+{
+    if ( profiler_ )
+    {
+        uint64_t bytesRead, bytesWritten;
+        readIoCounters( "/proc/thread-self/io", bytesRead, bytesWritten );
+        profiler_->add( phase_, pile_, elapsedSeconds(), bytesRead - startBytesRead_, bytesWritten - startBytesWritten_ );
+        profiler_ = NULL;
+    }
+} // ~PhaseProfiler::Scope::stop
+
+double PhaseProfiler::Scope::elapsedSeconds() const
+{
+    return now() - startTime_;
+} // ~PhaseProfiler::Scope::elapsedSeconds
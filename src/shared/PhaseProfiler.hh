@@ -0,0 +1,93 @@
+/**
+ ** Copyright (c) 2011-2014 Illumina, Inc.
+ **
+ ** This file is part of the BEETL software package,
+ ** covered by the "BSD 2-Clause License" (see accompanying LICENSE file)
+ **
+ ** Citation: Markus J. Bauer, Anthony J. Cox and Giovanna Rosone
+ ** Lightweight BWT Construction for Very Large String Collections.
+ ** Proceedings of CPM 2011, pp.219-231
+ **
+ **/
+
+#ifndef INCLUDED_PHASE_PROFILER
+#define INCLUDED_PHASE_PROFILER
+
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+// Class Name : PhaseProfiler
+// Description: Machine-readable timings of the phases of each iteration, one
+// record per (iteration, phase, pile) written as JSON lines or CSV:
+//   iteration, phase, pile (-1 when not pile-specific), seconds, bytesRead, bytesWritten, rssBytes
+// Bytes are the read()/write() volumes of the thread running the phase, taken
+// from /proc/thread-self/io, so that I/O-bound phases can be told apart from
+// CPU-bound ones. Seconds of per-pile phases are summed over their threads.
+// Each iteration ends with an "iteration" record holding its wall time and the
+// I/O of the whole process.
+class PhaseProfiler
+{
+public:
+    enum Format
+    {
+        FORMAT_JSON,
+        FORMAT_CSV
+    };
+
+    PhaseProfiler( const string &filename, const Format format );
+
+    // Adds to the totals of (phase, pile) for the current iteration. Thread-safe.
+    void add( const char *phase, const int pile, const double seconds, const uint64_t bytesRead = 0, const uint64_t bytesWritten = 0 );
+
+    // Writes the records of the iteration and starts a new one
+    void endIteration( const unsigned int iteration );
+
+    // Wall clock in seconds
+    static double now();
+
+    // Measures a scope and adds it to the profiler, if there is one
+    class Scope
+    {
+    public:
+        Scope( PhaseProfiler *profiler, const char *phase, const int pile = -1 );
+        ~Scope();
+        void stop(); // ends the measurement before the end of the scope
+        double elapsedSeconds() const;
+
+    private:
+        PhaseProfiler *profiler_;
+        const char *phase_;
+        const int pile_;
+        double startTime_;
+        uint64_t startBytesRead_;
+        uint64_t startBytesWritten_;
+    };
+
+private:
+    struct Record
+    {
+        string phase;
+        int pile;
+        double seconds;
+        uint64_t bytesRead;
+        uint64_t bytesWritten;
+    };
+
+    void writeRecord( const unsigned int iteration, const Record &record, const uint64_t rssBytes );
+
+    std::ofstream os_;
+    const Format format_;
+    vector<Record> records_;
+    double iterationStartTime_;
+    uint64_t iterationStartBytesRead_;
+    uint64_t iterationStartBytesWritten_;
+}; // PhaseProfiler
+
+#endif
+// end of PhaseProfiler.hh
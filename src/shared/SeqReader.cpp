@@ -12,12 +12,18 @@
 
 #include "SeqReader.hh"
 
+#include "libzoo/io/CompressedInputStream.hh"
 #include "libzoo/util/Logger.hh"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace std;
 
@@ -38,17 +44,46 @@ SeqReaderBase::~SeqReaderBase() {}
 //
 
 SeqReaderFile::SeqReaderFile( FILE *pFile ) :
-    pFile_( pFile ), allRead_( false ), length_( -1 )
+    pFile_( pFile ), ownsFile_( false ), allRead_( false ), length_( -1 )
 {
     bufSeq_[0]  = 0;
     bufQual_[0] = 0;
     bufName_[0] = 0;
 }
 
-SeqReaderFile::~SeqReaderFile() {}
+SeqReaderFile::~SeqReaderFile()
+{
+    if ( ownsFile_ )
+        fclose( pFile_ );
+}
 
 
 SeqReaderFile *SeqReaderFile::getReader( FILE *pFile )
+{
+    unsigned char magic[compressionMagicSize];
+    const size_t magicSize = readMagicBytes( pFile, magic, sizeof( magic ) );
+    if ( isGzipMagic( magic, magicSize ) )
+    {
+        Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Input is gzip-compressed" << endl;
+        SeqReaderFile *pReader = getUncompressedReader( openGzipDecompressingStream( pFile, magic, magicSize ) );
+        pReader->ownsFile_ = true;
+        return pReader;
+    }
+    else if ( isZstdMagic( magic, magicSize ) )
+    {
+        Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Input is zstd-compressed" << endl;
+        SeqReaderFile *pReader = getUncompressedReader( openZstdDecompressingStream( pFile, magic, magicSize ) );
+        pReader->ownsFile_ = true;
+        return pReader;
+    }
+
+    FILE *pUncompressedFile = unreadBytes( pFile, magic, magicSize );
+    SeqReaderFile *pReader = getUncompressedReader( pUncompressedFile );
+    pReader->ownsFile_ = ( pUncompressedFile != pFile );
+    return pReader;
+} // ~getReader
+
+SeqReaderFile *SeqReaderFile::getUncompressedReader( FILE *pFile )
 {
     int i( fgetc( pFile ) );
     char c( ( char )i ); // TBD check for error condition
@@ -71,7 +106,7 @@ SeqReaderFile *SeqReaderFile::getReader( FILE *pFile )
                         << i << " )" << endl;
         exit( EXIT_FAILURE );
     } // ~else
-} // ~getReader
+} // ~getUncompressedReader
 
 void SeqReaderFile::rewindFile()
 {
@@ -280,3 +315,187 @@ void SeqReaderFastq::readNext( char *seqBuf )
 
 
 
+//
+// SeqReaderMmap member function definitions
+//
+
+SeqReaderMmap *SeqReaderMmap::open( const string &filename )
+{
+    const int fd = ::open( filename.c_str(), O_RDONLY );
+    if ( fd == -1 )
+        return NULL;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if ( fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) && st.st_size > 0 )
+        data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if ( data == MAP_FAILED )
+        return NULL;
+
+    const unsigned char *magic = static_cast<const unsigned char *>( data );
+    const size_t magicSize = min( ( size_t )st.st_size, compressionMagicSize );
+    if ( isGzipMagic( magic, magicSize ) || isZstdMagic( magic, magicSize ) )
+    {
+        munmap( data, st.st_size );
+        return NULL;
+    }
+    madvise( data, st.st_size, MADV_SEQUENTIAL );
+    Logger_if( LOG_SHOW_IF_VERBOSE ) Logger::out() << "Memory-mapping input file " << filename << endl;
+    return new SeqReaderMmap( static_cast<const char *>( data ), st.st_size );
+}
+
+SeqReaderMmap::SeqReaderMmap( const char *data, const size_t size )
+    : data_( data )
+    , end_( data + size )
+    , next_( data )
+    , format_( data[0] )
+    , allRead_( false )
+    , length_( -1 )
+{
+    Logger_if( LOG_SHOW_IF_VERY_VERBOSE ) Logger::out() << "Creating SeqReaderMmap" << endl;
+    const Line emptyLine = { "", 0 };
+    seq_ = qual_ = name_ = emptyLine;
+    if ( format_ != '>' && format_ != '@' && whichPile[( int )format_] == nv )
+    {
+        Logger::error() << "Error: Unable to deduce file type from first char (char code = "
+                        << ( int )format_ << " )" << endl;
+        exit( EXIT_FAILURE );
+    }
+    readNext();
+    if ( allRead() == true )
+    {
+        Logger::error() << "Error: No sequences in file!" << endl;
+        exit( EXIT_FAILURE );
+    }
+    length_ = seq_.length;
+    Logger_if( LOG_SHOW_IF_VERY_VERBOSE ) Logger::out() << "Deducing read length of " << length_ << endl;
+}
+
+SeqReaderMmap::~SeqReaderMmap()
+{
+    munmap( const_cast<char *>( data_ ), end_ - data_ );
+}
+
+const char *SeqReaderMmap::nextLine( const char *p, const char *&lineEnd ) const
+{
+    lineEnd = static_cast<const char *>( memchr( p, '\n', end_ - p ) );
+    if ( lineEnd == NULL )
+    {
+        lineEnd = end_;
+        return end_;
+    }
+    return lineEnd + 1;
+}
+
+void SeqReaderMmap::readNext( char *seqBuf )
+{
+    if ( allRead_ == true )
+    {
+        Logger::error() << "Error: Tried to read an empty sequence stream" << endl;
+        exit( EXIT_FAILURE );
+    }
+    if ( next_ == end_ )
+    {
+        allRead_ = true;
+        return;
+    }
+
+    const char *lineEnd;
+    const char *p = next_;
+    if ( format_ == '>' || format_ == '@' )
+    {
+        if ( *p != format_ )
+        {
+            Logger::error() << "Error: Expected " << ( format_ == '>' ? "FASTA" : "FASTQ" ) << " header at offset " << ( p - data_ ) << endl;
+            exit( EXIT_FAILURE );
+        }
+        name_.data = p;
+        p = nextLine( p, lineEnd );
+        name_.length = lineEnd - name_.data;
+        if ( p == end_ )
+        {
+            Logger::error() << "Error: read header with no entry, incomplete file?" << endl;
+            exit( EXIT_FAILURE );
+        }
+    }
+    seq_.data = p;
+    p = nextLine( p, lineEnd );
+    seq_.length = lineEnd - seq_.data;
+    if ( length_ != -1 && seq_.length != ( size_t )length_ )
+    {
+        Logger::error() << "Error: Length of current sequence does not match length of first at offset " << ( seq_.data - data_ ) << endl;
+        exit( EXIT_FAILURE );
+    }
+    if ( format_ == '@' )
+    {
+        if ( p == end_ || *p != '+' )
+        {
+            Logger::error() << "Error: Expected FASTQ quality spacer at offset " << ( p - data_ ) << ", incomplete file?" << endl;
+            exit( EXIT_FAILURE );
+        }
+        p = nextLine( p, lineEnd );
+        if ( p == end_ )
+        {
+            Logger::error() << "Error: Could not read FASTQ quality string, incomplete file?" << endl;
+            exit( EXIT_FAILURE );
+        }
+        qual_.data = p;
+        p = nextLine( p, lineEnd );
+        qual_.length = lineEnd - qual_.data;
+    }
+    next_ = p;
+
+    if ( seqBuf )
+    {
+        if ( seq_.length > maxSeqSize - 2 )
+        {
+            Logger::error() << "Error: Sequence at offset " << ( seq_.data - data_ ) << " is longer than the maximum of " << ( maxSeqSize - 2 ) << " letters" << endl;
+            exit( EXIT_FAILURE );
+        }
+        memcpy( seqBuf, seq_.data, seq_.length );
+        seqBuf[seq_.length] = '\n';
+        seqBuf[seq_.length + 1] = '\0';
+    }
+} // ~Mmap::readNext
+
+const char *SeqReaderMmap::copyLine( const Line &line, string &copy ) const
+{
+    copy.assign( line.data, line.length );
+    if ( line.length != 0 )
+        copy += '\n';
+    return copy.c_str();
+}
+
+const char *SeqReaderMmap::thisSeq( void )
+{
+    return copyLine( seq_, seqCopy_ );
+}
+const char *SeqReaderMmap::thisQual( void )
+{
+    return copyLine( qual_, qualCopy_ );
+}
+const char *SeqReaderMmap::thisName( void )
+{
+    return copyLine( name_, nameCopy_ );
+}
+
+SeqReaderMmap::Line SeqReaderMmap::seqLine( void ) const
+{
+    return seq_;
+}
+SeqReaderMmap::Line SeqReaderMmap::qualLine( void ) const
+{
+    return qual_;
+}
+SeqReaderMmap::Line SeqReaderMmap::nameLine( void ) const
+{
+    return name_;
+}
+bool SeqReaderMmap::allRead( void ) const
+{
+    return allRead_;
+}
+int SeqReaderMmap::length( void ) const
+{
+    return length_;
+}
@@ -38,6 +38,8 @@ public:
 class SeqReaderFile : public SeqReaderBase
 {
 public:
+    // Deduces the file format from its first character.
+    // gzip/BGZF- and zstd-compressed input is decompressed on the fly.
     static SeqReaderFile *getReader( FILE *pFile );
 
 
@@ -51,8 +53,18 @@ public:
     virtual bool allRead( void ) const;
     virtual int length( void ) const;
     void rewindFile();
+
+    // Direct access to the (decompressed) stream, positioned after the current entry
+    FILE *file( void ) const
+    {
+        return pFile_;
+    }
+
 protected:
+    static SeqReaderFile *getUncompressedReader( FILE *pFile );
+
     FILE *pFile_;
+    bool ownsFile_;
     char bufSeq_[1 + maxSeqSize];
     char bufQual_[1 + maxSeqSize];
     char bufName_[1 + maxSeqSize];
@@ -101,6 +113,78 @@ public:
 };
 
 
+// SeqReaderMmap: reads an uncompressed raw, FASTA or FASTQ file through a
+// read-only memory mapping. Entries are not copied: seqLine() and co. give
+// them as pointer+length into the mapping, NOT '\0'-terminated (the quality
+// line is empty for formats without qualities). The SeqReaderBase accessors
+// copy the requested line, for the code needing C strings.
+// Line ends are found with memchr, which the C library vectorises.
+class SeqReaderMmap : public SeqReaderBase
+{
+public:
+    struct Line
+    {
+        const char *data;
+        size_t length;
+    };
+
+    // Returns NULL if the file can't be mapped (not a regular file, empty or compressed)
+    static SeqReaderMmap *open( const std::string &filename );
+    virtual ~SeqReaderMmap();
+
+    // If seqBuf (of maxSeqSize bytes) is given, the sequence line is copied there with a '\n' and a '\0'
+    virtual void readNext( char *seqBuf = NULL );
+    virtual const char *thisSeq( void );
+    virtual const char *thisQual( void );
+    virtual const char *thisName( void );
+    virtual bool allRead( void ) const;
+    virtual int length( void ) const;
+
+    Line seqLine( void ) const;
+    Line qualLine( void ) const;
+    Line nameLine( void ) const;
+
+    bool isFasta( void ) const
+    {
+        return format_ == '>';
+    }
+    bool isFastq( void ) const
+    {
+        return format_ == '@';
+    }
+
+    // Data following the current entry, up to the end of the file
+    const char *nextData( void ) const
+    {
+        return next_;
+    }
+    const char *dataEnd( void ) const
+    {
+        return end_;
+    }
+
+private:
+    SeqReaderMmap( const char *data, const size_t size );
+
+    // Returns the start of the next line, sets lineEnd to the '\n' (or end of file)
+    const char *nextLine( const char *p, const char *&lineEnd ) const;
+
+    // Copies a non-empty line with its '\n', as the SeqReaderFile readers keep it
+    const char *copyLine( const Line &line, std::string &copy ) const;
+
+    const char *data_;
+    const char *end_;
+    const char *next_;
+    char format_; // first character: '>', '@' or a base for raw sequences
+    Line seq_;
+    Line qual_;
+    Line name_;
+    bool allRead_;
+    int length_;
+    std::string seqCopy_;
+    std::string qualCopy_;
+    std::string nameCopy_;
+};
 
 
 #endif
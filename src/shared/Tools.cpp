@@ -15,6 +15,7 @@
 #include "Tools.hh"
 
 #include "Alphabet.hh"
+#include "libzoo/io/CompressedInputStream.hh"
 #include "libzoo/util/Logger.hh"
 
 #include <cstdlib>
@@ -475,6 +476,6 @@ shared_ptr<istream> openInputFileOrDashAsCin( const string &filename )
     if ( filename == "-" )
         input.reset( &cin, emptyDeleter() );
     else
-        input.reset( new ifstream( filename.c_str() ) );
+        input.reset( openPossiblyCompressedInputFile( filename ) );
     return input;
 }
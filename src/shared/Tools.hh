@@ -36,7 +36,6 @@ using std::vector;
 //#define deletePartialSA 0 //If it is set to 1, it deletes the SA-segments files and keeps the entire BWT, otherwise renames them.
 #define deleteCycFile 1  //If it is set to 1, it deletes the cycs files.
 #define BUILD_SA 0   //If it is set to 1, it computes the GSA (seqID, position) and the SA (position of the concatenated sequences without a further end-marker).
-#define BUILD_LCP 0	//If it is set to 1, it uses larger structures to allow --generate-lcp
 
 class Tools
 {